@@ -52,11 +52,12 @@
 #include "cmd.h"
 
 #include <ctype.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "appConfig.h"
-#include "cJSON.h"
+#include "json_tok.h"
 #include "cmd_fn.h"
 #include "reporter.h"
 #include "usb_uart_tx.h"
@@ -67,16 +68,245 @@
  */
 
 
-/* We want cJSON to use a definitive malloc/free */
-static const cJSON_Hooks sCmdcJSON_hooks = {
-    .malloc_fn = CMD_MALLOC,
-    .free_fn = CMD_FREE};
+/* JSON commands are tokenized in place, in a fixed token array */
+#define CMD_JSON_TOKENS 32
+
+static json_tok_t cmd_json_tokens[CMD_JSON_TOKENS];
+
+
+/* Dispatch index of the known commands, built on the first command:
+ * open addressing over a case-insensitive FNV-1a hash of the name.
+ * The section sizes are only known at link time, so with more commands than
+ * the index can hold the parser falls back to scanning the sections. */
+#define CMD_INDEX_SIZE 128 /**< power of 2, at least 4/3 of the number of commands */
+
+struct cmd_index_s
+{
+    const command_t *cmd;
+    uint32_t apps; /**< bit n: sub-command of the n-th entry of .known_apps */
+};
+
+static struct cmd_index_s cmd_index[CMD_INDEX_SIZE];
+static enum { CMD_INDEX_NONE = 0, CMD_INDEX_READY, CMD_INDEX_FULL } cmd_index_state;
+
+static uint32_t cmd_allocs; /**< CMD_MALLOC() calls */
+
+
+static uint32_t cmd_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+
+    while (*name && !isspace((unsigned char)*name))
+    {
+        h = (h ^ (uint8_t)toupper((unsigned char)*name++)) * 16777619u;
+    }
+    return h;
+}
+
+/* @brief   compares a command name to the first word of text, ignoring the case
+ * */
+static bool cmd_name_equal(const char *name, const char *text)
+{
+    while (*name && toupper((unsigned char)*text) == *name)
+    {
+        name++;
+        text++;
+    }
+    return (*name == 0) && (*text == 0 || isspace((unsigned char)*text));
+}
+
+static struct cmd_index_s *cmd_index_slot(const char *name)
+{
+    uint32_t i = cmd_hash(name);
+
+    for (int n = 0; n < CMD_INDEX_SIZE; n++, i++)
+    {
+        struct cmd_index_s *slot = &cmd_index[i & (CMD_INDEX_SIZE - 1)];
+
+        if (slot->cmd == NULL || cmd_name_equal(slot->cmd->name, name))
+        {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* @fn      cmd_index_build
+ * @brief   indexes the known commands and precomputes which applications
+ *          they are a sub-command of.
+ *          The first of several commands with the same name is kept, as the scan did.
+ * */
+static void cmd_index_build(void)
+{
+    int n = 0;
+    const command_t *cmd;
+    const app_definition_t *app;
+
+    memset(cmd_index, 0, sizeof(cmd_index));
+    cmd_index_state = CMD_INDEX_FULL;
+
+    for (cmd = KNOWN_COMMANDS_START; cmd < KNOWN_COMMANDS_END; cmd++)
+    {
+        struct cmd_index_s *slot;
+
+        if (cmd->name == NULL)
+        {
+            continue;
+        }
+        if (++n > (CMD_INDEX_SIZE * 3 / 4) || (slot = cmd_index_slot(cmd->name)) == NULL)
+        {
+            return;
+        }
+        if (slot->cmd == NULL)
+        {
+            slot->cmd = cmd;
+        }
+    }
+
+    for (app = KNOWN_APPS_START; app < KNOWN_APPS_END; app++)
+    {
+        const command_t *sub_cmd = app->sub_command;
+        int bit = app - KNOWN_APPS_START;
+
+        if (bit >= 32)
+        {
+            return;
+        }
+
+        while (sub_cmd != NULL)
+        {
+            struct cmd_index_s *slot = (sub_cmd->name) ? (cmd_index_slot(sub_cmd->name)) : (NULL);
+
+            if (slot && slot->cmd == sub_cmd)
+            {
+                slot->apps |= (1UL << bit);
+            }
+            if (sub_cmd->mode & APP_LAST_SUB_CMD)
+            {
+                break;
+            }
+            sub_cmd++;
+        }
+    }
+
+    cmd_index_state = CMD_INDEX_READY;
+}
+
+/* @brief   the sub-commands of apps which are not in .known_apps are checked with a walk
+ * */
+static bool cmd_is_sub_command(const app_definition_t *app, const command_t *cmd)
+{
+    const command_t *sub_cmd = app->sub_command;
+
+    while (sub_cmd != NULL)
+    {
+        if (sub_cmd == cmd)
+        {
+            return true;
+        }
+        if (sub_cmd->mode & APP_LAST_SUB_CMD)
+        {
+            break;
+        }
+        sub_cmd++;
+    }
+    return false;
+}
+
+/* @fn      command_lookup
+ * @brief   finds the command name, the first word of text, in the known commands
+ * @param   allowed - set if the command may run in the current application
+ * @return  the command, NULL if it is unknown
+ * */
+const command_t *command_lookup(const char *text, bool *allowed)
+{
+    const app_definition_t *app = AppGet();
+    const command_t *cmd = NULL;
+    uint32_t apps = 0;
+
+    if (cmd_index_state == CMD_INDEX_NONE)
+    {
+        cmd_index_build();
+    }
+
+    if (cmd_index_state == CMD_INDEX_READY)
+    {
+        struct cmd_index_s *slot = cmd_index_slot(text);
+
+        if (slot && slot->cmd)
+        {
+            cmd = slot->cmd;
+            apps = slot->apps;
+        }
+    }
+    else
+    {
+        for (const command_t *c = KNOWN_COMMANDS_START; c < KNOWN_COMMANDS_END; c++)
+        {
+            if (c->name && cmd_name_equal(c->name, text))
+            {
+                cmd = c;
+                break;
+            }
+        }
+    }
+
+    if (cmd == NULL)
+    {
+        return NULL;
+    }
+
+    /* Check the command mode. to define the execution permission*/
+    switch (cmd->mode & mMASK)
+    {
+    /* If it is an anytime command then launch it */
+    case mANY:
+        *allowed = true;
+        return cmd;
+    /* If it is an app then check the current running app mode */
+    case mIDLE:
+        if (app->app_mode == mIDLE)
+        {
+            *allowed = true;
+            return cmd;
+        }
+        break;
+    default:
+        break;
+    }
+
+    /* Check if the command is a sub command of the running application*/
+    if (app->sub_command != NULL)
+    {
+        if (cmd_index_state == CMD_INDEX_READY &&
+            app >= KNOWN_APPS_START && app < KNOWN_APPS_END)
+        {
+            *allowed = (apps >> (app - KNOWN_APPS_START)) & 1;
+        }
+        else
+        {
+            *allowed = cmd_is_sub_command(app, cmd);
+        }
+    }
+
+    return cmd;
+}
 
 
 /* IMPLEMENTATION */
-void command_parser_init(void)
+
+/* @fn      cmd_malloc
+ * @brief   malloc() of the commands, counted for the cost per command
+ * */
+void *cmd_malloc(size_t size)
 {
-    cJSON_InitHooks((cJSON_Hooks *)&sCmdcJSON_hooks);
+    cmd_allocs++;
+    return malloc(size);
+}
+
+uint32_t cmd_get_allocs(void)
+{
+    return cmd_allocs;
 }
 
 /*
@@ -101,27 +331,82 @@ static void cmd_onERROR(const char *err)
 }
 
 
+/* @fn      command_execute
+ * @brief   checks if the command line "text" is a known "COMMAND" or "PARAMETER VALUE",
+ *          checks its execution permissions and executes it
+ * @param   reply - the reply of the command, NULL if it failed
+ * @return  _COMMAND_ALLOWED if the command was executed
+ * */
+command_e command_execute(char *text, const char **reply)
+{
+    command_e equal = _NO_COMMAND;
+    int val = 0;
+    json_cmd_t json_cmd;
+    const json_cmd_t *json_params = NULL;
+    char cmd[20];
+
+    cmd[0] = 0; // Initialize no command
+    *reply = NULL;
+
+    if (*text == '{')
+    { // Probably a Json command
+        int n = json_tok_parse(text, strlen(text), cmd_json_tokens, CMD_JSON_TOKENS);
+        if (n > 0)
+        {                                                                    // Got valid Json command
+            int name = json_tok_find(text, cmd_json_tokens, n, 0, CMD_NAME); // Get command name
+            if (name > 0 && cmd_json_tokens[name].type == JSON_TOK_STRING)
+            {                                                                  // Got right command name
+                json_cmd.js = text;
+                json_cmd.tokens = cmd_json_tokens;
+                json_cmd.n_tokens = n;
+                json_cmd.params = json_tok_find(text, cmd_json_tokens, n, 0, CMD_PARAMS); // Get command params
+                if (json_cmd.params > 0)
+                { // We have a Json so we need to update command.
+                    char name_str[20];
+                    json_tok_copy(text, &cmd_json_tokens[name], name_str, sizeof(name_str));
+                    sscanf(name_str, "%9s", cmd);
+                    json_params = &json_cmd;
+                }
+            }
+        }
+    }
+    else
+    { // It is not a Json command
+        sscanf(text, "%9s %d", cmd, &val);
+    }
+
+    /* Look the command up in the __known_command sections */
+    bool allowed = false;
+    const command_t *cmd_found = command_lookup(cmd, &allowed);
+
+    if (cmd_found)
+    {
+        known_commands = (command_t *)cmd_found;
+        equal = (allowed) ? (_COMMAND_ALLOWED) : (_COMMAND_FOUND);
+    }
+
+    if (equal == _COMMAND_ALLOWED)
+    {
+        /* execute corresponded fn() */
+        *reply = known_commands->fn(text, NULL, val, json_params);
+    }
+
+    return equal;
+}
+
 /* @fn      command_parser
- * @brief   checks if input "text" string in known "COMMAND" or "PARAMETER VALUE" format,
- *          checks their execution permissions, a VALUE range if restrictions and
- *          executes COMMAND or sets the PARAMETER to the VALUE
+ * @brief   executes the commands of the input "text", one per line,
+ *          and prints their replies
  * */
 void command_parser(usb_data_e res, char *text)
 {
     char *temp_str = text;
-    command_e equal;
-    int val;
-    cJSON *json_root, *json_params;
-    char cmd[20];
     const char *ret;
 
-    extern uint32_t __known_commands_start;
-    extern uint32_t __known_commands_end;
-
     if (res != COMMAND_READY)
         return;
 
-    known_commands = (command_t *)&__known_commands_start;
+    known_commands = KNOWN_COMMANDS_START;
 
     while (*temp_str)
     {
@@ -132,102 +417,19 @@ void command_parser(usb_data_e res, char *text)
     /* Assume text may have more than one command inside.
      * For example "getKLIST\nnode 0\n" : this will execute 2 commands.
      * */
-    text = strtok(text, "\n"); // get first token
+    char *save;
+
+    text = strtok_r(text, "\n", &save); // get first token, reentrant: a command may run commands
 
     while (text != NULL)
     {
-        equal = _NO_COMMAND;
-        json_params = NULL;
-        json_root = NULL;
-        cmd[0] = 0; // Initialize no command
-
-        if (*text == '{')
-        { // Probably a Json command
-            json_root = cJSON_Parse(text);
-            if (json_root != NULL)
-            {                                                                     // Got valid Json command
-                temp_str = cJSON_GetObjectItem(json_root, CMD_NAME)->valuestring; // Get command name
-                if (temp_str != NULL)
-                {                                                             // Got right command name
-                    json_params = cJSON_GetObjectItem(json_root, CMD_PARAMS); // Get command params
-                    if (json_params != NULL)
-                    { // We have a Json so we need to update command.
-                        sscanf(temp_str, "%9s", cmd);
-                    }
-                }
-            }
-        }
-        else
-        { // It is not a Json command
-            sscanf(text, "%9s %d", cmd, &val);
-        }
-
-
-        /* Scan for known applications in the __known_command section*/
-        for(known_commands = (command_t*)&__known_commands_start; known_commands < (command_t*)&__known_commands_end; known_commands++)
-        {
-            if (known_commands->name && strcmp(cmd, known_commands->name) == 0)
-            {
-                equal = _COMMAND_FOUND;
-
-                /* Check the command mode. to define the execution permission*/
-                uint32_t mode = known_commands->mode & mMASK;
-
-                switch (mode)
-                {
-                /* If it is an anytime command then launch it */
-                case mANY:
-                    equal = _COMMAND_ALLOWED;
-                    break;
-                /* If it is an app then check the current running app mode */
-                case mIDLE:
-                    if (mode == AppGet()->app_mode)
-                    {
-                        equal = _COMMAND_ALLOWED;
-                    }
-                    break;
-                /* If it is a subcommand then check is done later*/
-                case mAPP:
-                    break;
-
-                default:
-                    break;
-                }
-                /* At this stage the command is not allowed to execute
-                Check if the command is a sub command of the running application*/
-                const struct command_s *sub_cmd = AppGet()->sub_command;
-                if (sub_cmd != NULL)
-                {
-                    while (equal != _COMMAND_ALLOWED)
-                    {
-                        if (sub_cmd == known_commands)
-                        {
-                            /* The command is a subcommand of the running app*/
-                            equal = _COMMAND_ALLOWED;
-                            break;
-                        }
-                        if (sub_cmd->mode & APP_LAST_SUB_CMD)
-                        {
-                            /* Check if it is the last */
-                            break;
-                        }
-                        sub_cmd++;
-                    }
-                }
-                break;
-            }
-        }
-
-        switch (equal)
+        switch (command_execute(text, &ret))
         {
         case (_COMMAND_FOUND): {
             cmd_onERROR(" incompatible mode");
             break;
         }
         case (_COMMAND_ALLOWED): {
-            /* execute corresponded fn() */
-            ret = known_commands->fn(text, NULL, val,json_params);
-
             if (ret)
             {
                 reporter_instance.print((char *)ret, strlen(ret));
@@ -242,12 +444,7 @@ void command_parser(usb_data_e res, char *text)
             break;
         }
 
-        if (json_root != NULL)
-        {
-            cJSON_Delete(json_root);
-        }
-
-        text = strtok(NULL, "\n");
+        text = strtok_r(NULL, "\n", &save);
     }
 }
 
@@ -78,6 +78,8 @@ typedef enum
  *             and executes COMMAND or set the PARAMETER to the VALUE
  * */
 void command_parser(usb_data_e res, char *text);
+command_e command_execute(char *text, const char **reply);
+const struct command_s *command_lookup(const char *text, bool *allowed);
 
 usb_data_e waitForCommand(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size);
 
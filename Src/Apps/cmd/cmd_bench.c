@@ -0,0 +1,218 @@
+/**
+ * @file      cmd_bench.c
+ *
+ * @brief     Benchmark of the command path: the parser, the dispatch and the handlers
+ *
+ *            A recorded session is fed to the parser of no host, by chunks of a USB packet,
+ *            and its commands are executed. Their output is formatted and then dropped,
+ *            so that the transport is not measured. The RX mode feeds random bytes to the
+ *            parser only, without executing anything.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmd.h"
+#include "cmd_fn.h"
+#include "cmd_resp.h"
+#include "usb_uart_rx.h"
+#include "usb_uart_tx.h"
+#include "HAL_cycles.h"
+
+#define BENCH_CHUNK     64   /**< bytes given to the parser at once, as a USB packet */
+#define BENCH_LOOPS_MAX 1000 /**< longest run, the control task is busy meanwhile */
+
+/* A session of commands which only show their settings, as a host polls them */
+static const char bench_session[] =
+    "TXSTAT\r"
+    "TXFLUSH\r"
+    "BOOT\r"
+    "UWBCFG\r"
+    "TXPOWER\r"
+    "STSKEYIV\r"
+    "DECA$\r"
+    "{\"CMD_NAME\":\"TXSTAT\",\"CMD_PARAMS\":{}}\r\n"
+    "PDOAOFF\r";
+
+static uint8_t bench_out[RX_FEED_OUT_SIZE(BENCH_CHUNK)];
+
+struct bench_res_s
+{
+    uint32_t cmds;   /**< commands found by the parser */
+    uint32_t bytes;  /**< bytes fed to the parser */
+    uint32_t allocs; /**< CMD_MALLOC() calls */
+    uint32_t errors; /**< outputs of the parser which overran */
+    uint64_t cycles;
+};
+
+/* @brief   commands in the output of the parser, which shall fit in bench_out
+ * */
+static int bench_count(struct bench_res_s *res)
+{
+    int n = 0;
+
+    for (int i = 0; i < (int)sizeof(bench_out); i++)
+    {
+        if (bench_out[i] == 0)
+        {
+            return n;
+        }
+        n += (bench_out[i] == '\n');
+    }
+    res->errors++;
+    return 0;
+}
+
+static void bench_session_run(struct bench_res_s *res, int loops)
+{
+    for (int loop = 0; loop < loops; loop++)
+    {
+        for (int off = 0; off < (int)sizeof(bench_session) - 1; off += BENCH_CHUNK)
+        {
+            int len = sizeof(bench_session) - 1 - off;
+            uint32_t start = hal_cycles_get();
+
+            len = (len < BENCH_CHUNK) ? (len) : (BENCH_CHUNK);
+
+            if (usb_uart_rx_feed(PORT_ITF_DEFAULT, (const uint8_t *)&bench_session[off], len, bench_out) == COMMAND_READY)
+            {
+                res->cmds += bench_count(res);
+                command_parser(COMMAND_READY, (char *)bench_out);
+            }
+
+            res->cycles += hal_cycles_get() - start;
+            res->bytes += len;
+        }
+    }
+}
+
+/* @brief   random bytes, with more of the ones the parser acts on
+ * */
+static void bench_rx_run(struct bench_res_s *res, int loops)
+{
+    static const char special[] = "{}\r\n\b ";
+    static uint32_t x = 2463534242u;
+    uint8_t buf[BENCH_CHUNK];
+
+    for (int loop = 0; loop < loops * 16; loop++)
+    {
+        for (int i = 0; i < BENCH_CHUNK; i++)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            buf[i] = (x & 0x300) ? ((uint8_t)x) : ((uint8_t)special[(x >> 16) % (sizeof(special) - 1)]);
+        }
+
+        uint32_t start = hal_cycles_get();
+
+        if (usb_uart_rx_feed(PORT_ITF_DEFAULT, buf, BENCH_CHUNK, bench_out) == COMMAND_READY)
+        {
+            res->cmds += bench_count(res);
+        }
+
+        res->cycles += hal_cycles_get() - start;
+        res->bytes += BENCH_CHUNK;
+    }
+}
+
+static const char COMMENT_CMDBENCH[] = {
+    "Benchmark of the command path, the output of the commands is not sent.\r\nUsage: \"CMDBENCH <loops>\" runs a recorded session <loops> times. \"CMDBENCH <loops> RX\" feeds <loops> kB of random bytes to the parser only."};
+
+REG_FN(f_cmd_bench)
+{
+    cmd_resp_t resp;
+    char cmd[10], mode[10];
+    int n, loops;
+    bool rx;
+    struct bench_res_s res;
+    uint32_t us, allocs;
+
+    n = sscanf(text, "%9s %d %9s", cmd, &loops, mode);
+
+    if (n < 2 || loops <= 0 || loops > BENCH_LOOPS_MAX || (n == 3 && strcmp(mode, "RX") != 0))
+    {
+        return (NULL);
+    }
+
+    rx = (n == 3);
+    memset(&res, 0, sizeof(res));
+    allocs = cmd_get_allocs();
+
+    port_tx_set_sink(true);
+    if (rx)
+    {
+        bench_rx_run(&res, loops);
+    }
+    else
+    {
+        bench_session_run(&res, loops);
+    }
+    port_tx_set_sink(false);
+
+    res.allocs = cmd_get_allocs() - allocs;
+    us = (uint32_t)(res.cycles / HAL_CYCLES_PER_US);
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"CMDBENCH\":{\"Mode\":\"%s\",\"Bytes\":%lu,\"Cmds\":%lu,\"Time_us\":%lu,\"Cmd_per_s\":%lu,"
+                               "\"kB_per_s\":%lu,\"Allocs\":%lu,\"Allocs_per_100cmd\":%lu,\"Overruns\":%lu}}",
+                        (rx) ? ("RX") : ("SESSION"), (unsigned long)res.bytes, (unsigned long)res.cmds, (unsigned long)us,
+                        (unsigned long)((us) ? ((uint64_t)res.cmds * 1000000 / us) : (0)),
+                        (unsigned long)((us) ? ((uint64_t)res.bytes * 1000000 / 1024 / us) : (0)),
+                        (unsigned long)res.allocs,
+                        (unsigned long)((res.cmds) ? ((uint64_t)res.allocs * 100 / res.cmds) : (0)),
+                        (unsigned long)res.errors);
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+const struct command_s known_commands_bench[] __attribute__((section(".known_commands_service"))) = {
+    {"CMDBENCH", mCmdGrp1 | mIDLE, f_cmd_bench, COMMENT_CMDBENCH},
+};
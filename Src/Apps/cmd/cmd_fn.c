@@ -73,6 +73,16 @@
 #include "comm_config.h"
 #include "rf_tuning_config.h"
 #include "HAL_uwb.h"
+#include "str_fmt.h"
+#include "boot_time.h"
+#include "cmd_resp.h"
+#include "mcps_event.h"
+#include "mcps_rx_ring.h"
+#include "skb_pool.h"
+#include "dw3000_diag.h"
+#include "dw3000_shadow.h"
+#include "mcps_capture.h"
+#include "HAL_cycles.h"
 
 #define CMD_COLUMN_WIDTH 10
 #define CMD_COLUMN_MAX   4
@@ -127,17 +137,17 @@ static const struct command_s known_commands_service [] = {
 
 #define NUMBER_OF_ANT_PORTS   (int)sizeof(antenna_t)
 
-__attribute__((weak)) char *f_jstat(char *text, void *pbss, int val, cJSON *params)
+__attribute__((weak)) char *f_jstat(char *text, void *pbss, int val, const json_cmd_t *params)
 {
     return NULL;
 };
 
-__attribute__((weak)) char *f_get_known_list(char *text, void *pbss, int val, cJSON *params)
+__attribute__((weak)) char *f_get_known_list(char *text, void *pbss, int val, const json_cmd_t *params)
 {
     return NULL;
 };
 
-__attribute__((weak)) char *f_get_discovered_list(char *text, void *pbss, int val, cJSON *params)
+__attribute__((weak)) char *f_get_discovered_list(char *text, void *pbss, int val, const json_cmd_t *params)
 {
     return NULL;
 };
@@ -191,6 +201,289 @@ REG_FN(f_thread)
     return thread_fn();
 }
 
+/**
+ * @brief show counters of the report buffer for every producer
+ *
+ * */
+REG_FN(f_txstat)
+{
+    static const char *const producer_names[TX_PRODUCER_MAX] = {"REPORT", "CTRL", "DIAG"};
+    static const char *const class_names[TX_CLASS_MAX] = {"RANGING", "REPLY", "ECHO", "DIAG"};
+
+    cmd_resp_t resp;
+
+    if (cmd_resp_json(&resp, 3 * MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"TXSTAT\":{");
+
+        for (int i = 0; i < TX_PRODUCER_MAX; i++)
+        {
+            const struct tx_stats_s *stats = get_tx_stats(i);
+
+            cmd_resp_printf(&resp, "%s\"%s\":{\"Enq\":%lu,\"Drop\":%lu,\"Bytes\":%lu,\"Peak\":%u}",
+                            (i > 0) ? (",") : (""), producer_names[i],
+                            (unsigned long)stats->enqueued, (unsigned long)stats->dropped,
+                            (unsigned long)stats->bytes, stats->peak);
+        }
+
+        cmd_resp_str(&resp, "},\"TXCLASS\":{");
+
+        for (int i = 0; i < TX_CLASS_MAX; i++)
+        {
+            const struct tx_class_stats_s *stats = get_tx_class_stats(i);
+
+            cmd_resp_printf(&resp, "%s\"%s\":{\"Pend\":%u,\"Budget\":%u,\"Drop\":%lu,\"Coal\":%lu}",
+                            (i > 0) ? (",") : (""), class_names[i],
+                            stats->pending, stats->budget,
+                            (unsigned long)stats->dropped, (unsigned long)stats->coalesced);
+        }
+
+        cmd_resp_str(&resp, "}}");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/**
+ * @brief show counters of the events of the UWB chip and of the MAC timer to the MCPS task
+ *        and of the ring and the buffers of the frames, with the time taken by a frame and its diagnostics
+ *
+ * */
+REG_FN(f_mcpsstat)
+{
+    static const char *const evt_names[MCPS_EVT_MAX] = {"TX_DONE", "RX_TIMEOUT", "RX_ERROR", "RX", "TIMER"};
+
+    const struct mcps_evt_stats_s *stats = mcps_evt_get_stats();
+    const struct mcps_rx_ring_stats_s *rx_stats = mcps_rx_ring_get_stats();
+    const struct skb_pool_stats_s *skb_stats = skb_pool_get_stats();
+    static const char *const shadow_names[DW3000_SHADOW_MAX] = {"STS", "AACK", "SADDR", "EUI", "PANID", "FFILT"};
+
+    const struct diag_stats_s *diag_stats = dw3000_diag_get_stats();
+    const struct dw3000_shadow_stats_s *shadow_stats = dw3000_shadow_get_stats();
+    cmd_resp_t resp;
+
+    if (cmd_resp_json(&resp, 4 * MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"MCPSSTAT\":{");
+
+        for (int i = 0; i < MCPS_EVT_MAX; i++)
+        {
+            cmd_resp_printf(&resp, "\"%s\":{\"Post\":%lu,\"Done\":%lu},", evt_names[i],
+                            (unsigned long)stats->posted[i], (unsigned long)stats->handled[i]);
+        }
+
+        cmd_resp_printf(&resp, "\"Wakeups\":%lu,\"Coal\":%lu,\"Lost\":%lu,\"Peak\":%u},",
+                        (unsigned long)stats->wakeups, (unsigned long)stats->coalesced,
+                        (unsigned long)stats->lost, stats->peak);
+
+        cmd_resp_printf(&resp, "\"RXRING\":{\"Len\":%u,\"Frame_max\":%u,\"Rx\":%lu,\"Overrun\":%lu,\"Trunc\":%lu,\"Peak\":%u}",
+                        MCPS_RX_RING_LEN, MCPS_RX_FRAME_MAX,
+                        (unsigned long)rx_stats->received, (unsigned long)rx_stats->overruns,
+                        (unsigned long)rx_stats->truncated, rx_stats->peak);
+
+        cmd_resp_printf(&resp, ",\"SKBPOOL\":{\"Len\":%u,\"Alloc\":%lu,\"Exhausted\":%lu,\"Used\":%u,\"Peak\":%u}",
+                        SKB_POOL_LEN, (unsigned long)skb_stats->allocs, (unsigned long)skb_stats->exhausted,
+                        skb_stats->in_use, skb_stats->peak);
+
+        /* time of the MCPS task per frame received, diagnostics off and on */
+        cmd_resp_str(&resp, ",\"RXTIME\":{");
+        for (int i = 0; i < 2; i++)
+        {
+            const struct mcps_evt_time_s *t = &stats->rx_time[i];
+
+            cmd_resp_printf(&resp, "%s\"%s\":{\"Frames\":%lu,\"Avg_us\":%lu,\"Max_us\":%lu}",
+                            (i > 0) ? (",") : (""), (i > 0) ? ("DiagOn") : ("DiagOff"), (unsigned long)t->frames,
+                            (unsigned long)((t->frames) ? (t->total_us / t->frames) : (0)), (unsigned long)t->max_us);
+        }
+
+        cmd_resp_printf(&resp, "},\"DIAG\":{\"Captured\":%lu,\"Dropped\":%lu,\"Computed\":%lu,\"Max_us\":%lu}",
+                        (unsigned long)diag_stats->captured, (unsigned long)diag_stats->dropped,
+                        (unsigned long)diag_stats->computed, (unsigned long)diag_stats->max_us);
+
+        /* SPI writes of the radio settings issued and skipped as redundant */
+        cmd_resp_str(&resp, ",\"SHADOW\":{");
+        for (int i = 0; i < DW3000_SHADOW_MAX; i++)
+        {
+            cmd_resp_printf(&resp, "%s\"%s\":{\"Wr\":%lu,\"Skip\":%lu}", (i > 0) ? (",") : (""), shadow_names[i],
+                            (unsigned long)shadow_stats->written[i], (unsigned long)shadow_stats->elided[i]);
+        }
+        cmd_resp_str(&resp, "}}");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/**
+ * @brief show the diagnostics of every sender heard since the MCPS started, the most recently heard first
+ *
+ * */
+REG_FN(f_diagresp)
+{
+    struct diag_resp_s diag[DIAG_RESP_MAX];
+    int n = dw3000_diag_get_resp(diag, DIAG_RESP_MAX);
+    char rssi[16];
+    cmd_resp_t resp;
+
+    /* DIAG_RESP_MAX entries of 66 bytes at most */
+    if (cmd_resp_json(&resp, 3 * MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"DIAGRESP\":[");
+
+        for (int i = 0; i < n; i++)
+        {
+            int len = (diag[i].rssi < 0.0) ? (fmt_float(rssi, 0, sizeof(rssi) - 1, diag[i].rssi, 1)) : (-1);
+
+            if (len > 0)
+            {
+                rssi[len] = '\0';
+            }
+            cmd_resp_str(&resp, (i > 0) ? (",{\"Addr\":\"0x") : ("{\"Addr\":\"0x"));
+            cmd_resp_hex(&resp, diag[i].addr, 4, false);
+            cmd_resp_printf(&resp, "\",\"Frames\":%u,\"RSSI_dBm\":\"%s\",\"NLOS_%%\":%d}", diag[i].frames,
+                            (len > 0) ? (rssi) : ("Invalid"), (int)diag[i].nlos);
+        }
+        cmd_resp_str(&resp, "]}");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/**
+ * @brief starts or stops the capture of the frames of the MCPS, shows its counters
+ * @param no param - show the counters
+ *        "CAPTURE <0|1>" - stop, or clear the counters and start, then show
+ *
+ * */
+REG_FN(f_capture)
+{
+    static uint32_t start_ms, stop_ms;
+
+    const struct mcps_capture_stats_s *stats = mcps_capture_get_stats();
+    uint32_t now_ms = osKernelSysTick() / (osKernelSysTickFrequency / 1000);
+    uint32_t elapsed_ms;
+    cmd_resp_t resp;
+    char cmd[10];
+    int n, on;
+
+    n = sscanf(text, "%9s %d", cmd, &on);
+
+    if (n == 2 && (on == 0 || on == 1))
+    {
+        if (on)
+        {
+            start_ms = now_ms;
+        }
+        else if (mcps_capture_is_enabled())
+        {
+            stop_ms = now_ms;
+        }
+        mcps_capture_enable(on);
+    }
+    else if (n != 1)
+    {
+        return (NULL);
+    }
+
+    elapsed_ms = ((mcps_capture_is_enabled()) ? (now_ms) : (stop_ms)) - start_ms;
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"CAPTURE\":{\"On\":%d,\"Captured\":%lu,\"Dropped\":%lu,\"Cut\":%lu,\"Sent\":%lu,"
+                               "\"Time_ms\":%lu,\"Frame_per_s\":%lu,\"Avg_ns\":%lu,\"Max_ns\":%lu}}",
+                        mcps_capture_is_enabled(), (unsigned long)stats->captured, (unsigned long)stats->dropped,
+                        (unsigned long)stats->cut, (unsigned long)stats->sent, (unsigned long)elapsed_ms,
+                        (unsigned long)((elapsed_ms) ? ((uint64_t)stats->sent * 1000 / elapsed_ms) : (0)),
+                        (unsigned long)((stats->captured) ? ((uint64_t)stats->cycles * 1000 / HAL_CYCLES_PER_US / stats->captured) : (0)),
+                        (unsigned long)(stats->max_cycles * 1000 / HAL_CYCLES_PER_US));
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/**
+ * @brief shows the timeline of the boot, microseconds from the start of main() to every stage,
+ *        -1 for a stage not reached
+ *
+ * */
+REG_FN(f_boot)
+{
+    static const char *const stage_names[BOOT_STAGE_MAX] = {"Config", "Uwb", "Kernel", "App", "Session", "First_report"};
+
+    cmd_resp_t resp;
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"BOOT\":{");
+
+        for (int i = 0; i < BOOT_STAGE_MAX; i++)
+        {
+            cmd_resp_str(&resp, (i > 0) ? (",\"") : ("\""));
+            cmd_resp_str(&resp, stage_names[i]);
+            cmd_resp_str(&resp, "_us\":");
+            cmd_resp_int(&resp, boot_time_get_us(i));
+        }
+
+        cmd_resp_str(&resp, "}}");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/**
+ * @brief sets or shows the flush threshold and deadline of the report buffer,
+ *        shows the histogram of the latency from the commit of a message to its transmission
+ * @param no param - show the settings and the histogram
+ *        "TXFLUSH <threshold> <deadline_ms>" - set, reset the histogram and then show
+ *
+ * */
+REG_FN(f_txflush)
+{
+    const char *ret = CMD_FN_RET_OK;
+    static const char *const bucket_names[TX_LATENCY_BUCKETS] = {"500", "1000", "2000", "5000", "10000", "20000", "50000", ">50000"};
+
+    cmd_resp_t resp;
+    char cmd[10];
+    int n;
+    unsigned int threshold, deadline_ms;
+    const struct tx_latency_s *latency = get_tx_latency();
+
+    n = sscanf(text, "%9s %u %u", cmd, &threshold, &deadline_ms);
+
+    if (n == 3 && threshold > 0 && threshold <= UINT16_MAX && deadline_ms <= UINT16_MAX)
+    {
+        set_flush_threshold((uint16_t)threshold);
+        set_flush_deadline_ms((uint16_t)deadline_ms);
+        reset_tx_latency();
+    }
+    else if (n != 1)
+    {
+        ret = NULL;
+    }
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"TXFLUSH\":{\"Threshold\":");
+        cmd_resp_uint(&resp, get_flush_threshold());
+        cmd_resp_str(&resp, ",\"Deadline_ms\":");
+        cmd_resp_uint(&resp, get_flush_deadline_ms());
+        cmd_resp_str(&resp, ",\"Lat_us\":{");
+
+        for (int i = 0; i < TX_LATENCY_BUCKETS; i++)
+        {
+            cmd_resp_str(&resp, (i > 0) ? (",\"") : ("\""));
+            cmd_resp_str(&resp, bucket_names[i]);
+            cmd_resp_str(&resp, "\":");
+            cmd_resp_uint(&resp, latency->hist[i]);
+        }
+
+        cmd_resp_str(&resp, "},\"Max_us\":");
+        cmd_resp_uint(&resp, latency->max_us);
+        cmd_resp_str(&resp, "}}");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (ret) : (NULL);
+}
+
 /**
  * @}
  */
@@ -258,91 +551,89 @@ REG_FN(f_test_mcps)
 
 REG_FN(f_decaid)
 {
+    cmd_resp_t resp;
+
     hal_uwb.wakeup_with_io();
 
-    diag_printf("Decawave device ID = 0x%08lx\r\n", dwt_readdevid());
-    diag_printf("Decawave lotID = 0x%08lx, partID = 0x%08lx\r\n", dwt_getlotid(), dwt_getpartid());
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "Decawave device ID = 0x%08lx\r\n", dwt_readdevid());
+        cmd_resp_printf(&resp, "Decawave lotID = 0x%08lx, partID = 0x%08lx\r\n", dwt_getlotid(), dwt_getpartid());
+    }
 
     hal_uwb.sleep_enter();
 
-    return (CMD_FN_RET_OK);
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 
 REG_FN(f_get_version)
 {
     const char version[] = FULL_VERSION;
-    diag_printf("VERSION:%s\r\n", version);
-    return (CMD_FN_RET_OK);
+    cmd_resp_t resp;
+
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "VERSION:");
+        cmd_resp_str(&resp, version);
+        cmd_resp_str(&resp, "\r\n");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 /** @brief
  * */
 REG_FN(f_decaJuniper)
 {
-    const char *ret = NULL;
     const char ver[] = FULL_VERSION;
+    cmd_resp_t resp;
 
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
-
-    if (str)
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
     {
-        int hlen;
-
-        hlen = sprintf(str, "JS%04X", 0x5A5A); // reserve space for length of JS object
-
-        sprintf(&str[strlen(str)], "{\"Info\":{\r\n");
-        sprintf(&str[strlen(str)], "\"Device\":\"%s\",\n\r", (char *)ProjectName);
-        sprintf(&str[strlen(str)], "\"Current App\":\"%s\",\r\n", AppGet()->app_name);
-
-        sprintf(&str[strlen(str)], "\"Version\":\"%s\",\r\n", ver);
-
-        sprintf(&str[strlen(str)], "\"Build\":\"%s %s\",\r\n", __DATE__, __TIME__);
-
-        sprintf(&str[strlen(str)], "\"Apps\":[");
+        cmd_resp_str(&resp, "{\"Info\":{\r\n");
+        cmd_resp_str(&resp, "\"Device\":\"");
+        cmd_resp_str(&resp, (char *)ProjectName);
+        cmd_resp_str(&resp, "\",\n\r\"Current App\":\"");
+        cmd_resp_str(&resp, AppGet()->app_name);
+        cmd_resp_str(&resp, "\",\r\n\"Version\":\"");
+        cmd_resp_str(&resp, ver);
+        cmd_resp_str(&resp, "\",\r\n");
+        cmd_resp_str(&resp, "\"Build\":\"" __DATE__ " " __TIME__ "\",\r\n");
+        cmd_resp_str(&resp, "\"Apps\":[");
 
         /* Scan for known applications in the __known_command section*/
-        extern uint32_t __known_commands_start;
-        extern uint32_t __known_commands_end;
-
         command_t *knownApp;
         /* Mask to distinguish apps from other commands*/
         const uint32_t application_mask = mCmdGrp2;
+        bool first = true;
 
-        /* Loop and add the application to the output string*/
-        for (knownApp = (command_t *)&__known_commands_start; knownApp < (command_t *)&__known_commands_end; knownApp++)
+        /* Loop and add the application to the output string, comma separated */
+        for (knownApp = KNOWN_COMMANDS_START; knownApp < KNOWN_COMMANDS_END; knownApp++)
         {
             if (knownApp->mode & application_mask)
             {
-                sprintf(&str[strlen(str)], "\"%s\",", knownApp->name);
+                cmd_resp_str(&resp, (first) ? ("\"") : (",\""));
+                cmd_resp_str(&resp, knownApp->name);
+                cmd_resp_char(&resp, '"');
+                first = false;
             }
         }
 
-        /* Remove last "," character*/
-        if (str[strlen(str) - 1] == ',')
-        {
-            str[strlen(str) - 1] = '\0';
-        }
         /* End the command braket*/
-        sprintf(&str[strlen(str)], "],\r\n");
-
-        sprintf(&str[strlen(str)], "\"Driver\":\"%s\"", dwt_version_string());
+        cmd_resp_str(&resp, "],\r\n\"Driver\":\"");
+        cmd_resp_str(&resp, dwt_version_string());
+        cmd_resp_char(&resp, '"');
 
         #ifdef UWBSTACK
-        sprintf(&str[strlen(str)],",\r\n\"UWB stack\":\"%s\"", UWBMAC_VERSION);
+        cmd_resp_str(&resp, ",\r\n\"UWB stack\":\"");
+        cmd_resp_str(&resp, UWBMAC_VERSION);
+        cmd_resp_char(&resp, '"');
         #endif
-        sprintf(&str[strlen(str)], "}}");
-
-        sprintf(&str[2], "%04X", strlen(str) - hlen); // add formatted 4X of length, this will erase first '{'
-        str[hlen] = '{';                              // restore the start bracket
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
-
-        CMD_FREE(str);
-        ret = CMD_FN_RET_OK;
+        cmd_resp_str(&resp, "}}");
     }
 
-    return (ret);
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 
@@ -357,45 +648,39 @@ REG_FN(f_power)
 {
     const char *ret = CMD_FN_RET_OK;
 
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
-
-    if (str)
-    {
-        /* Display the Key Config */
-        int n, hlen;
-
-        unsigned int pwr, pgDly;
-        int pgCnt;
-        dwt_txconfig_t *txConfig = get_dwt_txconfig();
-
-        n = sscanf(text, "%9s 0X%08x 0X%08x 0X%08x", str, &pwr, &pgDly, &pgCnt);
-
-        if (n == 4)
-        {
-            txConfig->power = pwr;
-            txConfig->PGdly = pgDly;
-            txConfig->PGcount = pgCnt;
-        }
-        else if (n != 1)
-        {
-            ret = NULL;
-        }
-
-        hlen = sprintf(str, "JS%04X", 0x5A5A); // reserve space for length of JS object
-        sprintf(&str[strlen(str)], "{\"TX POWER\":{\r\n");
+    cmd_resp_t resp;
+    char cmd[10];
+    int n;
+    unsigned int pwr, pgDly;
+    int pgCnt;
+    dwt_txconfig_t *txConfig = get_dwt_txconfig();
 
-        sprintf(&str[strlen(str)], "\"PWR\":\"0x%08X\",\r\n", (unsigned int)txConfig->power);
-        sprintf(&str[strlen(str)], "\"PGDLY\":\"0x%08X\",\r\n", (unsigned int)txConfig->PGdly);
-        sprintf(&str[strlen(str)], "\"PGCOUNT\":\"0x%08X\"}}", (unsigned int)txConfig->PGcount);
+    n = sscanf(text, "%9s 0X%08x 0X%08x 0X%08x", cmd, &pwr, &pgDly, &pgCnt);
 
-        sprintf(&str[2], "%04X", strlen(str) - hlen); // add formatted 4X of length, this will erase first '{'
-        str[hlen] = '{';                              // restore the start bracket
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
+    if (n == 4)
+    {
+        txConfig->power = pwr;
+        txConfig->PGdly = pgDly;
+        txConfig->PGcount = pgCnt;
+    }
+    else if (n != 1)
+    {
+        ret = NULL;
+    }
 
-        CMD_FREE(str);
+    /* Display the TX power Config */
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"TX POWER\":{\r\n\"PWR\":\"0x");
+        cmd_resp_hex(&resp, txConfig->power, 8, true);
+        cmd_resp_str(&resp, "\",\r\n\"PGDLY\":\"0x");
+        cmd_resp_hex(&resp, txConfig->PGdly, 8, true);
+        cmd_resp_str(&resp, "\",\r\n\"PGCOUNT\":\"0x");
+        cmd_resp_hex(&resp, txConfig->PGcount, 8, true);
+        cmd_resp_str(&resp, "\"}}");
     }
-    return (ret);
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (ret) : (NULL);
 }
 
 /**
@@ -516,62 +801,54 @@ REG_FN(f_stskeyiv)
 {
     const char *ret = CMD_FN_RET_OK;
 
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
-
-    if (str)
+    cmd_resp_t resp;
+    char cmd[10];
+    int n;
+    unsigned int key0, key1, key2, key3;
+    unsigned int iv0, iv1, iv2, iv3;
+    unsigned int sMode;
+
+    n = sscanf(text, "%9s 0X%08x%08x%08x%08x 0X%08x%08x%08x%08x %d", cmd, &key3, &key2, &key1, &key0,
+               &iv3, &iv2, &iv1, &iv0, &sMode);
+    sts_config_t *sts_config = get_sts_config();
+    if (n == 9 || n == 10)
     {
-        /* Display the Key Config */
-        int hlen, n;
+        sts_config->stsInteropMode = sMode;
 
-        unsigned int key0, key1, key2, key3;
-        unsigned int iv0, iv1, iv2, iv3;
-        unsigned int sMode;
+        sts_config->stsIv.iv0 = iv0;
+        sts_config->stsIv.iv1 = iv1;
+        sts_config->stsIv.iv2 = iv2;
+        sts_config->stsIv.iv3 = iv3;
 
-        n = sscanf(text, "%9s 0X%08x%08x%08x%08x 0X%08x%08x%08x%08x %d", str, &key3, &key2, &key1, &key0,
-                   &iv3, &iv2, &iv1, &iv0, &sMode);
-        sts_config_t *sts_config = get_sts_config();
-        if (n == 9 || n == 10)
-        {
-            sts_config->stsInteropMode = sMode;
-
-            sts_config->stsIv.iv0 = iv0;
-            sts_config->stsIv.iv1 = iv1;
-            sts_config->stsIv.iv2 = iv2;
-            sts_config->stsIv.iv3 = iv3;
-
-            sts_config->stsKey.key0 = key0;
-            sts_config->stsKey.key1 = key1;
-            sts_config->stsKey.key2 = key2;
-            sts_config->stsKey.key3 = key3;
-        }
-        else if (n != 1)
-        {
-            ret = NULL;
-        }
-
-        hlen = sprintf(str, "JS%04X", 0x5A5A); // reserve space for length of JS object
-        sprintf(&str[strlen(str)], "{\"STS KEY_IV\":{\r\n");
-
-        sprintf(&str[strlen(str)], "\"STS KEY\":\"0x%08X%08X%08X%08X\",\r\n",
-                (unsigned int)sts_config->stsKey.key3,
-                (unsigned int)sts_config->stsKey.key2,
-                (unsigned int)sts_config->stsKey.key1,
-                (unsigned int)sts_config->stsKey.key0);
-        sprintf(&str[strlen(str)], "\"STS IV\":\"0x%08X%08X%08X%08X\",\r\n",
-                (unsigned int)sts_config->stsIv.iv3,
-                (unsigned int)sts_config->stsIv.iv2,
-                (unsigned int)sts_config->stsIv.iv1,
-                (unsigned int)sts_config->stsIv.iv0);
-        sprintf(&str[strlen(str)], "\"STS_STATIC\":\"%d\"}}", (int)sts_config->stsInteropMode);
-
-        sprintf(&str[2], "%04X", strlen(str) - hlen); // add formatted 4X of length, this will erase first '{'
-        str[hlen] = '{';                              // restore the start bracket
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
+        sts_config->stsKey.key0 = key0;
+        sts_config->stsKey.key1 = key1;
+        sts_config->stsKey.key2 = key2;
+        sts_config->stsKey.key3 = key3;
+    }
+    else if (n != 1)
+    {
+        ret = NULL;
+    }
 
-        CMD_FREE(str);
+    /* Display the Key Config */
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"STS KEY_IV\":{\r\n\"STS KEY\":\"0x");
+        cmd_resp_hex(&resp, sts_config->stsKey.key3, 8, true);
+        cmd_resp_hex(&resp, sts_config->stsKey.key2, 8, true);
+        cmd_resp_hex(&resp, sts_config->stsKey.key1, 8, true);
+        cmd_resp_hex(&resp, sts_config->stsKey.key0, 8, true);
+        cmd_resp_str(&resp, "\",\r\n\"STS IV\":\"0x");
+        cmd_resp_hex(&resp, sts_config->stsIv.iv3, 8, true);
+        cmd_resp_hex(&resp, sts_config->stsIv.iv2, 8, true);
+        cmd_resp_hex(&resp, sts_config->stsIv.iv1, 8, true);
+        cmd_resp_hex(&resp, sts_config->stsIv.iv0, 8, true);
+        cmd_resp_str(&resp, "\",\r\n\"STS_STATIC\":\"");
+        cmd_resp_int(&resp, (int)sts_config->stsInteropMode);
+        cmd_resp_str(&resp, "\"}}");
     }
-    return (ret);
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (ret) : (NULL);
 }
 
 /**
@@ -631,30 +908,45 @@ REG_FN(f_uwbcfg)
         }
 
         /* Display the UWB Config object */
-        int hlen;
-
-        hlen = sprintf(str, "JS%04X", 0x5A5A); // reserve space for length of JS object
-        sprintf(&str[strlen(str)], "{\"UWB PARAM\":{\r\n");
-
-        sprintf(&str[strlen(str)], "\"CHAN\":%d,\r\n", deca_to_chan(dwt_config->chan));
-        sprintf(&str[strlen(str)], "\"PLEN\":%d,\r\n", deca_to_plen(dwt_config->txPreambLength));
-        sprintf(&str[strlen(str)], "\"PAC\":%d,\r\n", deca_to_pac(dwt_config->rxPAC));
-        sprintf(&str[strlen(str)], "\"TXCODE\":%d,\r\n", dwt_config->txCode);
-        sprintf(&str[strlen(str)], "\"RXCODE\":%d,\r\n", dwt_config->rxCode);
-        sprintf(&str[strlen(str)], "\"SFDTYPE\":%d,\r\n", dwt_config->sfdType);
-        sprintf(&str[strlen(str)], "\"DATARATE\":%d,\r\n", deca_to_bitrate(dwt_config->dataRate));
-        sprintf(&str[strlen(str)], "\"PHRMODE\":%d,\r\n", dwt_config->phrMode);
-        sprintf(&str[strlen(str)], "\"PHRRATE\":%d,\r\n", dwt_config->phrRate);
-        sprintf(&str[strlen(str)], "\"SFDTO\":%d,\r\n", dwt_config->sfdTO);
-        sprintf(&str[strlen(str)], "\"STSMODE\":%d,\r\n", dwt_config->stsMode);
-        sprintf(&str[strlen(str)], "\"STSLEN\":%d,\r\n", deca_to_sts_length(dwt_config->stsLength));
-        sprintf(&str[strlen(str)], "\"PDOAMODE\":%d}}", dwt_config->pdoaMode);
-
-
-        sprintf(&str[2], "%04X", strlen(str) - hlen); // add formatted 4X of length, this will erase first '{'
-        str[hlen] = '{';                              // restore the start bracket
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
+        const struct
+        {
+            const char *name;
+            int val;
+        } uwb_param[] = {
+            {"CHAN", deca_to_chan(dwt_config->chan)},
+            {"PLEN", deca_to_plen(dwt_config->txPreambLength)},
+            {"PAC", deca_to_pac(dwt_config->rxPAC)},
+            {"TXCODE", dwt_config->txCode},
+            {"RXCODE", dwt_config->rxCode},
+            {"SFDTYPE", dwt_config->sfdType},
+            {"DATARATE", deca_to_bitrate(dwt_config->dataRate)},
+            {"PHRMODE", dwt_config->phrMode},
+            {"PHRRATE", dwt_config->phrRate},
+            {"SFDTO", dwt_config->sfdTO},
+            {"STSMODE", dwt_config->stsMode},
+            {"STSLEN", deca_to_sts_length(dwt_config->stsLength)},
+            {"PDOAMODE", dwt_config->pdoaMode}};
+        const int nparams = sizeof(uwb_param) / sizeof(uwb_param[0]);
+        cmd_resp_t resp;
+
+        if (cmd_resp_json(&resp, MAX_STR_SIZE))
+        {
+            cmd_resp_str(&resp, "{\"UWB PARAM\":{\r\n");
+
+            for (int i = 0; i < nparams; i++)
+            {
+                cmd_resp_char(&resp, '"');
+                cmd_resp_str(&resp, uwb_param[i].name);
+                cmd_resp_str(&resp, "\":");
+                cmd_resp_int(&resp, uwb_param[i].val);
+                cmd_resp_str(&resp, (i < nparams - 1) ? (",\r\n") : ("}}"));
+            }
+        }
+
+        if (cmd_resp_end(&resp) != _NO_ERR)
+        {
+            ret = NULL;
+        }
 
         CMD_FREE(str);
     }
@@ -670,20 +962,20 @@ REG_FN(f_stat)
 {
     const char *ret = CMD_FN_RET_OK;
 
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
+    cmd_resp_t resp;
 
-    if (str)
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
     {
-        sprintf(str, "MODE: %s\r\n"
-                     "LAST ERR CODE: %d\r\n"
-                     "MAX MSG LEN: %d\r\n",
-                AppGet()->app_name,
-                AppGetLastError(),
-                /*app.maxMsgLen*/ 0);
-
-        reporter_instance.print((char *)str, strlen(str));
+        cmd_resp_printf(&resp, "MODE: %s\r\n"
+                               "LAST ERR CODE: %d\r\n"
+                               "MAX MSG LEN: %d\r\n",
+                        AppGet()->app_name,
+                        AppGetLastError(),
+                        /*app.maxMsgLen*/ 0);
+    }
 
-        CMD_FREE(str);
+    if (cmd_resp_end(&resp) == _NO_ERR)
+    {
 #ifdef LATER
         app.lastErrorCode = 0;
         app.maxMsgLen = 0;
@@ -699,20 +991,20 @@ REG_FN(f_stat)
     return (ret);
 }
 
-static int print_help_line(char *str, int cnt, const command_t *known_command)
+static int print_help_line(cmd_resp_t *resp, int cnt, const command_t *known_command)
 {
     switch (known_command->mode & mCmdGrpMASK)
     {
     case mCmdGrp0:
         if (cnt > 0)
         {
-            sprintf(&str[cnt], "\r\n");
-            port_tx_msg((uint8_t *)str, strlen(str));
+            cmd_resp_str(resp, "\r\n");
             cnt = 0;
         }
         /*print the Group name */
-        sprintf(str, "---- %s---\r\n", known_command->cmnt);
-        port_tx_msg((uint8_t *)str, strlen(str));
+        cmd_resp_str(resp, "---- ");
+        cmd_resp_str(resp, known_command->cmnt);
+        cmd_resp_str(resp, "---\r\n");
         break;
 
     case mCmdGrp1:
@@ -720,12 +1012,11 @@ static int print_help_line(char *str, int cnt, const command_t *known_command)
         /* print appropriate list of parameters for the current application */
         if (known_command->name)
         {
-            sprintf(&str[cnt], "%-10s", known_command->name);
+            cmd_resp_printf(resp, "%-10s", known_command->name);
             cnt += CMD_COLUMN_WIDTH;
             if (cnt >= CMD_COLUMN_WIDTH * CMD_COLUMN_MAX)
             {
-                sprintf(&str[cnt], "\r\n");
-                port_tx_msg((uint8_t *)str, strlen(str));
+                cmd_resp_str(resp, "\r\n");
                 cnt = 0;
             }
         }
@@ -757,48 +1048,40 @@ static int print_help_line(char *str, int cnt, const command_t *known_command)
 REG_FN(f_help_std)
 {
     int cnt = 0;
-    const char * ret = NULL;
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
-
-    extern uint32_t __known_commands_start;
-    extern uint32_t __known_commands_end;
-    extern uint32_t __known_commands_app_start;
-    extern uint32_t __known_commands_ilde_start;
-    extern uint32_t __known_commands_service_start;
+    cmd_resp_t resp;
 
-    known_commands = (command_t *)&__known_commands_start;
+    known_commands = KNOWN_COMMANDS_START;
 
-    if(str)
+    /* the reply is sent by chunks, the reporter is waited for: no critical section around it */
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
     {
-        CMD_ENTER_CRITICAL();
-
-        reporter_instance.print((char *)ProjectName, strlen(ProjectName));
-        reporter_instance.print("\r\n", 2);
+        cmd_resp_str(&resp, ProjectName);
+        cmd_resp_str(&resp, "\r\n");
 
         /* Scan for known applications in the __known_command section*/
-        for(known_commands = (command_t*)&__known_commands_start; known_commands < (command_t*)&__known_commands_end; known_commands++)
+        for(known_commands = KNOWN_COMMANDS_START; known_commands < KNOWN_COMMANDS_END; known_commands++)
         {
             uint32_t mode = known_commands->mode;
 
             if ((mode & mMASK) == mANY || mIDLE == AppGet()->app_mode)
             {
-                if(known_commands == (command_t*)&__known_commands_start)
+                if(known_commands == KNOWN_COMMANDS_START)
                 {
-                    cnt = print_help_line(str, cnt, known_commands_anytime);
+                    cnt = print_help_line(&resp, cnt, known_commands_anytime);
                 }
-                else if(known_commands == (command_t*)&__known_commands_app_start)
+                else if(known_commands == KNOWN_COMMANDS_APP_START)
                 {
-                    cnt = print_help_line(str, cnt, known_commands_app_start);
+                    cnt = print_help_line(&resp, cnt, known_commands_app_start);
                 }
-                else if(known_commands == (command_t*)&__known_commands_ilde_start)
+                else if(known_commands == KNOWN_COMMANDS_IDLE_START)
                 {
-                    cnt = print_help_line(str, cnt, known_commands_idle);
+                    cnt = print_help_line(&resp, cnt, known_commands_idle);
                 }
-                else if(known_commands == (command_t*)&__known_commands_service_start)
+                else if(known_commands == KNOWN_COMMANDS_SERVICE_START)
                 {
-                    cnt = print_help_line(str, cnt, known_commands_service);
+                    cnt = print_help_line(&resp, cnt, known_commands_service);
                 }
-                cnt = print_help_line(str, cnt, known_commands);
+                cnt = print_help_line(&resp, cnt, known_commands);
             }
         }
         if (((AppGet()->app_mode & mAPPMASK) == mAPP) && (AppGet()->sub_command != NULL))
@@ -806,7 +1089,7 @@ REG_FN(f_help_std)
             const command_t *sub_cmd = AppGet()->sub_command;
             while (1)
             {
-                cnt = print_help_line(str, cnt, sub_cmd);
+                cnt = print_help_line(&resp, cnt, sub_cmd);
                 if (sub_cmd->mode & APP_LAST_SUB_CMD)
                 {
                     break;
@@ -814,16 +1097,10 @@ REG_FN(f_help_std)
                 sub_cmd++;
             }
         }
-        sprintf(&str[cnt], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
-
-        CMD_EXIT_CRITICAL();
-
-        CMD_FREE(str);
-        ret = CMD_FN_RET_OK;
+        cmd_resp_str(&resp, "\r\n");
     }
 
-    return (ret);
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 
@@ -835,14 +1112,11 @@ REG_FN(f_help_std)
  * */
 REG_FN(f_help_help)
 {
-    int indx = 0, n = 0;
-    const char *ret = NULL;
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
+    int indx = 0;
+    cmd_resp_t resp;
 
-    if (str)
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
     {
-        CMD_ENTER_CRITICAL();
-
         while (known_commands[indx].cmnt != NULL)
         {
             uint32_t mode = known_commands[indx].mode;
@@ -851,25 +1125,24 @@ REG_FN(f_help_help)
             {
                 if ((known_commands[indx].name != NULL) && (strcmp(known_commands[indx].name, text) == 0))
                 {
-                    sprintf(str, "\r\n%s:\r\n", text);
-                    reporter_instance.print((char *)str, strlen(str));
+                    cmd_resp_str(&resp, "\r\n");
+                    cmd_resp_str(&resp, text);
+                    cmd_resp_str(&resp, ":\r\n");
 
                     const char *ptr = known_commands[indx].cmnt;
 
                     bool auto_crlf = (strchr(ptr, '\r') != NULL);
                     if (auto_crlf)
                     {
-                        reporter_instance.print((char *)ptr, strlen(ptr));
+                        cmd_resp_str(&resp, ptr);
                     }
                     else
                     {
                         while (ptr)
                         {
                             // CMD_COLUMN_WIDTH*CMD_COLUMN_MAX
-                            n = snprintf(str, 78, "%s", ptr);
-                            sprintf(&str[strlen(str)], "\r\n");
-                            reporter_instance.print((char *)str, strlen(str));
-                            if (n < 78)
+                            cmd_resp_printf(&resp, "%.77s\r\n", ptr);
+                            if (memchr(ptr, '\0', 78) != NULL)
                             {
                                 ptr = NULL;
                             }
@@ -887,16 +1160,10 @@ REG_FN(f_help_help)
             indx++;
         }
 
-        sprintf(str, "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
-
-        CMD_EXIT_CRITICAL();
-
-        CMD_FREE(str);
-        ret = CMD_FN_RET_OK;
+        cmd_resp_str(&resp, "\r\n");
     }
 
-    return ret;
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 /**
@@ -996,6 +1263,15 @@ const char COMMENT_TXPOWER[] = {"Tx Power settings.\r\nUsage: To see Tx power \"
 const char COMMENT_ANTENNA[] = {"Sets Antenna Type.\r\nUsage: To see Antenna \"ANTENNA\". To set the current antenna type for each port \"ANTENNA <PORT1> <PORT2>...\". To see possible values \"antenna values\"."};
 
 const char COMMENT_THREAD[] = {"Displays Heap and Threads stack usage"};
+const char COMMENT_TXFLUSH[] = {"Report buffer flushing: short messages are held until the pending bytes reach the threshold or until the deadline.\r\nUsage: To see the settings and the histogram of the transmit latency \"TXFLUSH\". To set \"TXFLUSH <THRESHOLD_BYTES> <DEADLINE_MS>\", the threshold is at least 1"};
+const char COMMENT_TXSTAT[] = {"Displays the report buffer counters of every producer: messages enqueued, dropped, bytes and peak usage,\r\nand of every message class: bytes pending, budget, messages dropped and coalesced"};
+
+const char COMMENT_MCPSSTAT[] = {"Displays the events of the UWB chip and of the MAC timer to the MCPS task since the session started:\r\nposted and handled by type, wakeups of the task, events coalesced in a wakeup, lost on a full queue and peak of the queue,\r\nand the frames received: depth and payload of the ring, frames committed, dropped on overrun, truncated and peak of the ring,\r\nand the pool of socket buffers: entries, allocations, allocations failed, entries in use and peak,\r\nthe time of the MCPS task per frame received with the diagnostics off and on, and the diagnostics captured, dropped, computed and the longest computation,\r\nand the SPI writes of the radio settings issued and skipped as the device held the value already"};
+const char COMMENT_CAPTURE[] = {"Capture of the frames transmitted and received, sent over the report link as binary frames to be converted by Tools/capture_pcapng.py.\r\nUsage: To see the counters \"CAPTURE\": frames captured, dropped on a full ring, cut, sent, time, frames sent per second and time of a capture. To start or stop \"CAPTURE <0|1>\""};
+
+const char COMMENT_DIAGRESP[] = {"Displays the RSSI and NLOS of the last frame of every sender heard with the diagnostics on, the most recently heard first,\r\nwith the frames computed per sender"};
+
+const char COMMENT_BOOT[] = {"Displays the timeline of the boot: microseconds from the start to the configuration, the UWB chip, the scheduler,\r\nthe default application, the ranging session and the first ranging report, -1 for a stage not reached"};
 
 const char COMMENT_DECAID[] = {"Displays UWB chip information"};
 const char COMMENT_VERSION[] = {"Shows version of the SW"};
@@ -1013,7 +1289,13 @@ const struct command_s known_commands_anytime_all [] __attribute__((section(".kn
     {"?",       mCmdGrp1 | mANY,   f_help_app,              COMMENT_HELP },
     {"STOP",    mCmdGrp1 | mANY,   f_stop,                  COMMENT_STOP },
     {"THREAD",  mCmdGrp1 | mANY,   f_thread,                COMMENT_THREAD },
+    {"TXSTAT",  mCmdGrp1 | mANY,   f_txstat,                COMMENT_TXSTAT },
+    {"TXFLUSH", mCmdGrp1 | mANY,   f_txflush,               COMMENT_TXFLUSH },
+    {"MCPSSTAT",mCmdGrp1 | mANY,   f_mcpsstat,              COMMENT_MCPSSTAT },
+    {"DIAGRESP",mCmdGrp1 | mANY,   f_diagresp,              COMMENT_DIAGRESP },
+    {"CAPTURE", mCmdGrp1 | mANY,   f_capture,               COMMENT_CAPTURE },
     {"STAT",    mCmdGrp1 | mANY,   f_stat,                  COMMENT_STAT },
+    {"BOOT",    mCmdGrp1 | mANY,   f_boot,                  COMMENT_BOOT },
     {"SAVE",    mCmdGrp1 | mANY,   f_save,                  COMMENT_SAVE },
     {"DECA$",   mCmdGrp1 | mANY,   f_decaJuniper,           COMMENT_DECAJUNIPER },
 };
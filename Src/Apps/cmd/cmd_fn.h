@@ -60,7 +60,7 @@ extern "C" {
 #include <stdlib.h>
 
 #include "app.h"
-#include "cJSON.h"
+#include "json_tok.h"
 #include "cmsis_os.h"
 #include "critical_section.h"
 #include "default_config.h"
@@ -69,7 +69,7 @@ extern "C" {
 /* module DEFINITIONS */
 #define MAX_STR_SIZE 255
 
-#define CMD_MALLOC           malloc
+#define CMD_MALLOC           cmd_malloc /**< counted, see cmd_get_allocs() */
 #define CMD_FREE             free
 #define CMD_ENTER_CRITICAL() enter_critical_section()
 #define CMD_EXIT_CRITICAL()  leave_critical_section()
@@ -96,10 +96,20 @@ typedef enum
 } cmdGroup_e;
 
 
+/* A JSON command, as tokenized in place by command_parser():
+ * params is the index of the token of the CMD_PARAMS value */
+typedef struct
+{
+    const char *js;
+    const json_tok_t *tokens;
+    int n_tokens;
+    int params;
+} json_cmd_t;
+
 //-----------------------------------------------------------------------------
 /* All cmd_fn functions have unified input: (char *text, param_block_t *pbss, int val) */
 /* use REG_FN(x) macro */
-#define REG_FN(x) const char *x(char *text, void *pbss, int val, cJSON *params)
+#define REG_FN(x) const char *x(char *text, void *pbss, int val, const json_cmd_t *params)
 
 /* command table structure definition */
 struct command_s
@@ -111,12 +121,36 @@ struct command_s
 };
 
 typedef struct command_s command_t;
+
+/* The command tables are placed in sections of their own (.known_commands_anytime, _app, _ilde, _service)
+ * and gathered by the linker, which marks them with the symbols below. The code reaches the tables through
+ * these macros only: a build without the linker script defines them to tables of its own. */
+#ifndef KNOWN_COMMANDS_START
+extern uint32_t __known_commands_start;
+extern uint32_t __known_commands_end;
+extern uint32_t __known_commands_app_start;
+extern uint32_t __known_commands_ilde_start;
+extern uint32_t __known_commands_service_start;
+extern uint32_t __known_apps_start;
+extern uint32_t __known_apps_end;
+
+#define KNOWN_COMMANDS_START         ((command_t *)&__known_commands_start)
+#define KNOWN_COMMANDS_END           ((command_t *)&__known_commands_end)
+#define KNOWN_COMMANDS_APP_START     ((command_t *)&__known_commands_app_start)
+#define KNOWN_COMMANDS_IDLE_START    ((command_t *)&__known_commands_ilde_start)
+#define KNOWN_COMMANDS_SERVICE_START ((command_t *)&__known_commands_service_start)
+#define KNOWN_APPS_START             ((app_definition_t *)&__known_apps_start)
+#define KNOWN_APPS_END               ((app_definition_t *)&__known_apps_end)
+#endif
+
 extern command_t *known_commands;
 extern const char CMD_FN_RET_OK[];
 extern const char CMD_FN_RET_KO[];
 extern const char COMMENT_VERSION[];
 
 void command_stop_received(void);
+void *cmd_malloc(size_t size);
+uint32_t cmd_get_allocs(void);
 
 #ifdef __cplusplus
 }
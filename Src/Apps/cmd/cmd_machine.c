@@ -0,0 +1,338 @@
+/**
+ * @file      cmd_machine.c
+ *
+ * @brief     Machine mode of the command interface: framed, sequence-tagged commands
+ *
+ *            The frames are received in the control task and queued in local_buff,
+ *            each one as its sequence number followed by the NUL-terminated command line.
+ *            The commands are dispatched through the known commands, as the text interface.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cmd_machine.h"
+#include "cmd.h"
+#include "cmd_fn.h"
+#include "cmd_resp.h"
+#include "controlTask.h"
+#include "crc16.h"
+#include "reporter.h"
+#include "usb_uart_rx.h"
+#include "usb_uart_tx.h"
+
+/* longest reply of a command sent back in its TX_FRAME_DONE */
+#define MACHINE_REPLY_MAX 62
+
+typedef enum
+{
+    MACHINE_RX_SOF = 0,
+    MACHINE_RX_LEN_LO,
+    MACHINE_RX_LEN_HI,
+    MACHINE_RX_SEQ,
+    MACHINE_RX_TYPE,
+    MACHINE_RX_PAYLOAD,
+    MACHINE_RX_CRC_HI,
+    MACHINE_RX_CRC_LO
+} machine_rx_state_e;
+
+static struct
+{
+    bool on;
+    bool request;                 /**< state to apply by machine_mode_update() */
+    port_itf_e itf;               /**< the interface of the host in the machine mode */
+    machine_rx_state_e state;
+    uint16_t len;                 /**< length of the payload of the frame being received */
+    uint16_t cnt;                 /**< bytes of the frame received after the SOF */
+    uint16_t crc;
+    uint8_t queued;               /**< commands queued in local_buff */
+    uint16_t queue_len;           /**< bytes queued in local_buff */
+    uint8_t frame[TX_FRAME_HDR_LEN - 1 + MACHINE_CMD_MAX]; /**< the frame after the SOF, without its CRC */
+    struct machine_stats_s stats;
+} machine;
+
+bool machine_mode_is_on(void)
+{
+    return machine.on;
+}
+
+/* @fn      machine_mode_itf
+ * @brief   the interface the machine mode was entered from, the only one read in the machine mode
+ * */
+port_itf_e machine_mode_itf(void)
+{
+    return machine.itf;
+}
+
+const struct machine_stats_s *machine_get_stats(void)
+{
+    return &machine.stats;
+}
+
+/* @fn      machine_mode_update
+ * @brief   enters or leaves the machine mode as requested by the MACHINE command,
+ *          once its reply has been sent
+ * */
+void machine_mode_update(void)
+{
+    if (machine.request != machine.on)
+    {
+        machine.on = machine.request;
+        machine.itf = usb_uart_rx_itf();
+        machine.state = MACHINE_RX_SOF;
+        port_tx_set_framing(machine.on, machine.itf);
+    }
+}
+
+static void machine_done(uint8_t seq, machine_status_e status, const char *reply)
+{
+    uint8_t done[1 + MACHINE_REPLY_MAX];
+    int len = 0;
+
+    done[len++] = (uint8_t)status;
+
+    if (reply)
+    {
+        int n = strlen(reply);
+
+        n = (n < MACHINE_REPLY_MAX) ? (n) : (MACHINE_REPLY_MAX);
+        memcpy(&done[len], reply, n);
+        len += n;
+    }
+
+    port_tx_frame_tag(seq);
+    port_tx_frame(done, len, TX_FRAME_DONE);
+    port_tx_frame_tag(0);
+}
+
+/* @brief   a frame was received: queues its command
+ * */
+static void machine_frame(void)
+{
+    uint8_t seq = machine.frame[2];
+    int len = machine.len;
+
+    machine.stats.frames++;
+
+    if (calc_crc16(machine.frame, (uint16_t)(TX_FRAME_HDR_LEN - 1 + len)) != machine.crc)
+    {
+        machine.stats.crc++;
+        machine_done(seq, MACHINE_STATUS_CRC, NULL);
+        return;
+    }
+
+    if (machine.frame[3] != TX_FRAME_CMD)
+    {
+        machine.stats.length++;
+        machine_done(seq, MACHINE_STATUS_LENGTH, NULL);
+        return;
+    }
+
+    if (machine.queued >= MACHINE_INFLIGHT || (machine.queue_len + 2 + len) >= COM_RX_BUF_SIZE)
+    {
+        machine.stats.busy++;
+        machine_done(seq, MACHINE_STATUS_BUSY, NULL);
+        return;
+    }
+
+    local_buff[machine.queue_len++] = seq;
+    memcpy(&local_buff[machine.queue_len], &machine.frame[TX_FRAME_HDR_LEN - 1], len);
+    machine.queue_len += len;
+    local_buff[machine.queue_len++] = 0;
+    machine.queued++;
+}
+
+/*
+ * @brief   the on_rx of the machine mode: receives the frames and queues their commands
+ *
+ * @return  COMMAND_READY : commands are queued in local_buff for machine_mode_process()
+ *          NO_DATA : no command yet
+ */
+usb_data_e machine_rx(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size)
+{
+    machine.queued = 0;
+    machine.queue_len = 0;
+
+    for (uint16_t cnt = 0; cnt < len; cnt++)
+    {
+        uint8_t c = pBuf[*read_offset];
+        *read_offset = (*read_offset + 1) & cyclic_size;
+
+        switch (machine.state)
+        {
+        case MACHINE_RX_SOF:
+            if (c == TX_FRAME_SOF)
+            {
+                machine.cnt = 0;
+                machine.state = MACHINE_RX_LEN_LO;
+            }
+            continue;
+        case MACHINE_RX_LEN_LO:
+            machine.len = c;
+            machine.state = MACHINE_RX_LEN_HI;
+            break;
+        case MACHINE_RX_LEN_HI:
+            machine.len |= (uint16_t)c << 8;
+            machine.state = MACHINE_RX_SEQ;
+            break;
+        case MACHINE_RX_SEQ:
+            machine.state = MACHINE_RX_TYPE;
+            break;
+        case MACHINE_RX_TYPE:
+            if (machine.len > MACHINE_CMD_MAX)
+            {
+                /* hunt for the next frame: a lost SOF must not make a length out of the data */
+                machine.stats.length++;
+                machine_done(machine.frame[2], MACHINE_STATUS_LENGTH, NULL);
+                machine.state = MACHINE_RX_SOF;
+                continue;
+            }
+            machine.state = (machine.len) ? (MACHINE_RX_PAYLOAD) : (MACHINE_RX_CRC_HI);
+            break;
+        case MACHINE_RX_PAYLOAD:
+            if ((machine.cnt + 1) == (TX_FRAME_HDR_LEN - 1 + machine.len))
+            {
+                machine.state = MACHINE_RX_CRC_HI;
+            }
+            break;
+        case MACHINE_RX_CRC_HI:
+            machine.crc = (uint16_t)c << 8;
+            machine.state = MACHINE_RX_CRC_LO;
+            continue;
+        case MACHINE_RX_CRC_LO:
+            machine.crc |= c;
+            machine.state = MACHINE_RX_SOF;
+            machine_frame();
+            continue;
+        }
+
+        machine.frame[machine.cnt++] = c;
+    }
+
+    return (machine.queued) ? (COMMAND_READY) : (NO_DATA);
+}
+
+/* @fn      machine_mode_process
+ * @brief   executes the queued commands, their output is tagged with their sequence number
+ * */
+void machine_mode_process(usb_data_e res)
+{
+    char *text = (char *)local_buff;
+
+    if (res != COMMAND_READY)
+    {
+        return;
+    }
+
+    for (int i = 0; i < machine.queued; i++)
+    {
+        uint8_t seq = (uint8_t)*text++;
+        const char *reply;
+        machine_status_e status;
+
+        for (char *p = text; *p; p++)
+        {
+            *p = (char)toupper(*p);
+        }
+
+        port_tx_frame_tag(seq);
+
+        switch (command_execute(text, &reply))
+        {
+        case _COMMAND_ALLOWED:
+            status = (reply) ? (MACHINE_STATUS_OK) : (MACHINE_STATUS_FAILED);
+            break;
+        case _COMMAND_FOUND:
+            status = MACHINE_STATUS_MODE;
+            break;
+        default:
+            status = MACHINE_STATUS_UNKNOWN;
+            break;
+        }
+
+        machine_done(seq, status, reply);
+
+        text += strlen(text) + 1;
+    }
+
+    machine.queued = 0;
+}
+
+static const char COMMENT_MACHINE[] = {
+    "Machine mode: framed commands with sequence numbers, and framed output.\r\nUsage: To see the counters \"MACHINE\". To enter \"MACHINE 1\", to leave \"MACHINE 0\""};
+
+REG_FN(f_machine)
+{
+    cmd_resp_t resp;
+    char cmd[10];
+    int n, dummy;
+
+    n = sscanf(text, "%9s %d", cmd, &dummy); // to count the number of arguments
+
+    if (n == 2)
+    {
+        if (val != 0 && val != 1)
+        {
+            return (NULL);
+        }
+        machine.request = (val == 1);
+    }
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"MACHINE\":{\"On\":%d,\"Frames\":%lu,\"Crc_err\":%lu,\"Busy\":%lu,\"Len_err\":%lu}}",
+                        machine.request, (unsigned long)machine.stats.frames, (unsigned long)machine.stats.crc,
+                        (unsigned long)machine.stats.busy, (unsigned long)machine.stats.length);
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+const struct command_s known_commands_machine[] __attribute__((section(".known_commands_anytime"))) = {
+    {"MACHINE", mCmdGrp1 | mANY, f_machine, COMMENT_MACHINE},
+};
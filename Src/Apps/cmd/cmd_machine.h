@@ -0,0 +1,108 @@
+/**
+ * @file      cmd_machine.h
+ *
+ * @brief     Machine mode of the command interface: framed, sequence-tagged commands
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef CMD_MACHINE_H_
+#define CMD_MACHINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app.h"
+#include "usb_uart_tx.h"
+
+/* In the machine mode the host sends TX_FRAME_CMD frames (see usb_uart_tx.h), with a
+ * command line of the text interface as payload and a sequence number of its choice.
+ * There is no echo. Everything the device sends is framed: the output of a command in
+ * TX_FRAME_DATA frames with its sequence number, then one TX_FRAME_DONE frame with its
+ * sequence number and the payload
+ *   0     1    status, machine_status_e
+ *   1     N    reply of the command, or the error
+ * Up to MACHINE_INFLIGHT commands may be sent without waiting for their TX_FRAME_DONE.
+ * "MACHINE 1" enters the machine mode, "MACHINE 0" leaves it. The machine mode belongs to
+ * the interface it was entered from, the input of the other interfaces is dropped meanwhile.
+ * */
+
+#define MACHINE_INFLIGHT 8     /**< commands received and not executed yet */
+#define MACHINE_CMD_MAX  0x100 /**< longest command line, as the text interface */
+
+typedef enum
+{
+    MACHINE_STATUS_OK = 0,
+    MACHINE_STATUS_UNKNOWN, /**< unknown command */
+    MACHINE_STATUS_MODE,    /**< the command is not allowed in the current mode */
+    MACHINE_STATUS_FAILED,  /**< the command returned an error */
+    MACHINE_STATUS_CRC,     /**< bad CRC, the command was not executed */
+    MACHINE_STATUS_BUSY,    /**< more than MACHINE_INFLIGHT commands, the command was not executed */
+    MACHINE_STATUS_LENGTH,  /**< longer than MACHINE_CMD_MAX, or not a command frame */
+} machine_status_e;
+
+struct machine_stats_s
+{
+    uint32_t frames;  /**< commands received */
+    uint32_t crc;     /**< frames with a bad CRC */
+    uint32_t busy;    /**< commands refused, MACHINE_INFLIGHT exceeded */
+    uint32_t length;  /**< frames refused by their length or type */
+};
+
+bool machine_mode_is_on(void);
+port_itf_e machine_mode_itf(void);
+void machine_mode_update(void);
+usb_data_e machine_rx(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size);
+void machine_mode_process(usb_data_e res);
+const struct machine_stats_s *machine_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMD_MACHINE_H_ */
@@ -0,0 +1,261 @@
+/**
+ * @file      cmd_resp.c
+ *
+ * @brief     Builder of the replies of the commands, formatted in place in the reporter's buffer
+ *
+ *            Every append costs only the bytes it adds: the length is kept, not searched for.
+ *            The reporter is waited for when it has no room, instead of dropping the reply.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "cmd_resp.h"
+#include "cmsis_os.h"
+#include "reporter.h"
+#include "str_fmt.h"
+#include "usb_uart_tx.h"
+
+#define CMD_RESP_HDR "JS5A5A" /**< placeholder of the "JSxxxx" header */
+
+/* @brief   reserves max bytes in the reporter's buffer, waiting for room
+ * */
+static bool cmd_resp_reserve(cmd_resp_t *r)
+{
+    for (int wait_ms = 0; !port_tx_room(r->max); wait_ms++)
+    {
+        if (wait_ms >= CMD_RESP_WAIT_MS)
+        {
+            break; /**< the reservation below reports the overflow */
+        }
+        osDelay(1);
+    }
+
+    r->buf = reporter_instance.reserve(r->max);
+    r->len = 0;
+    return (r->buf != NULL);
+}
+
+static bool cmd_resp_begin(cmd_resp_t *r, int max, int hlen)
+{
+    r->max = max;
+    r->hlen = hlen;
+    return cmd_resp_reserve(r);
+}
+
+/* @brief   drops the reply
+ * */
+static void cmd_resp_fail(cmd_resp_t *r)
+{
+    if (r->buf)
+    {
+        reporter_instance.commit(0);
+        r->buf = NULL;
+    }
+}
+
+/* @brief   sends the chunk of a text reply and reserves the next one
+ * @return  false for a JSON reply, which does not fit
+ * */
+static bool cmd_resp_next(cmd_resp_t *r)
+{
+    if (r->hlen || r->len == 0)
+    {
+        return false;
+    }
+    reporter_instance.commit(r->len);
+    return cmd_resp_reserve(r);
+}
+
+/* @brief   keeps len, the result of an append, or fails the reply
+ * */
+static void cmd_resp_set(cmd_resp_t *r, int len)
+{
+    if (len < 0)
+    {
+        cmd_resp_fail(r);
+    }
+    else
+    {
+        r->len = len;
+    }
+}
+
+/* appends with a str_fmt emitter, once more in a new chunk if it did not fit */
+#define CMD_RESP_APPEND(r, emit)               \
+    do                                         \
+    {                                          \
+        int len_;                              \
+        if (!(r)->buf)                         \
+            break;                             \
+        len_ = (emit);                         \
+        if (len_ < 0 && cmd_resp_next(r))      \
+            len_ = (emit);                     \
+        cmd_resp_set((r), len_);               \
+    } while (0)
+
+/* @fn      cmd_resp_json
+ * @brief   starts a JSON reply of up to max bytes, header included
+ * @return  false if the reporter has no room
+ * */
+bool cmd_resp_json(cmd_resp_t *r, int max)
+{
+    if (!cmd_resp_begin(r, max, (int)strlen(CMD_RESP_HDR)))
+    {
+        return false;
+    }
+    cmd_resp_set(r, fmt_str(r->buf, 0, r->max, CMD_RESP_HDR));
+    return (r->buf != NULL);
+}
+
+/* @fn      cmd_resp_text
+ * @brief   starts a text reply, sent by chunks of up to max bytes
+ * @return  false if the reporter has no room
+ * */
+bool cmd_resp_text(cmd_resp_t *r, int max)
+{
+    return cmd_resp_begin(r, max, 0);
+}
+
+/* @brief   appends s, split over several chunks of a text reply if needed
+ * */
+void cmd_resp_str(cmd_resp_t *r, const char *s)
+{
+    int n = (int)strlen(s);
+
+    while (r->buf && n > 0)
+    {
+        int room = r->max - r->len;
+
+        if (room == 0 || (r->hlen && n > room))
+        {
+            if (!cmd_resp_next(r))
+            {
+                cmd_resp_fail(r);
+            }
+            continue;
+        }
+
+        room = (n < room) ? (n) : (room);
+        memcpy(&r->buf[r->len], s, room);
+        r->len += room;
+        s += room;
+        n -= room;
+    }
+}
+
+void cmd_resp_char(cmd_resp_t *r, char c)
+{
+    CMD_RESP_APPEND(r, fmt_char(r->buf, r->len, r->max, c));
+}
+
+void cmd_resp_int(cmd_resp_t *r, int32_t v)
+{
+    CMD_RESP_APPEND(r, fmt_int(r->buf, r->len, r->max, v));
+}
+
+void cmd_resp_uint(cmd_resp_t *r, uint32_t v)
+{
+    CMD_RESP_APPEND(r, fmt_uint(r->buf, r->len, r->max, v));
+}
+
+/* @brief   appends v as "%0<width>X", or "%0<width>x" if not upper
+ * */
+void cmd_resp_hex(cmd_resp_t *r, uint32_t v, int width, bool upper)
+{
+    CMD_RESP_APPEND(r, fmt_hex(r->buf, r->len, r->max, v, width, upper));
+}
+
+/* @brief   appends a printf conversion, for the formats which str_fmt has not
+ * */
+void cmd_resp_printf(cmd_resp_t *r, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    for (int pass = 0; r->buf && pass < 2; pass++)
+    {
+        /* vsnprintf() terminates the string: the room shall exceed the output */
+        va_start(ap, fmt);
+        n = vsnprintf(&r->buf[r->len], r->max - r->len, fmt, ap);
+        va_end(ap);
+
+        if (n >= 0 && n < (r->max - r->len))
+        {
+            r->len += n;
+            return;
+        }
+        if (pass > 0 || !cmd_resp_next(r))
+        {
+            cmd_resp_fail(r);
+        }
+    }
+}
+
+/* @fn      cmd_resp_end
+ * @brief   fills the length of a JSON reply, which is ended by "\r\n", and sends the reply
+ * @return  _ERR if the reply did not fit or the reporter had no room, nothing is then sent
+ * */
+error_e cmd_resp_end(cmd_resp_t *r)
+{
+    if (r->buf && r->hlen)
+    {
+        fmt_hex(r->buf, 2, r->max, r->len - r->hlen, 4, true);
+        cmd_resp_set(r, fmt_str(r->buf, r->len, r->max, "\r\n"));
+    }
+
+    if (!r->buf)
+    {
+        return _ERR;
+    }
+
+    reporter_instance.commit(r->len);
+    r->buf = NULL;
+    return _NO_ERR;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file      cmd_resp.h
+ *
+ * @brief     Builder of the replies of the commands, formatted in place in the reporter's buffer
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef CMD_RESP_H_
+#define CMD_RESP_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "deca_error.h"
+
+/* A reply is appended to a space reserved in the reporter's buffer, the builder keeps its length.
+ *
+ * A JSON reply starts with the "JSxxxx" header, xxxx being the length of the JSON object in hex,
+ * which cmd_resp_end() fills in. The object shall fit in the space reserved by cmd_resp_json().
+ * A text reply is sent by chunks: when an append does not fit, the chunk is sent and a new one reserved.
+ *
+ * An append which cannot be done marks the reply as failed, the following ones are ignored
+ * and cmd_resp_end() drops the reply.
+ */
+
+/* the builder gives up when the reporter has had no room for a chunk for that long */
+#define CMD_RESP_WAIT_MS (1000)
+
+typedef struct
+{
+    char *buf; /**< space reserved in the reporter's buffer, NULL once failed */
+    int len;   /**< bytes formatted in buf */
+    int max;   /**< size of buf */
+    int hlen;  /**< length of the "JSxxxx" header, 0 for a text reply */
+} cmd_resp_t;
+
+bool cmd_resp_json(cmd_resp_t *r, int max);
+bool cmd_resp_text(cmd_resp_t *r, int max);
+void cmd_resp_str(cmd_resp_t *r, const char *s);
+void cmd_resp_char(cmd_resp_t *r, char c);
+void cmd_resp_int(cmd_resp_t *r, int32_t v);
+void cmd_resp_uint(cmd_resp_t *r, uint32_t v);
+void cmd_resp_hex(cmd_resp_t *r, uint32_t v, int width, bool upper);
+void cmd_resp_printf(cmd_resp_t *r, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+error_e cmd_resp_end(cmd_resp_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMD_RESP_H_ */
@@ -54,6 +54,7 @@
 #include "reporter.h"
 #include "rf_tuning_config.h"
 #include "deca_dbg.h"
+#include "cmd_resp.h"
 
 const char COMMENT_PDOAOFF         []={"Phase Difference offset for this Node\r\nUsage: To see Phase Difference offset value \"PDOAOFF\". To set the Phase Difference offset value \"PDOAOFF <DEC>\""};
 
@@ -129,39 +130,27 @@ REG_FN(f_ant_rx_b)
 
 REG_FN(f_pdoa_offset)
 {
-    const char *ret = CMD_FN_RET_OK;
-
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
-
+    cmd_resp_t resp;
+    char cmd[10];
     int n, dummy;
 
-    if (str)
-    {
-        rf_tuning_t *rf_tuning = get_rf_tuning_config();
-
-        n = sscanf(text, "%9s %d", str, &dummy); // to count the number of arguments
-
-        if (n == 2)
-        {
-            rf_tuning->pdoaOffset_deg = (int16_t)val; // val is the input
-        }
-
-        int hlen;
-
-        hlen = sprintf(str, "JS%04X", 0x5A5A);
-        sprintf(&str[strlen(str)], "{\"PDOAOFF_deg\":%d}", rf_tuning->pdoaOffset_deg);
+    rf_tuning_t *rf_tuning = get_rf_tuning_config();
 
-        sprintf(&str[2], "%04X", strlen(str) - hlen);
-        str[hlen] = '{';
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
+    n = sscanf(text, "%9s %d", cmd, &dummy); // to count the number of arguments
 
-        CMD_FREE(str);
+    if (n == 2)
+    {
+        rf_tuning->pdoaOffset_deg = (int16_t)val; // val is the input
+    }
 
-        ret = CMD_FN_RET_OK;
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"PDOAOFF_deg\":");
+        cmd_resp_int(&resp, rf_tuning->pdoaOffset_deg);
+        cmd_resp_char(&resp, '}');
     }
 
-    return (ret);
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 /**
@@ -175,47 +164,38 @@ REG_FN(f_xtal_trim)
 {
     const char *ret = CMD_FN_RET_OK;
 
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
-
+    cmd_resp_t resp;
+    char cmd[10];
     int n, xtalTrim;
 
-    if (str)
-    {
-        rf_tuning_t *rf_tuning = get_rf_tuning_config();
-        n = sscanf(text, "%9s 0X%02x", str, &xtalTrim);
-
-        CMD_ENTER_CRITICAL();
-
-        if (n == 2)
-        {
-            dwt_setxtaltrim((uint8_t)xtalTrim & 0x7F);
-        }
-        else
-        {
-            dwt_setxtaltrim(rf_tuning->xtalTrim & XTAL_TRIM_BIT_MASK);
-            xtalTrim = dwt_getxtaltrim() | (rf_tuning->xtalTrim & ~XTAL_TRIM_BIT_MASK);
-        }
-
-        rf_tuning->xtalTrim = xtalTrim; // it can have the 0x80 bit set to be able overwrite OTP values during APP starts.
+    rf_tuning_t *rf_tuning = get_rf_tuning_config();
+    n = sscanf(text, "%9s 0X%02x", cmd, &xtalTrim);
 
-        CMD_EXIT_CRITICAL();
+    CMD_ENTER_CRITICAL();
 
-        /* Display the XTAL object */
-        int hlen;
+    if (n == 2)
+    {
+        dwt_setxtaltrim((uint8_t)xtalTrim & 0x7F);
+    }
+    else
+    {
+        dwt_setxtaltrim(rf_tuning->xtalTrim & XTAL_TRIM_BIT_MASK);
+        xtalTrim = dwt_getxtaltrim() | (rf_tuning->xtalTrim & ~XTAL_TRIM_BIT_MASK);
+    }
 
-        hlen = sprintf(str, "JS%04X", 0x5A5A); // reserve space for length of JS object
-        sprintf(&str[strlen(str)], "{\"XTAL\":{\r\n");
-        sprintf(&str[strlen(str)], "\"TEMP TRIM\":\"0x%02x\"}}", xtalTrim);
+    rf_tuning->xtalTrim = xtalTrim; // it can have the 0x80 bit set to be able overwrite OTP values during APP starts.
 
-        sprintf(&str[2], "%04X", strlen(str) - hlen); // add formatted 4X of length, this will erase first '{'
-        str[hlen] = '{';                              // restore the start bracket
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
+    CMD_EXIT_CRITICAL();
 
-        CMD_FREE(str);
+    /* Display the XTAL object */
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"XTAL\":{\r\n\"TEMP TRIM\":\"0x");
+        cmd_resp_hex(&resp, (uint32_t)xtalTrim, 2, false);
+        cmd_resp_str(&resp, "\"}}");
     }
 
-    return (ret);
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (ret) : (NULL);
 }
 
 const struct command_s known_commands_idle_rf[] __attribute__((section(".known_commands_ilde"))) = {
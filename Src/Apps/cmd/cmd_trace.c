@@ -0,0 +1,146 @@
+/**
+ * @file      cmd_trace.c
+ *
+ * @brief     Dump of the tracepoints of the hot paths
+ *
+ *            The records are sent as REPORT_BIN_TYPE_TRACE frames, to be decoded on the host
+ *            by Tools/trace_decode.py, then the counts are replied in JSON.
+ *
+ * @author    Decawave Applications
+ *
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include "trace.h"
+
+#if (TRACE_ENABLE)
+
+#include "cmd.h"
+#include "cmd_fn.h"
+#include "cmd_resp.h"
+#include "cmsis_os.h"
+#include "reporter.h"
+#include "report_bin.h"
+#include "usb_uart_tx.h"
+#include "HAL_cycles.h"
+
+#define TRACE_FRAME_RECS (32) /**< records per frame */
+#define TRACE_FRAME_SIZE (REPORT_BIN_HDR_LEN + REPORT_BIN_TRACE_HDR_LEN + TRACE_FRAME_RECS * REPORT_BIN_TRACE_LEN + REPORT_BIN_CRC_LEN)
+
+static uint32_t trace_pos; /**< first record not dumped yet */
+
+/* @brief   sends a frame of the records, waiting for room in the reporter's buffer
+ * */
+static bool trace_send(const struct trace_rec_s *rec, int n)
+{
+    uint8_t *buf;
+    int len;
+
+    for (int wait_ms = 0; !port_tx_room(TRACE_FRAME_SIZE) && wait_ms < CMD_RESP_WAIT_MS; wait_ms++)
+    {
+        osDelay(1);
+    }
+
+    buf = (uint8_t *)reporter_instance.reserve(TRACE_FRAME_SIZE);
+    if (!buf)
+    {
+        return false;
+    }
+
+    len = report_bin_trace_begin(buf, TRACE_FRAME_SIZE, HAL_CYCLES_PER_US);
+    for (int i = 0; i < n && len > 0; i++)
+    {
+        len = report_bin_trace_add(buf, len, TRACE_FRAME_SIZE, &rec[i]);
+    }
+    len = (len > 0) ? (report_bin_end(buf, len, TRACE_FRAME_SIZE)) : (len);
+
+    reporter_instance.commit((len > 0) ? (len) : (0));
+    return (len > 0);
+}
+
+static const char COMMENT_TRACE[] = {
+    "Dumps the tracepoints recorded since the last dump as binary frames, then the records sent and lost.\r\nUsage: \"TRACE\", the frames are decoded by Tools/trace_decode.py"};
+
+/**
+ * @brief dumps the records, the recording is paused meanwhile
+ *
+ * */
+REG_FN(f_trace)
+{
+    struct trace_rec_s rec[TRACE_FRAME_RECS];
+    uint32_t sent = 0, lost = 0;
+    int n;
+    cmd_resp_t resp;
+
+    trace_pause(true);
+
+    while ((n = trace_read(&trace_pos, rec, TRACE_FRAME_RECS, &lost)) > 0)
+    {
+        if (!trace_send(rec, n))
+        {
+            lost += n;
+            break;
+        }
+        sent += n;
+    }
+
+    trace_pause(false);
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"TRACE\":{\"Len\":%u,\"Sent\":%lu,\"Lost\":%lu}}", TRACE_LEN, (unsigned long)sent,
+                        (unsigned long)lost);
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+const struct command_s known_commands_trace[] __attribute__((section(".known_commands_anytime"))) = {
+    {"TRACE", mCmdGrp1 | mANY, f_trace, COMMENT_TRACE},
+};
+
+#endif /* TRACE_ENABLE */
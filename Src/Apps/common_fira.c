@@ -66,6 +66,8 @@
 #include "HAL_uwb.h"
 #include "rf_tuning_config.h"
 #include "dw3000_pdoa.h"
+#include "cmd_resp.h"
+#include "usb_uart_tx.h"
 
 #ifdef FIRA_PARAM_CUSTOM
 #include "fira_custom_params.h"
@@ -79,86 +81,72 @@ static int local_pavrg_size;
 
 void show_fira_params()
 {
-#define REMAINING (2048 - strlen(str))
-    /* Display the Fira session */
-    char *str = malloc(2048);
-    int hlen;
+#define FIRA_PARAMS_STR_SIZE (1024)
+    /* Display the Fira session, formatted straight into the reporter's buffer */
+    cmd_resp_t resp;
+    fira_param_t *fira_param = get_fira_config();
 
-    if (!str)
+    if (!cmd_resp_json(&resp, FIRA_PARAMS_STR_SIZE))
     {
-        char *err = "not enough memory";
-        reporter_instance.print((char *)err, strlen(err));
         return;
     }
-    fira_param_t *fira_param = get_fira_config();
-    hlen = sprintf(str, "JS%04X",
-                   0x5A5A); // reserve space for length of JS object
-    snprintf(&str[strlen(str)], REMAINING, "{\"F PARAMS\":{\r\n");
-
-    snprintf(&str[strlen(str)], REMAINING, "\"SLOT, rstu\":%" PRIu32 ",\r\n",
-             fira_param->session.slot_duration_rstu);
-    snprintf(&str[strlen(str)], REMAINING, "\"Ranging Period, ms\":%" PRIu32 ",\r\n",
-             fira_param->session.block_duration_ms);
-    snprintf(&str[strlen(str)], REMAINING,
-             "\"Ranging round, slots\":%" PRIu32 ",\r\n",
-             fira_param->session.round_duration_slots);
-    snprintf(&str[strlen(str)], REMAINING,
-             "\"Ranging round usage (Unicast,SS,DS)\":%u,\r\n",
-             fira_param->session.ranging_round_usage);
-    snprintf(&str[strlen(str)], REMAINING, "\"Session_ID\":%u,\r\n",
-             (unsigned int)fira_param->session_id);
-    snprintf(&str[strlen(str)], REMAINING, "\"RFRAME\":%u,\r\n",
-             fira_param->session.rframe_config);
+
+    cmd_resp_str(&resp, "{\"F PARAMS\":{\r\n");
+
+    cmd_resp_str(&resp, "\"SLOT, rstu\":");
+    cmd_resp_uint(&resp, fira_param->session.slot_duration_rstu);
+    cmd_resp_str(&resp, ",\r\n\"Ranging Period, ms\":");
+    cmd_resp_uint(&resp, fira_param->session.block_duration_ms);
+    cmd_resp_str(&resp, ",\r\n\"Ranging round, slots\":");
+    cmd_resp_uint(&resp, fira_param->session.round_duration_slots);
+    cmd_resp_str(&resp, ",\r\n\"Ranging round usage (Unicast,SS,DS)\":");
+    cmd_resp_uint(&resp, fira_param->session.ranging_round_usage);
+    cmd_resp_str(&resp, ",\r\n\"Session_ID\":");
+    cmd_resp_uint(&resp, fira_param->session_id);
+    cmd_resp_str(&resp, ",\r\n\"RFRAME\":");
+    cmd_resp_uint(&resp, fira_param->session.rframe_config);
+    cmd_resp_str(&resp, ",\r\n");
     if (fira_param->session.rframe_config == FIRA_RFRAME_CONFIG_SP1)
     {
-        snprintf(&str[strlen(str)], REMAINING,
-                 "\"Vendor OUI\" 0x%06" PRIX32 ",\r\n",
-                 fira_param->session.data_vendor_oui);
+        cmd_resp_str(&resp, "\"Vendor OUI\" 0x");
+        cmd_resp_hex(&resp, fira_param->session.data_vendor_oui, 6, true);
+        cmd_resp_str(&resp, ",\r\n");
     }
-    snprintf(&str[strlen(str)], REMAINING, "\"SFD ID\":%u,\r\n",
-             fira_param->session.sfd_id);
-    snprintf(&str[strlen(str)], REMAINING, "\"Multi node mode\":%u,\r\n",
-             fira_param->session.multi_node_mode);
-    snprintf(&str[strlen(str)], REMAINING, "\"Round hopping\":%d,\r\n",
-             fira_param->session.round_hopping);
-    uint8_t *v = fira_param->session.vupper64;
-    snprintf(&str[strlen(str)], REMAINING,
-             "\"Vupper64\":\"%02x%02x%02x%02x%02x%02x%02x%02x\",\r\n",
-             v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
-
-    snprintf(&str[strlen(str)], REMAINING, "\"Initiator Addr\":\"0x%04X\",\r\n",
-             (fira_param->session.device_type == FIRA_DEVICE_TYPE_CONTROLLER) ? (fira_param->session.short_addr) : (fira_param->session.destination_short_address));
-
+    cmd_resp_str(&resp, "\"SFD ID\":");
+    cmd_resp_uint(&resp, fira_param->session.sfd_id);
+    cmd_resp_str(&resp, ",\r\n\"Multi node mode\":");
+    cmd_resp_uint(&resp, fira_param->session.multi_node_mode);
+    cmd_resp_str(&resp, ",\r\n\"Round hopping\":");
+    cmd_resp_int(&resp, fira_param->session.round_hopping);
+    cmd_resp_str(&resp, ",\r\n\"Vupper64\":\"");
+    for (int i = 0; i < FIRA_VUPPER64_SIZE; i++)
+    {
+        cmd_resp_hex(&resp, fira_param->session.vupper64[i], 2, false);
+    }
+    cmd_resp_str(&resp, "\",\r\n\"Initiator Addr\":\"0x");
+    cmd_resp_hex(&resp,
+                 (fira_param->session.device_type == FIRA_DEVICE_TYPE_CONTROLLER) ? (fira_param->session.short_addr) : (fira_param->session.destination_short_address),
+                 4, true);
+    cmd_resp_str(&resp, "\",\r\n");
 
     for (int i = 0; i < fira_param->controlees_params.n_controlees; i++)
     {
-        /* Remove the trailing , in the last param */
+        cmd_resp_str(&resp, "\"Responder[");
+        cmd_resp_int(&resp, i);
+        cmd_resp_str(&resp, "] Addr\":\"0x");
+        cmd_resp_hex(&resp, fira_param->controlees_params.controlees[i].address, 4, true);
+        /* Don't append a , after the last item */
+        cmd_resp_str(&resp, (i == fira_param->controlees_params.n_controlees - 1) ? ("\"\r\n") : ("\",\r\n"));
+    }
 
-        snprintf(&str[strlen(str)], REMAINING,
-                 "\"Responder[%d] Addr\":\"0x%04X\"", i,
-                 fira_param->controlees_params.controlees[i].address);
-        /* Check if it is the last item */
-        if (i == fira_param->controlees_params.n_controlees - 1)
-        {
-            /* Don't append a , at the end */
-            snprintf(&str[strlen(str)], REMAINING, "\r\n");
-        }
-        else
-        {
-            snprintf(&str[strlen(str)], REMAINING, ",\r\n");
-        }
+    cmd_resp_str(&resp, "}}");
+
+    /* the session is started next: let the parameters be sent first */
+    if (cmd_resp_end(&resp) == _NO_ERR)
+    {
+        port_tx_wait_flushed(CMD_RESP_WAIT_MS);
     }
-    snprintf(
-        &str[2], REMAINING, "%04X",
-        strlen(str) - hlen); // add formatted 4X of length, this will erase first '{'
-    str[hlen] = '{';         // restore the start bracket
-    sprintf(&str[strlen(str)], "}}\r\n");
-
-    reporter_instance.print((char *)str, strlen(str));
-    free(str);
-    /* Wait a little bit for printing. */
-    osDelay(100);
-#undef REMAINING
+#undef FIRA_PARAMS_STR_SIZE
 }
 
 void scan_fira_params(const char *text, bool controller)
@@ -0,0 +1,85 @@
+/**
+ * @file      report_config.c
+ *
+ * @brief     Report config file for NVM initialization
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include "report_config.h"
+#include <string.h>
+
+#define DEFAULT_REPORT_FORMAT REPORT_FORMAT_JSON
+#define DEFAULT_AGGR_BLOCKS   0 /**< every block is reported */
+#define DEFAULT_AGGR_PERIOD   0
+#define DEFAULT_DELTA_MM      10  /**< 1 cm */
+#define DEFAULT_DELTA_ANGLE   91  /**< 0.5 deg */
+#define DEFAULT_DELTA_CFO     10  /**< 0.1 ppm */
+#define DEFAULT_DELTA_KEY     50
+
+static const report_config_t report_config_flash_default = {
+    .format = DEFAULT_REPORT_FORMAT,
+    .aggr_blocks = DEFAULT_AGGR_BLOCKS,
+    .aggr_period_ms = DEFAULT_AGGR_PERIOD,
+    .delta_mm = DEFAULT_DELTA_MM,
+    .delta_angle = DEFAULT_DELTA_ANGLE,
+    .delta_cfo = DEFAULT_DELTA_CFO,
+    .delta_key = DEFAULT_DELTA_KEY,
+};
+
+static report_config_t report_config_ram __attribute__((section(".rconfig"))) = {0};
+
+report_config_t *get_report_config(void)
+{
+    return &report_config_ram;
+}
+
+static void restore_report_default_config(void)
+{
+    memcpy(&report_config_ram, &report_config_flash_default, sizeof(report_config_ram));
+}
+
+__attribute__((section(".config_entry"))) const void (*p_restore_report_default_config)(void) = (const void *)&restore_report_default_config;
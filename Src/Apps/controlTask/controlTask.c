@@ -60,8 +60,12 @@
 #include "task_signal.h"
 #include "usb_uart_rx.h"
 #include "usb_uart_tx.h"
+#ifdef CLI_BUILD
+#include "cmd_machine.h"
+#endif
 
 #define CONTROL_TASK_STACK_SIZE_BYTES 2048
+#define CTRL_STOP_FLUSH_MS            500 /**< longest wait for the reports to be sent before stopping the app */
 
 task_signal_t ctrlTask;
 
@@ -72,13 +76,15 @@ uint8_t local_buff[COM_RX_BUF_SIZE];                         /**< for RX from US
 /**
  * @brief     this is a Command Control and Data task.
  *             this task is activated on the startup
- *             there 2 sources of control data: Uart and Usb.
+ *             there 3 sources of control data: Uart, Usb and BLE, each one with its own parser.
  *
  * */
 static void CtrlTask(void const *arg)
 {
     usb_data_e res;
 
+    port_tx_register(TX_PRODUCER_CTRL);
+
     while (1)
     {
         osEvent evt = osSignalWait(ctrlTask.SignalMask, osWaitForever); /* signal from USB/UART that some data has been received */
@@ -86,7 +92,7 @@ static void CtrlTask(void const *arg)
 #ifdef CLI_BUILD
         if (evt.value.signals & CTRL_STOP_APP)
         {
-            osDelay(500);//time for flushing, TODO: create a function for testing flushing is over
+            port_tx_wait_flushed(CTRL_STOP_FLUSH_MS);
             command_stop_received();
         }
 #endif
@@ -100,7 +106,19 @@ static void CtrlTask(void const *arg)
                                      for future processing */
             leave_critical_section();
 
-            AppGet()->command_parser(res, (char *)local_buff);
+#ifdef CLI_BUILD
+            if (machine_mode_is_on())
+            {
+                machine_mode_process(res);
+            }
+            else
+#endif
+            {
+                AppGet()->command_parser(res, (char *)local_buff);
+            }
+#ifdef CLI_BUILD
+            machine_mode_update();
+#endif
         }
     }
 }
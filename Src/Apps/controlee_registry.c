@@ -0,0 +1,276 @@
+/**
+ * @file      controlee_registry.c
+ *
+ * @brief     Registry of the controlees of a FiRa controller, added and removed at runtime
+ *
+ *            The entries keep their slot for as long as they are registered: the commands add and
+ *            remove them, while the report task only updates the counters of the active ones.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+#include "controlee_registry.h"
+#include "critical_section.h"
+
+/* consecutive errors after which misses stops counting */
+#define CONTROLEE_MISSES_MAX (UINT8_MAX)
+
+static struct controlee_entry_s registry[CONTROLEE_REGISTRY_MAX];
+
+/* The registry is updated by the report task and changed by the control task:
+ * every access is made in a critical section, kept short as the registry is small */
+
+/* @brief   index of the registered address, -1 if unknown
+ * */
+static int controlee_registry_find(uint16_t address)
+{
+    for (int i = 0; i < CONTROLEE_REGISTRY_MAX; i++)
+    {
+        if (registry[i].state != CONTROLEE_FREE && registry[i].address == address)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void controlee_registry_reset(void)
+{
+    enter_critical_section();
+    memset(registry, 0, sizeof(registry));
+    leave_critical_section();
+}
+
+/* @fn      controlee_registry_add
+ * @brief   registers the address as waiting
+ * @return  index of the entry, -1 if the address is already registered or the registry is full
+ * */
+int controlee_registry_add(uint16_t address)
+{
+    int ret = -1;
+
+    enter_critical_section();
+
+    if (controlee_registry_find(address) < 0)
+    {
+        for (int i = 0; i < CONTROLEE_REGISTRY_MAX; i++)
+        {
+            if (registry[i].state == CONTROLEE_FREE)
+            {
+                memset(&registry[i], 0, sizeof(registry[i]));
+                registry[i].address = address;
+                registry[i].state = CONTROLEE_WAITING;
+                ret = i;
+                break;
+            }
+        }
+    }
+
+    leave_critical_section();
+    return ret;
+}
+
+/* @fn      controlee_registry_remove
+ * @return  controlee_state_e the address had, -1 if it was not registered
+ * */
+int controlee_registry_remove(uint16_t address)
+{
+    int i, state = -1;
+
+    enter_critical_section();
+
+    i = controlee_registry_find(address);
+    if (i >= 0)
+    {
+        state = registry[i].state;
+        registry[i].state = CONTROLEE_FREE;
+    }
+
+    leave_critical_section();
+    return state;
+}
+
+/* @fn      controlee_registry_get_state
+ * @return  controlee_state_e of the address, -1 if it is not registered
+ * */
+int controlee_registry_get_state(uint16_t address)
+{
+    int i, state = -1;
+
+    enter_critical_section();
+
+    i = controlee_registry_find(address);
+    if (i >= 0)
+    {
+        state = registry[i].state;
+    }
+
+    leave_critical_section();
+    return state;
+}
+
+void controlee_registry_set_state(uint16_t address, controlee_state_e state)
+{
+    enter_critical_section();
+
+    int i = controlee_registry_find(address);
+
+    if (i >= 0 && state != CONTROLEE_FREE)
+    {
+        registry[i].state = (uint8_t)state;
+        registry[i].misses = 0;
+    }
+
+    leave_critical_section();
+}
+
+/* @fn      controlee_registry_next_waiting
+ * @return  address of the first waiting controlee, -1 if none waits
+ * */
+int controlee_registry_next_waiting(void)
+{
+    int address = -1;
+
+    enter_critical_section();
+
+    for (int i = 0; i < CONTROLEE_REGISTRY_MAX; i++)
+    {
+        if (registry[i].state == CONTROLEE_WAITING)
+        {
+            address = registry[i].address;
+            break;
+        }
+    }
+
+    leave_critical_section();
+    return address;
+}
+
+int controlee_registry_count(controlee_state_e state)
+{
+    int n = 0;
+
+    enter_critical_section();
+
+    for (int i = 0; i < CONTROLEE_REGISTRY_MAX; i++)
+    {
+        n += (registry[i].state == state);
+    }
+
+    leave_critical_section();
+    return n;
+}
+
+/* @fn      controlee_registry_get_active
+ * @brief   fills controlees with the active controlees, at most FIRA_CONTROLEES_MAX
+ * @return  number of active controlees
+ * */
+int controlee_registry_get_active(struct controlees_parameters *controlees)
+{
+    controlees->n_controlees = 0;
+
+    enter_critical_section();
+
+    for (int i = 0; i < CONTROLEE_REGISTRY_MAX && controlees->n_controlees < FIRA_CONTROLEES_MAX; i++)
+    {
+        if (registry[i].state == CONTROLEE_ACTIVE)
+        {
+            controlees->controlees[controlees->n_controlees++].address = registry[i].address;
+        }
+    }
+
+    leave_critical_section();
+    return controlees->n_controlees;
+}
+
+/* @fn      controlee_registry_get
+ * @brief   copies the entry at index into entry
+ * @return  false past the end of the registry
+ * */
+bool controlee_registry_get(int index, struct controlee_entry_s *entry)
+{
+    if (index < 0 || index >= CONTROLEE_REGISTRY_MAX)
+    {
+        return false;
+    }
+
+    enter_critical_section();
+    *entry = registry[index];
+    leave_critical_section();
+    return true;
+}
+
+/* @fn      controlee_registry_update
+ * @brief   counts the measurements of the results per active controlee
+ * */
+void controlee_registry_update(const struct ranging_results *results)
+{
+    enter_critical_section();
+
+    for (int i = 0; i < results->n_measurements; i++)
+    {
+        const struct ranging_measurements *rm = &results->measurements[i];
+        int j = controlee_registry_find(rm->short_addr);
+
+        if (j < 0 || registry[j].state != CONTROLEE_ACTIVE)
+        {
+            continue;
+        }
+        if (rm->status == 0)
+        {
+            registry[j].ok++;
+            registry[j].misses = 0;
+        }
+        else
+        {
+            registry[j].err++;
+            registry[j].misses += (registry[j].misses < CONTROLEE_MISSES_MAX);
+        }
+    }
+
+    leave_critical_section();
+}
@@ -62,6 +62,7 @@
 #include "deca_dbg.h"
 #include "defaultTask.h"
 #include "int_priority.h"
+#include "boot_time.h"
 #ifdef USB_ENABLE
 #include "HAL_usb.h"
 #endif
@@ -113,6 +114,7 @@ void StartDefaultTask(void const *argument)
             /* Start appropriate RTOS top-level application:
              Contract: App registred should point to a valid application from the flash */
             AppSet(queue_message);
+            boot_time_mark(BOOT_APP);
             if (queue_message->helper != NULL)
             {
                 queue_message->helper(NULL);
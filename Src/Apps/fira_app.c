@@ -51,6 +51,7 @@
 
 #include <stdint.h>
 #include <inttypes.h>
+#include <string.h>
 #include "reporter.h"
 #include "deca_error.h"
 #include "app.h"
@@ -70,35 +71,25 @@
 #include "cmd.h"
 
 #include "fira_app.h"
+#include "fira_report.h"
 #include "dw3000_pdoa.h"
 #include "create_fira_app_task.h"
+#include "report_delta.h"
+#include "report_config.h"
+#include "report_capture.h"
+#include "controlee_registry.h"
+#include "boot_time.h"
+#include "HAL_cycles.h"
+#include "minmax.h"
+#include "trace.h"
 
 extern void pdoaupdate_lut(void);
 
 #define DATA_TASK_STACK_SIZE_BYTES 1400
 
-/* 0 - no output of PDoA
- * 1 - output of PDoA from uwb_stack, this is supported in 10.x.x
- */
-#if CONFIG_PEG_UWB == 1
-#define OUTPUT_PDOA_ENABLE (1)
-#else
-#define OUTPUT_PDOA_ENABLE (1)
-#endif
-
 static struct uwbmac_context *uwbmac_ctx = NULL;
 static struct fira_context fira_ctx;
 
-/* uwb_stack version >8.x.x allows usage of SP1 RFRAMES on Deferred DS-TWR to transmit IoT data.
- * This mode is not specified in FiRa MAC 1.2, i.e. proprietary implementation.
- * In this mode both Initiator and Responder can form RFRAMES with proprietary PIE.
- * Maximum IoT data excahnge limited to approx 70 bytes bidirectional per TWR.
- * uwb_stack encrypts and guarantee the integrity of the packet, however the flow control, and
- * retransmission shall be implemented on the upper layer.
- */
-#define PROPRIETARY_SP1_TWR_EXAMPLE_ENABLE (1)
-
-
 #if (PROPRIETARY_SP1_TWR_EXAMPLE_ENABLE == 1)
 /* Below is the example data set to be used for SP1 proprietary frames example */
 static struct data_parameters data_params = {
@@ -107,32 +98,46 @@ static struct data_parameters data_params = {
 };
 #endif
 
-#define STR_SIZE (256)
+/* the replay gives up when the reporter has had no room for a report for that long */
+#define REPLAY_WAIT_MS (1000)
+/* the replay task formats the reports as the report task of a session does */
+#define REPLAY_TASK_STACK_SIZE_BYTES (4096)
+
+/* initiation time of a session started again by fira_app_update(), instead of the configured one */
+#define UPDATE_INITIATION_MS (0)
 
 static uint32_t session_id = 42;
 static task_signal_t dataTransferTask;
 static bool started = false;
 static void report_cb(const struct ranging_results *results, void *user_data);
 static struct string_measurement output_result;
+static fira_param_t *fira_param_active;        /**< parameters of the running session */
+static struct fira_update_stats_s update_stats;
+static uint32_t update_ticks;                  /**< osKernelSysTick() of the last update, for first_report_ms */
+static bool boot_start = true;                 /**< no session was started since the reset */
+static task_signal_t replayTask;
+static struct replay_job_s
+{
+    int loops;
+    error_e ret;
+    struct report_replay_s *res;
+} replay_job;                                  /**< the replay asked to replayTask */
+static int fira_app_set_live_params(const struct session_parameters *session, int32_t initiation_time_ms);
 
 
 /* fira_app_process_init
  */
-static error_e fira_app_process_init(bool controller, void const *arg)
+static error_e fira_app_process_init(bool controller, bool boot, void const *arg)
 {
     fira_param_t *fira_param = (fira_param_t *)arg;
 
+    fira_param_active = fira_param;
     session_id = fira_param->session_id;
-    uint16_t string_len = STR_SIZE * (controller ? fira_param->controlees_params.n_controlees : 1);
 
-    output_result.str = malloc(string_len);
-    if (!(output_result.str))
-    {
-        char *err = "not enough memory";
-        reporter_instance.print((char *)err, strlen(err));
-        return _ERR_Cannot_Alloc_Memory;
-    }
-    output_result.len = string_len;
+    /* reports are formatted straight into the reporter's buffer, sized per block, see fira_report_process() */
+    output_result.str = NULL;
+    output_result.len = 0;
+    fira_report_reset();
 
     // Update LUT for the current antenna set
     pdoaupdate_lut();
@@ -158,6 +163,12 @@ static error_e fira_app_process_init(bool controller, void const *arg)
     // Set session parameters;
     r = fira_set_session_parameters(&fira_ctx, session_id, &fira_param->session);
     assert(r == UWBMAC_SUCCESS);
+    // Initiation time of the saved application at boot;
+    if (boot && fira_param->boot_initiation_ms != FIRA_BOOT_INITIATION_KEEP)
+    {
+        r = fira_app_set_live_params(&fira_param->session, fira_param->boot_initiation_ms);
+        assert(r == UWBMAC_SUCCESS);
+    }
 
     // Send sp1 data;
     if (fira_param->session.rframe_config == FIRA_RFRAME_CONFIG_SP1)
@@ -169,11 +180,20 @@ static error_e fira_app_process_init(bool controller, void const *arg)
         assert(0); /* PROPRIETARY_SP1_TWR_EXAMPLE_ENABLE not allowed */
 #endif
     }
+    controlee_registry_reset();
     if (controller)
     {
         // Add controlee session parameters;
         r = fira_helper_add_controlees(&fira_ctx, session_id, &fira_param->controlees_params);
         assert(r == UWBMAC_SUCCESS);
+
+        for (int i = 0; i < fira_param->controlees_params.n_controlees; i++)
+        {
+            uint16_t address = fira_param->controlees_params.controlees[i].address;
+
+            controlee_registry_add(address);
+            controlee_registry_set_state(address, CONTROLEE_ACTIVE);
+        }
     }
     return _NO_ERR;
 }
@@ -187,6 +207,7 @@ static void fira_app_process_start(void)
     r = fira_helper_start_session(&fira_ctx, session_id);
     assert(r == UWBMAC_SUCCESS);
     started = true;
+    boot_time_mark(BOOT_SESSION);
 }
 
 static error_e fira_app_process_terminate(void)
@@ -207,104 +228,115 @@ static error_e fira_app_process_terminate(void)
 
         // unregister driver;
         fira_uwb_mcps_deinit();
-
-        free(output_result.str);
     }
     return _NO_ERR;
 }
 
-static float convert_aoa_2pi_q16_to_deg(int16_t aoa_2pi_q16)
+/* @brief   copies the parameters which fira_app_update() changes from src to dst
+ * */
+static void fira_app_copy_live_params(struct session_parameters *dst, const struct session_parameters *src)
 {
-    return (360.0 * aoa_2pi_q16 / (1 << 16));
+    dst->block_duration_ms = src->block_duration_ms;
+    dst->round_duration_slots = src->round_duration_slots;
+    dst->ranging_round_usage = src->ranging_round_usage;
+    dst->round_hopping = src->round_hopping;
+    dst->report_tof = src->report_tof;
+    dst->report_aoa_azimuth = src->report_aoa_azimuth;
+    dst->report_aoa_fom = src->report_aoa_fom;
 }
 
-static void report_cb(const struct ranging_results *results, void *user_data)
+/* @brief   sets the parameters of session which fira_app_update() changes,
+ *          on the current session, with a partial message
+ * @param   initiation_time_ms - set as well when the session is about to be started again, unless negative
+ * */
+static int fira_app_set_live_params(const struct session_parameters *session, int32_t initiation_time_ms)
 {
-    int len = 0;
-    uint32_t seq = 0;
-    struct string_measurement *str_result = (struct string_measurement *)user_data;
-    struct ranging_measurements *rm;
-    fira_param_t *fira_param = get_fira_config();
-
-    if (results->stopped_reason != 0xFF)
+    struct session_parameters_builder param_builder;
+
+    session_parameters_builder_init(&fira_ctx, &param_builder, session_id);
+
+    session_parameters_builder_set_block_duration_ms(&param_builder, session->block_duration_ms);
+    session_parameters_builder_set_round_duration_slots(&param_builder, session->round_duration_slots);
+    session_parameters_builder_set_ranging_round_usage(&param_builder, session->ranging_round_usage);
+    session_parameters_builder_set_round_hopping(&param_builder, session->round_hopping);
+    session_parameters_builder_set_report_tof(&param_builder, session->report_tof);
+    session_parameters_builder_set_report_aoa_azimuth(&param_builder, session->report_aoa_azimuth);
+    session_parameters_builder_set_report_aoa_fom(&param_builder, session->report_aoa_fom);
+    if (initiation_time_ms >= 0)
     {
-        len = sprintf(str_result->str, "{\"Session Stopped\":\"%s\"}\r\n",
-                      (results->stopped_reason == 0x0) ? "Stop request" :
-                      (results->stopped_reason == 0x1) ? "Inband Stop" :
-                      (results->stopped_reason == 0x2) ? "Max attempts" : "Unknown");
-
-        reporter_instance.print(str_result->str, len);
-        return;
+        session_parameters_builder_set_initiation_time_ms(&param_builder, (uint32_t)initiation_time_ms);
     }
 
-    len = sprintf(str_result->str, "{\"Block\":%" PRIu32 ", \"results\":[", results->block_index);
+    return fira_helper_set_partial_session_parameters(&fira_ctx, &param_builder);
+}
 
-    for (int i = 0; i < results->n_measurements; i++)
+/* @brief   stops the session, sets session and starts it again.
+ *          uwbmac, the scheduler and the driver stay as they are.
+ * @param   stopped - returns whether the session was stopped, it runs as it was otherwise
+ * */
+static int fira_app_restart_session(const struct session_parameters *session, bool *stopped)
+{
+    int r = fira_helper_stop_session(&fira_ctx, session_id);
+
+    *stopped = (r == 0);
+    if (r == 0)
     {
-        if (i > 0)
+        /* the stop report has been sent, nothing is encoded until the start */
+        report_delta_reset();
+
+        r = fira_app_set_live_params(session, UPDATE_INITIATION_MS);
+        if (r == 0)
         {
-            len += snprintf(&str_result->str[len], str_result->len - len, ",");
+            r = fira_helper_start_session(&fira_ctx, session_id);
         }
+    }
+    return r;
+}
 
-        rm = (struct ranging_measurements *)(&results->measurements[i]);
-
-        len += snprintf(&str_result->str[len], str_result->len - len,
-                        "{\"Addr\":\"0x%04x\",\"Status\":\"%s\"",
-                        rm->short_addr, (rm->status) ? ("Err") : ("Ok"));
+/* @brief   signals the data_task once per new SP1 payload sent
+ * */
+static void report_sp1_signal(const struct ranging_results *results)
+{
+    uint32_t seq = 0;
 
-        if (rm->status == 0)
+    for (int i = 0; i < results->n_measurements; i++)
+    {
+        if (results->measurements[i].status == 0 && fira_report_sp1_data_sent(&results->measurements[i], &seq))
         {
-            len += snprintf(&str_result->str[len], str_result->len - len, ",\"D_cm\":%d",
-                            (int)(rm->distance_mm / 10));
-
-#if (OUTPUT_PDOA_ENABLE == 1)
-            len += snprintf(&str_result->str[len], str_result->len - len,
-                            ",\"LPDoA_deg\":%0.2f,\"LAoA_deg\":%0.2f,\"LFoM\":%d,\"RAoA_deg\":%0.2f",
-                            convert_aoa_2pi_q16_to_deg(rm->local_aoa_measurements[0].pdoa_2pi),
-                            convert_aoa_2pi_q16_to_deg(rm->local_aoa_measurements[0].aoa_2pi),
-                            rm->local_aoa_measurements[0].aoa_fom,
-                            convert_aoa_2pi_q16_to_deg(rm->remote_aoa_azimuth_2pi));
-#endif
-
-            len += snprintf(&str_result->str[len], str_result->len - len, ",\"CFO_100ppm\":%d", (int)fira_uwb_mcps_get_cfo_ppm());
-
-#if (PROPRIETARY_SP1_TWR_EXAMPLE_ENABLE == 1)
-            if (fira_param->session.rframe_config == FIRA_RFRAME_CONFIG_SP1)
+            if (osSignalSet(dataTransferTask.Handle, DATA_TRANSFER) == 0x80000000)
             {
-                if (rm->payload_seq_sent > seq)
-                {
-                    if (osSignalSet(dataTransferTask.Handle, DATA_TRANSFER) == 0x80000000)
-                    {
-                        error_handler(1, _ERR_Signal_Bad);
-                    }
-
-                    seq = rm->payload_seq_sent;
-
-                    len += snprintf(&str_result->str[len], str_result->len - len, ",\"SEQ\":%" PRIu32 "", seq);
-
-                    if (rm->sp1_data_len > 0)
-                    {
-                        uint8_t *data = (uint8_t *)(rm->sp1_data);
-                        len += snprintf(&str_result->str[len], str_result->len - len,
-                                        ",\"DATA\":\"%02X:%02X:%02X\"", data[0], data[1], data[2]); // <- Printing of received data from another device
-                    }
-                }
+                error_handler(1, _ERR_Signal_Bad);
             }
-#endif
         }
-        len += snprintf(&str_result->str[len], str_result->len - len, "}");
     }
+}
 
-    len += snprintf(&str_result->str[len], str_result->len - len, "]");
 
-    /* Display RSSI, CFO and NLOS */
-    if (fira_uwb_is_diag_enabled())
+static void report_cb(const struct ranging_results *results, void *user_data)
+{
+    struct string_measurement *str_result = (struct string_measurement *)user_data;
+
+    TRACE_POINT(TRACE_REPORT, results->n_measurements);
+
+    int32_t cfo_100ppm = fira_uwb_mcps_get_cfo_ppm();
+
+    fira_report_set_env(cfo_100ppm, fira_uwb_is_diag_enabled());
+    report_capture_add(results, cfo_100ppm);
+
+    if (results->stopped_reason == 0xFF)
     {
-        len = fira_uwb_add_diag(str_result->str, len, str_result->len);
+        boot_time_mark(BOOT_FIRST_REPORT);
+
+        if (update_stats.first_report_ms < 0)
+        {
+            update_stats.first_report_ms = (osKernelSysTick() - update_ticks) / (osKernelSysTickFrequency / 1000);
+        }
+
+        report_sp1_signal(results);
+        controlee_registry_update(results);
     }
 
-    len += snprintf(&str_result->str[len], str_result->len - len, "}\r\n");
-    reporter_instance.print((char *)str_result->str, len);
+    fira_report_process(results, str_result);
 }
 
 /* @brief DW3000 RX : RTOS implementation
@@ -370,7 +402,12 @@ static void fira_app(bool controller, void *arg)
 
     set_local_pavrg_size();
 
-    tmp = fira_app_process_init(controller, arg);
+    /* the first start since the reset, of the saved application, is the one at boot */
+    bool boot = boot_start && (AppGet() == AppGetDefaultEvent());
+
+    boot_start = false;
+
+    tmp = fira_app_process_init(controller, boot, arg);
 
     if (tmp != _NO_ERR)
     {
@@ -400,6 +437,288 @@ void fira_terminate(void)
     hal_uwb.sleep_enter();
 }
 
+
+/* @brief   the replay takes the place of the report task of a session:
+ *          it produces into the ring of the ranging reports, in their class,
+ *          so the budget and the coalescing apply as they do live
+ * */
+static void replay_task(void const *arg)
+{
+    static struct ranging_results replay_results;
+    struct string_measurement str_result;
+    int32_t cfo_100ppm;
+    uint32_t ticks = osKernelSysTick();
+
+    port_tx_register(TX_PRODUCER_REPORT);
+
+    replay_job.ret = _NO_ERR;
+
+    for (int loop = 0; loop < replay_job.loops; loop++)
+    {
+        int offset = 0;
+
+        while ((offset = report_capture_read(offset, &replay_results, &cfo_100ppm)) > 0)
+        {
+            /* the diagnostics are off, the driver being down */
+            fira_report_set_env(cfo_100ppm, false);
+
+            /* the link is behind: give it the time a session would give it before the next block */
+            if (!fira_report_process(&replay_results, &str_result))
+            {
+                replay_job.res->retries++;
+                osDelay(1);
+            }
+        }
+    }
+
+    /* what is still waiting for room: the aggregation window and the coalesced block */
+    for (int wait_ms = 0; !fira_report_flush(&str_result); wait_ms++)
+    {
+        if (wait_ms >= REPLAY_WAIT_MS)
+        {
+            replay_job.ret = _ERR_Timeout;
+            break;
+        }
+        osDelay(1);
+    }
+
+    if (replay_job.ret == _NO_ERR)
+    {
+        replay_job.ret = port_tx_wait_flushed(REPLAY_WAIT_MS);
+    }
+
+    replay_job.res->time_ms = (osKernelSysTick() - ticks) / (osKernelSysTickFrequency / 1000);
+
+    replayTask.Exit = 2;
+    while (replayTask.Exit == 2)
+    {
+        osDelay(1);
+    };
+}
+
+/* @fn      fira_app_replay
+ * @brief   sends the captured results through the report path of a session, in the current
+ *          report format, from a task which replaces the report task, and measures the throughput.
+ *          Only while no session runs: the diagnostics are off, the driver being down.
+ * @param   loops - passes over the capture
+ * */
+error_e fira_app_replay(int loops, struct report_replay_s *res)
+{
+    uint8_t format = get_report_config()->format;
+    const struct report_stats_s *stats = fira_report_get_stats((format < REPORT_FORMAT_MAX) ? (format) : (REPORT_FORMAT_JSON));
+    struct report_stats_s start;
+    uint32_t coalesced = get_tx_class_stats(TX_CLASS_RANGING)->coalesced;
+
+    if (started)
+    {
+        return _ERR_Busy;
+    }
+
+    memset(res, 0, sizeof(*res));
+    start = *stats;
+    fira_report_reset();
+
+    replay_job.loops = loops;
+    replay_job.res = res;
+    replayTask.Exit = 0;
+    replayTask.task_stack = NULL;
+
+    if (create_fira_app_task(replay_task, &replayTask, (uint16_t)REPLAY_TASK_STACK_SIZE_BYTES, NULL) != _NO_ERR)
+    {
+        return _ERR_Create_Task_Bad;
+    }
+
+    while (replayTask.Exit != 2)
+    {
+        osDelay(1);
+    }
+    terminate_task_with_mail(&replayTask); /**< the task waits in its last loop, it is terminated as is */
+
+    res->blocks = stats->blocks - start.blocks;
+    res->bytes = stats->bytes - start.bytes;
+    res->cycles = stats->cycles - start.cycles;
+    res->max_cycles = stats->max_cycles;
+    res->errors = stats->errors - start.errors;
+    res->coalesced = get_tx_class_stats(TX_CLASS_RANGING)->coalesced - coalesced;
+
+    /* the live reports start a new delta stream */
+    report_delta_reset();
+
+    return replay_job.ret;
+}
+
+/* @fn      fira_app_update
+ * @brief   changes the block duration, the round duration, the ranging round usage,
+ *          the round hopping and the ToF/AoA reports of the running session to the ones of session.
+ *          The parameters are pushed to the active session first; when the stack refuses them,
+ *          only the session is stopped and started again, without the initiation time,
+ *          uwbmac and the MCPS driver are kept.
+ *          When no session runs, the parameters are only stored for the next start.
+ * @param   path - returns the fira_update_e taken
+ * @return  _ERR when the stack refused the parameters, the session then runs with the previous ones;
+ *          _ERR_Busy when the session could not be stopped to take them, it is left running as it was
+ * */
+error_e fira_app_update(const struct session_parameters *session, fira_update_e *path)
+{
+    fira_param_t *fira_param = (started) ? (fira_param_active) : (get_fira_config());
+    struct session_parameters *active = &fira_param->session;
+    uint32_t cycles;
+    bool stopped;
+    int r;
+
+    *path = FIRA_UPDATE_STORED;
+
+    if (!started)
+    {
+        fira_app_copy_live_params(active, session);
+        return _NO_ERR;
+    }
+
+    cycles = hal_cycles_get();
+
+    r = fira_app_set_live_params(session, -1);
+    if (r == 0)
+    {
+        *path = FIRA_UPDATE_LIVE;
+    }
+    else
+    {
+        *path = FIRA_UPDATE_RESTART;
+        r = fira_app_restart_session(session, &stopped);
+        if (r != 0)
+        {
+            update_stats.failures++;
+            if (!stopped)
+            {
+                return _ERR_Busy; /**< the session runs as it was */
+            }
+            /* back to the parameters the session ran with, the session is stopped by now */
+            fira_app_set_live_params(active, UPDATE_INITIATION_MS);
+            fira_helper_start_session(&fira_ctx, session_id);
+            return _ERR;
+        }
+    }
+
+    cycles = hal_cycles_get() - cycles;
+
+    fira_app_copy_live_params(active, session);
+
+    update_ticks = osKernelSysTick();
+    update_stats.first_report_ms = -1;
+    update_stats.updates++;
+    update_stats.live += (*path == FIRA_UPDATE_LIVE);
+    update_stats.restarts += (*path == FIRA_UPDATE_RESTART);
+    update_stats.last_path = (uint8_t)*path;
+    update_stats.last_us = cycles / HAL_CYCLES_PER_US;
+    update_stats.max_us = MAX(update_stats.max_us, update_stats.last_us);
+
+    return _NO_ERR;
+}
+
+const struct fira_update_stats_s *fira_app_get_update_stats(void)
+{
+    return &update_stats;
+}
+
+/* @brief   the active controlees of the registry become the controlees of the session parameters,
+ *          as shown by show_fira_params()
+ * */
+static void fira_app_sync_controlees(void)
+{
+    controlee_registry_get_active(&fira_param_active->controlees_params);
+}
+
+/* @brief   adds the single address to the running session, or deletes it from it
+ * */
+static int fira_app_session_controlee(uint16_t address, bool add)
+{
+    struct controlees_parameters controlees = {.n_controlees = 1};
+
+    controlees.controlees[0].address = address;
+
+    return (add) ? (fira_helper_add_controlees(&fira_ctx, session_id, &controlees)) :
+                   (fira_helper_delete_controlees(&fira_ctx, session_id, &controlees));
+}
+
+static bool fira_app_is_controller(void)
+{
+    return started && (fira_param_active->session.device_type == FIRA_DEVICE_TYPE_CONTROLLER);
+}
+
+/* @fn      fira_app_add_controlee
+ * @brief   registers a controlee of the running controller session.
+ *          It joins the session right away while the session has less than FIRA_CONTROLEES_MAX,
+ *          otherwise it waits for another one to be removed.
+ * @param   state - returns the controlee_state_e of the new controlee
+ * */
+error_e fira_app_add_controlee(uint16_t address, int *state)
+{
+    if (!fira_app_is_controller())
+    {
+        return _ERR_Busy;
+    }
+
+    if (controlee_registry_add(address) < 0)
+    {
+        return _ERR;
+    }
+
+    *state = CONTROLEE_WAITING;
+
+    if (controlee_registry_count(CONTROLEE_ACTIVE) < FIRA_CONTROLEES_MAX && fira_app_session_controlee(address, true) == 0)
+    {
+        controlee_registry_set_state(address, CONTROLEE_ACTIVE);
+        fira_app_sync_controlees();
+        *state = CONTROLEE_ACTIVE;
+    }
+    return _NO_ERR;
+}
+
+/* @fn      fira_app_remove_controlee
+ * @brief   removes a controlee of the running controller session,
+ *          the first waiting controlee, if any, takes its place in the session
+ * @param   next - returns the address of that controlee, -1 if none
+ * */
+error_e fira_app_remove_controlee(uint16_t address, int *next)
+{
+    int state;
+
+    *next = -1;
+
+    if (!fira_app_is_controller())
+    {
+        return _ERR_Busy;
+    }
+
+    state = controlee_registry_get_state(address);
+    if (state < 0)
+    {
+        return _ERR;
+    }
+
+    /* an active controlee leaves the registry only once the session let it go:
+     * while still ranging it keeps its entry and its counters */
+    if (state == CONTROLEE_ACTIVE && fira_app_session_controlee(address, false) != 0)
+    {
+        return _ERR;
+    }
+
+    controlee_registry_remove(address);
+
+    if (state == CONTROLEE_ACTIVE)
+    {
+        int waiting = controlee_registry_next_waiting();
+
+        if (waiting >= 0 && fira_app_session_controlee((uint16_t)waiting, true) == 0)
+        {
+            controlee_registry_set_state((uint16_t)waiting, CONTROLEE_ACTIVE);
+            *next = waiting;
+        }
+        fira_app_sync_controlees();
+    }
+    return _NO_ERR;
+}
+
 void fira_helper_controller(const void *arg_fira_param)
 {
     void *fira_param = (arg_fira_param) ? (void *)arg_fira_param : (void *)get_fira_config();
@@ -56,9 +56,52 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include "deca_error.h"
+#include "fira_helper.h"
+
+/* Throughput of a replay of the capture, see fira_app_replay() */
+struct report_replay_s
+{
+    uint32_t blocks;     /**< Ranging blocks reported */
+    uint32_t bytes;      /**< Bytes passed to the reporter */
+    uint32_t time_ms;    /**< Time to send them, until the output is drained */
+    uint32_t cycles;     /**< CPU cycles spent encoding the blocks */
+    uint32_t max_cycles; /**< Worst case CPU cycles for a single block, since the statistics reset */
+    uint32_t errors;     /**< Reports which did not fit the output buffer */
+    uint32_t retries;    /**< Blocks which found no room in the reporter and were coalesced */
+    uint32_t coalesced;  /**< Measurements replaced by newer ones while the link was behind */
+};
+
+/* Paths of a parameters update, see fira_app_update() */
+typedef enum {
+    FIRA_UPDATE_STORED = 0, /**< no session runs, the parameters apply on the next start */
+    FIRA_UPDATE_LIVE,       /**< pushed to the running session */
+    FIRA_UPDATE_RESTART,    /**< the session was stopped and started again */
+    FIRA_UPDATE_MAX
+} fira_update_e;
+
+/* Statistics of the parameters updates of the running session */
+struct fira_update_stats_s
+{
+    uint32_t updates;          /**< Updates applied to a running session */
+    uint32_t live;             /**< Of which without a stop of the session */
+    uint32_t restarts;         /**< Of which with a stop and a start of the session */
+    uint32_t failures;         /**< Updates refused by the stack, the previous parameters were restored */
+    uint8_t last_path;         /**< fira_update_e of the last update */
+    uint32_t last_us;          /**< Time to apply the last update */
+    uint32_t max_us;           /**< Worst case time to apply an update */
+    int32_t first_report_ms;   /**< Time from the last update to the next ranging report, -1 while waiting */
+};
+
 void fira_terminate(void);
 void fira_helper_controller(const void *arg);
 void fira_helper_controlee(const void *arg);
+error_e fira_app_replay(int loops, struct report_replay_s *res);
+error_e fira_app_update(const struct session_parameters *session, fira_update_e *path);
+const struct fira_update_stats_s *fira_app_get_update_stats(void);
+error_e fira_app_add_controlee(uint16_t address, int *state);
+error_e fira_app_remove_controlee(uint16_t address, int *next);
 
 #ifdef __cplusplus
 }
@@ -51,7 +51,9 @@
 
 #include "fira_app_config.h"
 
-static const fira_param_t fira_config_flash_default = {0};
+static const fira_param_t fira_config_flash_default = {
+    .boot_initiation_ms = FIRA_BOOT_INITIATION_KEEP,
+};
 static fira_param_t fira_config_ram __attribute__((section(".rconfig"))) = {0};
 
 fira_param_t *get_fira_config(void)
@@ -56,12 +56,16 @@
 
 #include "fira_helper.h"
 
+/* boot_initiation_ms of a boot start with the initiation time of the session */
+#define FIRA_BOOT_INITIATION_KEEP (0xFFFF)
+
 struct fira_param_s
 {
     uint32_t session_id;
     uint16_t short_addr;
     struct session_parameters session;
     struct controlees_parameters controlees_params;
+    uint16_t boot_initiation_ms; /**< initiation time when the saved application starts at boot, or FIRA_BOOT_INITIATION_KEEP */
 };
 typedef struct fira_param_s fira_param_t;
 
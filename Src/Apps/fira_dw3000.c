@@ -53,6 +53,8 @@
 #include "common_fira.h"
 #include "rf_tuning_config.h"
 #include "debug_config.h"
+#include "report_bin.h"
+#include "str_fmt.h"
 
 static struct dwchip_s *dw = NULL;
 
@@ -151,16 +153,33 @@ bool fira_uwb_is_diag_enabled(void)
     return dw->mcps_runtime->diag.enable;
 }
 
+/* @brief   appends RSSI and NLOS to the JSON report
+ * @return  new length, -1 if it does not fit
+ * */
 int fira_uwb_add_diag(char *str, int len, int max_len)
 {
     if (dw->mcps_runtime->diag.rssi < 0.0)
     {
-        len += snprintf(&str[len], max_len - len, ",\"RSSI_dBm\":\"%.1f\"", dw->mcps_runtime->diag.rssi);
+        len = fmt_str(str, len, max_len, ",\"RSSI_dBm\":\"");
+        len = fmt_float(str, len, max_len, dw->mcps_runtime->diag.rssi, 1);
+        len = fmt_char(str, len, max_len, '"');
     }
     else
     {
-        len += snprintf(&str[len], max_len - len, ",\"RSSI_dBm\":\"Invalid\"");
+        len = fmt_str(str, len, max_len, ",\"RSSI_dBm\":\"Invalid\"");
     }
-    len += snprintf(&str[len], max_len - len, ",\"NLOS_%%\":%d", (int)dw->mcps_runtime->diag.non_line_of_sight);
+    len = fmt_str(str, len, max_len, ",\"NLOS_%\":");
+    len = fmt_int(str, len, max_len, (int)dw->mcps_runtime->diag.non_line_of_sight);
     return len;
 }
+
+/* @brief   binary counterpart of fira_uwb_add_diag()
+ * @param   rssi_dbm_x10 - RSSI in 0.1 dBm or REPORT_BIN_RSSI_INVALID
+ * */
+void fira_uwb_get_diag(int16_t *rssi_dbm_x10, uint8_t *nlos_pct)
+{
+    float rssi = dw->mcps_runtime->diag.rssi;
+
+    *rssi_dbm_x10 = (rssi < 0.0) ? ((int16_t)(rssi * 10.0f - 0.5f)) : (REPORT_BIN_RSSI_INVALID);
+    *nlos_pct = (uint8_t)dw->mcps_runtime->diag.non_line_of_sight;
+}
@@ -57,6 +57,15 @@
 #include "EventManager.h"
 #include "reporter.h"
 #include "rf_tuning_config.h"
+#include "report_config.h"
+#include "fira_app.h"
+#include "fira_report.h"
+#include "report_delta.h"
+#include "report_capture.h"
+#include "minmax.h"
+#include "HAL_uwb.h"
+#include "controlee_registry.h"
+#include "cmd_resp.h"
 
 #define INITF_OFFSET 0
 #define RESPF_OFFSET 1
@@ -69,6 +78,46 @@ static const char RESPF_CMD_COMMENT[] = {
 static const char COMMENT_AVERAGE[] = {
     "Phase Difference Average. \r\nUsage: To see averaging value \"PAVRG\". To set the averaging value \"PAVRG <DEC>\""};
 
+static const char COMMENT_RFORMAT[] = {
+    "Ranging report format and statistics.\r\nUsage: To see the format and statistics \"RFORMAT\". To set the format \"RFORMAT <DEC>\" (0:JSON, 1:BIN, 2:DELTA), this also clears the statistics"};
+
+static const char COMMENT_AGGR[] = {
+    "Aggregation of the ranging reports: one report of the distance and AoA statistics per responder every N blocks or T ms.\r\nUsage: To see the aggregation \"AGGR\". To set \"AGGR <N> <T_MS>\", 0 disables the limit, \"AGGR 0 0\" reports every block"};
+
+static const char COMMENT_RDELTA[] = {
+    "Deadbands of the delta report format.\r\nUsage: To see the deadbands \"RDELTA\". To set \"RDELTA <DIST_MM> <ANGLE_CDEG> <CFO_100PPM> <KEYFRAME_PERIOD>\", a field is sent when it moves beyond its deadband, all of them every KEYFRAME_PERIOD frames"};
+
+static const char COMMENT_RCAP[] = {
+    "Capture of the raw ranging results, for a replay.\r\nUsage: To see the capture \"RCAP\". To clear and start \"RCAP 1\", to stop \"RCAP 0\". To dump the stopped capture as hex \"RCAP DUMP\""};
+
+static const char COMMENT_RREPLAY[] = {
+    "Replay of the captured ranging results through the report path of a session, in the current report format:\r\nthe ring of the ranging reports, their budget, the coalescing and the aggregation.\r\nUsage: \"RREPLAY <LOOPS>\", reports the throughput"};
+
+static const char COMMENT_FUPD[] = {
+    "Update of the running FiRa session, without a new INITF/RESPF.\r\nUsage: To see the parameters and the update statistics \"FUPD\". "
+    "To set \"FUPD <BLOCK_MS> [ROUND_SLOTS] [RR_USAGE] [HOPPING] [REPORT_TOF] [REPORT_AOA]\", the parameters not given are kept. "
+    "Without a session, the parameters apply on the next start"};
+
+static const char COMMENT_CTRLEE[] = {
+    "Controlees of the running FiRa controller session.\r\nUsage: To list them \"CTRLEE\". To add one \"CTRLEE ADD <ADDR>\", to remove one \"CTRLEE DEL <ADDR>\". "
+    "The session has up to 8 controlees, the others wait for a place"};
+
+static const char COMMENT_FBOOT[] = {
+    "Initiation time of the FiRa session when the saved application starts at boot.\r\nUsage: To see it \"FBOOT\". To set \"FBOOT <MS>\", -1 keeps the initiation time of the session. "
+    "\"SAVE\" while INITF or RESPF runs makes it the application started at boot"};
+
+/* RSTU per ms, the unit of block_duration_ms */
+#define FUPD_RSTU_PER_MS (1200)
+
+/* bytes of the capture per line of RCAP DUMP */
+#define RCAP_DUMP_LINE 64
+
+static const char *const report_format_names[REPORT_FORMAT_MAX] = {"JSON", "BIN", "DELTA"};
+
+static const char *const fira_update_names[FIRA_UPDATE_MAX] = {"stored", "live", "restart"};
+
+static const char *const controlee_state_names[] = {"free", "waiting", "active"};
+
 extern const app_definition_t helpers_app_fira[];
 
 /* Fira Node and Tag */
@@ -100,39 +149,438 @@ REG_FN(f_responder_f)
 
 REG_FN(f_pdoa_average)
 {
-    const char *ret = CMD_FN_RET_OK;
+    cmd_resp_t resp;
+    char cmd[10];
+    int n, dummy;
+
+    rf_tuning_t *rf_tuning = get_rf_tuning_config();
+    n = sscanf(text, "%9s %d", cmd, &dummy); // to count the number of arguments
+
+    if (n == 2)
+    {
+        rf_tuning->paverage = (int16_t)val; // val is the input
+    }
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"AVERAGE\":");
+        cmd_resp_int(&resp, rf_tuning->paverage);
+        cmd_resp_char(&resp, '}');
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
 
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
 
+REG_FN(f_report_format)
+{
+    cmd_resp_t resp;
+    char cmd[10];
     int n, dummy;
 
-    if (str)
+    report_config_t *report_config = get_report_config();
+    n = sscanf(text, "%9s %d", cmd, &dummy); // to count the number of arguments
+
+    if (n == 2)
+    {
+        if (val < 0 || val >= REPORT_FORMAT_MAX)
+        {
+            return (NULL);
+        }
+        report_config->format = (uint8_t)val;
+        fira_report_reset_stats();
+        report_delta_reset();
+    }
+
+    if (cmd_resp_json(&resp, 2 * MAX_STR_SIZE))
     {
-        rf_tuning_t *rf_tuning = get_rf_tuning_config();
-        n = sscanf(text, "%9s %d", str, &dummy); // to count the number of arguments
+        cmd_resp_printf(&resp, "{\"RFORMAT\":\"%s\"", report_format_names[report_config->format]);
 
-        if (n == 2)
+        for (uint8_t i = 0; i < REPORT_FORMAT_MAX; i++)
         {
-            rf_tuning->paverage = (int16_t)val; // val is the input
+            const struct report_stats_s *stats = fira_report_get_stats(i);
+
+            cmd_resp_printf(&resp,
+                            ",\"%s\":{\"Blocks\":%lu,\"Meas\":%lu,\"Bytes\":%lu,\"Cyc_avg\":%lu,\"Cyc_max\":%lu,\"Err\":%lu}",
+                            report_format_names[i],
+                            (unsigned long)stats->blocks, (unsigned long)stats->measurements, (unsigned long)stats->bytes,
+                            (unsigned long)((stats->blocks) ? (stats->cycles / stats->blocks) : (0)),
+                            (unsigned long)stats->max_cycles, (unsigned long)stats->errors);
         }
+        cmd_resp_char(&resp, '}');
+    }
 
-        int hlen;
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
 
-        hlen = sprintf(str, "JS%04X", 0x5A5A);
-        sprintf(&str[strlen(str)], "{\"AVERAGE\":%d}", rf_tuning->paverage);
+REG_FN(f_report_aggr)
+{
+    cmd_resp_t resp;
+    char cmd[10];
+    int n;
+    unsigned int blocks, period_ms;
 
-        sprintf(&str[2], "%04X", strlen(str) - hlen);
-        str[hlen] = '{';
-        sprintf(&str[strlen(str)], "\r\n");
-        reporter_instance.print((char *)str, strlen(str));
+    report_config_t *report_config = get_report_config();
+    n = sscanf(text, "%9s %u %u", cmd, &blocks, &period_ms);
 
-        CMD_FREE(str);
+    if (n == 3)
+    {
+        if (blocks > UINT8_MAX || period_ms > UINT16_MAX)
+        {
+            return (NULL);
+        }
+        report_config->aggr_blocks = (uint8_t)blocks;
+        report_config->aggr_period_ms = (uint16_t)period_ms;
+    }
+    else if (n != 1)
+    {
+        return (NULL);
+    }
 
-        ret = CMD_FN_RET_OK;
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"AGGR\":{\"Blocks\":%u,\"Period_ms\":%u}}",
+                        report_config->aggr_blocks, report_config->aggr_period_ms);
     }
 
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
 
-    return (ret);
+REG_FN(f_report_delta)
+{
+    cmd_resp_t resp;
+    char cmd[10];
+    int n;
+    unsigned int dist_mm, angle_cdeg, cfo, key;
+
+    report_config_t *report_config = get_report_config();
+    n = sscanf(text, "%9s %u %u %u %u", cmd, &dist_mm, &angle_cdeg, &cfo, &key);
+
+    if (n == 5 && dist_mm <= UINT16_MAX && angle_cdeg <= 18000 && cfo <= UINT16_MAX && key <= UINT16_MAX)
+    {
+        report_config->delta_mm = (uint16_t)dist_mm;
+        report_config->delta_angle = (uint16_t)((angle_cdeg * 65536 + 18000) / 36000);
+        report_config->delta_cfo = (uint16_t)cfo;
+        report_config->delta_key = (uint16_t)key;
+        report_delta_reset();
+    }
+    else if (n != 1)
+    {
+        return (NULL);
+    }
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"RDELTA\":{\"D_mm\":%u,\"Angle_cdeg\":%u,\"CFO_100ppm\":%u,\"Key\":%u}}",
+                        report_config->delta_mm, (unsigned int)((report_config->delta_angle * 36000 + 32768) / 65536),
+                        report_config->delta_cfo, report_config->delta_key);
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/* @brief   sends the capture as hex, one JSON reply per RCAP_DUMP_LINE bytes
+ * */
+static error_e rcap_dump(void)
+{
+    struct report_capture_stats_s stats;
+    const uint8_t *data = report_capture_data();
+    cmd_resp_t resp;
+
+    report_capture_get_stats(&stats);
+
+    for (int offset = 0; offset < stats.bytes; offset += RCAP_DUMP_LINE)
+    {
+        int end = MIN(offset + RCAP_DUMP_LINE, stats.bytes);
+
+        if (cmd_resp_json(&resp, MAX_STR_SIZE))
+        {
+            cmd_resp_str(&resp, "{\"RCAP\":{\"Offset\":");
+            cmd_resp_int(&resp, offset);
+            cmd_resp_str(&resp, ",\"Hex\":\"");
+            for (int i = offset; i < end; i++)
+            {
+                cmd_resp_hex(&resp, data[i], 2, true);
+            }
+            cmd_resp_str(&resp, "\"}}");
+        }
+
+        if (cmd_resp_end(&resp) != _NO_ERR)
+        {
+            return _ERR;
+        }
+    }
+    return _NO_ERR;
+}
+
+REG_FN(f_report_capture)
+{
+    cmd_resp_t resp;
+    struct report_capture_stats_s stats;
+    char cmd[10], arg[10];
+    int n, dummy;
+
+    n = sscanf(text, "%9s %9s", cmd, arg);
+
+    if (n == 2 && strcmp(arg, "DUMP") == 0)
+    {
+        report_capture_get_stats(&stats);
+        if (stats.on || rcap_dump() != _NO_ERR)
+        {
+            return (NULL);
+        }
+    }
+    else if (n == 2 && sscanf(arg, "%d", &dummy) == 1 && (val == 0 || val == 1))
+    {
+        if (val)
+        {
+            report_capture_start();
+        }
+        else
+        {
+            report_capture_stop();
+        }
+    }
+    else if (n != 1)
+    {
+        return (NULL);
+    }
+
+    report_capture_get_stats(&stats);
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"RCAP\":{\"On\":%u,\"Records\":%u,\"Bytes\":%u,\"Size\":%u,\"Dropped\":%u}}",
+                        stats.on, stats.records, stats.bytes, REPORT_CAPTURE_BUFSIZE, stats.dropped);
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+REG_FN(f_report_replay)
+{
+    cmd_resp_t resp;
+    struct report_replay_s res;
+    struct report_capture_stats_s stats;
+
+    report_capture_get_stats(&stats);
+
+    if (val <= 0 || stats.on || stats.records == 0 || fira_app_replay(val, &res) != _NO_ERR)
+    {
+        return (NULL);
+    }
+
+    uint32_t time_ms = MAX(res.time_ms, 1);
+
+    if (cmd_resp_json(&resp, 2 * MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp,
+                        "{\"RREPLAY\":{\"Format\":\"%s\",\"Blocks\":%lu,\"Bytes\":%lu,\"Time_ms\":%lu,\"Blocks_s\":%lu,\"Bytes_s\":%lu,"
+                        "\"Cyc_avg\":%lu,\"Cyc_max\":%lu,\"Err\":%lu,\"Retries\":%lu,\"Coalesced\":%lu}}",
+                        report_format_names[get_report_config()->format],
+                        (unsigned long)res.blocks, (unsigned long)res.bytes, (unsigned long)res.time_ms,
+                        (unsigned long)((uint64_t)res.blocks * 1000 / time_ms), (unsigned long)((uint64_t)res.bytes * 1000 / time_ms),
+                        (unsigned long)((res.blocks) ? (res.cycles / res.blocks) : (0)),
+                        (unsigned long)res.max_cycles, (unsigned long)res.errors, (unsigned long)res.retries,
+                        (unsigned long)res.coalesced);
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/* @brief   checks the updated parameters of f_fira_update() against the ones which are kept
+ * */
+static bool fira_update_is_valid(const struct session_parameters *session)
+{
+    return (session->block_duration_ms > 0) && (session->round_duration_slots > 0) &&
+           ((uint64_t)session->round_duration_slots * session->slot_duration_rstu <= (uint64_t)session->block_duration_ms * FUPD_RSTU_PER_MS) &&
+           (session->ranging_round_usage == FIRA_RANGING_ROUND_USAGE_SSTWR || session->ranging_round_usage == FIRA_RANGING_ROUND_USAGE_DSTWR) &&
+           (session->report_tof <= 1) &&
+           (session->report_aoa_azimuth == 0 || hal_uwb.is_aoa() == AOA_ENABLED);
+}
+
+REG_FN(f_fira_update)
+{
+    cmd_resp_t resp;
+    char cmd[10];
+    int n;
+    unsigned int block_ms, round_slots, rr_usage, hopping, tof, aoa;
+
+    struct session_parameters *session = CMD_MALLOC(sizeof(struct session_parameters));
+    const struct fira_update_stats_s *stats = fira_app_get_update_stats();
+    fira_update_e path = (fira_update_e)stats->last_path;
+
+    if (!session)
+    {
+        return (NULL);
+    }
+
+    *session = get_fira_config()->session;
+    block_ms = session->block_duration_ms;
+    round_slots = session->round_duration_slots;
+    rr_usage = session->ranging_round_usage;
+    hopping = session->round_hopping;
+    tof = session->report_tof;
+    aoa = session->report_aoa_azimuth;
+
+    n = sscanf(text, "%9s %u %u %u %u %u %u", cmd, &block_ms, &round_slots, &rr_usage, &hopping, &tof, &aoa);
+
+    if (n > 1)
+    {
+        session->block_duration_ms = block_ms;
+        session->round_duration_slots = round_slots;
+        session->ranging_round_usage = (uint8_t)MIN(rr_usage, UINT8_MAX);
+        session->round_hopping = (hopping != 0);
+        session->report_tof = (uint8_t)MIN(tof, UINT8_MAX);
+        session->report_aoa_azimuth = (uint8_t)MIN(aoa, UINT8_MAX);
+        session->report_aoa_fom = session->report_aoa_azimuth;
+
+        if (hopping > 1 || aoa > 1 || !fira_update_is_valid(session) || fira_app_update(session, &path) != _NO_ERR)
+        {
+            CMD_FREE(session);
+            return (NULL);
+        }
+        *session = get_fira_config()->session;
+    }
+    else if (n != 1)
+    {
+        CMD_FREE(session);
+        return (NULL);
+    }
+
+    if (cmd_resp_json(&resp, 2 * MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp,
+                        "{\"FUPD\":{\"Block_ms\":%lu,\"Round_slots\":%lu,\"RR_usage\":%u,\"Hopping\":%u,\"ToF\":%u,\"AoA\":%u,"
+                        "\"Path\":\"%s\",\"Time_us\":%lu,\"Max_us\":%lu,\"First_report_ms\":%ld,"
+                        "\"Updates\":%lu,\"Live\":%lu,\"Restarts\":%lu,\"Failures\":%lu}}",
+                        (unsigned long)session->block_duration_ms, (unsigned long)session->round_duration_slots,
+                        session->ranging_round_usage, session->round_hopping, session->report_tof, session->report_aoa_azimuth,
+                        fira_update_names[(path < FIRA_UPDATE_MAX) ? (path) : (FIRA_UPDATE_STORED)],
+                        (unsigned long)stats->last_us, (unsigned long)stats->max_us, (long)stats->first_report_ms,
+                        (unsigned long)stats->updates, (unsigned long)stats->live, (unsigned long)stats->restarts,
+                        (unsigned long)stats->failures);
+    }
+
+    CMD_FREE(session);
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+REG_FN(f_fira_boot)
+{
+    cmd_resp_t resp;
+    char cmd[10];
+    int n, initiation_ms;
+
+    fira_param_t *fira_param = get_fira_config();
+    const app_definition_t *app = AppGetDefaultEvent();
+
+    n = sscanf(text, "%9s %d", cmd, &initiation_ms);
+
+    if (n == 2 && initiation_ms >= -1 && initiation_ms < FIRA_BOOT_INITIATION_KEEP)
+    {
+        fira_param->boot_initiation_ms = (initiation_ms < 0) ? (FIRA_BOOT_INITIATION_KEEP) : ((uint16_t)initiation_ms);
+    }
+    else if (n != 1)
+    {
+        return (NULL);
+    }
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"FBOOT\":{\"App\":\"");
+        cmd_resp_str(&resp, (app && app->app_name) ? (app->app_name) : (""));
+        cmd_resp_str(&resp, "\",\"Initiation_ms\":");
+        cmd_resp_int(&resp, (fira_param->boot_initiation_ms == FIRA_BOOT_INITIATION_KEEP) ? (-1) : ((int)fira_param->boot_initiation_ms));
+        cmd_resp_str(&resp, "}}");
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/* @brief   lists the registered controlees, one reply each as the registry is larger than a reply
+ * */
+static error_e ctrlee_list(void)
+{
+    cmd_resp_t resp;
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "{\"CTRLEE\":{\"Active\":%d,\"Waiting\":%d,\"Max\":%d}}",
+                        controlee_registry_count(CONTROLEE_ACTIVE), controlee_registry_count(CONTROLEE_WAITING), CONTROLEE_REGISTRY_MAX);
+    }
+    if (cmd_resp_end(&resp) != _NO_ERR)
+    {
+        return _ERR;
+    }
+
+    for (int i = 0; i < CONTROLEE_REGISTRY_MAX; i++)
+    {
+        struct controlee_entry_s entry;
+
+        if (!controlee_registry_get(i, &entry) || entry.state == CONTROLEE_FREE)
+        {
+            continue;
+        }
+
+        if (cmd_resp_json(&resp, MAX_STR_SIZE))
+        {
+            cmd_resp_printf(&resp, "{\"CTRLEE\":{\"Addr\":\"0x%04X\",\"State\":\"%s\",\"Ok\":%lu,\"Err\":%lu,\"Misses\":%u}}",
+                            entry.address, controlee_state_names[entry.state],
+                            (unsigned long)entry.ok, (unsigned long)entry.err, entry.misses);
+        }
+        if (cmd_resp_end(&resp) != _NO_ERR)
+        {
+            return _ERR;
+        }
+    }
+    return _NO_ERR;
+}
+
+REG_FN(f_controlee)
+{
+    cmd_resp_t resp;
+    char cmd[10], op[10];
+    int n, address, state, next;
+    bool add;
+
+    n = sscanf(text, "%9s %9s %i", cmd, op, &address);
+
+    if (n == 1)
+    {
+        return (ctrlee_list() == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+    }
+
+    if (n != 3 || address < 0 || address > UINT16_MAX || (strcmp(op, "ADD") != 0 && strcmp(op, "DEL") != 0))
+    {
+        return (NULL);
+    }
+
+    add = (strcmp(op, "ADD") == 0);
+
+    if (((add) ? (fira_app_add_controlee((uint16_t)address, &state)) : (fira_app_remove_controlee((uint16_t)address, &next))) != _NO_ERR)
+    {
+        return (NULL);
+    }
+
+    if (cmd_resp_json(&resp, MAX_STR_SIZE))
+    {
+        if (add)
+        {
+            cmd_resp_printf(&resp, "{\"CTRLEE\":{\"Add\":\"0x%04X\",\"State\":\"%s\"}}", address, controlee_state_names[state]);
+        }
+        else if (next >= 0)
+        {
+            cmd_resp_printf(&resp, "{\"CTRLEE\":{\"Del\":\"0x%04X\",\"Next\":\"0x%04X\"}}", address, next);
+        }
+        else
+        {
+            cmd_resp_printf(&resp, "{\"CTRLEE\":{\"Del\":\"0x%04X\"}}", address);
+        }
+    }
+
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
 }
 
 
@@ -146,4 +594,16 @@ const struct command_s known_commands_fira[] __attribute__((
 	section(".known_app_subcommands"))) = {
     { NULL, mCmdGrp0 | mIDLE, NULL, COMMENT_FIRA_OPT },
     { "PAVRG",mCmdGrp1 | mIDLE, f_pdoa_average,   COMMENT_AVERAGE},
+    { "AGGR", mCmdGrp1 | mIDLE, f_report_aggr,    COMMENT_AGGR},
+    { "RREPLAY", mCmdGrp1 | mIDLE, f_report_replay, COMMENT_RREPLAY},
+};
+
+const struct command_s known_commands_fira_anytime[] __attribute__((
+    section(".known_commands_anytime"))) = {
+    { "RFORMAT", mCmdGrp1 | mANY, f_report_format, COMMENT_RFORMAT},
+    { "RDELTA",  mCmdGrp1 | mANY, f_report_delta,  COMMENT_RDELTA},
+    { "RCAP",    mCmdGrp1 | mANY, f_report_capture, COMMENT_RCAP},
+    { "FUPD",    mCmdGrp1 | mANY, f_fira_update,  COMMENT_FUPD},
+    { "CTRLEE",  mCmdGrp1 | mANY, f_controlee,    COMMENT_CTRLEE},
+    { "FBOOT",   mCmdGrp1 | mANY, f_fira_boot,    COMMENT_FBOOT},
 };
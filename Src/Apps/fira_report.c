@@ -0,0 +1,669 @@
+/**
+ * @file      fira_report.c
+ *
+ * @brief     Report path of the FiRa sessions: formatting of the ranging results into the reporter, coalescing and aggregation
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "reporter.h"
+#include "common_fira.h"
+#include "fira_report.h"
+#include "report_bin.h"
+#include "report_aggr.h"
+#include "report_delta.h"
+#include "report_config.h"
+#include "usb_uart_tx.h"
+#include "cmsis_os.h"
+#include "HAL_cycles.h"
+#include "minmax.h"
+#include "str_fmt.h"
+
+/* 0 - no output of PDoA
+ * 1 - output of PDoA from uwb_stack, this is supported in 10.x.x
+ */
+#if CONFIG_PEG_UWB == 1
+#define OUTPUT_PDOA_ENABLE (1)
+#else
+#define OUTPUT_PDOA_ENABLE (1)
+#endif
+
+#define STR_SIZE (256)
+
+static struct report_stats_s report_stats[REPORT_FORMAT_MAX];
+static struct ranging_results report_pending; /**< coalesced results waiting for room in the reporter */
+static struct report_aggr_s report_aggr;      /**< statistics of the current aggregation window */
+
+/* State of the driver the reports depend on, sampled by report_cb() once per block.
+ * The replay of a capture sets it from the capture instead, the driver being down. */
+static struct report_env_s
+{
+    int32_t cfo_100ppm;
+    bool diag;
+} report_env;
+
+/* @fn      fira_report_reset
+ * @brief   drops what waits for room in the reporter, the aggregation window and the coalesced block,
+ *          and starts a new delta stream
+ * */
+void fira_report_reset(void)
+{
+    report_pending.n_measurements = 0;
+    report_aggr_reset(&report_aggr);
+    report_delta_reset();
+}
+
+/* @fn      fira_report_set_env
+ * @brief   the state of the driver of the next reports
+ * @param   cfo_100ppm - CFO of the driver, 0.01 ppm
+ *          diag - the diagnostics of the driver are added to the reports
+ * */
+void fira_report_set_env(int32_t cfo_100ppm, bool diag)
+{
+    report_env.cfo_100ppm = cfo_100ppm;
+    report_env.diag = diag;
+}
+
+/* @brief   checks for a new SP1 payload sent
+ * @return  true if the payload_seq_sent of rm is newer than seq
+ * */
+bool fira_report_sp1_data_sent(const struct ranging_measurements *rm, uint32_t *seq)
+{
+#if (PROPRIETARY_SP1_TWR_EXAMPLE_ENABLE == 1)
+    fira_param_t *fira_param = get_fira_config();
+
+    if ((fira_param->session.rframe_config == FIRA_RFRAME_CONFIG_SP1) && (rm->payload_seq_sent > *seq))
+    {
+        *seq = rm->payload_seq_sent;
+        return true;
+    }
+#endif
+    return false;
+}
+
+/* @brief   the start of the JSON line of a block, up to its first measurement
+ * @return  new length, -1 if it does not fit
+ * */
+static int report_json_begin(char *str, int len, int max, const struct ranging_results *results)
+{
+    len = fmt_str(str, len, max, "{\"Block\":");
+    len = fmt_uint(str, len, max, results->block_index);
+    return fmt_str(str, len, max, ", \"results\":[");
+}
+
+/* @brief   a measurement of the JSON line of a block
+ * @param   first - the first measurement of the line, else it follows a comma
+ *          seq - the last SP1 payload reported in the line
+ * @return  new length, -1 if it does not fit
+ * */
+static int report_json_meas(char *str, int len, int max, const struct ranging_measurements *rm, bool first, uint32_t *seq)
+{
+    if (!first)
+    {
+        len = fmt_char(str, len, max, ',');
+    }
+
+    len = fmt_str(str, len, max, "{\"Addr\":\"0x");
+    len = fmt_hex(str, len, max, rm->short_addr, 4, false);
+    len = fmt_str(str, len, max, (rm->status) ? ("\",\"Status\":\"Err\"") : ("\",\"Status\":\"Ok\""));
+
+    if (rm->status == 0)
+    {
+        len = fmt_str(str, len, max, ",\"D_cm\":");
+        len = fmt_int(str, len, max, rm->distance_mm / 10);
+
+#if (OUTPUT_PDOA_ENABLE == 1)
+        len = fmt_str(str, len, max, ",\"LPDoA_deg\":");
+        len = fmt_q16_deg(str, len, max, rm->local_aoa_measurements[0].pdoa_2pi);
+        len = fmt_str(str, len, max, ",\"LAoA_deg\":");
+        len = fmt_q16_deg(str, len, max, rm->local_aoa_measurements[0].aoa_2pi);
+        len = fmt_str(str, len, max, ",\"LFoM\":");
+        len = fmt_int(str, len, max, rm->local_aoa_measurements[0].aoa_fom);
+        len = fmt_str(str, len, max, ",\"RAoA_deg\":");
+        len = fmt_q16_deg(str, len, max, rm->remote_aoa_azimuth_2pi);
+#endif
+
+        len = fmt_str(str, len, max, ",\"CFO_100ppm\":");
+        len = fmt_int(str, len, max, report_env.cfo_100ppm);
+
+        if (fira_report_sp1_data_sent(rm, seq))
+        {
+            len = fmt_str(str, len, max, ",\"SEQ\":");
+            len = fmt_uint(str, len, max, *seq);
+
+            if (rm->sp1_data_len > 0)
+            {
+                uint8_t *data = (uint8_t *)(rm->sp1_data); // <- Printing of received data from another device
+                len = fmt_str(str, len, max, ",\"DATA\":\"");
+                len = fmt_hex(str, len, max, data[0], 2, true);
+                len = fmt_char(str, len, max, ':');
+                len = fmt_hex(str, len, max, data[1], 2, true);
+                len = fmt_char(str, len, max, ':');
+                len = fmt_hex(str, len, max, data[2], 2, true);
+                len = fmt_char(str, len, max, '"');
+            }
+        }
+    }
+    return fmt_char(str, len, max, '}');
+}
+
+/* @brief   the end of the JSON line of a block, after its last measurement
+ * @return  new length, -1 if it does not fit
+ * */
+static int report_json_end(char *str, int len, int max)
+{
+    len = fmt_char(str, len, max, ']');
+
+    /* Display RSSI, CFO and NLOS */
+    if (report_env.diag)
+    {
+        len = fira_uwb_add_diag(str, len, max);
+    }
+
+    return fmt_str(str, len, max, "}\r\n");
+}
+
+/* @brief   formats the results as a JSON line
+ * @return  length of the line, -1 if it does not fit
+ * */
+static int report_json(const struct ranging_results *results, struct string_measurement *str_result)
+{
+    int len = 0;
+    int max = str_result->len;
+    char *str = str_result->str;
+    uint32_t seq = 0;
+
+    if (results->stopped_reason != 0xFF)
+    {
+        len = fmt_str(str, len, max, "{\"Session Stopped\":\"");
+        len = fmt_str(str, len, max,
+                      (results->stopped_reason == 0x0) ? "Stop request" :
+                      (results->stopped_reason == 0x1) ? "Inband Stop" :
+                      (results->stopped_reason == 0x2) ? "Max attempts" : "Unknown");
+        len = fmt_str(str, len, max, "\"}\r\n");
+        return len;
+    }
+
+    len = report_json_begin(str, len, max, results);
+
+    for (int i = 0; i < results->n_measurements; i++)
+    {
+        len = report_json_meas(str, len, max, &results->measurements[i], (i == 0), &seq);
+    }
+
+    return report_json_end(str, len, max);
+}
+
+/* @brief   the fields of the binary record of a measurement
+ * */
+static void report_bin_fields(const struct ranging_measurements *rm, struct report_bin_meas_s *meas)
+{
+    memset(meas, 0, sizeof(*meas));
+    meas->short_addr = rm->short_addr;
+    meas->status = rm->status;
+
+    if (rm->status == 0)
+    {
+        meas->distance_mm = rm->distance_mm;
+#if (OUTPUT_PDOA_ENABLE == 1)
+        meas->aoa_fom = rm->local_aoa_measurements[0].aoa_fom;
+        meas->pdoa_2pi = rm->local_aoa_measurements[0].pdoa_2pi;
+        meas->aoa_2pi = rm->local_aoa_measurements[0].aoa_2pi;
+        meas->remote_aoa_2pi = rm->remote_aoa_azimuth_2pi;
+#endif
+        meas->cfo_100ppm = (int16_t)report_env.cfo_100ppm;
+    }
+}
+
+/* @brief   the diagnostics of the binary frames
+ * @return  NULL if they are disabled
+ * */
+static const struct report_bin_diag_s *report_bin_diag(struct report_bin_diag_s *diag)
+{
+    if (report_env.diag)
+    {
+        fira_uwb_get_diag(&diag->rssi_dbm_x10, &diag->nlos_pct);
+        return diag;
+    }
+    return NULL;
+}
+
+static int report_bin(const struct ranging_results *results, struct string_measurement *str_result)
+{
+    int len;
+    uint8_t *buf = (uint8_t *)str_result->str;
+    struct report_bin_diag_s diag;
+    struct report_bin_meas_s meas;
+
+    if (results->stopped_reason != 0xFF)
+    {
+        return report_bin_stopped(buf, str_result->len, results->stopped_reason);
+    }
+
+    len = report_bin_block_begin(buf, str_result->len, results->block_index, report_bin_diag(&diag));
+
+    for (int i = 0; (i < results->n_measurements) && (len > 0); i++)
+    {
+        report_bin_fields(&results->measurements[i], &meas);
+        len = report_bin_block_add(buf, len, str_result->len, &meas);
+    }
+
+    return (len > 0) ? (report_bin_end(buf, len, str_result->len)) : (len);
+}
+
+static int report_delta(const struct ranging_results *results, struct string_measurement *str_result)
+{
+    uint8_t *buf = (uint8_t *)str_result->str;
+    struct report_bin_diag_s diag;
+    struct report_bin_meas_s meas[FIRA_CONTROLEES_MAX];
+    int n = MIN(results->n_measurements, FIRA_CONTROLEES_MAX);
+
+    if (results->stopped_reason != 0xFF)
+    {
+        return report_bin_stopped(buf, str_result->len, results->stopped_reason);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        report_bin_fields(&results->measurements[i], &meas[i]);
+    }
+
+    return report_delta_encode(buf, str_result->len, get_report_config(), results->block_index, report_bin_diag(&diag), meas, n);
+}
+
+/* @brief   formats the statistics of the aggregation window as a JSON line
+ * @return  length of the line, -1 if it does not fit
+ * */
+static int report_aggr_json(const struct report_aggr_s *aggr, struct string_measurement *str_result)
+{
+    int len = 0;
+    int max = str_result->len;
+    char *str = str_result->str;
+    struct report_aggr_result_s res;
+
+    len = fmt_str(str, len, max, "{\"Block\":");
+    len = fmt_uint(str, len, max, aggr->first_block);
+    len = fmt_str(str, len, max, ", \"Blocks\":");
+    len = fmt_uint(str, len, max, aggr->blocks);
+    len = fmt_str(str, len, max, ", \"aggr\":[");
+
+    for (int i = 0; i < aggr->n_entries; i++)
+    {
+        report_aggr_get(aggr, i, &res);
+
+        if (i > 0)
+        {
+            len = fmt_char(str, len, max, ',');
+        }
+
+        len = fmt_str(str, len, max, "{\"Addr\":\"0x");
+        len = fmt_hex(str, len, max, res.short_addr, 4, false);
+        len = fmt_str(str, len, max, "\",\"Ok\":");
+        len = fmt_uint(str, len, max, res.ok);
+        len = fmt_str(str, len, max, ",\"Err\":");
+        len = fmt_uint(str, len, max, res.err);
+
+        if (res.ok)
+        {
+            len = fmt_str(str, len, max, ",\"D_cm\":");
+            len = fmt_int(str, len, max, res.d_mean_mm / 10);
+            len = fmt_str(str, len, max, ",\"D_min_cm\":");
+            len = fmt_int(str, len, max, res.d_min_mm / 10);
+            len = fmt_str(str, len, max, ",\"D_max_cm\":");
+            len = fmt_int(str, len, max, res.d_max_mm / 10);
+            len = fmt_str(str, len, max, ",\"D_std_cm\":");
+            len = fmt_float(str, len, max, res.d_std_mm / 10.0f, 1);
+#if (OUTPUT_PDOA_ENABLE == 1)
+            len = fmt_str(str, len, max, ",\"LAoA_deg\":");
+            len = fmt_q16_deg(str, len, max, res.aoa_2pi);
+#endif
+        }
+        len = fmt_char(str, len, max, '}');
+    }
+
+    len = fmt_str(str, len, max, "]}\r\n");
+
+    return len;
+}
+
+static int report_aggr_bin(const struct report_aggr_s *aggr, struct string_measurement *str_result)
+{
+    int len;
+    uint8_t *buf = (uint8_t *)str_result->str;
+    struct report_aggr_result_s res;
+    struct report_bin_aggr_s rec;
+
+    len = report_bin_aggr_begin(buf, str_result->len, aggr->first_block, aggr->blocks);
+
+    for (int i = 0; (i < aggr->n_entries) && (len > 0); i++)
+    {
+        report_aggr_get(aggr, i, &res);
+
+        rec.short_addr = res.short_addr;
+        rec.ok = res.ok;
+        rec.err = res.err;
+        rec.aoa_2pi = res.aoa_2pi;
+        rec.d_mean_mm = res.d_mean_mm;
+        rec.d_min_mm = res.d_min_mm;
+        rec.d_max_mm = res.d_max_mm;
+        rec.d_std_mm_x10 = (res.d_std_mm < (UINT16_MAX / 10.0f)) ? ((uint16_t)(res.d_std_mm * 10.0f + 0.5f)) : (UINT16_MAX);
+
+        len = report_bin_aggr_add(buf, len, str_result->len, &rec);
+    }
+
+    return (len > 0) ? (report_bin_end(buf, len, str_result->len)) : (len);
+}
+
+/* @brief   sends the JSON line of a block in parts: its start, then one record per measurement, then its end.
+ *          The reporter sends them with nothing in between, a part never needs more than STR_SIZE.
+ * @return  length of the line, 0 if the reporter has no room for it, -1 if a part did not fit
+ * */
+static int report_json_stream(const struct ranging_results *results)
+{
+    int len, total = 0, err = 0;
+    uint32_t seq = 0;
+    bool first = true;
+    char *str;
+
+    /* all the parts or none: a line is never left open. The refusal is counted as a failed reservation */
+    if (!reporter_instance.room(results->n_measurements + 2, STR_SIZE))
+    {
+        port_tx_dropped(TX_CLASS_RANGING, 1);
+        return 0;
+    }
+
+    str = reporter_instance.reserve(STR_SIZE);
+    len = report_json_begin(str, 0, STR_SIZE, results);
+    reporter_instance.commit_more(MAX(len, 0));
+    total += len;
+
+    for (int i = 0; i < results->n_measurements; i++)
+    {
+        str = reporter_instance.reserve(STR_SIZE);
+        len = report_json_meas(str, 0, STR_SIZE, &results->measurements[i], first, &seq);
+        reporter_instance.commit_more(MAX(len, 0));
+        err |= (len <= 0);
+        first = first && (len <= 0);
+        total += MAX(len, 0);
+    }
+
+    str = reporter_instance.reserve(STR_SIZE);
+    len = report_json_end(str, 0, STR_SIZE);
+    reporter_instance.commit(MAX(len, 0));
+    err |= (len <= 0);
+    total += len;
+
+    return (err) ? (-1) : (total);
+}
+
+/* @brief   the room to reserve for the report, the measurements of the block or the entries of the window
+ * */
+static int report_size(uint8_t format, const struct ranging_results *results, const struct report_aggr_s *aggr)
+{
+    int n = (aggr) ? (aggr->n_entries) : (results->n_measurements);
+    int frame = REPORT_BIN_HDR_LEN + REPORT_BIN_BLOCK_LEN + REPORT_BIN_DIAG_LEN + REPORT_BIN_CRC_LEN;
+
+    if (format == REPORT_FORMAT_JSON)
+    {
+        return STR_SIZE * MAX(n, 1);
+    }
+    if (aggr)
+    {
+        return REPORT_BIN_HDR_LEN + REPORT_BIN_AGGR_HDR_LEN + n * REPORT_BIN_AGGR_LEN + REPORT_BIN_CRC_LEN;
+    }
+    return frame + n * ((format == REPORT_FORMAT_DELTA) ? (REPORT_BIN_DELTA_MAX_LEN) : (REPORT_BIN_MEAS_LEN));
+}
+
+/* @brief   formats the results, or the statistics of the aggregation window if aggr is given,
+ *          straight into the reporter's buffer.
+ *          Out of the machine mode, the JSON line of a block is streamed one measurement at a time:
+ *          a frame of the machine mode carries a whole report.
+ * @return  false if the reporter has no room for them
+ * */
+static bool report_send(const struct ranging_results *results, const struct report_aggr_s *aggr, struct string_measurement *str_result)
+{
+    int len;
+    uint8_t format = get_report_config()->format;
+    struct report_stats_s *stats = &report_stats[(format < REPORT_FORMAT_MAX) ? (format) : (REPORT_FORMAT_JSON)];
+    uint32_t cycles = hal_cycles_get();
+
+    if (!aggr && results->stopped_reason == 0xFF && format == REPORT_FORMAT_JSON && !port_tx_is_framing())
+    {
+        len = report_json_stream(results);
+
+        if (len == 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        /* the room needed grows with the measurements of the block, not with the controlees of the session */
+        str_result->len = report_size(format, results, aggr);
+        str_result->str = reporter_instance.reserve(str_result->len);
+
+        if (!str_result->str)
+        {
+            return false;
+        }
+
+        if (aggr)
+        {
+            len = (format == REPORT_FORMAT_JSON) ? (report_aggr_json(aggr, str_result)) : (report_aggr_bin(aggr, str_result));
+        }
+        else if (format == REPORT_FORMAT_BIN)
+        {
+            len = report_bin(results, str_result);
+        }
+        else if (format == REPORT_FORMAT_DELTA)
+        {
+            len = report_delta(results, str_result);
+        }
+        else
+        {
+            len = report_json(results, str_result);
+        }
+
+        len = (len > str_result->len) ? (-1) : (len);
+        reporter_instance.commit(MAX(len, 0));
+    }
+
+    cycles = hal_cycles_get() - cycles;
+
+    if (len <= 0)
+    {
+        stats->errors++;
+        return true;
+    }
+
+    if (aggr)
+    {
+        stats->blocks += aggr->blocks;
+        for (int i = 0; i < aggr->n_entries; i++)
+        {
+            stats->measurements += aggr->entry[i].ok + aggr->entry[i].err;
+        }
+        stats->cycles += cycles;
+        stats->max_cycles = (cycles > stats->max_cycles) ? (cycles) : (stats->max_cycles);
+    }
+    else if (results->stopped_reason == 0xFF)
+    {
+        stats->blocks++;
+        stats->measurements += results->n_measurements;
+        stats->cycles += cycles;
+        stats->max_cycles = (cycles > stats->max_cycles) ? (cycles) : (stats->max_cycles);
+    }
+    stats->bytes += len;
+
+    return true;
+}
+
+/* @brief   keeps the latest measurement of every responder of results in report_pending
+ * */
+static void report_coalesce(const struct ranging_results *results)
+{
+    const int max = sizeof(report_pending.measurements) / sizeof(report_pending.measurements[0]);
+    int replaced = 0;
+    int dropped = 0;
+
+    for (int i = 0; i < results->n_measurements; i++)
+    {
+        const struct ranging_measurements *rm = &results->measurements[i];
+        int j;
+
+        for (j = 0; j < report_pending.n_measurements; j++)
+        {
+            if (report_pending.measurements[j].short_addr == rm->short_addr)
+            {
+                replaced++;
+                break;
+            }
+        }
+
+        if (j < max)
+        {
+            report_pending.measurements[j] = *rm;
+            report_pending.n_measurements = MAX(report_pending.n_measurements, j + 1);
+        }
+        else
+        {
+            dropped++; /**< a new responder while the pending block is full */
+        }
+    }
+
+    report_pending.stopped_reason = results->stopped_reason;
+    report_pending.session_id = results->session_id;
+    report_pending.block_index = results->block_index;
+    report_pending.ranging_interval_ms = results->ranging_interval_ms;
+    report_pending.timestamp_ns = results->timestamp_ns;
+
+    port_tx_coalesced(TX_CLASS_RANGING, replaced);
+    port_tx_dropped(TX_CLASS_RANGING, dropped);
+}
+
+/* @fn      fira_report_process
+ * @brief   the link is behind when the reporter has no room for a block:
+ *          the blocks are then coalesced, latest measurement per responder address,
+ *          and sent as one block when there is room again.
+ *          With the aggregation enabled, only the statistics of every window are sent.
+ *          The path of every block, live or replayed.
+ * @return  false if the link was behind and the block was coalesced
+ * */
+bool fira_report_process(const struct ranging_results *results, struct string_measurement *str_result)
+{
+    report_config_t *report_config = get_report_config();
+
+    if (results->stopped_reason != 0xFF)
+    {
+        fira_report_flush(str_result);
+        return report_send(results, NULL, str_result);
+    }
+
+    if (report_config->aggr_blocks || report_config->aggr_period_ms)
+    {
+        uint32_t now_ms = osKernelSysTick() / (osKernelSysTickFrequency / 1000);
+
+        report_aggr_add(&report_aggr, results, now_ms);
+
+        /* a window which could not be sent keeps growing until there is room */
+        if (report_aggr_due(&report_aggr, report_config->aggr_blocks, report_config->aggr_period_ms, now_ms) &&
+            report_send(NULL, &report_aggr, str_result))
+        {
+            report_aggr_reset(&report_aggr);
+        }
+        return true;
+    }
+
+    if (report_pending.n_measurements == 0)
+    {
+        if (report_send(results, NULL, str_result))
+        {
+            return true;
+        }
+        report_coalesce(results);
+        return false;
+    }
+
+    report_coalesce(results);
+
+    if (report_send(&report_pending, NULL, str_result))
+    {
+        report_pending.n_measurements = 0;
+        return true;
+    }
+    return false;
+}
+
+/* @fn      fira_report_flush
+ * @brief   sends what waits for room in the reporter: the aggregation window and the coalesced block
+ * @return  true when nothing waits any more
+ * */
+bool fira_report_flush(struct string_measurement *str_result)
+{
+    if (report_aggr.blocks && report_send(NULL, &report_aggr, str_result))
+    {
+        report_aggr_reset(&report_aggr);
+    }
+    if (report_pending.n_measurements && report_send(&report_pending, NULL, str_result))
+    {
+        report_pending.n_measurements = 0;
+    }
+    return (report_aggr.blocks == 0) && (report_pending.n_measurements == 0);
+}
+
+/* @brief   per-format statistics of the reports sent by fira_report_process()
+ * */
+const struct report_stats_s *fira_report_get_stats(uint8_t format)
+{
+    return (format < REPORT_FORMAT_MAX) ? (&report_stats[format]) : (NULL);
+}
+
+void fira_report_reset_stats(void)
+{
+    memset(report_stats, 0, sizeof(report_stats));
+}
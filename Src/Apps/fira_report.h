@@ -0,0 +1,97 @@
+/**
+ * @file      fira_report.h
+ *
+ * @brief     Report path of the FiRa sessions: formatting of the ranging results into the reporter, coalescing and aggregation
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef FIRA_REPORT_H_
+#define FIRA_REPORT_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fira_helper.h"
+
+struct string_measurement;
+
+/* uwb_stack version >8.x.x allows usage of SP1 RFRAMES on Deferred DS-TWR to transmit IoT data.
+ * This mode is not specified in FiRa MAC 1.2, i.e. proprietary implementation.
+ * In this mode both Initiator and Responder can form RFRAMES with proprietary PIE.
+ * Maximum IoT data excahnge limited to approx 70 bytes bidirectional per TWR.
+ * uwb_stack encrypts and guarantee the integrity of the packet, however the flow control, and
+ * retransmission shall be implemented on the upper layer.
+ */
+#define PROPRIETARY_SP1_TWR_EXAMPLE_ENABLE (1)
+
+/* Statistics of the ranging reports, kept per report_format_e */
+struct report_stats_s
+{
+    uint32_t blocks;       /**< Ranging blocks reported */
+    uint32_t measurements; /**< Measurements within those blocks */
+    uint32_t bytes;        /**< Bytes passed to the reporter, including stop reports */
+    uint32_t cycles;       /**< CPU cycles spent encoding the blocks */
+    uint32_t max_cycles;   /**< Worst case CPU cycles for a single block */
+    uint32_t errors;       /**< Reports which did not fit the output buffer */
+};
+
+void fira_report_reset(void);
+void fira_report_set_env(int32_t cfo_100ppm, bool diag);
+bool fira_report_process(const struct ranging_results *results, struct string_measurement *str_result);
+bool fira_report_flush(struct string_measurement *str_result);
+bool fira_report_sp1_data_sent(const struct ranging_measurements *rm, uint32_t *seq);
+const struct report_stats_s *fira_report_get_stats(uint8_t format);
+void fira_report_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIRA_REPORT_H_ */
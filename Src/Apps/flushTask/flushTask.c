@@ -58,22 +58,76 @@
 #include "circular_buffers.h"
 #include "usb_uart_tx.h"
 #include "create_flush_task.h"
+#include "minmax.h"
+#include "reporter.h"
+#include "report_bin.h"
+#include "mcps_capture.h"
+#include "dw3000_diag.h"
+#include "HAL_cycles.h"
 
 task_signal_t flushTask;
 
-#define FLUSH_TASK_STACK_SIZE_BYTES 512
+#define FLUSH_TASK_STACK_SIZE_BYTES 640
 
-#define USB_FLUSH_MS 5
+#define CAPTURE_FRAME_SIZE (REPORT_BIN_HDR_LEN + REPORT_BIN_FRAME_HDR_LEN + MCPS_CAPTURE_DATA_MAX + REPORT_BIN_CRC_LEN)
+
+#define USB_FLUSH_MS      5
+#define USB_FLUSH_IDLE_MS 20
+
+/*
+ * @brief moves the captured frames to the report buffer while it has room,
+ *        the others wait in the capture ring
+ * */
+static void capture_drain(void)
+{
+    const struct mcps_capture_rec_s *rec;
+
+    while ((rec = mcps_capture_front()) != NULL && port_tx_room(CAPTURE_FRAME_SIZE))
+    {
+        uint8_t *buf = (uint8_t *)reporter_instance.reserve(CAPTURE_FRAME_SIZE);
+        int16_t rssi_dbm_x10 = REPORT_BIN_RSSI_INVALID;
+        float rssi;
+        int len;
+
+        if (!buf)
+        {
+            break;
+        }
+
+        if (!(rec->flags & (MCPS_CAPTURE_FLAG_TX | MCPS_CAPTURE_FLAG_ND)) &&
+            dw3000_diag_get_rssi(rec->data, MIN(rec->len, MCPS_CAPTURE_DATA_MAX), &rssi))
+        {
+            rssi_dbm_x10 = (int16_t)(rssi * 10.0f + ((rssi < 0) ? (-0.5f) : (0.5f)));
+        }
+
+        len = report_bin_frame(buf, CAPTURE_FRAME_SIZE, HAL_CYCLES_PER_US, rec, rssi_dbm_x10);
+        reporter_instance.commit((len > 0) ? (len) : (0));
+        mcps_capture_pop();
+    }
+}
 
 /*
  * @brief this thread is
- *        flushing report buffer on demand or every USB_FLUSH_MS ms
+ *        flushing report buffer on demand, at the flush deadline of the pending messages
+ *        or every USB_FLUSH_MS ms while the transport is busy,
+ *        after having moved the captured frames to it
  * */
 void FlushTask(void const *argument)
 {
+    int due;
+    uint32_t wait_ms;
+
     while (1)
     {
-        osSignalWait(flushTask.SignalMask, USB_FLUSH_MS);
+        due = flush_report_due_ms();
+        wait_ms = (due < 0) ? (USB_FLUSH_IDLE_MS) : ((due > 0) ? (MIN(due, USB_FLUSH_MS)) : (USB_FLUSH_MS));
+        /* nothing wakes the task up for a captured frame: it polls for them while capturing */
+        if (mcps_capture_is_enabled() || mcps_capture_front())
+        {
+            wait_ms = MIN(wait_ms, USB_FLUSH_MS);
+        }
+        osSignalWait(flushTask.SignalMask, wait_ms);
+        capture_drain();
         flush_report_buf();
     }
 }
@@ -0,0 +1,178 @@
+/**
+ * @file      report_aggr.c
+ *
+ * @brief     Decimation of the ranging reports: per responder statistics over N blocks or T ms
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+#include "report_aggr.h"
+
+#define AGGR_Q16_PER_RAD (32768.0f / (float)M_PI)
+
+/* @fn      report_aggr_reset
+ * @brief   starts a new aggregation window
+ * */
+void report_aggr_reset(struct report_aggr_s *aggr)
+{
+    memset(aggr, 0, sizeof(*aggr));
+}
+
+/* @brief   the entry of the responder, a new one if there is room
+ * @return  NULL if all the entries are in use by other responders
+ * */
+static struct report_aggr_entry_s *report_aggr_entry(struct report_aggr_s *aggr, uint16_t short_addr)
+{
+    struct report_aggr_entry_s *e;
+
+    for (int i = 0; i < aggr->n_entries; i++)
+    {
+        if (aggr->entry[i].short_addr == short_addr)
+        {
+            return &aggr->entry[i];
+        }
+    }
+
+    if (aggr->n_entries >= (int)(sizeof(aggr->entry) / sizeof(aggr->entry[0])))
+    {
+        return NULL;
+    }
+
+    e = &aggr->entry[aggr->n_entries++];
+    e->short_addr = short_addr;
+    e->d_min_mm = INT32_MAX;
+    e->d_max_mm = INT32_MIN;
+    return e;
+}
+
+/* @fn      report_aggr_add
+ * @brief   adds the measurements of one block to the aggregation window
+ * @param   now_ms - time of the block, only used to start the window
+ * */
+void report_aggr_add(struct report_aggr_s *aggr, const struct ranging_results *results, uint32_t now_ms)
+{
+    if (aggr->blocks == 0)
+    {
+        aggr->first_block = results->block_index;
+        aggr->start_ms = now_ms;
+    }
+
+    if (aggr->blocks < UINT16_MAX)
+    {
+        aggr->blocks++;
+    }
+
+    for (int i = 0; i < results->n_measurements; i++)
+    {
+        const struct ranging_measurements *rm = &results->measurements[i];
+        struct report_aggr_entry_s *e = report_aggr_entry(aggr, rm->short_addr);
+
+        if (!e || (e->ok == UINT16_MAX) || (e->err == UINT16_MAX))
+        {
+            aggr->dropped++;
+            continue;
+        }
+
+        if (rm->status)
+        {
+            e->err++;
+            continue;
+        }
+
+        float d = (float)rm->distance_mm;
+        float delta = d - e->d_mean_mm;
+        float rad = (float)rm->local_aoa_measurements[0].aoa_2pi / AGGR_Q16_PER_RAD;
+
+        e->ok++;
+        e->d_mean_mm += delta / e->ok;
+        e->d_m2 += delta * (d - e->d_mean_mm);
+        e->d_min_mm = (rm->distance_mm < e->d_min_mm) ? (rm->distance_mm) : (e->d_min_mm);
+        e->d_max_mm = (rm->distance_mm > e->d_max_mm) ? (rm->distance_mm) : (e->d_max_mm);
+        e->aoa_sin += sinf(rad);
+        e->aoa_cos += cosf(rad);
+    }
+}
+
+/* @fn      report_aggr_due
+ * @brief   the window is complete after n_blocks blocks or period_ms ms, whichever comes first
+ * @param   n_blocks, period_ms - 0 if not used
+ * */
+bool report_aggr_due(const struct report_aggr_s *aggr, uint16_t n_blocks, uint16_t period_ms, uint32_t now_ms)
+{
+    if (aggr->blocks == 0)
+    {
+        return false;
+    }
+
+    return ((n_blocks != 0) && (aggr->blocks >= n_blocks)) ||
+           ((period_ms != 0) && ((uint32_t)(now_ms - aggr->start_ms) >= period_ms));
+}
+
+/* @fn      report_aggr_get
+ * @brief   the statistics of the idx-th responder of the window
+ * */
+void report_aggr_get(const struct report_aggr_s *aggr, int idx, struct report_aggr_result_s *res)
+{
+    const struct report_aggr_entry_s *e = &aggr->entry[idx];
+
+    memset(res, 0, sizeof(*res));
+    res->short_addr = e->short_addr;
+    res->ok = e->ok;
+    res->err = e->err;
+
+    if (e->ok == 0)
+    {
+        return;
+    }
+
+    res->d_mean_mm = (int32_t)lroundf(e->d_mean_mm);
+    res->d_min_mm = e->d_min_mm;
+    res->d_max_mm = e->d_max_mm;
+    res->d_std_mm = (e->d_m2 > 0.0f) ? (sqrtf(e->d_m2 / e->ok)) : (0.0f);
+    res->aoa_2pi = (int16_t)(int32_t)lroundf(atan2f(e->aoa_sin, e->aoa_cos) * AGGR_Q16_PER_RAD);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file      report_aggr.h
+ *
+ * @brief     Decimation of the ranging reports: per responder statistics over N blocks or T ms
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef REPORT_AGGR_H_
+#define REPORT_AGGR_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fira_helper.h"
+
+/* Running statistics of one responder, fixed size */
+struct report_aggr_entry_s
+{
+    uint16_t short_addr;
+    uint16_t ok;        /**< measurements with status Ok */
+    uint16_t err;       /**< measurements in error */
+    int32_t d_min_mm;
+    int32_t d_max_mm;
+    float d_mean_mm;    /**< Welford's running mean */
+    float d_m2;         /**< Welford's sum of the squared deviations */
+    float aoa_sin;      /**< sum of the unit vectors of the local AoA */
+    float aoa_cos;
+};
+
+struct report_aggr_s
+{
+    uint32_t first_block; /**< index of the first aggregated block */
+    uint32_t start_ms;    /**< time of the first aggregated block */
+    uint16_t blocks;      /**< number of aggregated blocks */
+    uint16_t dropped;     /**< measurements of responders which did not fit in entry[] */
+    int n_entries;
+    struct report_aggr_entry_s entry[FIRA_CONTROLEES_MAX];
+};
+
+/* Statistics of one responder, as reported */
+struct report_aggr_result_s
+{
+    uint16_t short_addr;
+    uint16_t ok;
+    uint16_t err;
+    int32_t d_mean_mm;
+    int32_t d_min_mm;
+    int32_t d_max_mm;
+    float d_std_mm;  /**< population standard deviation */
+    int16_t aoa_2pi; /**< circular mean of the local AoA, Q16 fraction of 2*pi */
+};
+
+void report_aggr_reset(struct report_aggr_s *aggr);
+void report_aggr_add(struct report_aggr_s *aggr, const struct ranging_results *results, uint32_t now_ms);
+bool report_aggr_due(const struct report_aggr_s *aggr, uint16_t n_blocks, uint16_t period_ms, uint32_t now_ms);
+void report_aggr_get(const struct report_aggr_s *aggr, int idx, struct report_aggr_result_s *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPORT_AGGR_H_ */
@@ -0,0 +1,381 @@
+/**
+ * @file      report_bin.c
+ *
+ * @brief     Compact binary encoding of the ranging reports
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "report_bin.h"
+#include "crc16.h"
+
+#define REPORT_BIN_OFFSET_LEN    4
+#define REPORT_BIN_OFFSET_N_MEAS (REPORT_BIN_HDR_LEN + 4)
+#define REPORT_BIN_OFFSET_N_AGGR (REPORT_BIN_HDR_LEN + 6)
+#define REPORT_BIN_OFFSET_N_TRACE (REPORT_BIN_HDR_LEN + 2)
+
+static uint8_t frame_seq = 0;
+
+static inline void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static int report_bin_header(uint8_t *buf, int max_len, report_bin_type_e type)
+{
+    if (max_len < REPORT_BIN_HDR_LEN + REPORT_BIN_CRC_LEN)
+    {
+        return -1;
+    }
+    buf[0] = REPORT_BIN_SYNC;
+    buf[1] = REPORT_BIN_VERSION;
+    buf[2] = (uint8_t)type;
+    buf[3] = frame_seq++;
+    put_le16(&buf[REPORT_BIN_OFFSET_LEN], 0);
+    return REPORT_BIN_HDR_LEN;
+}
+
+static int report_bin_block_header(uint8_t *buf, int max_len, report_bin_type_e type, uint32_t block_index,
+                                   const struct report_bin_diag_s *diag, uint8_t flags)
+{
+    int len = report_bin_header(buf, max_len, type);
+    int need = REPORT_BIN_BLOCK_LEN + ((diag) ? (REPORT_BIN_DIAG_LEN) : (0));
+
+    if (len < 0 || (len + need + REPORT_BIN_CRC_LEN) > max_len)
+    {
+        return -1;
+    }
+
+    put_le32(&buf[len], block_index);
+    buf[len + 4] = 0;
+    buf[len + 5] = flags | ((diag) ? (REPORT_BIN_FLAG_DIAG) : (0));
+    len += REPORT_BIN_BLOCK_LEN;
+
+    if (diag)
+    {
+        put_le16(&buf[len], (uint16_t)diag->rssi_dbm_x10);
+        buf[len + 2] = diag->nlos_pct;
+        buf[len + 3] = 0;
+        len += REPORT_BIN_DIAG_LEN;
+    }
+    return len;
+}
+
+/* @fn      report_bin_block_begin
+ * @brief   starts a REPORT_BIN_TYPE_BLOCK frame in buf
+ * @param   diag - diagnostics to be added to the block or NULL
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_block_begin(uint8_t *buf, int max_len, uint32_t block_index, const struct report_bin_diag_s *diag)
+{
+    return report_bin_block_header(buf, max_len, REPORT_BIN_TYPE_BLOCK, block_index, diag, 0);
+}
+
+/* @fn      report_bin_block_add
+ * @brief   appends one measurement record to the block started with report_bin_block_begin()
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_block_add(uint8_t *buf, int len, int max_len, const struct report_bin_meas_s *meas)
+{
+    uint8_t *p = &buf[len];
+
+    if ((len + REPORT_BIN_MEAS_LEN + REPORT_BIN_CRC_LEN) > max_len || buf[REPORT_BIN_OFFSET_N_MEAS] == UINT8_MAX)
+    {
+        return -1;
+    }
+
+    put_le16(&p[0], meas->short_addr);
+    p[2] = meas->status;
+    p[3] = meas->aoa_fom;
+    put_le32(&p[4], (uint32_t)meas->distance_mm);
+    put_le16(&p[8], (uint16_t)meas->pdoa_2pi);
+    put_le16(&p[10], (uint16_t)meas->aoa_2pi);
+    put_le16(&p[12], (uint16_t)meas->remote_aoa_2pi);
+    put_le16(&p[14], (uint16_t)meas->cfo_100ppm);
+
+    buf[REPORT_BIN_OFFSET_N_MEAS]++;
+
+    return len + REPORT_BIN_MEAS_LEN;
+}
+
+/* @fn      report_bin_delta_begin
+ * @brief   starts a REPORT_BIN_TYPE_DELTA frame in buf
+ * @param   diag - diagnostics to be added to the block or NULL
+ * @param   key - the frame is a keyframe: all the fields of every responder
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_delta_begin(uint8_t *buf, int max_len, uint32_t block_index, const struct report_bin_diag_s *diag, bool key)
+{
+    return report_bin_block_header(buf, max_len, REPORT_BIN_TYPE_DELTA, block_index, diag, (key) ? (REPORT_BIN_FLAG_KEY) : (0));
+}
+
+/* @fn      report_bin_delta_add
+ * @brief   appends the fields of mask of one responder to the frame started with report_bin_delta_begin()
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_delta_add(uint8_t *buf, int len, int max_len, const struct report_bin_meas_s *meas, uint8_t mask)
+{
+    uint8_t *p = &buf[len];
+    int n = 3;
+
+    if ((len + REPORT_BIN_DELTA_MAX_LEN + REPORT_BIN_CRC_LEN) > max_len || buf[REPORT_BIN_OFFSET_N_MEAS] == UINT8_MAX)
+    {
+        return -1;
+    }
+
+    put_le16(&p[0], meas->short_addr);
+    p[2] = mask;
+
+    if (mask & REPORT_BIN_DELTA_STATUS)
+    {
+        p[n++] = meas->status;
+    }
+    if (mask & REPORT_BIN_DELTA_FOM)
+    {
+        p[n++] = meas->aoa_fom;
+    }
+    if (mask & REPORT_BIN_DELTA_DISTANCE)
+    {
+        put_le32(&p[n], (uint32_t)meas->distance_mm);
+        n += 4;
+    }
+    if (mask & REPORT_BIN_DELTA_PDOA)
+    {
+        put_le16(&p[n], (uint16_t)meas->pdoa_2pi);
+        n += 2;
+    }
+    if (mask & REPORT_BIN_DELTA_AOA)
+    {
+        put_le16(&p[n], (uint16_t)meas->aoa_2pi);
+        n += 2;
+    }
+    if (mask & REPORT_BIN_DELTA_REMOTE_AOA)
+    {
+        put_le16(&p[n], (uint16_t)meas->remote_aoa_2pi);
+        n += 2;
+    }
+    if (mask & REPORT_BIN_DELTA_CFO)
+    {
+        put_le16(&p[n], (uint16_t)meas->cfo_100ppm);
+        n += 2;
+    }
+
+    buf[REPORT_BIN_OFFSET_N_MEAS]++;
+
+    return len + n;
+}
+
+/* @fn      report_bin_aggr_begin
+ * @brief   starts a REPORT_BIN_TYPE_AGGR frame in buf
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_aggr_begin(uint8_t *buf, int max_len, uint32_t first_block, uint16_t blocks)
+{
+    int len = report_bin_header(buf, max_len, REPORT_BIN_TYPE_AGGR);
+
+    if (len < 0 || (len + REPORT_BIN_AGGR_HDR_LEN + REPORT_BIN_CRC_LEN) > max_len)
+    {
+        return -1;
+    }
+
+    put_le32(&buf[len], first_block);
+    put_le16(&buf[len + 4], blocks);
+    buf[len + 6] = 0;
+    buf[len + 7] = 0;
+
+    return len + REPORT_BIN_AGGR_HDR_LEN;
+}
+
+/* @fn      report_bin_aggr_add
+ * @brief   appends one responder record to the frame started with report_bin_aggr_begin()
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_aggr_add(uint8_t *buf, int len, int max_len, const struct report_bin_aggr_s *aggr)
+{
+    uint8_t *p = &buf[len];
+
+    if ((len + REPORT_BIN_AGGR_LEN + REPORT_BIN_CRC_LEN) > max_len || buf[REPORT_BIN_OFFSET_N_AGGR] == UINT8_MAX)
+    {
+        return -1;
+    }
+
+    put_le16(&p[0], aggr->short_addr);
+    put_le16(&p[2], aggr->ok);
+    put_le16(&p[4], aggr->err);
+    put_le16(&p[6], (uint16_t)aggr->aoa_2pi);
+    put_le32(&p[8], (uint32_t)aggr->d_mean_mm);
+    put_le32(&p[12], (uint32_t)aggr->d_min_mm);
+    put_le32(&p[16], (uint32_t)aggr->d_max_mm);
+    put_le16(&p[20], aggr->d_std_mm_x10);
+
+    buf[REPORT_BIN_OFFSET_N_AGGR]++;
+
+    return len + REPORT_BIN_AGGR_LEN;
+}
+
+/* @fn      report_bin_stopped
+ * @brief   writes a complete REPORT_BIN_TYPE_STOPPED frame to buf
+ * @return  the length of the frame or -1 if buf is too small
+ * */
+int report_bin_stopped(uint8_t *buf, int max_len, uint8_t reason)
+{
+    int len = report_bin_header(buf, max_len, REPORT_BIN_TYPE_STOPPED);
+
+    if (len < 0 || (len + 1 + REPORT_BIN_CRC_LEN) > max_len)
+    {
+        return -1;
+    }
+    buf[len++] = reason;
+
+    return report_bin_end(buf, len, max_len);
+}
+
+/* @fn      report_bin_trace_begin
+ * @brief   starts a REPORT_BIN_TYPE_TRACE frame in buf
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_trace_begin(uint8_t *buf, int max_len, uint16_t cycles_per_us)
+{
+    int len = report_bin_header(buf, max_len, REPORT_BIN_TYPE_TRACE);
+
+    if (len < 0 || (len + REPORT_BIN_TRACE_HDR_LEN + REPORT_BIN_CRC_LEN) > max_len)
+    {
+        return -1;
+    }
+
+    put_le16(&buf[len], cycles_per_us);
+    buf[len + 2] = 0;
+    buf[len + 3] = 0;
+
+    return len + REPORT_BIN_TRACE_HDR_LEN;
+}
+
+/* @fn      report_bin_trace_add
+ * @brief   appends one record to the frame started with report_bin_trace_begin()
+ * @return  the length of the frame so far or -1 if buf is too small
+ * */
+int report_bin_trace_add(uint8_t *buf, int len, int max_len, const struct trace_rec_s *rec)
+{
+    uint8_t *p = &buf[len];
+
+    if ((len + REPORT_BIN_TRACE_LEN + REPORT_BIN_CRC_LEN) > max_len || buf[REPORT_BIN_OFFSET_N_TRACE] == UINT8_MAX)
+    {
+        return -1;
+    }
+
+    put_le32(&p[0], rec->cycles);
+    put_le32(&p[4], rec->arg);
+    p[8] = rec->id;
+    p[9] = rec->phase;
+    put_le16(&p[10], rec->seq);
+
+    buf[REPORT_BIN_OFFSET_N_TRACE]++;
+
+    return len + REPORT_BIN_TRACE_LEN;
+}
+
+/* @fn      report_bin_frame
+ * @brief   writes a complete REPORT_BIN_TYPE_FRAME frame of a captured frame to buf
+ * @return  the length of the frame or -1 if buf is too small
+ * */
+int report_bin_frame(uint8_t *buf, int max_len, uint16_t cycles_per_us, const struct mcps_capture_rec_s *rec, int16_t rssi_dbm_x10)
+{
+    int len = report_bin_header(buf, max_len, REPORT_BIN_TYPE_FRAME);
+    int n = (rec->flags & MCPS_CAPTURE_FLAG_ND) ? (0) : ((rec->len < MCPS_CAPTURE_DATA_MAX) ? (rec->len) : (MCPS_CAPTURE_DATA_MAX));
+    uint8_t *p;
+
+    if (len < 0 || (len + REPORT_BIN_FRAME_HDR_LEN + n + REPORT_BIN_CRC_LEN) > max_len)
+    {
+        return -1;
+    }
+
+    p = &buf[len];
+    put_le16(&p[0], cycles_per_us);
+    put_le32(&p[2], rec->cycles);
+    put_le32(&p[6], (uint32_t)rec->rctu);
+    p[10] = (uint8_t)(rec->rctu >> 32);
+    put_le16(&p[11], (uint16_t)rec->cfo_100ppm);
+    put_le16(&p[13], (uint16_t)rssi_dbm_x10);
+    p[15] = rec->sts_mode;
+    p[16] = rec->flags;
+    put_le16(&p[17], rec->len);
+    memcpy(&p[REPORT_BIN_FRAME_HDR_LEN], rec->data, n);
+
+    return report_bin_end(buf, len + REPORT_BIN_FRAME_HDR_LEN + n, max_len);
+}
+
+/* @fn      report_bin_end
+ * @brief   fills the payload length and appends the CRC16 trailer
+ * @return  the final length of the frame or -1 if buf is too small
+ * */
+int report_bin_end(uint8_t *buf, int len, int max_len)
+{
+    uint16_t crc;
+
+    if (len < REPORT_BIN_HDR_LEN || (len + REPORT_BIN_CRC_LEN) > max_len)
+    {
+        return -1;
+    }
+
+    put_le16(&buf[REPORT_BIN_OFFSET_LEN], (uint16_t)(len - REPORT_BIN_HDR_LEN));
+
+    crc = calc_crc16(buf, (uint16_t)len);
+    buf[len++] = (uint8_t)(crc >> 8);
+    buf[len++] = (uint8_t)crc;
+
+    return len;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file      report_bin.h
+ *
+ * @brief     Compact binary encoding of the ranging reports
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef REPORT_BIN_H_
+#define REPORT_BIN_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "trace.h"
+#include "mcps_capture.h"
+
+/* Binary report frame, all multi-byte fields are little-endian except the CRC:
+ *
+ *  offset size
+ *   0     1    sync, REPORT_BIN_SYNC
+ *   1     1    version, REPORT_BIN_VERSION
+ *   2     1    type, report_bin_type_e
+ *   3     1    frame sequence number, wraps at 255
+ *   4     2    payload length N
+ *   6     N    payload
+ *   6+N   2    CRC16 of bytes [0 .. 6+N-1], high byte first (as checked by check_crc16())
+ *
+ * REPORT_BIN_TYPE_BLOCK payload:
+ *   0     4    block index
+ *   4     1    number of measurement records M
+ *   5     1    flags, REPORT_BIN_FLAG_xx
+ *   [if REPORT_BIN_FLAG_DIAG]
+ *   +0    2    RSSI, 0.1 dBm, REPORT_BIN_RSSI_INVALID if not available
+ *   +2    1    NLOS probability, %
+ *   +3    1    reserved
+ *   M x REPORT_BIN_MEAS_LEN measurement records:
+ *   +0    2    short address
+ *   +2    1    status, 0 is Ok
+ *   +3    1    local AoA figure of merit
+ *   +4    4    distance, mm
+ *   +8    2    local PDoA, Q16 fraction of 2*pi
+ *   +10   2    local AoA, Q16 fraction of 2*pi
+ *   +12   2    remote AoA azimuth, Q16 fraction of 2*pi
+ *   +14   2    CFO, 0.01 ppm
+ *
+ * REPORT_BIN_TYPE_STOPPED payload:
+ *   0     1    stopped reason as reported by the FiRa helper
+ *
+ * REPORT_BIN_TYPE_AGGR payload, statistics of the blocks of one aggregation window:
+ *   0     4    index of the first block
+ *   4     2    number of blocks
+ *   6     1    number of responder records M
+ *   7     1    reserved
+ *   M x REPORT_BIN_AGGR_LEN responder records:
+ *   +0    2    short address
+ *   +2    2    measurements with status Ok
+ *   +4    2    measurements in error
+ *   +6    2    circular mean of the local AoA, Q16 fraction of 2*pi
+ *   +8    4    mean distance, mm
+ *   +12   4    min distance, mm
+ *   +16   4    max distance, mm
+ *   +20   2    standard deviation of the distance, 0.1 mm, saturated
+ *
+ * REPORT_BIN_TYPE_DELTA payload, only the fields which changed since the last frame sent:
+ *   0     4    block index
+ *   4     1    number of responder records M
+ *   5     1    flags, REPORT_BIN_FLAG_xx; with REPORT_BIN_FLAG_KEY every record has all the fields
+ *   [if REPORT_BIN_FLAG_DIAG]
+ *   +0    4    as in REPORT_BIN_TYPE_BLOCK
+ *   M responder records, the responders without any change are omitted:
+ *   +0    2    short address
+ *   +2    1    mask of the fields which follow, REPORT_BIN_DELTA_xx
+ *   then, in this order, the fields of the mask, with the size and unit of the measurement record:
+ *         status (1), local AoA figure of merit (1), distance (4), local PDoA (2), local AoA (2),
+ *         remote AoA azimuth (2), CFO (2)
+ *
+ * REPORT_BIN_TYPE_TRACE payload, records of the tracepoints in the order taken:
+ *   0     2    cycles of the cycle counter per microsecond
+ *   2     1    number of records M
+ *   3     1    reserved
+ *   M x REPORT_BIN_TRACE_LEN records:
+ *   +0    4    cycle counter
+ *   +4    4    argument
+ *   +8    1    id, trace_id_e
+ *   +9    1    phase, 'B' begin, 'E' end or 'i' instant
+ *   +10   2    lower 16 bits of the index of the record, a gap tells records lost
+ *
+ * REPORT_BIN_TYPE_FRAME payload, a frame transmitted or received by the MCPS:
+ *   0     2    cycles of the cycle counter per microsecond
+ *   2     4    cycle counter at the capture
+ *   6     5    RMARKER, received or scheduled, RCTU of the MAC timebase, 0 for an immediate TX
+ *   11    2    CFO, 0.01 ppm
+ *   13    2    RSSI of the last frame of the sender, 0.1 dBm, REPORT_BIN_RSSI_INVALID if not available
+ *   15    1    STS packet configuration, 0xFF if not known
+ *   16    1    flags, MCPS_CAPTURE_FLAG_xx
+ *   17    2    length of the frame, the FCS excluded
+ *   19    N    first bytes of the frame, N is the length unless cut
+ * */
+
+#define REPORT_BIN_SYNC    0xB5
+#define REPORT_BIN_VERSION 1
+
+#define REPORT_BIN_HDR_LEN   6
+#define REPORT_BIN_CRC_LEN   2
+#define REPORT_BIN_BLOCK_LEN 6
+#define REPORT_BIN_DIAG_LEN  4
+#define REPORT_BIN_MEAS_LEN  16
+#define REPORT_BIN_AGGR_HDR_LEN 8
+#define REPORT_BIN_AGGR_LEN  22
+#define REPORT_BIN_TRACE_HDR_LEN 4
+#define REPORT_BIN_TRACE_LEN 12
+#define REPORT_BIN_FRAME_HDR_LEN 19
+
+#define REPORT_BIN_FLAG_DIAG 0x01
+#define REPORT_BIN_FLAG_KEY  0x02
+
+#define REPORT_BIN_DELTA_STATUS     0x01
+#define REPORT_BIN_DELTA_FOM        0x02
+#define REPORT_BIN_DELTA_DISTANCE   0x04
+#define REPORT_BIN_DELTA_PDOA       0x08
+#define REPORT_BIN_DELTA_AOA        0x10
+#define REPORT_BIN_DELTA_REMOTE_AOA 0x20
+#define REPORT_BIN_DELTA_CFO        0x40
+#define REPORT_BIN_DELTA_ALL        0x7F
+#define REPORT_BIN_DELTA_MAX_LEN    17 /**< record with all the fields */
+
+#define REPORT_BIN_RSSI_INVALID ((int16_t)0x8000)
+
+typedef enum
+{
+    REPORT_BIN_TYPE_BLOCK = 1,
+    REPORT_BIN_TYPE_STOPPED = 2,
+    REPORT_BIN_TYPE_AGGR = 3,
+    REPORT_BIN_TYPE_DELTA = 4,
+    REPORT_BIN_TYPE_TRACE = 5,
+    REPORT_BIN_TYPE_FRAME = 6
+} report_bin_type_e;
+
+struct report_bin_meas_s
+{
+    uint16_t short_addr;
+    uint8_t status;
+    uint8_t aoa_fom;
+    int32_t distance_mm;
+    int16_t pdoa_2pi;
+    int16_t aoa_2pi;
+    int16_t remote_aoa_2pi;
+    int16_t cfo_100ppm;
+};
+
+struct report_bin_aggr_s
+{
+    uint16_t short_addr;
+    uint16_t ok;
+    uint16_t err;
+    int16_t aoa_2pi;
+    int32_t d_mean_mm;
+    int32_t d_min_mm;
+    int32_t d_max_mm;
+    uint16_t d_std_mm_x10;
+};
+
+struct report_bin_diag_s
+{
+    int16_t rssi_dbm_x10;
+    uint8_t nlos_pct;
+};
+
+int report_bin_block_begin(uint8_t *buf, int max_len, uint32_t block_index, const struct report_bin_diag_s *diag);
+int report_bin_block_add(uint8_t *buf, int len, int max_len, const struct report_bin_meas_s *meas);
+int report_bin_stopped(uint8_t *buf, int max_len, uint8_t reason);
+int report_bin_aggr_begin(uint8_t *buf, int max_len, uint32_t first_block, uint16_t blocks);
+int report_bin_aggr_add(uint8_t *buf, int len, int max_len, const struct report_bin_aggr_s *aggr);
+int report_bin_delta_begin(uint8_t *buf, int max_len, uint32_t block_index, const struct report_bin_diag_s *diag, bool key);
+int report_bin_delta_add(uint8_t *buf, int len, int max_len, const struct report_bin_meas_s *meas, uint8_t mask);
+int report_bin_trace_begin(uint8_t *buf, int max_len, uint16_t cycles_per_us);
+int report_bin_trace_add(uint8_t *buf, int len, int max_len, const struct trace_rec_s *rec);
+int report_bin_frame(uint8_t *buf, int max_len, uint16_t cycles_per_us, const struct mcps_capture_rec_s *rec, int16_t rssi_dbm_x10);
+int report_bin_end(uint8_t *buf, int len, int max_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPORT_BIN_H_ */
@@ -0,0 +1,212 @@
+/**
+ * @file      report_capture.c
+ *
+ * @brief     Capture of the raw ranging results delivered to the report callback, for a later replay
+ *
+ *            The results are appended to a linear log until it is full: the log is written by the
+ *            report task only, and read by the commands only once the capture is stopped.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+#include "report_capture.h"
+
+static uint8_t capture_buf[REPORT_CAPTURE_BUFSIZE];
+
+static struct
+{
+    volatile bool on;
+    uint16_t len;
+    uint16_t records;
+    uint16_t dropped;
+} capture;
+
+static inline void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* @fn      report_capture_start
+ * @brief   clears the log and starts the capture
+ * */
+void report_capture_start(void)
+{
+    capture.on = false;
+    capture.len = 0;
+    capture.records = 0;
+    capture.dropped = 0;
+    capture.on = true;
+}
+
+void report_capture_stop(void)
+{
+    capture.on = false;
+}
+
+/* @fn      report_capture_add
+ * @brief   appends the results to the log, if the capture is on
+ * @param   cfo_100ppm - CFO of the driver at the time of the results
+ * */
+void report_capture_add(const struct ranging_results *results, int32_t cfo_100ppm)
+{
+    int n = results->n_measurements;
+    int need = REPORT_CAPTURE_HDR_LEN + n * REPORT_CAPTURE_MEAS_LEN;
+    uint8_t *p;
+
+    if (!capture.on)
+    {
+        return;
+    }
+
+    if ((capture.len + need) > REPORT_CAPTURE_BUFSIZE)
+    {
+        capture.dropped++;
+        return;
+    }
+
+    p = &capture_buf[capture.len];
+    p[0] = (uint8_t)n;
+    p[1] = results->stopped_reason;
+    put_le16(&p[2], (uint16_t)(int16_t)cfo_100ppm);
+    put_le32(&p[4], results->block_index);
+    p += REPORT_CAPTURE_HDR_LEN;
+
+    for (int i = 0; i < n; i++, p += REPORT_CAPTURE_MEAS_LEN)
+    {
+        const struct ranging_measurements *rm = &results->measurements[i];
+
+        put_le16(&p[0], rm->short_addr);
+        p[2] = rm->status;
+        p[3] = rm->local_aoa_measurements[0].aoa_fom;
+        put_le32(&p[4], (uint32_t)rm->distance_mm);
+        put_le16(&p[8], (uint16_t)rm->local_aoa_measurements[0].pdoa_2pi);
+        put_le16(&p[10], (uint16_t)rm->local_aoa_measurements[0].aoa_2pi);
+        put_le16(&p[12], (uint16_t)rm->remote_aoa_azimuth_2pi);
+    }
+
+    capture.len += need;
+    capture.records++;
+}
+
+/* @fn      report_capture_read
+ * @brief   rebuilds the results of the record at offset of the log
+ * @return  offset of the next record, -1 at the end of the log or if the capture is on
+ * */
+int report_capture_read(int offset, struct ranging_results *results, int32_t *cfo_100ppm)
+{
+    const uint8_t *p = &capture_buf[offset];
+    int n;
+
+    if (capture.on || (offset + REPORT_CAPTURE_HDR_LEN) > capture.len)
+    {
+        return -1;
+    }
+
+    n = p[0];
+
+    if (n > FIRA_CONTROLEES_MAX || (offset + REPORT_CAPTURE_HDR_LEN + n * REPORT_CAPTURE_MEAS_LEN) > capture.len)
+    {
+        return -1;
+    }
+
+    memset(results, 0, sizeof(*results));
+    results->n_measurements = n;
+    results->stopped_reason = p[1];
+    *cfo_100ppm = (int16_t)get_le16(&p[2]);
+    results->block_index = get_le32(&p[4]);
+    p += REPORT_CAPTURE_HDR_LEN;
+
+    for (int i = 0; i < n; i++, p += REPORT_CAPTURE_MEAS_LEN)
+    {
+        struct ranging_measurements *rm = &results->measurements[i];
+
+        rm->short_addr = get_le16(&p[0]);
+        rm->status = p[2];
+        rm->local_aoa_measurements[0].aoa_fom = p[3];
+        rm->distance_mm = (int32_t)get_le32(&p[4]);
+        rm->local_aoa_measurements[0].pdoa_2pi = (int16_t)get_le16(&p[8]);
+        rm->local_aoa_measurements[0].aoa_2pi = (int16_t)get_le16(&p[10]);
+        rm->remote_aoa_azimuth_2pi = (int16_t)get_le16(&p[12]);
+    }
+
+    return offset + REPORT_CAPTURE_HDR_LEN + n * REPORT_CAPTURE_MEAS_LEN;
+}
+
+/* @fn      report_capture_data
+ * @brief   the raw log, report_capture_get_stats() gives its length
+ * */
+const uint8_t *report_capture_data(void)
+{
+    return capture_buf;
+}
+
+void report_capture_get_stats(struct report_capture_stats_s *stats)
+{
+    stats->on = capture.on;
+    stats->records = capture.records;
+    stats->bytes = capture.len;
+    stats->dropped = capture.dropped;
+}
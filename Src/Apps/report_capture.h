@@ -0,0 +1,103 @@
+/**
+ * @file      report_capture.h
+ *
+ * @brief     Capture of the raw ranging results delivered to the report callback, for a later replay
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef REPORT_CAPTURE_H_
+#define REPORT_CAPTURE_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fira_helper.h"
+
+/* Capture log: a sequence of records, all multi-byte fields are little-endian
+ *
+ *  offset size
+ *   0     1    number of measurements M
+ *   1     1    stopped reason, 0xFF while the session is running
+ *   2     2    CFO of the driver, 0.01 ppm
+ *   4     4    block index
+ *   M x REPORT_CAPTURE_MEAS_LEN measurement records:
+ *   +0    2    short address
+ *   +2    1    status
+ *   +3    1    local AoA figure of merit
+ *   +4    4    distance, mm
+ *   +8    2    local PDoA, Q16 fraction of 2*pi
+ *   +10   2    local AoA, Q16 fraction of 2*pi
+ *   +12   2    remote AoA azimuth, Q16 fraction of 2*pi
+ * */
+
+#define REPORT_CAPTURE_BUFSIZE   4096
+#define REPORT_CAPTURE_HDR_LEN   8
+#define REPORT_CAPTURE_MEAS_LEN  14
+
+struct report_capture_stats_s
+{
+    bool on;
+    uint16_t records; /**< records in the log */
+    uint16_t bytes;   /**< bytes in the log */
+    uint16_t dropped; /**< results which did not fit in the log */
+};
+
+void report_capture_start(void);
+void report_capture_stop(void);
+void report_capture_add(const struct ranging_results *results, int32_t cfo_100ppm);
+int report_capture_read(int offset, struct ranging_results *results, int32_t *cfo_100ppm);
+const uint8_t *report_capture_data(void);
+void report_capture_get_stats(struct report_capture_stats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPORT_CAPTURE_H_ */
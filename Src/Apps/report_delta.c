@@ -0,0 +1,173 @@
+/**
+ * @file      report_delta.c
+ *
+ * @brief     Delta encoding of the ranging reports: only the fields which changed beyond their deadband
+ *
+ *            The encoder keeps the last value sent of every field of every responder.
+ *            A field is sent when it is further than its deadband from that value,
+ *            so the error of the host's copy never exceeds the deadband.
+ *            A keyframe with all the fields is sent every cfg->delta_key frames for the host to resync.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "report_delta.h"
+#include "fira_helper.h"
+
+struct report_delta_s
+{
+    uint16_t since_key; /**< frames since the last keyframe, 0 if the next frame shall be a keyframe */
+    int n;
+    struct report_bin_meas_s last[FIRA_CONTROLEES_MAX]; /**< the values known by the host */
+};
+
+static struct report_delta_s report_delta;
+
+/* @fn      report_delta_reset
+ * @brief   forgets the values known by the host: the next frame is a keyframe
+ * */
+void report_delta_reset(void)
+{
+    memset(&report_delta, 0, sizeof(report_delta));
+}
+
+static bool report_delta_angle(int16_t a, int16_t b, uint16_t deadband)
+{
+    return abs((int16_t)(a - b)) > deadband; /**< the angles wrap at +-pi */
+}
+
+/* @brief   the fields of meas to send
+ * */
+static uint8_t report_delta_mask(const report_config_t *cfg, const struct report_bin_meas_s *last, const struct report_bin_meas_s *meas)
+{
+    uint8_t mask = (meas->status != last->status) ? (REPORT_BIN_DELTA_STATUS) : (0);
+
+    if (meas->status)
+    {
+        return mask; /**< the other fields are not measured */
+    }
+
+    mask |= (meas->aoa_fom != last->aoa_fom) ? (REPORT_BIN_DELTA_FOM) : (0);
+    mask |= (labs((long)meas->distance_mm - last->distance_mm) > cfg->delta_mm) ? (REPORT_BIN_DELTA_DISTANCE) : (0);
+    mask |= report_delta_angle(meas->pdoa_2pi, last->pdoa_2pi, cfg->delta_angle) ? (REPORT_BIN_DELTA_PDOA) : (0);
+    mask |= report_delta_angle(meas->aoa_2pi, last->aoa_2pi, cfg->delta_angle) ? (REPORT_BIN_DELTA_AOA) : (0);
+    mask |= report_delta_angle(meas->remote_aoa_2pi, last->remote_aoa_2pi, cfg->delta_angle) ? (REPORT_BIN_DELTA_REMOTE_AOA) : (0);
+    mask |= (abs(meas->cfo_100ppm - last->cfo_100ppm) > cfg->delta_cfo) ? (REPORT_BIN_DELTA_CFO) : (0);
+
+    return mask;
+}
+
+/* @brief   updates the values known by the host with the fields of mask
+ * */
+static void report_delta_update(struct report_bin_meas_s *last, const struct report_bin_meas_s *meas, uint8_t mask)
+{
+    last->short_addr = meas->short_addr;
+    last->status = (mask & REPORT_BIN_DELTA_STATUS) ? (meas->status) : (last->status);
+    last->aoa_fom = (mask & REPORT_BIN_DELTA_FOM) ? (meas->aoa_fom) : (last->aoa_fom);
+    last->distance_mm = (mask & REPORT_BIN_DELTA_DISTANCE) ? (meas->distance_mm) : (last->distance_mm);
+    last->pdoa_2pi = (mask & REPORT_BIN_DELTA_PDOA) ? (meas->pdoa_2pi) : (last->pdoa_2pi);
+    last->aoa_2pi = (mask & REPORT_BIN_DELTA_AOA) ? (meas->aoa_2pi) : (last->aoa_2pi);
+    last->remote_aoa_2pi = (mask & REPORT_BIN_DELTA_REMOTE_AOA) ? (meas->remote_aoa_2pi) : (last->remote_aoa_2pi);
+    last->cfo_100ppm = (mask & REPORT_BIN_DELTA_CFO) ? (meas->cfo_100ppm) : (last->cfo_100ppm);
+}
+
+/* @fn      report_delta_encode
+ * @brief   writes a complete REPORT_BIN_TYPE_DELTA frame of the block to buf.
+ *          The values known by the host are updated only if the frame fits:
+ *          the caller shall send every frame this function returns.
+ * @return  the length of the frame or -1 if buf is too small
+ * */
+int report_delta_encode(uint8_t *buf, int max_len, const report_config_t *cfg, uint32_t block_index,
+                        const struct report_bin_diag_s *diag, const struct report_bin_meas_s *meas, int n_meas)
+{
+    struct report_delta_s next = report_delta;
+    bool key = (next.since_key == 0);
+    int len = report_bin_delta_begin(buf, max_len, block_index, diag, key);
+
+    for (int i = 0; (i < n_meas) && (len > 0); i++)
+    {
+        struct report_bin_meas_s *last = NULL;
+        uint8_t mask = REPORT_BIN_DELTA_ALL;
+
+        for (int j = 0; j < next.n; j++)
+        {
+            if (next.last[j].short_addr == meas[i].short_addr)
+            {
+                last = &next.last[j];
+                break;
+            }
+        }
+
+        if (!last && next.n < FIRA_CONTROLEES_MAX)
+        {
+            last = &next.last[next.n++]; /**< a new responder: all its fields */
+        }
+        else if (last && !key)
+        {
+            mask = report_delta_mask(cfg, last, &meas[i]);
+        }
+
+        if (mask)
+        {
+            len = report_bin_delta_add(buf, len, max_len, &meas[i], mask);
+        }
+        if (last)
+        {
+            report_delta_update(last, &meas[i], mask);
+        }
+    }
+
+    len = (len > 0) ? (report_bin_end(buf, len, max_len)) : (len);
+
+    if (len > 0)
+    {
+        next.since_key = ((next.since_key + 1) < cfg->delta_key) ? (next.since_key + 1) : (0);
+        report_delta = next;
+    }
+    return len;
+}
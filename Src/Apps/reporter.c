@@ -55,11 +55,19 @@
 
 
 static error_e usb_print(char *buff, int len);
+static char *usb_reserve(int max_len);
+static error_e usb_commit(int len);
+static error_e usb_commit_more(int len);
+static bool usb_room(int n, int max_len);
 static void usb_init(void);
 
 reporter_t reporter_instance = {
     .init = usb_init,
-    .print = usb_print
+    .print = usb_print,
+    .reserve = usb_reserve,
+    .commit = usb_commit,
+    .commit_more = usb_commit_more,
+    .room = usb_room
 };
 
 static error_e usb_print(char *buff, int len)
@@ -67,6 +75,26 @@ static error_e usb_print(char *buff, int len)
     return port_tx_msg((uint8_t *)buff, len);
 }
 
+static char *usb_reserve(int max_len)
+{
+    return (char *)reserve_tx_msg(max_len, TX_CLASS_AUTO);
+}
+
+static error_e usb_commit(int len)
+{
+    return port_tx_commit(len);
+}
+
+static error_e usb_commit_more(int len)
+{
+    return port_tx_commit_more(len);
+}
+
+static bool usb_room(int n, int max_len)
+{
+    return port_tx_room_n(n, max_len);
+}
+
 static void usb_init(void)
 {
     return;
@@ -52,12 +52,17 @@
 #ifndef REPORTER_H
 #define REPORTER_H
 
+#include <stdbool.h>
 #include "deca_error.h"
 
 struct reporter_s
 {
     void (*init)(void);
     error_e (*print)(char *buff, int len);
+    char *(*reserve)(int max_len); /**< space to format a message of up to max_len bytes in place, NULL if not available */
+    error_e (*commit)(int len);    /**< sends len bytes of the reserved space, shall follow every successful reserve */
+    error_e (*commit_more)(int len); /**< as commit, the message goes on in the next reserve: nothing is sent in between */
+    bool (*room)(int n, int max_len); /**< n reserve of max_len bytes in a row would succeed now */
 };
 typedef struct reporter_s reporter_t;
 
@@ -62,6 +62,9 @@
 #include "controlTask.h"
 //#include "usb2spi.h"
 #include "cmd.h"
+#ifdef CLI_BUILD
+#include "cmd_machine.h"
+#endif
 #include "usb_uart_tx.h"
 #ifdef USB_ENABLE
 #include "HAL_usb.h"
@@ -76,8 +79,6 @@
 #define USB_UART_ENTER_CRITICAL()
 #define USB_UART_EXIT_CRITICAL()
 
-#define MAX_CMD_LENGTH 0x100
-
 extern data_circ_buf_t *uartRx;
 extern data_circ_buf_t *usbRx;
 extern data_circ_buf_t *btRx;
@@ -90,12 +91,36 @@ typedef enum
     cmdUNKNOWN_TYPE /* Unknown command */
 } command_type_e;
 
+/* State of the command being received from one interface:
+ * the hosts on different interfaces do not mix their commands
+ * */
+struct rx_parser_s
+{
+    uint8_t cmdBuf[MAX_CMD_LENGTH]; /* Commands buffer */
+    uint16_t cmdLen;
+    uint8_t brackets_cnt;
+    command_type_e command_type;
+};
+
+/* one more parser, for usb_uart_rx_feed(PORT_ITF_DEFAULT) */
+static struct rx_parser_s rx_parser[PORT_ITF_MAX + 1] = {
+    [PORT_ITF_UART] = {.command_type = cmdUNKNOWN_TYPE},
+    [PORT_ITF_USB] = {.command_type = cmdUNKNOWN_TYPE},
+    [PORT_ITF_BT] = {.command_type = cmdUNKNOWN_TYPE},
+    [PORT_ITF_DEFAULT] = {.command_type = cmdUNKNOWN_TYPE},
+};
+
+static port_itf_e rx_itf = PORT_ITF_UART;  /**< the interface being read, then the one of the commands in local_buff */
+static port_itf_e rx_next = PORT_ITF_UART; /**< the interface to read first on the next call */
+static uint8_t *rx_out = local_buff;       /**< where waitForCommand() writes the commands */
+
 //-----------------------------------------------------------------------------
 // IMPLEMENTATION
 
 /*
  * @brief    Waits only commands from incoming stream.
  *             The binary interface (deca_usb2spi stream) is not allowed.
+ *             The bytes are added to the command being received from the interface rx_itf.
  *
  * @return  COMMAND_READY : the data for future processing can be found in app.local_buff : app.local_buff_len
  *          NO_DATA : no command yet
@@ -103,11 +128,8 @@ typedef enum
 usb_data_e waitForCommand(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size)
 {
     usb_data_e ret = NO_DATA;
-    static uint8_t cmdLen = 0;
-    static uint8_t cmdBuf[MAX_CMD_LENGTH]; /* Commands buffer */
+    struct rx_parser_s *p = &rx_parser[rx_itf];
     uint16_t cnt;
-    static command_type_e command_type = cmdUNKNOWN_TYPE;
-    static uint8_t brackets_cnt;
 
     uint16_t local_buff_length = 0;
 
@@ -115,149 +137,220 @@ usb_data_e waitForCommand(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, ui
     {
         if (pBuf[*read_offset] == '\b') // erase of a char in the terminal
         {
-            port_tx_msg((uint8_t *)"\b\x20\b", 3);
-            if (cmdLen)
+            port_tx_msg_class((uint8_t *)"\b\x20\b", 3, TX_CLASS_ECHO);
+            if (p->cmdLen)
             {
-                cmdLen--;
+                p->cmdLen--;
             }
         }
         else
         {
-            port_tx_msg(&pBuf[*read_offset], 1);
+            port_tx_msg_class(&pBuf[*read_offset], 1, TX_CLASS_ECHO);
             if (pBuf[*read_offset] == '\n' || pBuf[*read_offset] == '\r')
             {
-                if ((cmdLen!=0)&&(command_type==cmdREGULAR))//Checks if need to handle regular command
+                if ((p->cmdLen!=0)&&(p->command_type==cmdREGULAR))//Checks if need to handle regular command
                 {//Update the app commands buffer
-                    memcpy(&local_buff[local_buff_length],cmdBuf,cmdLen);
-                    local_buff[local_buff_length+cmdLen]='\n';
-                    local_buff_length+=(cmdLen+1);
-                    cmdLen=0;
-                    command_type=cmdUNKNOWN_TYPE;
+                    memcpy(&rx_out[local_buff_length],p->cmdBuf,p->cmdLen);
+                    rx_out[local_buff_length+p->cmdLen]='\n';
+                    local_buff_length+=(p->cmdLen+1);
+                    p->cmdLen=0;
+                    p->command_type=cmdUNKNOWN_TYPE;
                     ret = COMMAND_READY;
                 }
             }
-            else if (command_type==cmdUNKNOWN_TYPE)
+            else if (p->command_type==cmdUNKNOWN_TYPE)
             {//Find out if getting regular command or JSON
-                cmdBuf[cmdLen]=pBuf[*read_offset];
+                p->cmdBuf[p->cmdLen]=pBuf[*read_offset];
                 if (pBuf[*read_offset]== '{')
                 {//Start Json command
-                    command_type=cmdJSON;
-                    brackets_cnt=1;
+                    p->command_type=cmdJSON;
+                    p->brackets_cnt=1;
                 }
                 else
                 { // Start regular command
-                    command_type = cmdREGULAR;
+                    p->command_type = cmdREGULAR;
                 }
-                cmdLen++;
+                p->cmdLen++;
             }
-            else if (command_type == cmdREGULAR)
+            else if (p->command_type == cmdREGULAR)
             { // Regular command
-                cmdBuf[cmdLen] = pBuf[*read_offset];
-                cmdLen++;
+                p->cmdBuf[p->cmdLen] = pBuf[*read_offset];
+                p->cmdLen++;
             }
             else
             { // Json command
-                cmdBuf[cmdLen] = pBuf[*read_offset];
-                cmdLen++;
+                p->cmdBuf[p->cmdLen] = pBuf[*read_offset];
+                p->cmdLen++;
                 if (pBuf[*read_offset] == '{')
                 {
-                    brackets_cnt++;
+                    p->brackets_cnt++;
                 }
                 else if (pBuf[*read_offset] == '}')
                 {
-                    brackets_cnt--;
-                    if (brackets_cnt==0)//Got a full Json command
+                    p->brackets_cnt--;
+                    if (p->brackets_cnt==0)//Got a full Json command
                     {//Update the app commands buffer
-                        memcpy(&local_buff[local_buff_length],cmdBuf,cmdLen);
-                        local_buff[local_buff_length+cmdLen]='\n';
-                        local_buff_length+=(cmdLen+1);
-                        cmdLen=0;
-                        command_type=cmdUNKNOWN_TYPE;
+                        memcpy(&rx_out[local_buff_length],p->cmdBuf,p->cmdLen);
+                        rx_out[local_buff_length+p->cmdLen]='\n';
+                        local_buff_length+=(p->cmdLen+1);
+                        p->cmdLen=0;
+                        p->command_type=cmdUNKNOWN_TYPE;
                         ret = COMMAND_READY;
                     }
                 }
             }
         }
         *read_offset = (*read_offset + 1) & cyclic_size;
-        if (cmdLen >= sizeof(cmdBuf)) /* Checks if command too long and we need to reset it */
+        if (p->cmdLen >= sizeof(p->cmdBuf)) /* Checks if command too long and we need to reset it */
         {
-            cmdLen = 0;
-            command_type = cmdUNKNOWN_TYPE;
+            p->cmdLen = 0;
+            p->command_type = cmdUNKNOWN_TYPE;
         }
     }
 
     if (ret == COMMAND_READY)
     { // If there is at least 1 command, add 0 at the end
-        local_buff[local_buff_length] = 0;
+        rx_out[local_buff_length] = 0;
         local_buff_length++;
     }
     return (ret);
 }
 
 
-/* @fn     usb_uart_rx
- * @brief  this should be calling on a reception of a data from UART or USB.
- *         uses platform-dependent
- *
+/* @brief   the receive buffer of an interface, NULL if the interface cannot be read now
  * */
-usb_data_e usb_uart_rx(void)
+static data_circ_buf_t *rx_itf_buf(port_itf_e itf)
 {
-    usb_data_e ret = NO_DATA;
-    uint16_t uartLen, headUart, tailUart;
+    switch (itf)
+    {
+    case PORT_ITF_UART:
+        return (get_uartEn()) ? (uartRx) : (NULL);
 #ifdef USB_ENABLE
-    uint16_t usbLen, headUsb, tailUsb;
+    case PORT_ITF_USB:
+        return (UsbGetState() == USB_CONFIGURED) ? (usbRx) : (NULL);
 #endif
 #ifdef BT_UART_ENABLE
-    uint16_t btLen, headBt, tailBt;
+    case PORT_ITF_BT:
+        return btRx;
 #endif
-    /* USART control prevails over USB control if both at the same time */
+    default:
+        return NULL;
+    }
+}
 
-    USB_UART_ENTER_CRITICAL();
-    headUart = uartRx->head;
-#ifdef USB_ENABLE
-    headUsb = usbRx->head;
-#endif
-#ifdef BT_UART_ENABLE
-    headBt = btRx->head;
-#endif
+/* @brief   bytes waiting in the receive buffer of an interface
+ * */
+static uint16_t rx_itf_len(data_circ_buf_t *rx)
+{
+    uint16_t head;
 
+    USB_UART_ENTER_CRITICAL();
+    head = rx->head;
     USB_UART_EXIT_CRITICAL();
 
-    tailUart = uartRx->tail;
-    uartLen = CIRC_CNT(headUart, tailUart, sizeof(uartRx->buf));
-#ifdef USB_ENABLE
-    tailUsb = usbRx->tail;
-    usbLen = CIRC_CNT(headUsb, tailUsb, sizeof(usbRx->buf));
-#endif
-#ifdef BT_UART_ENABLE
-    tailBt = btRx->tail;
-    btLen = CIRC_CNT(headBt, tailBt, sizeof(btRx->buf));
-#endif
+    return CIRC_CNT(head, rx->tail, sizeof(rx->buf));
+}
 
-    if ((uartLen > 0) && get_uartEn())
-    {
-        ret = AppGet()->on_rx(uartRx->buf, uartLen, &tailUart, sizeof(uartRx->buf) - 1);
-        USB_UART_ENTER_CRITICAL();
-        uartRx->tail = tailUart;
-        USB_UART_EXIT_CRITICAL();
-    }
-#ifdef USB_ENABLE
-    else if ((usbLen > 0) && (UsbGetState() == USB_CONFIGURED))
+/* @fn      usb_uart_rx_feed
+ * @brief   parses len bytes as if they were received from the interface itf,
+ *          PORT_ITF_DEFAULT has a parser of its own, which no host uses.
+ *          The complete commands are written to out as usb_uart_rx() writes them to local_buff,
+ *          out shall hold RX_FEED_OUT_SIZE(len) bytes. This is the entry point to the parser of the tests.
+ * */
+usb_data_e usb_uart_rx_feed(port_itf_e itf, const uint8_t *buf, uint16_t len, uint8_t *out)
+{
+    port_itf_e itf_saved = rx_itf;
+    uint16_t offset = 0;
+    usb_data_e ret;
+
+    rx_itf = (itf < PORT_ITF_MAX) ? (itf) : (PORT_ITF_DEFAULT);
+    rx_out = out;
+
+    ret = waitForCommand((uint8_t *)buf, len, &offset, UINT16_MAX); /**< linear buffer: the mask keeps the offset */
+
+    rx_out = local_buff;
+    rx_itf = itf_saved;
+    return ret;
+}
+
+/* @fn      usb_uart_rx_itf
+ * @brief   the interface of the commands given by the last usb_uart_rx()
+ * */
+port_itf_e usb_uart_rx_itf(void)
+{
+    return rx_itf;
+}
+
+/* @fn     usb_uart_rx
+ * @brief  this should be calling on a reception of a data from UART, USB or BLE.
+ *         The interfaces are read in turn, each one with its own parser, starting after
+ *         the one of the last command: a busy host cannot starve the others.
+ *         The reading stops at the first interface with a complete command, so that local_buff
+ *         holds the commands of one interface; the control task is signalled again if
+ *         there are bytes left. The echo and the replies go to the interface of the command.
+ *
+ * */
+usb_data_e usb_uart_rx(void)
+{
+    usb_data_e ret = NO_DATA;
+    usb_data_e (*on_rx)(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size) = AppGet()->on_rx;
+    port_itf_e first = rx_next;
+
+#ifdef CLI_BUILD
+    if (machine_mode_is_on())
     {
-        ret = AppGet()->on_rx(usbRx->buf, usbLen, &tailUsb, sizeof(usbRx->buf) - 1);
-        USB_UART_ENTER_CRITICAL();
-        usbRx->tail = tailUsb;
-        USB_UART_EXIT_CRITICAL();
+        on_rx = machine_rx; /**< no echo and framed commands */
     }
 #endif
-#ifdef BT_UART_ENABLE
-    if (btLen > 0)
+
+    for (int i = 0; i < PORT_ITF_MAX; i++)
     {
-        ret = AppGet()->on_rx(btRx->buf, btLen, &tailBt, sizeof(btRx->buf) - 1);
+        port_itf_e itf = (port_itf_e)((first + i) % PORT_ITF_MAX);
+        data_circ_buf_t *rx = rx_itf_buf(itf);
+        uint16_t len, tail;
+
+        if (!rx || (len = rx_itf_len(rx)) == 0)
+        {
+            continue;
+        }
+
+        tail = rx->tail;
+
+#ifdef CLI_BUILD
+        if (machine_mode_is_on() && itf != machine_mode_itf())
+        {
+            /* the frames of the machine mode come from one host only */
+            tail = (tail + len) & (sizeof(rx->buf) - 1);
+        }
+        else
+#endif
+        {
+            rx_itf = itf;
+            port_tx_set_itf(itf); /**< for the echo */
+            ret = on_rx(rx->buf, len, &tail, sizeof(rx->buf) - 1);
+        }
+
         USB_UART_ENTER_CRITICAL();
-        btRx->tail = tailBt;
+        rx->tail = tail;
         USB_UART_EXIT_CRITICAL();
+
+        if (ret == COMMAND_READY)
+        {
+            rx_next = (port_itf_e)((itf + 1) % PORT_ITF_MAX);
+
+            for (i++; i < PORT_ITF_MAX; i++)
+            {
+                rx = rx_itf_buf((port_itf_e)((first + i) % PORT_ITF_MAX));
+
+                if (rx && rx_itf_len(rx))
+                {
+                    NotifyControlTask(); /**< the next interface is read on the next run */
+                    break;
+                }
+            }
+            break;
+        }
     }
-#endif
+
     return ret;
 }
@@ -53,12 +53,21 @@
 #define __INC_USB_UART_RX_H_ 1
 
 #include "app.h"
+#include "usb_uart_tx.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define MAX_CMD_LENGTH 0x100 /**< longest command line */
+
+/* the commands written by usb_uart_rx_feed() from len bytes, a JSON command gets a '\n' added
+ * and a command line started earlier may complete */
+#define RX_FEED_OUT_SIZE(len) ((len) + (len) / 2 + MAX_CMD_LENGTH + 1)
+
 usb_data_e usb_uart_rx(void);
+port_itf_e usb_uart_rx_itf(void);
+usb_data_e usb_uart_rx_feed(port_itf_e itf, const uint8_t *buf, uint16_t len, uint8_t *out);
 
 #ifdef __cplusplus
 }
@@ -49,9 +49,12 @@
  *
  */
 
+#include <string.h>
+#include <stdbool.h>
+#include "nrf.h"
+#include "cmsis_os.h"
+#include "critical_section.h"
 #include "usb_uart_tx.h"
-#include "circular_buffers.h"
-#include "HAL_lock.h"
 #include "HAL_uart.h"
 #ifdef USB_ENABLE
 #include "HAL_usb.h"
@@ -67,6 +70,9 @@
 
 #include "minmax.h"
 #include "comm_config.h"
+#include "HAL_cycles.h"
+#include "crc16.h"
+#include "trace.h"
 
 
 //-----------------------------------------------------------------------------
@@ -85,78 +91,630 @@
 #define CDC_DATA_FS_MAX_PACKET_SIZE 64
 #endif
 
-static uint8_t ubuf[CDC_DATA_FS_MAX_PACKET_SIZE]; /**< linear buffer, to transmit next chunk of data */
+/* The report buffer is split between the producers, the ranging reports get the largest part */
+#define TX_REPORT_BUFSIZE (USB_REPORT_BUFSIZE / 2)
+#define TX_CTRL_BUFSIZE   (USB_REPORT_BUFSIZE / 4)
+#define TX_DIAG_BUFSIZE   (USB_REPORT_BUFSIZE / 4)
+
+static uint8_t ubuf[CDC_DATA_FS_MAX_PACKET_SIZE]; /**< linear buffer, to gather small messages into one packet */
+
+/* Upper bounds of the buckets of the enqueue to transmit latency histogram, us */
+static const uint32_t tx_latency_bounds_us[TX_LATENCY_BUCKETS - 1] = {500, 1000, 2000, 5000, 10000, 20000, 50000};
+
+/* Budgets of bytes waiting for transmission, per message class.
+ * The ranging results get only a part of their ring: when the link falls behind,
+ * fresh results are coalesced by the application rather than queued behind stale ones.
+ * */
+#define TX_RANGING_BUDGET (TX_REPORT_BUFSIZE / 2)
+#define TX_REPLY_BUDGET   (TX_CTRL_BUFSIZE)
+#define TX_ECHO_BUDGET    (TX_CTRL_BUFSIZE / 8)
+#define TX_DIAG_BUDGET    (TX_DIAG_BUFSIZE)
+
+/* Every message is a record: header followed by the message, padded to 4 bytes */
+struct tx_rec_s
+{
+    uint16_t len; /**< length of the message */
+    uint16_t seq; /**< global sequence number, to restore the order of the messages between the rings */
+    uint8_t cls;  /**< tx_class_e */
+    uint8_t itf;  /**< port_itf_e, the interface to send the message to */
+    uint8_t flags; /**< TX_REC_xx */
+    uint8_t reserved;
+    uint32_t stamp; /**< CPU cycles at the commit */
+};
+
+/* A message may be committed in several records of a ring, see port_tx_commit_more():
+ * no record of another ring is sent between them */
+#define TX_REC_MORE 0x01 /**< the message goes on in the next record of the ring */
+#define TX_REC_CONT 0x02 /**< the record goes on with the message of the previous record */
+
+#define TX_REC_HDR       ((int)sizeof(struct tx_rec_s))
+#define TX_REC_SIZE(len) ((TX_REC_HDR + (len) + 3) & ~3)
+
+/* Single producer / single consumer "bip" circular buffer.
+ * The records are contiguous, so producers format straight into the buffer and the
+ * transport sends straight from it. When a record does not fit before the physical
+ * end of the buffer, it is placed at the beginning and "end" marks where the valid
+ * data stop. head and end are written by the producer only, tail by flush_report_buf() only.
+ * */
+struct tx_ring_s
+{
+    volatile uint16_t head;   /**< next free byte, producer */
+    volatile uint16_t tail;   /**< first record to send, consumer */
+    volatile uint16_t end;    /**< end of the valid data, meaningful only when head < tail */
+    uint16_t size;            /**< size of buf, multiple of 4 */
+    uint16_t rec;             /**< offset of the pending reservation */
+    uint16_t reserved;        /**< length of the pending reservation, 0 if none */
+    uint16_t offset;          /**< bytes of the record at the tail already sent, consumer */
+    uint8_t def_cls;          /**< class of the messages, if not given by the producer */
+    uint8_t cls;              /**< class of the pending reservation */
+    uint8_t frame;            /**< tx_frame_e of the pending reservation, TX_FRAME_AUTO if it is not framed */
+    uint8_t tag;              /**< sequence number of the frames of the producer */
+    uint8_t itf;              /**< port_itf_e of the messages of the producer */
+    bool sink;                /**< the messages of the producer are dropped at their commit, uncounted */
+    bool more;                /**< the last record committed goes on in the next one */
+    osThreadId owner;         /**< the task producing into the ring, NULL for the shared ring */
+    struct tx_stats_s stats;
+    uint8_t *buf;
+};
+
+static uint8_t tx_report_buf[TX_REPORT_BUFSIZE] __attribute__((aligned(4)));
+static uint8_t tx_ctrl_buf[TX_CTRL_BUFSIZE] __attribute__((aligned(4)));
+static uint8_t tx_diag_buf[TX_DIAG_BUFSIZE] __attribute__((aligned(4)));
 
 static struct _txHandle
 {
-    dw_hal_lockTypeDef lock; /**< locking object  */
-    struct
-    {
-        uint16_t head;
-        uint16_t tail;
-        uint8_t buf[USB_REPORT_BUFSIZE]; /**< Large USB/UART circular Tx buffer */
-    } Report;                            /**< circular report buffer, data to transmit */
+    struct tx_ring_s ring[TX_PRODUCER_MAX];
+    struct tx_class_stats_s cls[TX_CLASS_MAX];
+    uint16_t seq;            /**< sequence number of the next record */
+    uint16_t discard_seq;    /**< sequence number of the next record at the last reset_report_buf() */
+    volatile bool reset_req; /**< reset_report_buf() was called */
+    volatile bool framed;    /**< the messages are sent as frames of the machine mode */
+    uint8_t framed_itf;      /**< port_itf_e of the host in the machine mode, the destination of every frame */
+    int cur;                 /**< ring of the record being sent, -1 if none */
+    int group;               /**< ring of the message in several records being sent, -1 if none */
+    uint16_t inflight;       /**< bytes of the current record given to the USB, still in use by its DMA */
+    uint16_t ubuf_len;       /**< bytes gathered in ubuf and not transmitted yet */
+    uint8_t ubuf_itf;        /**< port_itf_e of the packet in ubuf: a packet goes to one interface */
+    uint32_t pending;        /**< bytes of all the records waiting for transmission */
+    bool wake;               /**< the flushing thread shall be notified */
+    struct tx_latency_s latency;
 }
 
 txHandle = {
-    .lock = DW_HAL_NODE_UNLOCKED,
-    .Report.head = 0,
-    .Report.tail = 0
+    .ring = {
+        [TX_PRODUCER_REPORT] = {.size = TX_REPORT_BUFSIZE, .end = TX_REPORT_BUFSIZE, .buf = tx_report_buf, .def_cls = TX_CLASS_RANGING, .itf = PORT_ITF_DEFAULT},
+        [TX_PRODUCER_CTRL] = {.size = TX_CTRL_BUFSIZE, .end = TX_CTRL_BUFSIZE, .buf = tx_ctrl_buf, .def_cls = TX_CLASS_REPLY, .itf = PORT_ITF_DEFAULT},
+        [TX_PRODUCER_DIAG] = {.size = TX_DIAG_BUFSIZE, .end = TX_DIAG_BUFSIZE, .buf = tx_diag_buf, .def_cls = TX_CLASS_DIAG, .itf = PORT_ITF_DEFAULT},
+    },
+    .cls = {
+        [TX_CLASS_RANGING] = {.budget = TX_RANGING_BUDGET},
+        [TX_CLASS_REPLY] = {.budget = TX_REPLY_BUDGET},
+        [TX_CLASS_ECHO] = {.budget = TX_ECHO_BUDGET},
+        [TX_CLASS_DIAG] = {.budget = TX_DIAG_BUDGET},
+    },
+    .seq = 0,
+    .reset_req = false,
+    .framed_itf = PORT_ITF_DEFAULT,
+    .cur = -1,
+    .group = -1,
+    .inflight = 0,
+    .ubuf_len = 0
 };
 
 
 //-----------------------------------------------------------------------------
 // Implementation
 
+/* @fn      port_tx_register()
+ * @brief   the calling task becomes the only producer of the given ring,
+ *          the messages from any other task go to the shared TX_PRODUCER_DIAG ring.
+ * */
+void port_tx_register(tx_producer_e producer)
+{
+    if (producer < TX_PRODUCER_DIAG)
+    {
+        txHandle.ring[producer].owner = osThreadGetId();
+    }
+}
+
+/* @fn      get_tx_stats()
+ * @brief   counters of the given producer
+ * */
+const struct tx_stats_s *get_tx_stats(tx_producer_e producer)
+{
+    return (producer < TX_PRODUCER_MAX) ? (&txHandle.ring[producer].stats) : (NULL);
+}
+
+/* @fn      get_tx_class_stats()
+ * @brief   counters of the given message class
+ * */
+const struct tx_class_stats_s *get_tx_class_stats(tx_class_e cls)
+{
+    return (cls < TX_CLASS_MAX) ? (&txHandle.cls[cls]) : (NULL);
+}
+
+/* @fn      get_tx_latency()
+ * @brief   histogram of the latency from the commit of a message to its transmission
+ * */
+const struct tx_latency_s *get_tx_latency(void)
+{
+    return &txHandle.latency;
+}
+
+void reset_tx_latency(void)
+{
+    memset(&txHandle.latency, 0, sizeof(txHandle.latency));
+}
+
+/* @fn      tx_notify()
+ * @brief   wakes up the flushing thread if a commit asked for it
+ * */
+static void tx_notify(void)
+{
+    if (__atomic_exchange_n(&txHandle.wake, false, __ATOMIC_RELAXED))
+    {
+        NotifyFlushTask();
+    }
+}
+
+/* @fn      port_tx_coalesced()
+ * @brief   the application reports n messages of the class replaced by newer ones
+ * */
+void port_tx_coalesced(tx_class_e cls, int n)
+{
+    if (cls < TX_CLASS_MAX)
+    {
+        __atomic_fetch_add(&txHandle.cls[cls].coalesced, n, __ATOMIC_RELAXED);
+    }
+}
+
+/* @fn      port_tx_dropped()
+ * @brief   the application reports n messages of the class it dropped before reserving them
+ * */
+void port_tx_dropped(tx_class_e cls, int n)
+{
+    if (cls < TX_CLASS_MAX)
+    {
+        __atomic_fetch_add(&txHandle.cls[cls].dropped, n, __ATOMIC_RELAXED);
+    }
+}
+
+/* @fn      port_tx_set_framing()
+ * @brief   the messages reserved from now on are sent as frames of the machine mode,
+ *          all of them to itf, the interface of the host in the machine mode
+ * */
+void port_tx_set_framing(bool on, port_itf_e itf)
+{
+    txHandle.framed_itf = (itf < PORT_ITF_MAX) ? (itf) : (PORT_ITF_DEFAULT);
+    txHandle.framed = on;
+}
+
+bool port_tx_is_framing(void)
+{
+    return txHandle.framed;
+}
+
+/* @fn      port_tx_frame_tag()
+ * @brief   the sequence number of the next frames of the calling task
+ * */
+void port_tx_frame_tag(uint8_t seq)
+{
+    osThreadId self = osThreadGetId();
+
+    for (int i = 0; i < TX_PRODUCER_DIAG; i++)
+    {
+        if (txHandle.ring[i].owner == self)
+        {
+            txHandle.ring[i].tag = seq;
+        }
+    }
+}
+
+/* @fn      port_tx_set_sink()
+ * @brief   the messages of the calling task are formatted as usual and then dropped,
+ *          to measure the cost of the commands without the transport
+ * */
+void port_tx_set_sink(bool on)
+{
+    osThreadId self = osThreadGetId();
+
+    for (int i = 0; i < TX_PRODUCER_DIAG; i++)
+    {
+        if (txHandle.ring[i].owner == self)
+        {
+            txHandle.ring[i].sink = on;
+        }
+    }
+}
+
+/* @fn      port_tx_set_itf()
+ * @brief   the messages of the calling task committed from now on are sent to the interface itf,
+ *          the control task sends its echo and replies to the interface of the command
+ * */
+void port_tx_set_itf(port_itf_e itf)
+{
+    osThreadId self = osThreadGetId();
+
+    for (int i = 0; i < TX_PRODUCER_DIAG; i++)
+    {
+        if (txHandle.ring[i].owner == self)
+        {
+            txHandle.ring[i].itf = (itf < PORT_ITF_MAX) ? (itf) : (PORT_ITF_DEFAULT);
+        }
+    }
+}
+
+/* @brief   the frame type of a message class
+ * */
+static uint8_t tx_frame_type(tx_class_e cls)
+{
+    switch (cls)
+    {
+    case TX_CLASS_RANGING:
+        return TX_FRAME_REPORT;
+    case TX_CLASS_REPLY:
+        return TX_FRAME_DATA;
+    default:
+        return TX_FRAME_LOG;
+    }
+}
+
+/* @fn      reset_report_buf()
+ * @brief   drops everything which was committed so far,
+ *          the flushing thread does it on its next run
+ * */
 int reset_report_buf(void)
 {
-    QHAL_LOCK(&txHandle);
-    txHandle.Report.head = txHandle.Report.tail = 0;
-    QHAL_UNLOCK(&txHandle);
+    txHandle.discard_seq = txHandle.seq;
+    txHandle.reset_req = true;
     return _NO_ERR;
 }
 
-/* @fn         copy_tx_msg()
- * @brief     put message to circular report buffer
- *             it will be transmitted in background ASAP from flushing thread
- * @return    HAL_BUSY - can not do it now, wait for release
- *             HAL_ERROR- buffer overflow
- *             HAL_OK   - scheduled for transmission
+static int tx_ring_used(struct tx_ring_s *r, int head, int tail)
+{
+    return (head >= tail) ? (head - tail) : (r->end - tail + head);
+}
+
+/* @fn      tx_ring_get()
+ * @brief   the ring of the calling context, the shared ring is entered in a critical section
+ * @return  NULL if the message cannot be sent from this context (ISR)
  * */
-error_e copy_tx_msg(uint8_t *str, int len)
+static struct tx_ring_s *tx_ring_get(void)
 {
-    error_e ret = _NO_ERR;
-    uint16_t head, tail;
-    const uint16_t size = sizeof(txHandle.Report.buf) / sizeof(txHandle.Report.buf[0]);
+    osThreadId self;
+
+    if (__get_IPSR() != 0)
+    {
+        txHandle.ring[TX_PRODUCER_DIAG].stats.dropped++;
+        return NULL;
+    }
+
+    self = osThreadGetId();
+
+    for (int i = 0; i < TX_PRODUCER_DIAG; i++)
+    {
+        if (txHandle.ring[i].owner == self)
+        {
+            return &txHandle.ring[i];
+        }
+    }
+
+    enter_critical_section();
+    return &txHandle.ring[TX_PRODUCER_DIAG];
+}
+
+static void tx_ring_put(struct tx_ring_s *r)
+{
+    if (r == &txHandle.ring[TX_PRODUCER_DIAG])
+    {
+        leave_critical_section();
+    }
+}
+
+/* @brief   position of a record of need bytes in the ring, the head at head
+ * @return  -1 if it does not fit
+ * */
+static int tx_ring_fit_at(struct tx_ring_s *r, uint16_t head, int need)
+{
+    uint16_t tail = r->tail;
+
+    /* head shall never catch up the tail: keep the ring one record short of full */
+    if (head >= tail)
+    {
+        if ((r->size - head) > need || ((r->size - head) == need && tail > 0))
+        {
+            return head;
+        }
+        return (tail > need) ? (0) : (-1);
+    }
+    return ((tail - head) > need) ? (head) : (-1);
+}
+
+static int tx_ring_fit(struct tx_ring_s *r, int need)
+{
+    return tx_ring_fit_at(r, r->head, need);
+}
+
+/* @fn      port_tx_room()
+ * @brief   checks, without reporting an overflow, that reserve_tx_msg(len, TX_CLASS_AUTO)
+ *          from the calling task would succeed now
+ * */
+bool port_tx_room(int len)
+{
+    return port_tx_room_n(1, len);
+}
+
+/* @fn      port_tx_room_n()
+ * @brief   checks, without reporting an overflow, that n reserve_tx_msg(len, TX_CLASS_AUTO) in a row,
+ *          each one committed, from the calling task would succeed now:
+ *          the parts of a message of port_tx_commit_more()
+ * */
+bool port_tx_room_n(int n, int len)
+{
+    struct tx_ring_s *r = tx_ring_get();
+    int over = (txHandle.framed) ? (TX_FRAME_HDR_LEN + TX_FRAME_CRC_LEN) : (0);
+    int need = TX_REC_SIZE(len + over);
+    uint16_t head;
+    bool room;
+
+    if (!r)
+    {
+        return false;
+    }
+
+    room = ((txHandle.cls[r->def_cls].pending + n * (len + over)) <= txHandle.cls[r->def_cls].budget);
+
+    /* the records follow each other from the head, as commit_tx_msg() places them */
+    head = r->head;
+    for (int i = 0; room && i < n; i++)
+    {
+        int pos = tx_ring_fit_at(r, head, need);
+
+        room = (pos >= 0);
+        head = (uint16_t)(pos + need);
+    }
+
+    tx_ring_put(r);
+    return room;
+}
+
+/* @fn      port_tx_wait_flushed()
+ * @brief   waits until every committed message has been handed to the transport
+ * @return  _ERR_Timeout if messages are still pending after timeout_ms
+ * */
+error_e port_tx_wait_flushed(int timeout_ms)
+{
+    for (int wait_ms = 0; flush_report_due_ms() >= 0; wait_ms++)
+    {
+        if (wait_ms >= timeout_ms)
+        {
+            return _ERR_Timeout;
+        }
+        osDelay(1);
+    }
+    return _NO_ERR;
+}
+
+/* @fn      reserve_tx_msg()
+ * @brief   reserves len contiguous bytes in the ring of the calling task,
+ *          the caller can format the message in place and then shall call commit_tx_msg().
+ *          The message is dropped if the bytes waiting for transmission in its class
+ *          would exceed the budget of the class.
+ *          Tasks without their own ring share one, which is kept in a critical section
+ *          until commit_tx_msg(), so keep the formatting short.
+ * @return  pointer to the reserved space or
+ *          NULL if there is no space: the overflow is reported.
+ * */
+static uint8_t *tx_reserve(int len, tx_class_e cls, tx_frame_e frame)
+{
+    int pos;
+    struct tx_ring_s *r = tx_ring_get();
+    int over = (txHandle.framed) ? (TX_FRAME_HDR_LEN + TX_FRAME_CRC_LEN) : (0);
+    int need = TX_REC_SIZE(len + over);
+
+    if (!r)
+    {
+        return NULL;
+    }
+
+    cls = (cls < TX_CLASS_MAX) ? (cls) : (r->def_cls);
+
+    if ((txHandle.cls[cls].pending + len + over) > txHandle.cls[cls].budget)
+    {
+        __atomic_fetch_add(&txHandle.cls[cls].dropped, 1, __ATOMIC_RELAXED);
+        r->stats.dropped++;
+        tx_ring_put(r);
+        return NULL;
+    }
 
-    /* add TX msg to circular buffer and increase circular buffer length */
+    pos = tx_ring_fit(r, need);
 
-    QHAL_LOCK(&txHandle); //"return HAL_BUSY;" if locked
-    head = txHandle.Report.head;
-    tail = txHandle.Report.tail;
+    if (pos < 0)
+    {
+        goto overflow;
+    }
 
-    if (CIRC_SPACE(head, tail, size) > len)
+    r->rec = pos;
+    r->reserved = len;
+    r->cls = cls;
+
+    if (over)
     {
-        while (len > 0)
+        r->frame = (frame == TX_FRAME_AUTO) ? (tx_frame_type(cls)) : (frame);
+        return &r->buf[pos + TX_REC_HDR + TX_FRAME_HDR_LEN];
+    }
+
+    r->frame = TX_FRAME_AUTO;
+    return &r->buf[pos + TX_REC_HDR];
+
+overflow:
+    /* if packet can not fit, setup TX Buffer overflow ERROR and exit */
+    __atomic_fetch_add(&txHandle.cls[cls].dropped, 1, __ATOMIC_RELAXED);
+    r->stats.dropped++;
+    tx_ring_put(r);
+    error_handler(0, _ERR_TxBuf_Overflow);
+    return NULL;
+}
+
+uint8_t *reserve_tx_msg(int len, tx_class_e cls)
+{
+    return tx_reserve(len, cls, TX_FRAME_AUTO);
+}
+
+/* @brief   wraps the message of the record in a frame of the machine mode
+ * @return  length of the frame
+ * */
+static int tx_frame_wrap(struct tx_ring_s *r, int len)
+{
+    uint8_t *frame = &r->buf[r->rec + TX_REC_HDR];
+    uint16_t crc;
+
+    frame[0] = TX_FRAME_SOF;
+    frame[1] = (uint8_t)len;
+    frame[2] = (uint8_t)(len >> 8);
+    frame[3] = r->tag;
+    frame[4] = r->frame;
+
+    crc = calc_crc16(&frame[1], (uint16_t)(TX_FRAME_HDR_LEN - 1 + len));
+    frame[TX_FRAME_HDR_LEN + len] = (uint8_t)(crc >> 8);
+    frame[TX_FRAME_HDR_LEN + len + 1] = (uint8_t)crc;
+
+    return len + TX_FRAME_HDR_LEN + TX_FRAME_CRC_LEN;
+}
+
+/* @fn      tx_commit()
+ * @brief   schedules for transmission len bytes formatted in the space given by reserve_tx_msg().
+ *          len == 0 drops the reservation.
+ * @param   more - the message goes on in the next reservation of the task
+ * */
+static error_e tx_commit(int len, bool more)
+{
+    struct tx_ring_s *r;
+    struct tx_rec_s *hdr;
+    osThreadId self = osThreadGetId();
+    uint16_t head;
+
+    r = &txHandle.ring[TX_PRODUCER_DIAG];
+    for (int i = 0; i < TX_PRODUCER_DIAG; i++)
+    {
+        if (txHandle.ring[i].owner == self)
+        {
+            r = &txHandle.ring[i];
+        }
+    }
+
+    len = MIN(len, r->reserved);
+
+    if (r->sink)
+    {
+        len = 0;
+    }
+    else if (len > 0 || (r->reserved && r->more && !more)) /**< an empty record ends a message in several records */
+    {
+        if (r->frame != TX_FRAME_AUTO && len > 0)
+        {
+            len = tx_frame_wrap(r, len);
+        }
+
+        hdr = (struct tx_rec_s *)&r->buf[r->rec];
+        hdr->len = len;
+        hdr->cls = r->cls;
+        hdr->itf = (r->frame != TX_FRAME_AUTO) ? (txHandle.framed_itf) : (r->itf);
+        hdr->flags = ((r->more) ? (TX_REC_CONT) : (0)) | ((more) ? (TX_REC_MORE) : (0));
+        hdr->stamp = hal_cycles_get();
+        __atomic_fetch_add(&txHandle.cls[r->cls].pending, len, __ATOMIC_RELAXED);
+        hdr->seq = __atomic_fetch_add(&txHandle.seq, 1, __ATOMIC_RELAXED);
+
+        head = r->rec + TX_REC_SIZE(len);
+
+        if (r->rec != r->head)
         {
-            txHandle.Report.buf[head] = *(str++);
-            head = (head + 1) & (size - 1);
-            len--;
+            r->end = r->head; /**< the record was placed at the beginning */
         }
+        else if (head == r->size)
+        {
+            r->end = r->size;
+            head = 0;
+        }
+
+        __DMB(); /**< the record and the end shall be visible before the new head */
+        r->head = head;
 
-        txHandle.Report.head = head;
+        /* Nagle: the first pending message arms the deadline, then wait for the threshold */
+        uint32_t prev = __atomic_fetch_add(&txHandle.pending, len, __ATOMIC_RELAXED);
+        if (prev == 0 || (prev + len) >= get_flush_threshold() || r->more)
+        {
+            txHandle.wake = true; /**< the flushing thread may wait for the next part of a message */
+        }
+        r->more = more;
+
+        r->stats.enqueued++;
+        r->stats.bytes += len;
+        r->stats.peak = MAX(r->stats.peak, tx_ring_used(r, head, r->tail));
     }
-    else
+    else if (r->reserved)
     {
-        /* if packet can not fit, setup TX Buffer overflow ERROR and exit */
-        error_handler(0, _ERR_TxBuf_Overflow);
-        ret = _ERR_TxBuf_Overflow;
+        __atomic_fetch_add(&txHandle.cls[r->cls].dropped, 1, __ATOMIC_RELAXED);
+        r->stats.dropped++;
     }
 
-    QHAL_UNLOCK(&txHandle);
+    r->reserved = 0;
+    tx_ring_put(r);
+    return _NO_ERR;
+}
+
+/* @fn      commit_tx_msg()
+ * @brief   schedules for transmission len bytes formatted in the space given by reserve_tx_msg().
+ *          len == 0 drops the reservation.
+ * */
+error_e commit_tx_msg(int len)
+{
+    return tx_commit(len, false);
+}
+
+static error_e copy_tx_msg_class(uint8_t *str, int len, tx_class_e cls)
+{
+    uint8_t *dst = reserve_tx_msg(len, cls);
+
+    if (!dst)
+    {
+        return _ERR_TxBuf_Overflow;
+    }
+
+    memcpy(dst, str, len);
+    return commit_tx_msg(len);
+}
+
+/* @fn      port_tx_frame()
+ * @brief   sends a message in a frame of the given type, in the machine mode
+ * */
+error_e port_tx_frame(const uint8_t *str, int len, tx_frame_e type)
+{
+    uint8_t *dst = tx_reserve(len, TX_CLASS_AUTO, type);
+    error_e ret;
+
+    if (!dst)
+    {
+        return _ERR_TxBuf_Overflow;
+    }
+
+    memcpy(dst, str, len);
+    ret = commit_tx_msg(len);
+    tx_notify();
     return ret;
 }
 
+/* @fn         copy_tx_msg()
+ * @brief     put message to circular report buffer
+ *             it will be transmitted in background ASAP from flushing thread
+ * @return    HAL_ERROR- buffer overflow
+ *             HAL_OK   - scheduled for transmission
+ * */
+error_e copy_tx_msg(uint8_t *str, int len)
+{
+    return copy_tx_msg_class(str, len, TX_CLASS_AUTO);
+}
+
 /* @fn        port_tx_msg
  * @brief     wrap for copy_tx_msg
  *             Puts message to circular report buffer
@@ -166,7 +724,45 @@ error_e copy_tx_msg(uint8_t *str, int len)
 error_e port_tx_msg(uint8_t *str, int len)
 {
     error_e ret = copy_tx_msg(str, len);
-    NotifyFlushTask();
+    tx_notify();
+    return (ret);
+}
+
+/* @fn        port_tx_msg_class
+ * @brief     as port_tx_msg, with a class other than the default class of the producer
+ *
+ * @return    see copy_tx_msg()
+ * */
+error_e port_tx_msg_class(uint8_t *str, int len, tx_class_e cls)
+{
+    error_e ret = copy_tx_msg_class(str, len, cls);
+    tx_notify();
+    return (ret);
+}
+
+/* @fn        port_tx_commit
+ * @brief     wrap for commit_tx_msg
+ *
+ * @return    see commit_tx_msg()
+ * */
+error_e port_tx_commit(int len)
+{
+    error_e ret = commit_tx_msg(len);
+    tx_notify();
+    return (ret);
+}
+
+/* @fn        port_tx_commit_more
+ * @brief     as port_tx_commit(), the message goes on in the next reservation of the task:
+ *            a message is formatted and committed in parts, which are sent with no other message
+ *            between them. The last part is committed with port_tx_commit(), even if it is empty.
+ *            Only for a task with its own ring, which should check first with port_tx_room_n()
+ *            that every part will fit: the other messages wait for the end of the message.
+ * */
+error_e port_tx_commit_more(int len)
+{
+    error_e ret = tx_commit(len, true);
+    tx_notify();
     return (ret);
 }
 
@@ -175,18 +771,287 @@ error_e port_tx_msg(uint8_t *str, int len)
 //     USB/UART report : platform - dependent section
 //                      can be in platform port file
 
+/* @fn      tx_ring_release()
+ * @brief   frees the record at the tail of the ring
+ * @param   sent - the record has been given to the transport, its latency is recorded
+ * */
+static void tx_ring_release(struct tx_ring_s *r, bool sent)
+{
+    struct tx_rec_s *hdr = (struct tx_rec_s *)&r->buf[r->tail];
+    int head = r->head;
+    int tail = r->tail + TX_REC_SIZE(hdr->len);
+
+    if (sent)
+    {
+        uint32_t us = (hal_cycles_get() - hdr->stamp) / HAL_CYCLES_PER_US;
+        int i;
+
+        for (i = 0; i < (TX_LATENCY_BUCKETS - 1) && us >= tx_latency_bounds_us[i]; i++)
+        {
+        }
+        txHandle.latency.hist[i]++;
+        txHandle.latency.max_us = MAX(txHandle.latency.max_us, us);
+    }
+
+    __atomic_fetch_sub(&txHandle.cls[hdr->cls].pending, hdr->len, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&txHandle.pending, hdr->len, __ATOMIC_RELAXED);
+
+    if (head < r->tail && tail >= r->end)
+    {
+        tail = 0;
+    }
+    r->offset = 0;
+    r->tail = tail;
+}
+
+/* @brief   the position of the record at the tail.
+ *          A record placed at the beginning of an empty ring leaves the tail at the end of the data:
+ *          the tail wraps before the record is read. Read only, called from any task:
+ *          the wrapped position is stored by the consumer alone.
+ * */
+static int tx_ring_tail(const struct tx_ring_s *r, int head)
+{
+    int tail = r->tail;
+
+    return (head < tail && tail >= r->end) ? (0) : (tail);
+}
+
+/* @fn      tx_next_record()
+ * @brief   the ring of the oldest record waiting for transmission
+ * @param   pos - the position of that record in its ring, the tail wrapped
+ * @return  index of the ring, -1 if all of them are empty
+ * */
+static int tx_next_record(int *pos)
+{
+    int best = -1;
+    uint16_t best_seq = 0;
+
+    if (txHandle.group >= 0)
+    {
+        struct tx_ring_s *r = &txHandle.ring[txHandle.group];
+        int head = r->head;
+
+        if (head == r->tail)
+        {
+            return -1; /**< the next part of the message is not committed yet */
+        }
+        __DMB(); /**< read the record after the head */
+
+        *pos = tx_ring_tail(r, head);
+        return txHandle.group;
+    }
+
+    for (int i = 0; i < TX_PRODUCER_MAX; i++)
+    {
+        struct tx_ring_s *r = &txHandle.ring[i];
+        int head = r->head;
+
+        if (head == r->tail)
+        {
+            continue;
+        }
+        __DMB(); /**< read the record after the head */
+
+        int tail = tx_ring_tail(r, head);
+        struct tx_rec_s *hdr = (struct tx_rec_s *)&r->buf[tail];
+
+        if (best < 0 || (int16_t)(hdr->seq - best_seq) < 0)
+        {
+            best = i;
+            best_seq = hdr->seq;
+            *pos = tail;
+        }
+    }
+    return best;
+}
+
+/* @fn      tx_release_inflight()
+ * @brief   the chunk given to the transport has been sent
+ * */
+static void tx_release_inflight(void)
+{
+    struct tx_ring_s *r = &txHandle.ring[txHandle.cur];
+    struct tx_rec_s *hdr = (struct tx_rec_s *)&r->buf[r->tail];
+
+    r->offset += txHandle.inflight;
+    txHandle.inflight = 0;
+
+    if (r->offset >= hdr->len)
+    {
+        tx_ring_release(r, true);
+        txHandle.cur = -1;
+    }
+}
+
+/* @fn      tx_next_packet()
+ * @brief   prepares the next packet: a part of a long message is sent straight from its ring,
+ *          the short messages to the same interface are gathered in ubuf to fill the packet.
+ * @return  the length of the packet, 0 if there is nothing to send
+ * */
+static int tx_next_packet(uint8_t **span, uint8_t *itf)
+{
+    int n = txHandle.ubuf_len;
+
+    *span = ubuf;
+
+    while (n < CDC_DATA_FS_MAX_PACKET_SIZE)
+    {
+        if (txHandle.cur < 0)
+        {
+            int pos;
+
+            txHandle.cur = tx_next_record(&pos);
+
+            if (txHandle.cur < 0)
+            {
+                break;
+            }
+            txHandle.ring[txHandle.cur].tail = pos; /**< the consumer stores the wrap */
+
+            struct tx_rec_s *first = (struct tx_rec_s *)&txHandle.ring[txHandle.cur].buf[pos];
+
+            if ((first->flags & TX_REC_CONT) && txHandle.group != txHandle.cur)
+            {
+                tx_ring_release(&txHandle.ring[txHandle.cur], false); /**< the start of its message was dropped */
+                txHandle.cur = -1;
+                continue;
+            }
+            txHandle.group = (first->flags & TX_REC_MORE) ? (txHandle.cur) : (-1);
+        }
+
+        struct tx_ring_s *r = &txHandle.ring[txHandle.cur];
+        struct tx_rec_s *hdr = (struct tx_rec_s *)&r->buf[r->tail];
+        uint8_t *src = &r->buf[r->tail + TX_REC_HDR + r->offset];
+        int chunk = hdr->len - r->offset;
+
+        if (n > 0 && hdr->itf != txHandle.ubuf_itf)
+        {
+            break; /**< the record is sent in the next packet */
+        }
+
+        txHandle.ubuf_itf = hdr->itf;
+        *itf = hdr->itf;
+
+        if (n == 0 && chunk >= CDC_DATA_FS_MAX_PACKET_SIZE)
+        {
+            *span = src;
+            txHandle.inflight = CDC_DATA_FS_MAX_PACKET_SIZE;
+            return CDC_DATA_FS_MAX_PACKET_SIZE;
+        }
+
+        chunk = MIN(CDC_DATA_FS_MAX_PACKET_SIZE - n, chunk);
+        memcpy(&ubuf[n], src, chunk);
+        n += chunk;
+        r->offset += chunk;
+
+        if (r->offset >= hdr->len)
+        {
+            tx_ring_release(r, true);
+            txHandle.cur = -1;
+        }
+    }
+
+    *itf = txHandle.ubuf_itf;
+    txHandle.ubuf_len = n;
+    return n;
+}
+
+/* @fn      tx_reset()
+ * @brief   drops the records committed before reset_report_buf(),
+ *          called between the messages: a message is never cut
+ * */
+static void tx_reset(void)
+{
+    txHandle.reset_req = false;
+    for (int i = 0; i < TX_PRODUCER_MAX; i++)
+    {
+        struct tx_ring_s *r = &txHandle.ring[i];
+
+        while (r->head != r->tail)
+        {
+            __DMB(); /**< read the record after the head */
+
+            r->tail = tx_ring_tail(r, r->head);
+
+            struct tx_rec_s *hdr = (struct tx_rec_s *)&r->buf[r->tail];
+
+            if ((int16_t)(hdr->seq - txHandle.discard_seq) >= 0)
+            {
+                break;
+            }
+            tx_ring_release(r, false);
+        }
+    }
+}
+
+/* @fn      flush_report_due_ms()
+ * @brief   time to wait for the flush deadline of the oldest message
+ * @return  -1 if there is nothing to send, 0 if the messages shall be sent now
+ * */
+int flush_report_due_ms(void)
+{
+    int idx, pos;
+    uint32_t age_ms;
+
+    if (txHandle.cur >= 0 || txHandle.ubuf_len)
+    {
+        return 0;
+    }
+
+    idx = tx_next_record(&pos);
+
+    if (idx < 0)
+    {
+        return -1; /**< also while the next part of a message is not committed: its commit wakes the thread */
+    }
+
+    if (txHandle.pending >= get_flush_threshold())
+    {
+        return 0;
+    }
+
+    struct tx_rec_s *hdr = (struct tx_rec_s *)&txHandle.ring[idx].buf[pos];
+
+    age_ms = (hal_cycles_get() - hdr->stamp) / (HAL_CYCLES_PER_US * 1000);
+
+    return (age_ms >= get_flush_deadline_ms()) ? (0) : (get_flush_deadline_ms() - age_ms);
+}
 
 /* @fn        flush_report_buff()
  * @brief    FLUSH should have higher priority than reporter_instance.print()
  *             This shall be called periodically from process, which can not be locked,
  *             i.e. from independent high priority thread / timer etc.
+ *             The records of all producers are sent in the order of their sequence numbers,
+ *             a record is completed before the next one is started.
+ *             Short messages are held until they fill a packet or until the flush deadline.
  * */
+/* @brief   whether a packet to itf is sent over the interface dest
+ * */
+static bool tx_to_itf(uint8_t itf, port_itf_e dest)
+{
+    switch (dest)
+    {
+    case PORT_ITF_UART:
+        return get_uartEn() && (itf == PORT_ITF_UART || itf == PORT_ITF_DEFAULT);
+#ifdef USB_ENABLE
+    case PORT_ITF_USB:
+        return (UsbGetState() == USB_CONFIGURED) && (itf == PORT_ITF_USB || (itf == PORT_ITF_DEFAULT && !get_uartEn()));
+#endif
+    case PORT_ITF_BT:
+        return (itf == PORT_ITF_BT || (itf == PORT_ITF_DEFAULT && !get_uartEn()));
+    default:
+        return false;
+    }
+}
+
 error_e flush_report_buf(void)
 {
-    int size = sizeof(txHandle.Report.buf) / sizeof(txHandle.Report.buf[0]);
     int chunk;
     error_e ret = _NO_ERR;
     uint32_t tmr;
+    uint8_t *span;
+    uint8_t itf;
+    bool usb_held;
 
 #ifndef BT_UART_ENABLE
     if (!get_uartEn()
@@ -197,89 +1062,112 @@ error_e flush_report_buf(void)
         return _ERR_Usb_Tx;
 #endif
 
-    QHAL_LOCK(&txHandle); //"return HAL_BUSY;" if locked
-
-    int head = txHandle.Report.head;
-    int tail = txHandle.Report.tail;
-
-    int len = CIRC_CNT(head, tail, size);
+    if (txHandle.reset_req && txHandle.cur < 0 && txHandle.group < 0)
+    {
+        tx_reset();
+    }
 
 #ifdef USB_ENABLE
-    int old_tail = txHandle.Report.tail;
+    /* the USB transmits straight from the ring: release what it has sent */
+    if (txHandle.inflight && Usb.isTxBufferEmpty())
+    {
+        tx_release_inflight();
+    }
 #endif
 
+    if (!(AppGet()->app_mode & APP_BLOCK_FLUSH) && flush_report_due_ms() != 0)
+    {
+        return _NO_ERR;
+    }
+
+    TRACE_BEGIN(TRACE_FLUSH, txHandle.pending);
+
     Timer.start(&tmr);
 
-    if (len > 0)
+    do
     {
-        do
+        if (Timer.check(tmr, USB_UART_TX_TIMEOUT_MS))
         {
-            if (Timer.check(tmr, USB_UART_TX_TIMEOUT_MS))
-            {
-                break; // max timeout for any output on the 115200bps rate (currently ~1400ms if over the UART)
-            }
+            break; // max timeout for any output on the 115200bps rate (currently ~1400ms if over the UART)
+        }
 
 #ifdef LATER
-            /* check the UART status - ready to TX */
-            if ((huart3.gState & 0x01) && (get_uartEn() == 1))
-            {
-                continue; /**< UART is slow and busy, but it does not care of sudden disconnection like USB : wait to complete */
-            }
+        /* check the UART status - ready to TX */
+        if ((huart3.gState & 0x01) && (get_uartEn() == 1))
+        {
+            continue; /**< UART is slow and busy, but it does not care of sudden disconnection like USB : wait to complete */
+        }
 #endif
 #ifdef USB_ENABLE
-            /* check USB status - ready to TX */
-            if ((UsbGetState() == USB_CONFIGURED) && !Usb.isTxBufferEmpty())
-            {
-                continue; /**< USB did not send the buffer: no connection to the terminal */
-            }
-#endif
+        /* check USB status - ready to TX */
+        if ((UsbGetState() == USB_CONFIGURED) && !Usb.isTxBufferEmpty())
+        {
+            continue; /**< USB did not send the buffer: no connection to the terminal */
+        }
 
-            /* copy MAX allowed length from circular buffer to linear buffer */
-            chunk = MIN(sizeof(ubuf), len);
+        if (txHandle.inflight)
+        {
+            tx_release_inflight();
+        }
+#endif
 
-            for (int i = 0; i < chunk; i++)
-            {
-                ubuf[i] = txHandle.Report.buf[tail];
-                tail = (tail + 1) & (size - 1);
-            }
+        chunk = tx_next_packet(&span, &itf);
 
-            len -= chunk;
+        if (chunk == 0)
+        {
+            break;
+        }
 
-            txHandle.Report.tail = tail;
+        usb_held = false;
 
-            if (get_uartEn())
+        if (tx_to_itf(itf, PORT_ITF_UART))
+        {
+            /* the UART driver copies to its FIFO: the chunk can be released at once */
+            if (!deca_uart_transmit(span, chunk))
             {
-                /* setup UART DMA transfer */
-                // if (HAL_UART_Transmit_DMA(&huart3, ubuf, chunk) != HAL_OK)
-                if (!deca_uart_transmit(ubuf, chunk))
-                {
-                    error_handler(0, _ERR_UART_TX); /**< indicate UART transmit error */
-                    ret = _ERR_UART_TX;
-                }
+                error_handler(0, _ERR_UART_TX); /**< indicate UART transmit error */
+                ret = _ERR_UART_TX;
             }
-            else
-            {
+        }
+#ifdef BT_UART_ENABLE
+        if (tx_to_itf(itf, PORT_ITF_BT) && span != ubuf)
+        {
+            memcpy(ubuf, span, chunk);
+        }
+#endif
 #ifdef USB_ENABLE
-                /* setup USB IT transfer */
-                // if (CDC_Transmit_FS(ubuf, chunk) != USBD_OK)
-                if (!Usb.transmit(ubuf, chunk))
-                {
-                    error_handler(0, _ERR_Usb_Tx); /**< indicate USB transmit error */
-                    txHandle.Report.tail = old_tail;
-                    ret = _ERR_Usb_Tx;
-                }
-                else
-                {
-                    old_tail = tail;
-                }
+        if (tx_to_itf(itf, PORT_ITF_USB))
+        {
+            /* setup USB IT transfer, a chunk of a ring is released when it has been sent */
+            // if (CDC_Transmit_FS(ubuf, chunk) != USBD_OK)
+            if (!Usb.transmit(span, chunk))
+            {
+                error_handler(0, _ERR_Usb_Tx); /**< indicate USB transmit error */
+                txHandle.inflight = 0;
+                ret = _ERR_Usb_Tx;
+                break;
+            }
+            usb_held = true;
+        }
 #endif
 #ifdef BT_UART_ENABLE
-                bt_uart_transmit(ubuf, chunk);
+        if (tx_to_itf(itf, PORT_ITF_BT))
+        {
+            bt_uart_transmit(ubuf, chunk);
+        }
 #endif
-            }
-        } while (len > 0 && (AppGet()->app_mode & APP_BLOCK_FLUSH));
-    }
-    QHAL_UNLOCK(&txHandle);
+
+        txHandle.ubuf_len = 0;
+
+        /* a packet to an interface which is down is dropped */
+        if (!usb_held && txHandle.inflight)
+        {
+            tx_release_inflight();
+        }
+    } while (AppGet()->app_mode & APP_BLOCK_FLUSH);
+
+    TRACE_END(TRACE_FLUSH, txHandle.pending);
+
     return ret;
 }
 
@@ -56,12 +56,114 @@
 extern "C" {
 #endif
 #include <stdint.h>
+#include <stdbool.h>
 #include "deca_error.h"
 
+/* Producers of the messages, each one has its own part of the report buffer */
+typedef enum
+{
+    TX_PRODUCER_REPORT = 0, /**< the task of the ranging reports */
+    TX_PRODUCER_CTRL,       /**< the control task: echo and command replies */
+    TX_PRODUCER_DIAG,       /**< any other task, shared */
+    TX_PRODUCER_MAX
+} tx_producer_e;
+
+/* Interfaces of the commands, a reply is sent to the interface of its command */
+typedef enum
+{
+    PORT_ITF_UART = 0,
+    PORT_ITF_USB,
+    PORT_ITF_BT,
+    PORT_ITF_MAX,
+    PORT_ITF_DEFAULT = PORT_ITF_MAX /**< the UART if it is enabled, else the USB and the BLE */
+} port_itf_e;
+
+/* Classes of the messages, each one has a budget of bytes waiting for transmission */
+typedef enum
+{
+    TX_CLASS_RANGING = 0, /**< ranging results */
+    TX_CLASS_REPLY,       /**< command replies */
+    TX_CLASS_ECHO,        /**< echo of the command line */
+    TX_CLASS_DIAG,        /**< diagnostic prints */
+    TX_CLASS_MAX,
+    TX_CLASS_AUTO = TX_CLASS_MAX /**< the default class of the producer */
+} tx_class_e;
+
+struct tx_class_stats_s
+{
+    volatile uint16_t pending; /**< bytes waiting for transmission */
+    uint16_t budget;           /**< max bytes waiting for transmission */
+    uint32_t dropped;          /**< messages dropped because of the budget or a full buffer, or by the application */
+    uint32_t coalesced;        /**< messages replaced by a newer one before transmission */
+};
+
+struct tx_stats_s
+{
+    uint32_t enqueued; /**< messages scheduled for transmission */
+    uint32_t dropped;  /**< messages which did not fit */
+    uint32_t bytes;    /**< bytes scheduled for transmission */
+    uint16_t peak;     /**< max bytes used in the producer's part of the buffer */
+};
+
+/* Frames of the machine mode, in both directions, see cmd_machine.h:
+ *
+ *  offset size
+ *   0     1    TX_FRAME_SOF
+ *   1     2    length N of the payload, little-endian
+ *   3     1    sequence number of the command, 0 for the frames of no command
+ *   4     1    type, TX_FRAME_xx
+ *   5     N    payload
+ *   5+N   2    CRC16 of the bytes 1 to 4+N, as calc_crc16(), big-endian
+ * */
+#define TX_FRAME_SOF     0xA5
+#define TX_FRAME_HDR_LEN 5
+#define TX_FRAME_CRC_LEN 2
+
+typedef enum
+{
+    TX_FRAME_DATA = 0, /**< output of the command seq */
+    TX_FRAME_DONE,     /**< end of the command seq: status, then the reply of the command */
+    TX_FRAME_REPORT,   /**< ranging reports */
+    TX_FRAME_LOG,      /**< diagnostic prints */
+    TX_FRAME_CMD,      /**< host to device: a command line */
+    TX_FRAME_AUTO = 0xFF /**< the type of the message class */
+} tx_frame_e;
+
+/* Buckets of the latency from the commit of a message to its transmission */
+#define TX_LATENCY_BUCKETS 8
+
+struct tx_latency_s
+{
+    uint32_t hist[TX_LATENCY_BUCKETS]; /**< <500us, <1ms, <2ms, <5ms, <10ms, <20ms, <50ms, above */
+    uint32_t max_us;                   /**< worst latency, us */
+};
+
 error_e copy_tx_msg(uint8_t *str, int len);
+uint8_t *reserve_tx_msg(int len, tx_class_e cls);
+error_e commit_tx_msg(int len);
+error_e port_tx_commit(int len);
+error_e port_tx_commit_more(int len);
+bool port_tx_room(int len);
+bool port_tx_room_n(int n, int len);
+error_e port_tx_wait_flushed(int timeout_ms);
 error_e flush_report_buf(void);
 error_e port_tx_msg(uint8_t *str, int len);
+error_e port_tx_msg_class(uint8_t *str, int len, tx_class_e cls);
 int reset_report_buf(void);
+void port_tx_register(tx_producer_e producer);
+const struct tx_stats_s *get_tx_stats(tx_producer_e producer);
+const struct tx_class_stats_s *get_tx_class_stats(tx_class_e cls);
+void port_tx_coalesced(tx_class_e cls, int n);
+void port_tx_dropped(tx_class_e cls, int n);
+int flush_report_due_ms(void);
+const struct tx_latency_s *get_tx_latency(void);
+void reset_tx_latency(void);
+void port_tx_set_framing(bool on, port_itf_e itf);
+bool port_tx_is_framing(void);
+void port_tx_frame_tag(uint8_t seq);
+void port_tx_set_itf(port_itf_e itf);
+void port_tx_set_sink(bool on);
+error_e port_tx_frame(const uint8_t *str, int len, tx_frame_e type);
 
 
 #ifdef __cplusplus
@@ -72,6 +72,7 @@ enum Priorities {
     PRIO_FlushTask          = osPriorityAboveNormal, /* FlushTask should have higher priority than CalckTask */
     PRIO_CtrlTask           = osPriorityNormal,
     PRIO_StartDefaultTask   = osPriorityLow,
+    PRIO_DiagTask           = osPriorityBelowNormal, /* RSSI and NLOS of the frames received, off the MCPS task */
 
     PRIO_RxTask             = osPriorityHigh,
     PRIO_CalcTask           = osPriorityNormal,
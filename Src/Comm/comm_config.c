@@ -58,9 +58,15 @@
 #define DEFAULT_UART                1      /**< output to the UART */
 #endif
 
+#define DEFAULT_FLUSH_THRESHOLD     64     /**< bytes: send when a full USB packet is pending */
+#define DEFAULT_FLUSH_DEADLINE_MS   2      /**< max time a short message waits for the others */
+
 static const uint8_t uartEn_default = DEFAULT_UART;
 
+/* Saved in .rconfig: a change of these is a change of CONFIG_LAYOUT_VERSION */
 static uint8_t uartEn __attribute__((section(".rconfig")));
+static uint16_t flushThreshold __attribute__((section(".rconfig")));
+static uint16_t flushDeadlineMs __attribute__((section(".rconfig")));
 
 bool get_uartEn(void)
 {
@@ -72,9 +78,31 @@ void set_uartEn(bool set)
     uartEn = set ? 1 : 0;
 }
 
+uint16_t get_flush_threshold(void)
+{
+    return flushThreshold;
+}
+
+void set_flush_threshold(uint16_t threshold)
+{
+    flushThreshold = threshold;
+}
+
+uint16_t get_flush_deadline_ms(void)
+{
+    return flushDeadlineMs;
+}
+
+void set_flush_deadline_ms(uint16_t deadline_ms)
+{
+    flushDeadlineMs = deadline_ms;
+}
+
 static void restore_comm_default_config(void)
 {
     uartEn = uartEn_default;
+    flushThreshold = DEFAULT_FLUSH_THRESHOLD;
+    flushDeadlineMs = DEFAULT_FLUSH_DEADLINE_MS;
 }
 
 __attribute__((section(".config_entry"))) const void (*p_restore_comm_default_config)(void) = (const void *)&restore_comm_default_config;
\ No newline at end of file
@@ -49,6 +49,11 @@
  *
  */
 #include <stdbool.h>
+#include <stdint.h>
 
 bool get_uartEn(void);
-void set_uartEn(bool);
\ No newline at end of file
+void set_uartEn(bool);
+uint16_t get_flush_threshold(void);
+void set_flush_threshold(uint16_t);
+uint16_t get_flush_deadline_ms(void);
+void set_flush_deadline_ms(uint16_t);
@@ -75,6 +75,13 @@ typedef enum
 #include "deca_error.h"
 #include "default_config.h"
 
+/* Layout of the structures placed in .rconfig. Bump it on any change of them:
+ * a saved configuration of another layout is not loaded, the defaults are restored.
+ *  1: report_config_t, boot initiation time of fira_param_t
+ *  2: flush threshold and deadline of the comm config
+ */
+#define CONFIG_LAYOUT_VERSION       2
+
 void load_bssConfig(void);
 void restore_bssConfig(void); // require defaultFConfig
 error_e save_bssConfig(void); /**< save to FConfig */
@@ -78,6 +78,7 @@ extern uint8_t __rconfig_start[];
 extern uint8_t __rconfig_end[];
 extern uint8_t __rconfig_crc_end[];
 
+__attribute__((section(".rconfig_ver"))) static uint32_t config_layout = 0;
 __attribute__((section(".rconfig_crc"))) static uint16_t config_crc = 0;
 __attribute__((section(".fconfig"))) const uint32_t DummyConfig[1]  = {0xDEADBEEF};
 
@@ -85,6 +86,8 @@ static bool auto_restore = false;
 
 /* @fn      load_bssConfig
  * @brief   copy parameters from NVM to RAM structure.
+ *          The defaults are restored when the saved block is corrupted
+ *          or was saved with another CONFIG_LAYOUT_VERSION.
  *
  *          assumes that memory model in the MCU of .text and .bss are the same
  * */
@@ -95,7 +98,7 @@ void load_bssConfig(void)
     
     memcpy((uint8_t*)&__rconfig_start, (uint8_t*)&__fconfig_start, rconfig_len_with_crc);
     uint16_t crc = calc_crc16((uint8_t*)&__rconfig_start, rconfig_len);
-    if(crc != config_crc)
+    if((crc != config_crc) || (config_layout != CONFIG_LAYOUT_VERSION))
     {
         auto_restore = true;
         restore_bssConfig();
@@ -115,6 +118,7 @@ void restore_bssConfig(void)
         void (*restore)(void) = (void(*)(void))(*ptr);
         restore();
     }
+    config_layout = CONFIG_LAYOUT_VERSION;
     save_bssConfig();
 }
 
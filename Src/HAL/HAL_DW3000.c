@@ -63,6 +63,7 @@
 #include "sdk_config.h"
 #include "cmsis_os.h"
 #include "rf_tuning_config.h"
+#include "trace.h"
 #ifdef SOFTDEVICE_PRESENT
 #include "nrf_sdh.h"
 #endif
@@ -345,11 +346,15 @@ static inline GPIO_PinState port_CheckEXT_IRQ(void)
  * */
 static inline void process_deca_irq(void)
 {
+    TRACE_BEGIN(TRACE_IRQ, 0);
+
     while (port_CheckEXT_IRQ() == GPIO_PIN_SET)
     {
         dwt_isr();
     } // while DW3000 IRQ line active
 
+    TRACE_END(TRACE_IRQ, 0);
+
     if (hal_uwb_sleep_status_get() & UWB_CAN_SLEEP_IN_IRQ)
     {
         hal_uwb_sleep_enter();
@@ -77,6 +77,7 @@
 #include "InterfUsb.h"
 #include "HAL_usb.h"
 #include "controlTask.h"
+#include "flushTask.h"
 
 //#include "app.h"
 
@@ -151,6 +152,7 @@ static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const *p_inst,
         break;
     case APP_USBD_CDC_ACM_USER_EVT_TX_DONE:
         tx_pending = false;
+        NotifyFlushTask(); // the next packet can be sent
         break;
     case APP_USBD_CDC_ACM_USER_EVT_RX_DONE: {
         /*Get amount of data transfered*/
@@ -93,7 +93,7 @@ void init_reverse_byte(void)
 void init_table_crc16(void)
 {
     int i, j;
-    short crc;
+    uint16_t crc;
 
     for (i = 0; i < 256; i++)
     {
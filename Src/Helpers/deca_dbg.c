@@ -55,24 +55,20 @@
 #include "reporter.h"
 #include "deca_dbg.h"
 
-#define DIAG_BUF_LEN 0x8
 #define DIAG_STR_LEN 64
-// note, (DIAG_BUF_LEN*(DIAG_STR_LEN+4)) shall be < HTTP_PAGE_MALLOC_SIZE-16
-//  <br>=4
-typedef struct
-{
-    uint8_t buf[DIAG_BUF_LEN][DIAG_STR_LEN];
-    int     head;
-} gDiagPrintFStr_t;
-
-gDiagPrintFStr_t gDiagPrintFStr;
 
 void diag_printf(char *s, ...)
 {
     va_list args;
+    int len;
+    char *str = reporter_instance.reserve(DIAG_STR_LEN);
+
     va_start(args, s);
-    vsnprintf((char *)(&gDiagPrintFStr.buf[gDiagPrintFStr.head][0]), DIAG_STR_LEN, s, args);
-    reporter_instance.print((char *)&gDiagPrintFStr.buf[gDiagPrintFStr.head][0], strlen((char *)(&gDiagPrintFStr.buf[gDiagPrintFStr.head][0])));
-    gDiagPrintFStr.head = (gDiagPrintFStr.head + 1) & (DIAG_BUF_LEN - 1);
+    if (str)
+    {
+        /* format straight into the report buffer */
+        len = vsnprintf(str, DIAG_STR_LEN, s, args);
+        reporter_instance.commit((len < DIAG_STR_LEN) ? (len) : (DIAG_STR_LEN - 1));
+    }
     va_end(args);
 }
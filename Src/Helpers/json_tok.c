@@ -0,0 +1,421 @@
+/**
+ * @file      json_tok.c
+ *
+ * @brief     In-place JSON tokenizer, with no heap use
+ *
+ *            The text is split into tokens of a caller's array, in a single pass:
+ *            nothing is copied or allocated, the tokens are offsets within the text.
+ *            cJSON, which it replaced, is no longer built in the firmware: it stays in Helpers/
+ *            as the reference of the host tests (Tests/fuzz_json.c, Tests/test_json.c).
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <string.h>
+#include "json_tok.h"
+
+/* what the tokenizer expects next */
+typedef enum
+{
+    JSON_TOK_ST_VALUE,          /**< a value, after ':' or ',' of an array, and at the root */
+    JSON_TOK_ST_VALUE_OR_CLOSE, /**< the first item of an array, or ']' */
+    JSON_TOK_ST_KEY,            /**< a key, after ',' of an object */
+    JSON_TOK_ST_KEY_OR_CLOSE,   /**< the first key of an object, or '}' */
+    JSON_TOK_ST_COLON,          /**< ':' after a key */
+    JSON_TOK_ST_SEP,            /**< ',' or the end of the object or array after a value */
+    JSON_TOK_ST_END             /**< only white space after the root value */
+} json_tok_state_e;
+
+struct json_tok_parser_s
+{
+    const char *js;
+    int len;
+    int pos;           /**< current position in the text */
+    json_tok_t *tokens;
+    int num_tokens;
+    int toknext;       /**< next token to allocate */
+    int toksuper;      /**< open object or array, or key waiting for its value, -1 for none */
+    json_tok_state_e state;
+};
+
+static json_tok_t *json_tok_alloc(struct json_tok_parser_s *p, uint8_t type, int start)
+{
+    json_tok_t *tok;
+
+    if (p->toknext >= p->num_tokens)
+    {
+        return NULL;
+    }
+    tok = &p->tokens[p->toknext++];
+    tok->type = type;
+    tok->start = start;
+    tok->end = -1;
+    tok->size = 0;
+    tok->parent = p->toksuper;
+
+    if (p->toksuper != -1)
+    {
+        p->tokens[p->toksuper].size++;
+    }
+    return tok;
+}
+
+/* @brief   a value is complete: back from its key to the object, if it had a key
+ * */
+static void json_tok_value_done(struct json_tok_parser_s *p)
+{
+    if (p->toksuper != -1 && p->tokens[p->toksuper].type == JSON_TOK_STRING)
+    {
+        p->toksuper = p->tokens[p->toksuper].parent;
+    }
+    p->state = (p->toksuper == -1) ? (JSON_TOK_ST_END) : (JSON_TOK_ST_SEP);
+}
+
+static bool json_tok_is_digit(char c)
+{
+    return (c >= '0' && c <= '9');
+}
+
+/* @brief   checks a number, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ * */
+static bool json_tok_number(const char *s, int len)
+{
+    int i = 0;
+
+    if (i < len && s[i] == '-')
+    {
+        i++;
+    }
+    if (i >= len || !json_tok_is_digit(s[i]))
+    {
+        return false;
+    }
+    if (s[i] == '0')
+    {
+        i++;
+    }
+    else
+    {
+        while (i < len && json_tok_is_digit(s[i]))
+        {
+            i++;
+        }
+    }
+    if (i < len && s[i] == '.')
+    {
+        if (++i >= len || !json_tok_is_digit(s[i]))
+        {
+            return false;
+        }
+        while (i < len && json_tok_is_digit(s[i]))
+        {
+            i++;
+        }
+    }
+    if (i < len && (s[i] == 'e' || s[i] == 'E'))
+    {
+        if (++i < len && (s[i] == '+' || s[i] == '-'))
+        {
+            i++;
+        }
+        if (i >= len || !json_tok_is_digit(s[i]))
+        {
+            return false;
+        }
+        while (i < len && json_tok_is_digit(s[i]))
+        {
+            i++;
+        }
+    }
+    return (i == len);
+}
+
+static int json_tok_primitive(struct json_tok_parser_s *p)
+{
+    json_tok_t *tok;
+    const char *s = &p->js[p->pos];
+    int n = 0;
+
+    while ((p->pos + n) < p->len && s[n] && s[n] != ' ' && s[n] != '\t' && s[n] != '\r' && s[n] != '\n' &&
+           s[n] != ',' && s[n] != ']' && s[n] != '}')
+    {
+        n++;
+    }
+
+    if (!((n == 4 && memcmp(s, "true", 4) == 0) || (n == 5 && memcmp(s, "false", 5) == 0) ||
+          (n == 4 && memcmp(s, "null", 4) == 0) || json_tok_number(s, n)))
+    {
+        return JSON_TOK_ERROR_INVAL;
+    }
+
+    tok = json_tok_alloc(p, JSON_TOK_PRIMITIVE, p->pos);
+    if (tok == NULL)
+    {
+        return JSON_TOK_ERROR_NOMEM;
+    }
+    tok->end = p->pos + n;
+    p->pos += n - 1;
+    return 0;
+}
+
+static int json_tok_string(struct json_tok_parser_s *p)
+{
+    json_tok_t *tok;
+    int i;
+
+    for (i = p->pos + 1; i < p->len && p->js[i]; i++)
+    {
+        char c = p->js[i];
+
+        if (c == '"')
+        {
+            tok = json_tok_alloc(p, JSON_TOK_STRING, p->pos + 1);
+            if (tok == NULL)
+            {
+                return JSON_TOK_ERROR_NOMEM;
+            }
+            tok->end = i;
+            p->pos = i;
+            return 0;
+        }
+
+        if ((unsigned char)c < 32)
+        {
+            return JSON_TOK_ERROR_INVAL;
+        }
+
+        if (c == '\\')
+        {
+            if (++i >= p->len || !p->js[i])
+            {
+                break;
+            }
+            switch (p->js[i])
+            {
+            case '"': case '/': case '\\': case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                for (int k = 0; k < 4; k++)
+                {
+                    char h = (++i < p->len) ? (p->js[i]) : (0);
+
+                    if (!h)
+                    {
+                        return JSON_TOK_ERROR_PART;
+                    }
+                    if (!(json_tok_is_digit(h) || (h >= 'A' && h <= 'F') || (h >= 'a' && h <= 'f')))
+                    {
+                        return JSON_TOK_ERROR_INVAL;
+                    }
+                }
+                break;
+            default:
+                return JSON_TOK_ERROR_INVAL;
+            }
+        }
+    }
+
+    return JSON_TOK_ERROR_PART;
+}
+
+/* @fn      json_tok_parse
+ * @brief   splits the JSON text js into tokens, the root first and every token before its children
+ * @param   len - length of js, the text also ends at a NUL
+ * @return  number of tokens, or a negative JSON_TOK_ERROR_*
+ * */
+int json_tok_parse(const char *js, int len, json_tok_t *tokens, int num_tokens)
+{
+    struct json_tok_parser_s parser = {js, len, 0, tokens, num_tokens, 0, -1, JSON_TOK_ST_VALUE};
+    struct json_tok_parser_s *p = &parser;
+    json_tok_t *tok;
+    int r;
+
+    for (; p->pos < len && js[p->pos]; p->pos++)
+    {
+        char c = js[p->pos];
+        bool value = (p->state == JSON_TOK_ST_VALUE || p->state == JSON_TOK_ST_VALUE_OR_CLOSE);
+
+        switch (c)
+        {
+        case '\t':
+        case '\r':
+        case '\n':
+        case ' ':
+            break;
+
+        case '{':
+        case '[':
+            if (!value)
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            tok = json_tok_alloc(p, (c == '{') ? (JSON_TOK_OBJECT) : (JSON_TOK_ARRAY), p->pos);
+            if (tok == NULL)
+            {
+                return JSON_TOK_ERROR_NOMEM;
+            }
+            p->toksuper = p->toknext - 1;
+            p->state = (c == '{') ? (JSON_TOK_ST_KEY_OR_CLOSE) : (JSON_TOK_ST_VALUE_OR_CLOSE);
+            break;
+
+        case '}':
+        case ']':
+            if (!(p->state == JSON_TOK_ST_SEP ||
+                  (c == '}' && p->state == JSON_TOK_ST_KEY_OR_CLOSE) ||
+                  (c == ']' && p->state == JSON_TOK_ST_VALUE_OR_CLOSE)))
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            tok = &tokens[p->toksuper];
+            if (tok->type != ((c == '}') ? (JSON_TOK_OBJECT) : (JSON_TOK_ARRAY)))
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            tok->end = p->pos + 1;
+            p->toksuper = tok->parent;
+            json_tok_value_done(p);
+            break;
+
+        case '"':
+            if (p->state == JSON_TOK_ST_KEY || p->state == JSON_TOK_ST_KEY_OR_CLOSE)
+            {
+                if ((r = json_tok_string(p)) < 0)
+                {
+                    return r;
+                }
+                p->toksuper = p->toknext - 1;
+                p->state = JSON_TOK_ST_COLON;
+            }
+            else if (value)
+            {
+                if ((r = json_tok_string(p)) < 0)
+                {
+                    return r;
+                }
+                json_tok_value_done(p);
+            }
+            else
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            break;
+
+        case ':':
+            if (p->state != JSON_TOK_ST_COLON)
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            p->state = JSON_TOK_ST_VALUE;
+            break;
+
+        case ',':
+            if (p->state != JSON_TOK_ST_SEP)
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            p->state = (tokens[p->toksuper].type == JSON_TOK_OBJECT) ? (JSON_TOK_ST_KEY) : (JSON_TOK_ST_VALUE);
+            break;
+
+        default:
+            if (!value)
+            {
+                return JSON_TOK_ERROR_INVAL;
+            }
+            if ((r = json_tok_primitive(p)) < 0)
+            {
+                return r;
+            }
+            json_tok_value_done(p);
+            break;
+        }
+    }
+
+    return (p->state == JSON_TOK_ST_END) ? (p->toknext) : (JSON_TOK_ERROR_PART);
+}
+
+/* @fn      json_tok_find
+ * @brief   looks up the member key of the object token obj
+ * @return  index of the value token of key, -1 if there is none
+ * */
+int json_tok_find(const char *js, const json_tok_t *tokens, int n, int obj, const char *key)
+{
+    int key_len = strlen(key);
+
+    if (obj < 0 || obj >= n || tokens[obj].type != JSON_TOK_OBJECT)
+    {
+        return -1;
+    }
+
+    for (int i = obj + 1; i < n - 1 && tokens[i].start < tokens[obj].end; i++)
+    {
+        const json_tok_t *tok = &tokens[i];
+
+        if (tok->parent == obj && tok->type == JSON_TOK_STRING && (tok->end - tok->start) == key_len &&
+            memcmp(&js[tok->start], key, key_len) == 0 && tokens[i + 1].parent == i)
+        {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+/* @fn      json_tok_copy
+ * @brief   copies the text of the token to buf, NUL terminated and truncated to max - 1 characters,
+ *          the escapes of a string are not decoded
+ * @return  number of characters copied
+ * */
+int json_tok_copy(const char *js, const json_tok_t *tok, char *buf, int max)
+{
+    int len = tok->end - tok->start;
+
+    if (max <= 0)
+    {
+        return 0;
+    }
+    len = (len < max - 1) ? (len) : (max - 1);
+    memcpy(buf, &js[tok->start], len);
+    buf[len] = 0;
+    return len;
+}
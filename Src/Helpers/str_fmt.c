@@ -0,0 +1,258 @@
+/**
+ * @file      str_fmt.c
+ *
+ * @brief     Allocation-free number formatting into a caller's buffer.
+ *            The fixed-point conversions are exact and round half to even, as printf does,
+ *            so that no float printf code is needed on the report path.
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <string.h>
+#include "str_fmt.h"
+
+#define FMT_DECIMALS_MAX 9
+
+static const uint32_t fmt_pow10[FMT_DECIMALS_MAX + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+/* @brief   decimal digits of v, zero padded to width (no more than 10)
+ * */
+static int fmt_digits(char *buf, int len, int max, uint32_t v, int width)
+{
+    char tmp[10];
+    int n = 0;
+
+    do
+    {
+        tmp[n++] = (char)('0' + (v % 10));
+        v /= 10;
+    } while (v);
+
+    while (n < width)
+    {
+        tmp[n++] = '0';
+    }
+
+    if (len < 0 || (len + n) > max)
+    {
+        return -1;
+    }
+
+    while (n)
+    {
+        buf[len++] = tmp[--n];
+    }
+    return len;
+}
+
+/* @brief   "%.<decimals>f" of m / 2^shift, rounded half to even
+ * @param   m - magnitude, m * 10^decimals shall fit in 63 bits
+ * */
+static int fmt_fixed(char *buf, int len, int max, bool neg, uint64_t m, int shift, int decimals)
+{
+    uint64_t q;
+
+    if (decimals < 0 || decimals > FMT_DECIMALS_MAX)
+    {
+        return -1;
+    }
+
+    m *= fmt_pow10[decimals];
+
+    if (shift <= 0)
+    {
+        q = m << -shift;
+    }
+    else if (shift >= 64)
+    {
+        q = 0; /**< below a half of the last digit */
+    }
+    else
+    {
+        uint64_t rem = m & ((1ULL << shift) - 1);
+        uint64_t half = 1ULL << (shift - 1);
+
+        q = m >> shift;
+
+        if (rem > half || (rem == half && (q & 1)))
+        {
+            q++;
+        }
+    }
+
+    if (neg)
+    {
+        len = fmt_char(buf, len, max, '-');
+    }
+
+    len = fmt_digits(buf, len, max, (uint32_t)(q / fmt_pow10[decimals]), 1);
+
+    if (decimals > 0)
+    {
+        len = fmt_char(buf, len, max, '.');
+        len = fmt_digits(buf, len, max, (uint32_t)(q % fmt_pow10[decimals]), decimals);
+    }
+    return len;
+}
+
+int fmt_str(char *buf, int len, int max, const char *s)
+{
+    int n = strlen(s);
+
+    if (len < 0 || (len + n) > max)
+    {
+        return -1;
+    }
+
+    memcpy(&buf[len], s, n);
+    return len + n;
+}
+
+int fmt_char(char *buf, int len, int max, char c)
+{
+    if (len < 0 || len >= max)
+    {
+        return -1;
+    }
+
+    buf[len] = c;
+    return len + 1;
+}
+
+int fmt_uint(char *buf, int len, int max, uint32_t v)
+{
+    return fmt_digits(buf, len, max, v, 1);
+}
+
+int fmt_int(char *buf, int len, int max, int32_t v)
+{
+    if (v < 0)
+    {
+        len = fmt_char(buf, len, max, '-');
+        return fmt_digits(buf, len, max, 0U - (uint32_t)v, 1);
+    }
+    return fmt_digits(buf, len, max, (uint32_t)v, 1);
+}
+
+int fmt_hex(char *buf, int len, int max, uint32_t v, int width, bool upper)
+{
+    const char *digits = (upper) ? ("0123456789ABCDEF") : ("0123456789abcdef");
+    char tmp[8];
+    int n = 0;
+
+    do
+    {
+        tmp[n++] = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+
+    if (width > (int)sizeof(tmp))
+    {
+        width = sizeof(tmp);
+    }
+
+    while (n < width)
+    {
+        tmp[n++] = '0';
+    }
+
+    if (len < 0 || (len + n) > max)
+    {
+        return -1;
+    }
+
+    while (n)
+    {
+        buf[len++] = tmp[--n];
+    }
+    return len;
+}
+
+int fmt_q(char *buf, int len, int max, int32_t v, int q, int decimals)
+{
+    bool neg = (v < 0);
+
+    return fmt_fixed(buf, len, max, neg, (neg) ? (0U - (uint32_t)v) : ((uint32_t)v), q, decimals);
+}
+
+int fmt_float(char *buf, int len, int max, float v, int decimals)
+{
+    union
+    {
+        float f;
+        uint32_t u;
+    } bits = {.f = v};
+    bool neg = (bits.u >> 31) != 0;
+    int exp = (bits.u >> 23) & 0xFF;
+    uint32_t m = bits.u & 0x7FFFFF;
+
+    if (exp == 0xFF)
+    {
+        if (m)
+        {
+            return fmt_str(buf, len, max, "nan");
+        }
+        return fmt_str(buf, len, max, (neg) ? ("-inf") : ("inf"));
+    }
+
+    if (exp == 0)
+    {
+        exp = 1; /**< subnormal */
+    }
+    else
+    {
+        m |= 0x800000;
+    }
+
+    exp -= 150; /**< v = m * 2^exp */
+
+    if (exp > 7)
+    {
+        return -1; /**< |v| >= 2^31 */
+    }
+
+    return fmt_fixed(buf, len, max, neg, m, -exp, decimals);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file      str_fmt.h
+ *
+ * @brief     Allocation-free number formatting into a caller's buffer
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef STR_FMT_H_
+#define STR_FMT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* All the emitters append to buf at len, never beyond max bytes, and return the new length.
+ * They do not terminate the string. When the output does not fit, nothing is written and -1 is returned;
+ * a negative len is passed through, so a chain of emitters can be checked once at its end.
+ *
+ * The output is byte-identical to the printf conversions given for every emitter.
+ */
+
+int fmt_str(char *buf, int len, int max, const char *s);                  /**< "%s" */
+int fmt_char(char *buf, int len, int max, char c);                        /**< "%c" */
+int fmt_int(char *buf, int len, int max, int32_t v);                      /**< "%d" */
+int fmt_uint(char *buf, int len, int max, uint32_t v);                    /**< "%u" */
+int fmt_hex(char *buf, int len, int max, uint32_t v, int width, bool upper); /**< "%0<width>x", "%0<width>X" */
+int fmt_q(char *buf, int len, int max, int32_t v, int q, int decimals);   /**< "%.<decimals>f" of v / 2^q, i.e. Q16, Q11 */
+int fmt_float(char *buf, int len, int max, float v, int decimals);        /**< "%.<decimals>f" of v, |v| < 2^31 */
+
+/* Angle in degrees of a Q16 fraction of 2pi, "%0.2f" of 360.0 * v / 2^16 */
+#define fmt_q16_deg(buf, len, max, v) fmt_q((buf), (len), (max), (int32_t)(v) * 360, 16, 2)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STR_FMT_H_ */
@@ -0,0 +1,141 @@
+/**
+ * @file      trace.c
+ *
+ * @brief     Tracepoints of the hot paths, from the DW3000 IRQ to the transmission of the report
+ *
+ * @author    Decawave Applications
+ *
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include "trace.h"
+
+#if (TRACE_ENABLE)
+
+#include "HAL_cycles.h"
+
+#if (TRACE_LEN & (TRACE_LEN - 1))
+#error "TRACE_LEN shall be a power of 2"
+#endif
+
+static struct
+{
+    struct trace_rec_s rec[TRACE_LEN];
+    uint32_t head;   /**< index of the next record, free running */
+    uint8_t paused;
+} trace;
+
+/* @fn      trace_rec
+ * @brief   records a tracepoint, called by the TRACE_xx macros
+ * */
+void trace_rec(uint8_t id, uint8_t phase, uint32_t arg)
+{
+    uint32_t cycles = hal_cycles_get();
+
+    if (__atomic_load_n(&trace.paused, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    uint32_t n = __atomic_fetch_add(&trace.head, 1, __ATOMIC_RELAXED);
+    struct trace_rec_s *r = &trace.rec[n & (TRACE_LEN - 1)];
+
+    r->cycles = cycles;
+    r->arg = arg;
+    r->id = id;
+    r->phase = phase;
+    __atomic_store_n(&r->seq, (uint16_t)n, __ATOMIC_RELEASE);
+}
+
+/* @fn      trace_pause
+ * @brief   stops or restarts the recording, the tracepoints are ignored meanwhile
+ * */
+void trace_pause(bool pause)
+{
+    __atomic_store_n(&trace.paused, (uint8_t)pause, __ATOMIC_RELEASE);
+}
+
+/* @fn      trace_read
+ * @brief   copies the records from *pos on, at most max, and advances *pos past them
+ * @param   pos: index of the first record to read, 0 at first
+ * @param   lost: incremented by the records overwritten or being written, not copied
+ * @return  the number of records copied
+ * */
+int trace_read(uint32_t *pos, struct trace_rec_s *rec, int max, uint32_t *lost)
+{
+    uint32_t head = __atomic_load_n(&trace.head, __ATOMIC_ACQUIRE);
+    int n = 0;
+
+    if (head - *pos > TRACE_LEN)
+    {
+        *lost += head - TRACE_LEN - *pos;
+        *pos = head - TRACE_LEN;
+    }
+
+    while (*pos != head && n < max)
+    {
+        const struct trace_rec_s *r = &trace.rec[*pos & (TRACE_LEN - 1)];
+        uint16_t seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+
+        rec[n] = *r;
+
+        /* a record rewritten while being copied changed its sequence */
+        if (seq == (uint16_t)*pos && __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) == seq)
+        {
+            rec[n].seq = seq;
+            n++;
+        }
+        else
+        {
+            (*lost)++;
+        }
+        (*pos)++;
+    }
+    return n;
+}
+
+#endif /* TRACE_ENABLE */
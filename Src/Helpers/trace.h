@@ -0,0 +1,121 @@
+/**
+ * @file      trace.h
+ *
+ * @brief     Tracepoints of the hot paths, from the DW3000 IRQ to the transmission of the report
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Set to 1 to build the tracepoints and the TRACE command, else they compile to nothing */
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 0
+#endif
+
+/* A tracepoint records the cycle counter, its id, its phase and a 32-bit argument in a ring,
+ * without formatting. The ring keeps the last TRACE_LEN records, the oldest being overwritten.
+ * Records are taken from the tasks and the interrupts alike, without lock.
+ *
+ * The phase is the one of the Chrome trace format: a begin and an end delimit a duration, a point is instant.
+ */
+
+#define TRACE_LEN (256) /**< records kept, a power of 2 */
+
+#define TRACE_PH_BEGIN 'B'
+#define TRACE_PH_END   'E'
+#define TRACE_PH_POINT 'i'
+
+/* The ids are in the order of the path of a received frame; the host decoder has the same list */
+typedef enum
+{
+    TRACE_IRQ = 1,     /**< process_deca_irq(), duration, arg: 0 */
+    TRACE_RX_CB,       /**< mcps_rx_cb(), point, arg: frame length */
+    TRACE_MCPS_EVT,    /**< McpsTask handling an event, duration, arg: mcps_evt_e */
+    TRACE_RX_GET_FRAME,/**< rx_get_frame(), point, arg: frame length */
+    TRACE_TX_FRAME,    /**< tx_frame(), point, arg: flags of the frame */
+    TRACE_LP_TIMER,    /**< lp_timer_fira(), point, arg: operational state handled */
+    TRACE_REPORT,      /**< report_cb(), point, arg: measurements */
+    TRACE_FLUSH,       /**< flush_report_buf() sending, duration, arg: bytes pending */
+    TRACE_ID_MAX
+} trace_id_e;
+
+struct trace_rec_s
+{
+    uint32_t cycles; /**< hal_cycles_get() */
+    uint32_t arg;
+    uint8_t id;      /**< trace_id_e */
+    uint8_t phase;   /**< TRACE_PH_xx */
+    uint16_t seq;    /**< index of the record, lower bits, written last */
+};
+
+#if (TRACE_ENABLE)
+#define TRACE_BEGIN(id, arg) trace_rec((id), TRACE_PH_BEGIN, (uint32_t)(arg))
+#define TRACE_END(id, arg)   trace_rec((id), TRACE_PH_END, (uint32_t)(arg))
+#define TRACE_POINT(id, arg) trace_rec((id), TRACE_PH_POINT, (uint32_t)(arg))
+#else
+#define TRACE_BEGIN(id, arg) ((void)0)
+#define TRACE_END(id, arg)   ((void)0)
+#define TRACE_POINT(id, arg) ((void)0)
+#endif
+
+void trace_rec(uint8_t id, uint8_t phase, uint32_t arg);
+void trace_pause(bool pause);
+int trace_read(uint32_t *pos, struct trace_rec_s *rec, int max, uint32_t *lost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -53,6 +53,7 @@
 #include <string.h>
 
 #include "FreeRTOS.h"
+#include "skb_pool.h"
 
 
 /* Define the linked list structure.  This is used to link free blocks in order
@@ -83,6 +84,12 @@ void *malloc(size_t size)
 
 void free(void *ptr)
 {
+    /* the MAC releases the socket buffers of the pool with free() */
+    if (skb_pool_free(ptr))
+    {
+        return;
+    }
+
     vPortFree(ptr);
     return;
 }
@@ -81,6 +81,8 @@ typedef struct task_signal_s task_signal_t;
 #define MCPS_TASK_RX            0x10
 #define MCPS_TASK_TIMER_EXPIRED 0x20
 
+#define DIAG_TASK_SNAPSHOT      0x02
+
 bool terminate_task(struct task_signal_s *task);
 bool terminate_task_with_mail(struct task_signal_s *task);
 
@@ -0,0 +1,343 @@
+/**
+ * @file      dw3000_diag.c
+ *
+ * @brief     RSSI and NLOS of the frames received, computed by a diagnostics task off the MCPS task
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+
+#include "dw3000_diag.h"
+#include "dw3000_statistics.h"
+#include "create_diag_task.h"
+#include "HAL_cycles.h"
+
+#define DIAG_TASK_STACK_SIZE_BYTES 1024
+
+#define DIAG_SNAP_MASK (DIAG_SNAP_LEN - 1)
+
+#if (DIAG_SNAP_LEN & DIAG_SNAP_MASK)
+#error "DIAG_SNAP_LEN must be a power of 2"
+#endif
+
+/* IEEE 802.15.4 frame control */
+#define FCF_PAN_ID_COMP    (1 << 6)
+#define FCF_SEQ_SUPP       (1 << 8)
+#define FCF_DST_MODE(fcf)  (((fcf) >> 10) & 3)
+#define FCF_VERSION(fcf)   (((fcf) >> 12) & 3)
+#define FCF_SRC_MODE(fcf)  (((fcf) >> 14) & 3)
+#define FCF_ADDR_SHORT     (2)
+#define FCF_ADDR_EXT       (3)
+#define FCF_VERSION_2015   (2)
+
+static task_signal_t diagTask;
+
+/* snapshots: written by the MCPS task at head, read by the diagnostics task at tail */
+static struct
+{
+    struct diag_snapshot_s snap[DIAG_SNAP_LEN];
+    uint16_t head;
+    uint16_t tail;
+    struct diag_stats_s stats;
+} diag;
+
+static struct diag_resp_s diag_resp[DIAG_RESP_MAX];
+static uint32_t diag_seq;
+
+static struct dwchip_s *diag_dw;
+
+/* @fn      diag_src_addr
+ * @brief   short source address of a frame from its MAC header
+ * @return  DIAG_ADDR_NONE if the frame has none
+ * */
+static uint16_t diag_src_addr(const uint8_t *frame, unsigned int len)
+{
+    uint16_t fcf;
+    unsigned int off = 2;
+    int dst;
+
+    if (!frame || len < 2)
+    {
+        return DIAG_ADDR_NONE;
+    }
+
+    fcf = frame[0] | (frame[1] << 8);
+    dst = FCF_DST_MODE(fcf);
+
+    if (FCF_SRC_MODE(fcf) != FCF_ADDR_SHORT)
+    {
+        return DIAG_ADDR_NONE;
+    }
+
+    /* with a short source address, the PAN IDs are present alike in all the versions
+     * (IEEE 802.15.4-2015 table 7-2), only the sequence number may be suppressed in the 2015 one */
+    if (FCF_VERSION(fcf) != FCF_VERSION_2015 || !(fcf & FCF_SEQ_SUPP))
+    {
+        off += 1;
+    }
+
+    if (dst)
+    {
+        off += 2 + ((dst == FCF_ADDR_EXT) ? (8) : (2));
+    }
+    if (!(fcf & FCF_PAN_ID_COMP))
+    {
+        off += 2;
+    }
+
+    if (off + 2 > len)
+    {
+        return DIAG_ADDR_NONE;
+    }
+
+    return frame[off] | (frame[off + 1] << 8);
+}
+
+/* @fn      diag_update
+ * @brief   stores the diagnostics of a frame in the entry of its sender
+ * */
+static void diag_update(uint16_t addr, const struct mcps_diag_s *d)
+{
+    struct diag_resp_s *e = &diag_resp[0];
+
+    for (int i = 0; i < DIAG_RESP_MAX; i++)
+    {
+        if (diag_resp[i].frames && diag_resp[i].addr == addr)
+        {
+            e = &diag_resp[i];
+            break;
+        }
+        if (diag_resp[i].seq < e->seq)
+        {
+            e = &diag_resp[i];
+        }
+    }
+
+    enter_critical_section();
+    if (e->addr != addr || !e->frames)
+    {
+        e->addr = addr;
+        e->frames = 0;
+    }
+    if (e->frames < UINT16_MAX)
+    {
+        e->frames++;
+    }
+    e->rssi = d->rssi;
+    e->nlos = d->non_line_of_sight;
+    e->seq = ++diag_seq;
+    leave_critical_section();
+}
+
+static void DiagTask(void const *arg)
+{
+    (void)arg;
+
+    while (diagTask.Exit == 0)
+    {
+        osEvent evt = osSignalWait(diagTask.SignalMask, osWaitForever);
+
+        if (evt.value.signals & STOP_TASK)
+        {
+            break;
+        }
+
+        while (__atomic_load_n(&diag.head, __ATOMIC_ACQUIRE) != diag.tail)
+        {
+            const struct diag_snapshot_s *snap = &diag.snap[diag.tail & DIAG_SNAP_MASK];
+            struct mcps_diag_s *d = &diag_dw->mcps_runtime->diag;
+            struct mcps_diag_s res;
+            uint32_t start = hal_cycles_get();
+            uint32_t us;
+
+            calculateStats(snap, &res);
+            diag_update(snap->addr, &res);
+
+            /* the last frame for the reports without senders */
+            d->rssi = res.rssi;
+            d->non_line_of_sight = res.non_line_of_sight;
+
+            __atomic_store_n(&diag.tail, (uint16_t)(diag.tail + 1), __ATOMIC_RELEASE);
+
+            us = (hal_cycles_get() - start) / HAL_CYCLES_PER_US;
+            diag.stats.computed++;
+            if (us > diag.stats.max_us)
+            {
+                diag.stats.max_us = us;
+            }
+        }
+    }
+
+    diagTask.Exit = 2;
+    while (diagTask.Exit == 2)
+    {
+        osThreadYield();
+        osDelay(1);
+    };
+}
+
+/* @fn      dw3000_diag_start
+ * @brief   clears the snapshots, the table and the counters, creates the diagnostics task
+ * */
+error_e dw3000_diag_start(struct dwchip_s *dw)
+{
+    diag_dw = dw;
+    memset(&diag, 0, sizeof(diag));
+    memset(diag_resp, 0, sizeof(diag_resp));
+    diag_seq = 0;
+
+    diagTask.Exit = 0;
+    diagTask.task_stack = NULL;
+
+    return create_diag_task(DiagTask, &diagTask, DIAG_TASK_STACK_SIZE_BYTES);
+}
+
+void dw3000_diag_stop(void)
+{
+    terminate_task(&diagTask);
+}
+
+/* @fn      dw3000_diag_capture
+ * @brief   MCPS task: reads the diagnostic registers of the frame just received
+ *          and passes them to the diagnostics task
+ * */
+void dw3000_diag_capture(struct dwchip_s *dw, const uint8_t *frame, unsigned int len)
+{
+    uint16_t head = diag.head;
+    struct diag_snapshot_s *snap;
+
+    if (!diagTask.Handle)
+    {
+        return;
+    }
+
+    if ((uint16_t)(head - __atomic_load_n(&diag.tail, __ATOMIC_ACQUIRE)) >= DIAG_SNAP_LEN)
+    {
+        diag.stats.dropped++;
+        return;
+    }
+
+    snap = &diag.snap[head & DIAG_SNAP_MASK];
+    captureStats(dw, snap);
+    snap->addr = diag_src_addr(frame, len);
+
+    diag.stats.captured++;
+    __atomic_store_n(&diag.head, (uint16_t)(head + 1), __ATOMIC_RELEASE);
+
+    osSignalSet(diagTask.Handle, DIAG_TASK_SNAPSHOT);
+}
+
+/* @fn      dw3000_diag_get_resp
+ * @brief   copies the entries of the senders, the most recently updated first
+ * @return  number of entries copied
+ * */
+int dw3000_diag_get_resp(struct diag_resp_s *resp, int max)
+{
+    struct diag_resp_s table[DIAG_RESP_MAX];
+    int n = 0;
+
+    enter_critical_section();
+    memcpy(table, diag_resp, sizeof(table));
+    leave_critical_section();
+
+    while (n < max)
+    {
+        struct diag_resp_s *last = NULL;
+
+        for (int i = 0; i < DIAG_RESP_MAX; i++)
+        {
+            if (table[i].frames && (!last || table[i].seq > last->seq))
+            {
+                last = &table[i];
+            }
+        }
+        if (!last)
+        {
+            break;
+        }
+        resp[n++] = *last;
+        last->frames = 0;
+    }
+
+    return n;
+}
+
+/* @fn      dw3000_diag_get_rssi
+ * @brief   the RSSI of the last frame of the sender of a frame which diagnostics were computed
+ * @return  false if the frame has no short source address or its sender has no entry
+ * */
+bool dw3000_diag_get_rssi(const uint8_t *frame, unsigned int len, float *rssi)
+{
+    uint16_t addr = diag_src_addr(frame, len);
+    bool found = false;
+
+    if (addr == DIAG_ADDR_NONE)
+    {
+        return false;
+    }
+
+    enter_critical_section();
+    for (int i = 0; i < DIAG_RESP_MAX && !found; i++)
+    {
+        if (diag_resp[i].frames && diag_resp[i].addr == addr)
+        {
+            *rssi = diag_resp[i].rssi;
+            found = true;
+        }
+    }
+    leave_critical_section();
+
+    return found;
+}
+
+const struct diag_stats_s *dw3000_diag_get_stats(void)
+{
+    return &diag.stats;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file      dw3000_diag.h
+ *
+ * @brief     RSSI and NLOS of the frames received, computed by a diagnostics task off the MCPS task
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef DW3000_DIAG_H
+#define DW3000_DIAG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "deca_interface.h"
+#include "HAL_error.h"
+
+/* The MCPS task captures the diagnostic registers of a frame in a snapshot,
+ * the diagnostics task computes its RSSI and NLOS into the entry of the sender.
+ * A frame received while all the snapshots are pending has no diagnostics, it is counted as dropped.
+ */
+
+/* snapshots pending, must be a power of 2 */
+#define DIAG_SNAP_LEN  (4)
+
+/* senders of the table, the least recently updated is replaced */
+#define DIAG_RESP_MAX  (8)
+
+/* sender of a frame without a short source address */
+#define DIAG_ADDR_NONE (0xFFFF)
+
+struct diag_resp_s
+{
+    uint16_t addr;   /**< short address of the sender */
+    uint16_t frames; /**< frames computed */
+    float rssi;      /**< dBm of the last frame */
+    float nlos;      /**< probability of NLOS of the last frame, % */
+    uint32_t seq;    /**< order of the last update */
+};
+
+struct diag_stats_s
+{
+    uint32_t captured; /**< snapshots taken by the MCPS task */
+    uint32_t dropped;  /**< frames without a snapshot free */
+    uint32_t computed; /**< snapshots computed by the diagnostics task */
+    uint32_t max_us;   /**< longest computation */
+};
+
+error_e dw3000_diag_start(struct dwchip_s *dw);
+void dw3000_diag_stop(void);
+void dw3000_diag_capture(struct dwchip_s *dw, const uint8_t *frame, unsigned int len);
+int dw3000_diag_get_resp(struct diag_resp_s *resp, int max);
+bool dw3000_diag_get_rssi(const uint8_t *frame, unsigned int len, float *rssi);
+const struct diag_stats_s *dw3000_diag_get_stats(void);
+
+#endif /* DW3000_DIAG_H */
@@ -52,6 +52,9 @@
 
 #include "linux/ieee802154.h"
 #include "linux/skbuff.h"
+#include "skb_pool.h"
+#include "dw3000_shadow.h"
+#include "trace.h"
 
 #define LP_DIAG_PRINTF(...)
 #define LP_DIAG_PRINTF1(...)
@@ -116,6 +119,8 @@ static void lp_timer_fira(void *p_context)
 
     tmr_tick = htimer->get_tick(htimer);
 
+    TRACE_POINT(TRACE_LP_TIMER, rt->current_operational_state);
+
     if (rt->current_operational_state == DW3000_OP_STATE_DEEP_SLEEP)
     {
         hal_uwb.wakeup_start();
@@ -236,8 +241,7 @@ static void lp_timer_fira(void *p_context)
             {
                 ret = ops->tx_frame(dw, dss->tx_skb->data, dss->tx_skb->len + 2 /*IEEE802154_FCS_LEN*/, &dss->txops);
 
-                free(dss->tx_skb->data);
-                free(dss->tx_skb);
+                skb_pool_free(dss->tx_skb);
                 dss->tx_skb = NULL;
             }
             else
@@ -408,6 +412,7 @@ int dw3000_rx_enable(struct dwchip_s *dw, int rx_delayed, uint32_t date_dtu, uin
             /* deep sleep now */
             ops->ioctl(dw, DWT_ENTERSLEEP, 0, NULL);
             rt->current_operational_state = DW3000_OP_STATE_DEEP_SLEEP;
+            dw3000_shadow_invalidate_all();
         }
 
         LP_DEBUG_D1();
@@ -472,7 +477,11 @@ int dw3000_tx_frame(struct dwchip_s *dw, struct sk_buff *skb, int tx_delayed, ui
 
     rt->corr_4ns = tx_date_dtu & 0x01; // Tx delayed set in 4ns resolution, but actual Tx is happening on the even time of 8ns
 
-    if (tx_delayed && htimer->start && !rt->need_ranging_clock && (delay_dtu - dw->llhw->shr_dtu) > min_sleep_dtu)
+    struct sk_buff *tx_skb = NULL;
+
+    /* the frame is kept until the wake up, the TX is done without deep sleep when the pool is exhausted */
+    if (tx_delayed && htimer->start && !rt->need_ranging_clock && (delay_dtu - dw->llhw->shr_dtu) > min_sleep_dtu
+        && (!skb || (tx_skb = skb_pool_alloc(skb->len)) != NULL))
     {
         { /* implementing only deep sleep power save */
             LP_DEBUG_D0();
@@ -488,21 +497,12 @@ int dw3000_tx_frame(struct dwchip_s *dw, struct sk_buff *skb, int tx_delayed, ui
 
             if(skb)
             {
-
-                struct sk_buff *tx_skb;
-
-                tx_skb = malloc(sizeof(struct sk_buff));
-                tx_skb->data = malloc(skb->len);
                 tx_skb->len = skb->len;
                 memcpy(tx_skb->data, skb->data, skb->len);
-
-                ddss->tx_skb = tx_skb;
-            }
-            else
-            {
-                ddss->tx_skb = NULL;
             }
 
+            ddss->tx_skb = tx_skb;
+
             if (rt->current_operational_state > DW3000_OP_STATE_DEEP_SLEEP)
             {
                 /* switching off the rx timeout such it would not trigger until programmed after wakeup */
@@ -512,6 +512,7 @@ int dw3000_tx_frame(struct dwchip_s *dw, struct sk_buff *skb, int tx_delayed, ui
                 /* deep sleep now */
                 ops->ioctl(dw, DWT_ENTERSLEEP, 0, NULL);
                 rt->current_operational_state = DW3000_OP_STATE_DEEP_SLEEP;
+                dw3000_shadow_invalidate_all();
             }
 
             LP_DIAG_PRINTF("will Tx after sleep: stx_date_dtu: 0x%08x00 tmr_tick:%d\r\n", txops.tx_date_dtu, tmr_tick);
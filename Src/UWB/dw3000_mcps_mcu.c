@@ -68,8 +68,11 @@
 #include "dw3000_mcps_mcu.h"
 #include "dw3000_xtal_trim.h"
 #include "dw3000_pdoa.h"
-#include "dw3000_statistics.h"
+#include "dw3000_diag.h"
 #include "task_signal.h"
+#include "mcps_event.h"
+#include "skb_pool.h"
+#include "mcps_capture.h"
 #include "int_priority.h"
 
 #include "minmax.h"
@@ -77,6 +80,8 @@
 
 #include "dw3000_lp_mcu.h"
 #include "create_mcps_Task.h"
+#include "HAL_cycles.h"
+#include "trace.h"
 
 extern uint8_t get_local_pavrg_size(void);
 extern int get_rx_ctx_size(void);
@@ -108,43 +113,65 @@ static void mcps_wakeup_mac_from_idle(void);
 #endif
 
 static task_signal_t mcpsTask;
+static struct dwt_mcps_rx_s *mcps_rx_cur; /**< descriptor of the RX event being handled, read by rx_get_frame() */
 
 static void McpsTask(void const *arg)
 {
     struct mcps802154_llhw *local_llhw = (struct mcps802154_llhw *)arg;
+    struct dwchip_s *dw = (struct dwchip_s *)local_llhw->priv;
 
     while (mcpsTask.Exit == 0)
     {
         osEvent evt = osSignalWait(mcpsTask.SignalMask, osWaitForever);
+        struct mcps_evt_s e;
+        bool first = true;
 
         if (evt.value.signals & STOP_TASK)
         {
             break;
         }
-        else if (evt.value.signals & MCPS_TASK_TX_DONE)
-        {
-            mcps802154_tx_done(local_llhw);
-        }
-        else if (evt.value.signals & MCPS_TASK_RX_TIMEOUT)
-        {
-            mcps802154_rx_timeout(local_llhw);
-        }
-        else if (evt.value.signals & MCPS_TASK_RX_ERROR)
-        {
-            mcps802154_rx_error(local_llhw,
-                                MCPS802154_RX_ERROR_OTHER);
-        }
-        else if (evt.value.signals & MCPS_TASK_RX)
-        {
-            mcps802154_rx_frame(local_llhw);
-        }
-        else if (evt.value.signals & MCPS_TASK_TIMER_EXPIRED)
-        {
-            mcps802154_timer_expired(local_llhw);
-        }
-        else
+
+        /* the signals only wake the task up: several events may be pending,
+         * they are all handled, in the order they came */
+        while (mcps_evt_get(&e, first))
         {
-            // do nothing
+            first = false;
+
+            TRACE_BEGIN(TRACE_MCPS_EVT, e.type);
+
+            switch (e.type)
+            {
+            case MCPS_EVT_TX_DONE:
+                mcps802154_tx_done(local_llhw);
+                break;
+            case MCPS_EVT_RX_TIMEOUT:
+                mcps802154_rx_timeout(local_llhw);
+                break;
+            case MCPS_EVT_RX_ERROR:
+                mcps802154_rx_error(local_llhw,
+                                    MCPS802154_RX_ERROR_OTHER);
+                break;
+            case MCPS_EVT_RX:
+            {
+                uint32_t start = hal_cycles_get();
+
+                /* rx_get_frame() reads the frame of the event, released once handled */
+                mcps_rx_cur = e.data;
+                mcps802154_rx_frame(local_llhw);
+                mcps_rx_cur = NULL;
+                mcps_rx_ring_pop(e.data);
+
+                mcps_evt_rx_time(dw->mcps_runtime->diag.enable, (hal_cycles_get() - start) / HAL_CYCLES_PER_US);
+                break;
+            }
+            case MCPS_EVT_TIMER_EXPIRED:
+                mcps802154_timer_expired(local_llhw);
+                break;
+            default:
+                break;
+            }
+
+            TRACE_END(TRACE_MCPS_EVT, e.type);
         }
     }
 
@@ -156,28 +183,37 @@ static void McpsTask(void const *arg)
     };
 }
 
-static void mcps_txdone_cb(const dwt_cb_data_t *txd)
+static void mcps_task_wake(int32_t signal)
 {
-    if (osSignalSet(mcpsTask.Handle, MCPS_TASK_TX_DONE) == 0x80000000)
+    if (osSignalSet(mcpsTask.Handle, signal) == 0x80000000)
     {
         error_handler(1, _ERR_Signal_Bad);
     }
 }
 
+/* @brief     ISR layer
+ *             queues the event with its payload and wakes the MCPS task up,
+ *             an event lost on a full queue is counted by mcps_evt_post()
+ * */
+static void mcps_evt_signal(uint8_t type, int32_t signal, uint32_t status, void *data)
+{
+    mcps_evt_post(type, status, data);
+    mcps_task_wake(signal);
+}
+
+static void mcps_txdone_cb(const dwt_cb_data_t *txd)
+{
+    mcps_evt_signal(MCPS_EVT_TX_DONE, MCPS_TASK_TX_DONE, txd->status, NULL);
+}
+
 static void mcps_rxtimeout_cb(const dwt_cb_data_t *rxd)
 {
-    if (osSignalSet(mcpsTask.Handle, MCPS_TASK_RX_TIMEOUT) == 0x80000000)
-    {
-        error_handler(1, _ERR_Signal_Bad);
-    }
+    mcps_evt_signal(MCPS_EVT_RX_TIMEOUT, MCPS_TASK_RX_TIMEOUT, rxd->status, NULL);
 }
 
 static void mcps_rxerror_cb(const dwt_cb_data_t *rxd)
 {
-    if (osSignalSet(mcpsTask.Handle, MCPS_TASK_RX_ERROR) == 0x80000000)
-    {
-        error_handler(1, _ERR_Signal_Bad);
-    }
+    mcps_evt_signal(MCPS_EVT_RX_ERROR, MCPS_TASK_RX_ERROR, rxd->status, NULL);
 }
 
 /* @brief     ISR layer
@@ -186,19 +222,23 @@ static void mcps_rxerror_cb(const dwt_cb_data_t *rxd)
  * */
 static void mcps_rx_cb(const dwt_cb_data_t *rxd)
 {
-#define MAX_MSG     2
-#define MAX_MSG_LEN 128
-    static uint8_t message[MAX_MSG][MAX_MSG_LEN];
-    static dwt_mcps_rx_t rx[MAX_MSG];
-    static int idx = 0;
-
     struct dwchip_s *dw = rxd->dw;
     const struct dwt_mcps_ops_s *mcps_ops = dw->dwt_driver->dwt_mcps_ops;
     struct dwt_mcps_runtime_s *rt = dw->mcps_runtime;
 
-    struct dwt_mcps_rx_s *pRx = &rx[idx];
+    unsigned int frame_max = (dw->config->rxtx_config->pdwCfg->phrMode == DWT_PHRMODE_EXT) ? (MCPS_RX_EXT_FRAME_MAX) : (MCPS_RX_STD_FRAME_MAX);
+    struct dwt_mcps_rx_s *pRx = mcps_rx_ring_reserve(rxd->datalength, frame_max);
     uint64_t ts, timebase64;
 
+    TRACE_POINT(TRACE_RX_CB, rxd->datalength);
+
+    if (!pRx)
+    {
+        /* no descriptor free: the frame is dropped, the MAC is told of an error to carry on */
+        mcps_evt_signal(MCPS_EVT_RX_ERROR, MCPS_TASK_RX_ERROR, rxd->status, NULL);
+        return;
+    }
+
     pRx->rtcTimeStamp = Rtc.getTimestamp();
 
     /* RX TS in RCTU of local timebase */
@@ -209,12 +249,8 @@ static void mcps_rx_cb(const dwt_cb_data_t *rxd)
 
     pRx->timeStamp = (ts + timebase64 + rt->corr_4ns) & 0xFFFFFFFFFFULL;
 
-    pRx->flags = 0;
-
-    if (rxd->datalength)
+    if (pRx->len)
     {
-        pRx->len = MIN(rxd->datalength, MAX_MSG_LEN);
-        pRx->data = (uint8_t *)&message[idx];
         struct dwt_rw_data_s rd = {(uint8_t *)pRx->data, pRx->len, 0};
         mcps_ops->ioctl(dw, DWT_READRXDATA, 0, (void *)&rd);
 
@@ -229,23 +265,36 @@ static void mcps_rx_cb(const dwt_cb_data_t *rxd)
     else
     {
         // most likely an SP3 packet --> no data
-        pRx->len = 0;
         pRx->data = NULL;
         pRx->flags |= DW3000_RX_FLAG_ND;
     }
 
-    dw->rx = pRx;
+    if (mcps_capture_is_enabled())
+    {
+        uint64_t sts_mode;
+
+        mcps_capture_frame(0, pRx->timeStamp, (pRx->len) ? ((int16_t)dw->mcps_runtime->diag.cfo_ppm) : (0),
+                           (dw3000_shadow_get(DW3000_SHADOW_STS_MODE, &sts_mode)) ? ((uint8_t)sts_mode) : (MCPS_CAPTURE_STS_UNKNOWN),
+                           pRx->data, (pRx->len > IEEE802154_FCS_LEN) ? (pRx->len - IEEE802154_FCS_LEN) : (0));
+    }
 
 #if 0
     if (data->rx_flags & DW3000_CB_DATA_RX_FLAG_AAT)
             rx->flags |= DW3000_RX_FLAG_AACK;
 #endif
 
-    idx = (idx == MAX_MSG - 1) ? 0 : idx + 1;
-    if (osSignalSet(mcpsTask.Handle, MCPS_TASK_RX) == 0x80000000)
+    /* the descriptor is committed only with its event: a frame the task is not told of
+     * would be taken for the frame of the next event */
+    if (mcps_evt_post(MCPS_EVT_RX, rxd->status, pRx))
     {
-        error_handler(1, _ERR_Signal_Bad);
+        mcps_rx_ring_commit();
     }
+    else
+    {
+        mcps_rx_ring_cancel();
+    }
+
+    mcps_task_wake(MCPS_TASK_RX);
 }
 
 static int dw3000_setcallbacks(struct dwchip_s *dw)
@@ -367,6 +416,8 @@ static int tx_frame(struct mcps802154_llhw *llhw, struct sk_buff *skb,
     int rc;
     u8 sts_mode;
 
+    TRACE_POINT(TRACE_TX_FRAME, info->flags);
+
     info->timestamp_dtu &= 0xFFFFFFFE; /* DTU to actual DTU_TX */
 
     /* Check data : no data if SP3, must have data otherwise */
@@ -433,6 +484,13 @@ static int tx_frame(struct mcps802154_llhw *llhw, struct sk_buff *skb,
     /* WRKRND: first Tx in a new ranging round does not require ranging clock before it */
     rt->need_ranging_clock &= !(bool)(info->flags & MCPS802154_TX_FRAME_CONFIG_RANGING_ROUND);
 
+    if (mcps_capture_is_enabled())
+    {
+        mcps_capture_frame(MCPS_CAPTURE_FLAG_TX | ((tx_delayed) ? (MCPS_CAPTURE_FLAG_DELAYED) : (0)),
+                           (tx_delayed) ? (timestamp_dtu_to_rctu(llhw, tx_date_dtu)) : (0), 0, sts_mode,
+                           (skb) ? (skb->data) : (NULL), (skb) ? (skb->len) : (0));
+    }
+
     int nok = dw3000_tx_frame(dw, skb, tx_delayed, tx_date_dtu, rx_delay_dly, rx_timeout_pac);
 
     /* requirement to keep ranging clock is a pre-requirement for the next Tx/Rx */
@@ -588,7 +646,7 @@ static int rx_get_frame(struct mcps802154_llhw *llhw, struct sk_buff **skb,
                         struct mcps802154_rx_frame_info *info)
 {
     struct dwchip_s *dw = (struct dwchip_s *)llhw->priv;
-    struct dwt_mcps_rx_s *rx = dw->rx;
+    struct dwt_mcps_rx_s *rx = mcps_rx_cur;
     int ret = 0;
 
     /* Sanity check parameters */
@@ -598,17 +656,26 @@ static int rx_get_frame(struct mcps802154_llhw *llhw, struct sk_buff **skb,
         goto error;
     }
 
-    struct sk_buff *local_skb = malloc(sizeof(struct sk_buff));
+    if (!rx)
+    {
+        ret = UWBMAC_EAGAIN;
+        goto error;
+    }
+
+    TRACE_POINT(TRACE_RX_GET_FRAME, rx->len);
+
+    /* the buffer points to the frame in the RX ring, the MAC releases it with free() */
+    struct sk_buff *local_skb = skb_pool_alloc(0);
     *skb = local_skb;
 
     /* Check buffer available */
-    if (unlikely(!*skb && !(rx->flags & DW3000_RX_FLAG_ND)))
+    if (unlikely(!*skb))
     {
             ret = UWBMAC_EAGAIN;
             goto error;
     }
-    local_skb->data = dw->rx->data;
-    local_skb->len = dw->rx->len;
+    local_skb->data = rx->data;
+    local_skb->len = rx->len;
     if (local_skb->len)
         local_skb->len -= IEEE802154_FCS_LEN;
 
@@ -619,7 +686,8 @@ static int rx_get_frame(struct mcps802154_llhw *llhw, struct sk_buff **skb,
 
         if (dw->mcps_runtime->diag.enable)
         {
-            calculateStats(dw, &dw->mcps_runtime->diag);
+            /* the registers only, RSSI and NLOS are computed by the diagnostics task */
+            dw3000_diag_capture(dw, rx->data, rx->len);
         }
     }
 
@@ -699,7 +767,7 @@ static int rx_get_frame(struct mcps802154_llhw *llhw, struct sk_buff **skb,
 
     if ((*skb)->len == 0)
     {
-        free(*skb);
+        skb_pool_free(*skb);
         *skb = NULL;
     }
 
@@ -881,6 +949,9 @@ static int reset(struct mcps802154_llhw *llhw)
         dw->dwt_driver->dwt_ops->ioctl(dw, DWT_SETPDOAOFFSET, 0, (void *)&tmp);
     }
 
+    /* the device lost its settings */
+    dw3000_shadow_invalidate_all();
+
     leave_critical_section(); /**< all RTOS tasks can be scheduled */
 
     return ret;
@@ -1209,6 +1280,28 @@ static int set_sts_params(struct mcps802154_llhw *llhw,
 }
 
 
+/* @fn      configure_frame_filter
+ * @brief   writes the frame filter unless the device has it already.
+ *          The shadow is keyed on both the enable and the mode written.
+ *          The frame filter gates the auto-acknowledgement, whose shadow is invalidated on a write.
+ * */
+static int configure_frame_filter(struct dwchip_s *dw, uint16_t enabletype, uint16_t filtermode)
+{
+    struct dwt_configure_ff_s tmp = {enabletype, filtermode};
+    int ret = 0;
+
+    if (dw3000_shadow_write(DW3000_SHADOW_FRAME_FILTER, ((uint32_t)enabletype << 16) | filtermode))
+    {
+        ret = dw->dwt_driver->dwt_mcps_ops->ioctl(dw, DWT_CONFIGUREFRAMEFILTER, 0, (void *)&tmp);
+        dw3000_shadow_invalidate(DW3000_SHADOW_AUTOACK);
+        if (ret)
+        {
+            dw3000_shadow_invalidate(DW3000_SHADOW_FRAME_FILTER);
+        }
+    }
+    return ret;
+}
+
 static int set_hw_addr_filt(struct mcps802154_llhw *llhw,
                             struct ieee802154_hw_addr_filt *filt,
                             unsigned long changed)
@@ -1227,16 +1320,16 @@ static int set_hw_addr_filt(struct mcps802154_llhw *llhw,
         return ret;
     }
 
-    if (changed & IEEE802154_AFILT_SADDR_CHANGED)
+    if ((changed & IEEE802154_AFILT_SADDR_CHANGED) && dw3000_shadow_write(DW3000_SHADOW_SHORT_ADDR, filt->short_addr))
     {
         ret = ops->ioctl(dw, DWT_SETADDRESS16, 0,
                          (void *)&filt->short_addr);
     }
-    if (!ret && (changed & IEEE802154_AFILT_IEEEADDR_CHANGED))
+    if (!ret && (changed & IEEE802154_AFILT_IEEEADDR_CHANGED) && dw3000_shadow_write(DW3000_SHADOW_EUI, filt->ieee_addr))
     {
         ret = ops->ioctl(dw, DWT_SETEUI, 0, (void *)&filt->ieee_addr);
     }
-    if (!ret && (changed & IEEE802154_AFILT_PANID_CHANGED))
+    if (!ret && (changed & IEEE802154_AFILT_PANID_CHANGED) && dw3000_shadow_write(DW3000_SHADOW_PAN_ID, filt->pan_id))
     {
         ret = ops->ioctl(dw, DWT_SETPANID, 0, (void *)&filt->pan_id);
     }
@@ -1244,17 +1337,18 @@ static int set_hw_addr_filt(struct mcps802154_llhw *llhw,
     {
         /*if (filt->pan_coord)
         {
-            struct dwt_configure_ff_s tmp = {1, DWT_FF_COORD_EN};
-            ret = ops->ioctl(dw, DWT_CONFIGUREFRAMEFILTER, 0,
-                             (void *)&tmp);
+            ret = configure_frame_filter(dw, 1, DWT_FF_COORD_EN);
         }
         else*/
         {
-            struct dwt_configure_ff_s tmp = {0, 0};
-            ret = ops->ioctl(dw, DWT_CONFIGUREFRAMEFILTER, 0,
-                             (void *)&tmp);
+            ret = configure_frame_filter(dw, 0, 0);
         }
     }
+    if (ret)
+    {
+        /* the write failed part way, which of the settings it reached is unknown */
+        dw3000_shadow_invalidate_all();
+    }
     return ret;
 }
 
@@ -1292,10 +1386,7 @@ static int set_promiscuous_mode(struct mcps802154_llhw *llhw, bool on)
                          DWT_FF_COORD_EN;
 #endif
 
-    struct dwt_configure_ff_s tmp = {p->frameFilter, p->frameFilterMode};
-
-    dw->dwt_driver->dwt_mcps_ops->ioctl(dw, DWT_CONFIGUREFRAMEFILTER, 0,
-                                        (void *)&tmp);
+    configure_frame_filter(dw, p->frameFilter, p->frameFilterMode);
     return 0;
 }
 
@@ -1544,12 +1635,22 @@ int dw3000_mcps_register(struct dwchip_s *dw)
 
     mcpsTask.task_stack = NULL;
 
+    mcps_evt_reset();
+    mcps_rx_ring_reset();
+    skb_pool_reset_stats();
+    dw3000_shadow_reset_stats();
+
     error_e ret = create_mcps_task((void *)McpsTask, &mcpsTask, (uint16_t)MCPS_TASK_STACK_SIZE_BYTES, dw->llhw);
     if (ret != _NO_ERR)
     {
         error_handler(1, _ERR_Create_Task_Bad);
     }
 
+    if (dw->mcps_runtime->diag.enable && dw3000_diag_start(dw) != _NO_ERR)
+    {
+        error_handler(1, _ERR_Create_Task_Bad);
+    }
+
     old_dw = dwt_update_dw(dw);
     reset(dw->llhw);
 
@@ -1562,6 +1663,7 @@ int dw3000_mcps_register(struct dwchip_s *dw)
 void dw3000_mcps_unregister(struct dwchip_s *dw)
 {
     terminate_task(&mcpsTask);
+    dw3000_diag_stop();
 
     /* deinit low-power timer */
     lp_timer_fira_deinit(dw);
@@ -1572,8 +1674,5 @@ void dw3000_mcps_unregister(struct dwchip_s *dw)
 
 void mcps_wakeup_mac_from_idle(void)
 {
-    if (osSignalSet(mcpsTask.Handle, MCPS_TASK_TIMER_EXPIRED) == 0x80000000)
-    {
-        error_handler(1, _ERR_Signal_Bad);
-    }
+    mcps_evt_signal(MCPS_EVT_TIMER_EXPIRED, MCPS_TASK_TIMER_EXPIRED, 0, NULL);
 }
\ No newline at end of file
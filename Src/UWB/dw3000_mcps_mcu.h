@@ -55,6 +55,7 @@
 
 #include <deca_interface.h>
 #include <net/mcps802154.h>
+#include "mcps_rx_ring.h"
 
 enum operational_state
 {
@@ -96,17 +97,6 @@ struct dw3000_deep_sleep_state
     };
 };
 
-struct dwt_mcps_rx_s
-{
-    uint64_t timeStamp; /* Full TimeStamp */
-    uint32_t rtcTimeStamp;
-    uint32_t flags;
-    uint8_t *data;
-    unsigned int len;
-    int16_t cfo;
-};
-typedef struct dwt_mcps_rx_s dwt_mcps_rx_t;
-
 struct mcps_diag_s
 {
     bool enable;
@@ -59,6 +59,7 @@
 #include "linux/errno.h"
 #include "deca_interface.h"
 #include "dw3000_mcps_mcu.h"
+#include "dw3000_shadow.h"
 #include "HAL_uwb.h"
 #include "uwbmac.h"
 
@@ -118,8 +119,17 @@ static inline s16 dw3000_readpdoa(struct dwchip_s *dw)
 static inline int dw3000_set_sts(struct dwchip_s *dw, u8 mode)
 {
     uint8_t stsMode = mode;
+    int rc = 0;
 
-    return dw->dwt_driver->dwt_mcps_ops->ioctl(dw, DWT_CONFIGURESTSMODE, 0, (void *)&stsMode);
+    if (dw3000_shadow_write(DW3000_SHADOW_STS_MODE, mode))
+    {
+        rc = dw->dwt_driver->dwt_mcps_ops->ioctl(dw, DWT_CONFIGURESTSMODE, 0, (void *)&stsMode);
+        if (rc)
+        {
+            dw3000_shadow_invalidate(DW3000_SHADOW_STS_MODE);
+        }
+    }
+    return rc;
 }
 
 /**
@@ -131,7 +141,14 @@ static inline int dw3000_set_sts(struct dwchip_s *dw, u8 mode)
  */
 static inline int dw3000_enable_autoack(struct dwchip_s *dw, bool force)
 {
-    dw->dwt_driver->dwt_mcps_ops->mcps_compat.ack_enable(dw, (int)true);
+    if (force)
+    {
+        dw3000_shadow_invalidate(DW3000_SHADOW_AUTOACK);
+    }
+    if (dw3000_shadow_write(DW3000_SHADOW_AUTOACK, true))
+    {
+        dw->dwt_driver->dwt_mcps_ops->mcps_compat.ack_enable(dw, (int)true);
+    }
     return 0;
 }
 
@@ -144,7 +161,14 @@ static inline int dw3000_enable_autoack(struct dwchip_s *dw, bool force)
  */
 static inline int dw3000_disable_autoack(struct dwchip_s *dw, bool force)
 {
-    dw->dwt_driver->dwt_mcps_ops->mcps_compat.ack_enable(dw, (int)false);
+    if (force)
+    {
+        dw3000_shadow_invalidate(DW3000_SHADOW_AUTOACK);
+    }
+    if (dw3000_shadow_write(DW3000_SHADOW_AUTOACK, false))
+    {
+        dw->dwt_driver->dwt_mcps_ops->mcps_compat.ack_enable(dw, (int)false);
+    }
     return 0;
 }
 
@@ -255,6 +279,8 @@ static int dw3000_set_sts_length(struct dwchip_s *dw, dwt_sts_lengths_e len)
         }
         config->stsLength = len;
 
+        /* the STS configuration carries the STS mode of the configuration */
+        dw3000_shadow_invalidate(DW3000_SHADOW_STS_MODE);
         ret = ops->ioctl(dw, DWT_CFG_STS, 0, config);
     }
 
@@ -0,0 +1,133 @@
+/**
+ * @file      dw3000_shadow.c
+ *
+ * @brief     Shadow of the radio settings the MCPS programs per frame, to skip the SPI writes of unchanged values
+ *
+ * @author    Decawave Applications
+ *
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include "dw3000_shadow.h"
+
+#define DW3000_SHADOW_ALL ((1UL << DW3000_SHADOW_MAX) - 1)
+
+static struct
+{
+    uint64_t value[DW3000_SHADOW_MAX]; /**< last value programmed */
+    uint32_t valid;                    /**< a bit set per value matching the device */
+    struct dw3000_shadow_stats_s stats;
+} shadow;
+
+/* @fn      dw3000_shadow_write
+ * @brief   records the value of a setting about to be programmed
+ * @param   reg: the setting
+ * @param   value: its new value
+ * @return  true if the device is to be written, false if it holds that value already
+ * */
+bool dw3000_shadow_write(dw3000_shadow_e reg, uint64_t value)
+{
+    uint32_t bit = 1UL << reg;
+
+    if ((__atomic_load_n(&shadow.valid, __ATOMIC_ACQUIRE) & bit) && shadow.value[reg] == value)
+    {
+        shadow.stats.elided[reg]++;
+        return false;
+    }
+
+    shadow.value[reg] = value;
+    __atomic_fetch_or(&shadow.valid, bit, __ATOMIC_RELEASE);
+    shadow.stats.written[reg]++;
+    return true;
+}
+
+/* @fn      dw3000_shadow_get
+ * @brief   the value of a setting programmed in the device
+ * @return  false if it is not known
+ * */
+bool dw3000_shadow_get(dw3000_shadow_e reg, uint64_t *value)
+{
+    if (!(__atomic_load_n(&shadow.valid, __ATOMIC_ACQUIRE) & (1UL << reg)))
+    {
+        return false;
+    }
+    *value = shadow.value[reg];
+    return true;
+}
+
+/* @fn      dw3000_shadow_invalidate
+ * @brief   forgets a setting, the write failed or the device changed it: its next write goes to the device
+ * */
+void dw3000_shadow_invalidate(dw3000_shadow_e reg)
+{
+    __atomic_fetch_and(&shadow.valid, ~(1UL << reg), __ATOMIC_RELEASE);
+}
+
+/* @fn      dw3000_shadow_invalidate_all
+ * @brief   forgets every setting, on reset, deep sleep or reconfiguration of the device
+ * */
+void dw3000_shadow_invalidate_all(void)
+{
+    __atomic_fetch_and(&shadow.valid, ~DW3000_SHADOW_ALL, __ATOMIC_RELEASE);
+}
+
+/* @fn      dw3000_shadow_reset_stats
+ * @brief   clears the counters, at the start of a session
+ * */
+void dw3000_shadow_reset_stats(void)
+{
+    for (int i = 0; i < DW3000_SHADOW_MAX; i++)
+    {
+        shadow.stats.written[i] = 0;
+        shadow.stats.elided[i] = 0;
+    }
+}
+
+const struct dw3000_shadow_stats_s *dw3000_shadow_get_stats(void)
+{
+    return &shadow.stats;
+}
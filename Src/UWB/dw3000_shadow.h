@@ -0,0 +1,95 @@
+/**
+ * @file      dw3000_shadow.h
+ *
+ * @brief     Shadow of the radio settings the MCPS programs per frame, to skip the SPI writes of unchanged values
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef DW3000_SHADOW_H_
+#define DW3000_SHADOW_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* A setting is written to the DW3000 only when its value differs from the last one programmed.
+ * The shadow is invalidated whenever the device may lose or overwrite it: reset, deep sleep,
+ * reconfiguration; the next write of every setting then goes to the device.
+ */
+
+typedef enum
+{
+    DW3000_SHADOW_STS_MODE,
+    DW3000_SHADOW_AUTOACK,
+    DW3000_SHADOW_SHORT_ADDR,
+    DW3000_SHADOW_EUI,
+    DW3000_SHADOW_PAN_ID,
+    DW3000_SHADOW_FRAME_FILTER,
+    DW3000_SHADOW_MAX
+} dw3000_shadow_e;
+
+struct dw3000_shadow_stats_s
+{
+    uint32_t written[DW3000_SHADOW_MAX]; /**< writes issued to the device */
+    uint32_t elided[DW3000_SHADOW_MAX];  /**< writes skipped, the value programmed already */
+};
+
+bool dw3000_shadow_write(dw3000_shadow_e reg, uint64_t value);
+bool dw3000_shadow_get(dw3000_shadow_e reg, uint64_t *value);
+void dw3000_shadow_invalidate(dw3000_shadow_e reg);
+void dw3000_shadow_invalidate_all(void);
+void dw3000_shadow_reset_stats(void);
+const struct dw3000_shadow_stats_s *dw3000_shadow_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DW3000_SHADOW_H_ */
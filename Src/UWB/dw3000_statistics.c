@@ -68,12 +68,47 @@
 #define CONSTANT_PR_IP_A   0.39178 // Constant from simulations on DW device accumulator, please see App Notes "APS006 PART 3"
 #define CONSTANT_PR_IP_B   1.31719 // Constant from simulations on DW device accumulator, please see App Notes "APS006 PART 3"
 
-void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
+/* @fn      captureStats
+ * @brief   reads the diagnostic registers of the frame just received, for calculateStats()
+ * */
+void captureStats(struct dwchip_s *dw, struct diag_snapshot_s *snap)
+{
+    uint32_t dev_id = dw->dwt_driver->devid;
+    dwt_config_t *cfg = dw->config->rxtx_config->pdwCfg;
+    static const dwt_diag_type_e diag_types[DIAG_SNAPSHOT_TYPES] = {IPATOV, STS1, STS2};
+
+    snap->dev_c0 = ((dev_id == (uint32_t)DWT_DW3000_DEV_ID) || (dev_id == (uint32_t)DWT_DW3000_PDOA_DEV_ID));
+    snap->prf_64 = (cfg->rxCode > RX_CODE_THRESHOLD);
+    snap->sts_off = (cfg->stsMode == DWT_STS_MODE_OFF);
+    snap->pdoa_m3 = (cfg->pdoaMode == DWT_PDOA_M3);
+
+    for (int i = 0; i < DIAG_SNAPSHOT_TYPES; i++)
+    {
+        dwt_nlos_alldiag_t all_diag;
+
+        all_diag.diag_type = diag_types[i];
+        dw->dwt_driver->dwt_ops->ioctl(dw, DWT_NLOS_ALLDIAG, 0, (void *)&all_diag);
+        snap->diag[i].accumCount = all_diag.accumCount;
+        snap->diag[i].F1 = all_diag.F1;
+        snap->diag[i].F2 = all_diag.F2;
+        snap->diag[i].F3 = all_diag.F3;
+        snap->diag[i].cir_power = all_diag.cir_power;
+    }
+
+    dw->dwt_driver->dwt_ops->ioctl(dw, DWT_GETDGCDECISION, 0, (void *)&snap->dgc_decision);
+
+    /* only needed when the signal levels are low, read now as the next frame overwrites it */
+    dwt_nlos_ipdiag(&snap->index);
+}
+
+/* @fn      calculateStats
+ * @brief   RSSI and probability of NLOS from the registers captured by captureStats()
+ * */
+void calculateStats(const struct diag_snapshot_s *snap, struct mcps_diag_s *diag)
 {
     /* Line-of-sight / Non-line-of-sight Variables */
-    uint32_t dev_id, D;
-    dwt_nlos_alldiag_t all_diag;
-    dwt_nlos_ipdiag_t index;
+    uint32_t D;
+    const struct diag_snapshot_regs_s *all_diag;
 
     // All float variables used for recording different diagnostic results and probability.
     float ip_f1, ip_f2, ip_f3, sts1_f1, sts1_f2, sts1_f3, sts2_f1, sts2_f2, sts2_f3 = 0;
@@ -81,9 +116,7 @@ void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
     float pr_nlos, sl_diff_ip, sl_diff_sts1, sl_diff_sts2, sl_diff, index_diff = 0;
     float alpha, ip_alpha, log_constant = 0;
 
-    dev_id = dw->dwt_driver->devid;
-
-    if ((dev_id == (uint32_t)DWT_DW3000_DEV_ID) || (dev_id == (uint32_t)DWT_DW3000_PDOA_DEV_ID))
+    if (snap->dev_c0)
     {
         log_constant = LOG_CONSTANT_C0;
     }
@@ -91,34 +124,31 @@ void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
     {
         log_constant = LOG_CONSTANT_D0_E0;
     }
-    // Select IPATOV to read Ipatov diagnostic registers from API function dwt_nlos_alldiag()
-    all_diag.diag_type = IPATOV;
-    dw->dwt_driver->dwt_ops->ioctl(dw, DWT_NLOS_ALLDIAG, 0, (void *)&all_diag);
-    ip_alpha = (dw->config->rxtx_config->pdwCfg->rxCode > RX_CODE_THRESHOLD) ? (-(ALPHA_PRF_64 + 1)) : -(ALPHA_PRF_16);
-    ip_n = all_diag.accumCount; // The number of preamble symbols accumulated
-    ip_f1 = all_diag.F1 / 4;    // The First Path Amplitude (point 1) magnitude value (it has 2 fractional bits),
-    ip_f2 = all_diag.F2 / 4;    // The First Path Amplitude (point 2) magnitude value (it has 2 fractional bits),
-    ip_f3 = all_diag.F3 / 4;    // The First Path Amplitude (point 3) magnitude value (it has 2 fractional bits),
-    ip_cp = all_diag.cir_power;
-
-    // Select STS1 to read STS1 diagnostic registers from API function dwt_nlos_alldiag()
-    all_diag.diag_type = STS1;
-    dw->dwt_driver->dwt_ops->ioctl(dw, DWT_NLOS_ALLDIAG, 0, (void *)&all_diag);
+    // IPATOV diagnostic registers read by dwt_nlos_alldiag()
+    all_diag = &snap->diag[IPATOV];
+    ip_alpha = (snap->prf_64) ? (-(ALPHA_PRF_64 + 1)) : -(ALPHA_PRF_16);
+    ip_n = all_diag->accumCount; // The number of preamble symbols accumulated
+    ip_f1 = all_diag->F1 / 4;    // The First Path Amplitude (point 1) magnitude value (it has 2 fractional bits),
+    ip_f2 = all_diag->F2 / 4;    // The First Path Amplitude (point 2) magnitude value (it has 2 fractional bits),
+    ip_f3 = all_diag->F3 / 4;    // The First Path Amplitude (point 3) magnitude value (it has 2 fractional bits),
+    ip_cp = all_diag->cir_power;
+
+    // STS1 diagnostic registers read by dwt_nlos_alldiag()
+    all_diag = &snap->diag[STS1];
     alpha = -(ALPHA_PRF_64 + 1);
-    sts1_n = all_diag.accumCount; // The number of preamble symbols accumulated
-    sts1_f1 = all_diag.F1 / 4;    // The First Path Amplitude (point 1) magnitude value (it has 2 fractional bits),
-    sts1_f2 = all_diag.F2 / 4;    // The First Path Amplitude (point 2) magnitude value (it has 2 fractional bits),
-    sts1_f3 = all_diag.F3 / 4;    // The First Path Amplitude (point 3) magnitude value (it has 2 fractional bits),
-    sts1_cp = all_diag.cir_power;
-
-    // Select STS2 to read STS2 diagnostic registers from API function dwt_nlos_alldiag()
-    all_diag.diag_type = STS2;
-    dw->dwt_driver->dwt_ops->ioctl(dw, DWT_NLOS_ALLDIAG, 0, (void *)&all_diag);
-    sts2_n = all_diag.accumCount; // The number of preamble symbols accumulated
-    sts2_f1 = all_diag.F1 / 4;    // The First Path Amplitude (point 1) magnitude value (it has 2 fractional bits),
-    sts2_f2 = all_diag.F2 / 4;    // The First Path Amplitude (point 2) magnitude value (it has 2 fractional bits),
-    sts2_f3 = all_diag.F3 / 4;    // The First Path Amplitude (point 3) magnitude value (it has 2 fractional bits),
-    sts2_cp = all_diag.cir_power;
+    sts1_n = all_diag->accumCount; // The number of preamble symbols accumulated
+    sts1_f1 = all_diag->F1 / 4;    // The First Path Amplitude (point 1) magnitude value (it has 2 fractional bits),
+    sts1_f2 = all_diag->F2 / 4;    // The First Path Amplitude (point 2) magnitude value (it has 2 fractional bits),
+    sts1_f3 = all_diag->F3 / 4;    // The First Path Amplitude (point 3) magnitude value (it has 2 fractional bits),
+    sts1_cp = all_diag->cir_power;
+
+    // STS2 diagnostic registers read by dwt_nlos_alldiag()
+    all_diag = &snap->diag[STS2];
+    sts2_n = all_diag->accumCount; // The number of preamble symbols accumulated
+    sts2_f1 = all_diag->F1 / 4;    // The First Path Amplitude (point 1) magnitude value (it has 2 fractional bits),
+    sts2_f2 = all_diag->F2 / 4;    // The First Path Amplitude (point 2) magnitude value (it has 2 fractional bits),
+    sts2_f3 = all_diag->F3 / 4;    // The First Path Amplitude (point 3) magnitude value (it has 2 fractional bits),
+    sts2_cp = all_diag->cir_power;
 
     // The calculation of First Path Power Level(FSL) and Receive Signal Power Level(RSL) is taken from
     // DW3000 User Manual section 4.7.1 & 4.7.2
@@ -142,9 +172,7 @@ void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
     sts2_f3 *= sts2_f3;
 
     //    D = all_diag.D * 6;
-    uint8_t tmp = 0;
-    dw->dwt_driver->dwt_ops->ioctl(dw, DWT_GETDGCDECISION, 0, (void *)&tmp);
-    D = tmp * 6;
+    D = snap->dgc_decision * 6;
 
     // Calculate the First Signal Level(FSL) and Receive Signal Level(RSL) then subtract FSL from RSL
     // to find out Signal Level Difference which is compared to defined Signal Threshold.
@@ -165,7 +193,7 @@ void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
     sts2_fsl = 10 * log10(((sts2_f1 + sts2_f2 + sts2_f3) / sts2_n)) + alpha + D;
 
     // STS Mode OFF, Signal Level Difference of STS1 and STS2 is zero.
-    if (dw->config->rxtx_config->pdwCfg->stsMode == DWT_STS_MODE_OFF)
+    if (snap->sts_off)
     {
         sl_diff_sts1 = 0;
         sl_diff_sts2 = 0;
@@ -175,7 +203,7 @@ void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
         sl_diff_sts1 = sts1_rsl - sts1_fsl;
 
         // IF PDOA MODE 3 is not enabled then Signal Level Difference of STS2 is zero.
-        if (dw->config->rxtx_config->pdwCfg->pdoaMode != DWT_PDOA_M3)
+        if (!snap->pdoa_m3)
         {
             sl_diff_sts2 = 0;
         }
@@ -235,8 +263,7 @@ void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag)
     //    3.c. If the Index level is greater than 6 dB then it's a Non Line of Sight signal.
     else
     {
-        dwt_nlos_ipdiag(&index);
-        index_diff = ((float)index.index_pp_u32 - (float)index.index_fp_u32) / 32;
+        index_diff = ((float)snap->index.index_pp_u32 - (float)snap->index.index_fp_u32) / 32;
 
         if (index_diff <= IP_MIN_THRESHOLD)
         {
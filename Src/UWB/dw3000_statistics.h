@@ -56,6 +56,32 @@
 #include "deca_interface.h"
 #include "dw3000_mcps_mcu.h"
 
-void calculateStats(struct dwchip_s *dw, struct mcps_diag_s *diag);
+#define DIAG_SNAPSHOT_TYPES (3) /* IPATOV, STS1, STS2 */
+
+/* the registers of dwt_nlos_alldiag_t used by calculateStats() */
+struct diag_snapshot_regs_s
+{
+    uint32_t accumCount;
+    uint32_t F1;
+    uint32_t F2;
+    uint32_t F3;
+    uint32_t cir_power;
+};
+
+/* diagnostic registers of a frame received and the configuration they are read with */
+struct diag_snapshot_s
+{
+    struct diag_snapshot_regs_s diag[DIAG_SNAPSHOT_TYPES];
+    dwt_nlos_ipdiag_t index;
+    uint16_t addr;        /* short address of the sender */
+    uint8_t dgc_decision;
+    uint8_t dev_c0   : 1; /* DW3000 C0 device, else D0/E0 */
+    uint8_t prf_64   : 1;
+    uint8_t sts_off  : 1;
+    uint8_t pdoa_m3  : 1;
+};
+
+void captureStats(struct dwchip_s *dw, struct diag_snapshot_s *snap);
+void calculateStats(const struct diag_snapshot_s *snap, struct mcps_diag_s *diag);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+/**
+ * @file      mcps_capture.c
+ *
+ * @brief     Capture of the frames transmitted and received by the MCPS, for offline analysis
+ *
+ * @author    Decawave Applications
+ *
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+
+#include "mcps_capture.h"
+#include "HAL_cycles.h"
+
+#if (MCPS_CAPTURE_LEN & (MCPS_CAPTURE_LEN - 1))
+#error "MCPS_CAPTURE_LEN shall be a power of 2"
+#endif
+
+static struct
+{
+    struct
+    {
+        struct mcps_capture_rec_s rec;
+        uint32_t ready; /**< index of the record + 1 once filled */
+    } slot[MCPS_CAPTURE_LEN];
+    uint32_t head; /**< next record to fill, claimed by the producers */
+    uint32_t tail; /**< next record to send, consumer */
+    uint8_t enabled;
+    struct mcps_capture_stats_s stats;
+} capture;
+
+/* @fn      mcps_capture_enable
+ * @brief   starts the capture with clear counters, or stops it: the records pending are still sent
+ * */
+void mcps_capture_enable(bool on)
+{
+    if (on)
+    {
+        memset(&capture.stats, 0, sizeof(capture.stats));
+    }
+    __atomic_store_n(&capture.enabled, (uint8_t)on, __ATOMIC_RELEASE);
+}
+
+bool mcps_capture_is_enabled(void)
+{
+    return __atomic_load_n(&capture.enabled, __ATOMIC_RELAXED);
+}
+
+/* @fn      mcps_capture_frame
+ * @brief   copies a frame to the ring, called by tx_frame() and the RX callback
+ * @param   data, len: the frame, the FCS excluded, NULL and 0 for a frame without data
+ * */
+void mcps_capture_frame(uint8_t flags, uint64_t rctu, int16_t cfo_100ppm, uint8_t sts_mode,
+                        const uint8_t *data, unsigned int len)
+{
+    uint32_t start = hal_cycles_get();
+    uint32_t h, cycles, max;
+
+    if (!mcps_capture_is_enabled())
+    {
+        return;
+    }
+
+    h = __atomic_load_n(&capture.head, __ATOMIC_RELAXED);
+    do
+    {
+        if (h - __atomic_load_n(&capture.tail, __ATOMIC_ACQUIRE) >= MCPS_CAPTURE_LEN)
+        {
+            __atomic_fetch_add(&capture.stats.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&capture.head, &h, h + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    struct mcps_capture_rec_s *r = &capture.slot[h & (MCPS_CAPTURE_LEN - 1)].rec;
+
+    if (len > MCPS_CAPTURE_DATA_MAX)
+    {
+        flags |= MCPS_CAPTURE_FLAG_CUT;
+        __atomic_fetch_add(&capture.stats.cut, 1, __ATOMIC_RELAXED);
+    }
+
+    r->rctu = rctu;
+    r->cycles = start;
+    r->len = (uint16_t)len;
+    r->cfo_100ppm = cfo_100ppm;
+    r->sts_mode = sts_mode;
+    r->flags = flags | ((data && len) ? (0) : (MCPS_CAPTURE_FLAG_ND));
+    if (data && len)
+    {
+        memcpy(r->data, data, (len > MCPS_CAPTURE_DATA_MAX) ? (MCPS_CAPTURE_DATA_MAX) : (len));
+    }
+
+    __atomic_store_n(&capture.slot[h & (MCPS_CAPTURE_LEN - 1)].ready, h + 1, __ATOMIC_RELEASE);
+
+    cycles = hal_cycles_get() - start;
+    __atomic_fetch_add(&capture.stats.captured, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&capture.stats.cycles, cycles, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&capture.stats.max_cycles, __ATOMIC_RELAXED);
+    while (cycles > max && !__atomic_compare_exchange_n(&capture.stats.max_cycles, &max, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/* @fn      mcps_capture_front
+ * @brief   the oldest record, to be sent and then popped by the flushing task
+ * @return  NULL if there is none or it is being filled
+ * */
+const struct mcps_capture_rec_s *mcps_capture_front(void)
+{
+    uint32_t t = capture.tail;
+
+    if (__atomic_load_n(&capture.slot[t & (MCPS_CAPTURE_LEN - 1)].ready, __ATOMIC_ACQUIRE) != t + 1)
+    {
+        return NULL;
+    }
+    return &capture.slot[t & (MCPS_CAPTURE_LEN - 1)].rec;
+}
+
+void mcps_capture_pop(void)
+{
+    capture.stats.sent++;
+    __atomic_store_n(&capture.tail, capture.tail + 1, __ATOMIC_RELEASE);
+}
+
+const struct mcps_capture_stats_s *mcps_capture_get_stats(void)
+{
+    return &capture.stats;
+}
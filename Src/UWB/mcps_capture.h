@@ -0,0 +1,114 @@
+/**
+ * @file      mcps_capture.h
+ *
+ * @brief     Capture of the frames transmitted and received by the MCPS, for offline analysis
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef MCPS_CAPTURE_H_
+#define MCPS_CAPTURE_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* tx_frame() and the RX callback copy every frame to a record of the ring, from the task and the
+ * interrupt alike, without lock; the flushing task sends the records over the report link.
+ * The cost of a capture is bounded by the copy of MCPS_CAPTURE_DATA_MAX bytes: a longer frame is cut,
+ * a frame captured while all the records are pending is dropped, both are counted.
+ */
+
+/* records pending, must be a power of 2 */
+#define MCPS_CAPTURE_LEN (8)
+
+/* bytes kept of a frame, the FCS excluded */
+#define MCPS_CAPTURE_DATA_MAX (125)
+
+#define MCPS_CAPTURE_FLAG_TX      0x01 /**< transmitted, else received */
+#define MCPS_CAPTURE_FLAG_DELAYED 0x02 /**< TX at the date of the timestamp, else at once */
+#define MCPS_CAPTURE_FLAG_ND      0x04 /**< no data, SP3 */
+#define MCPS_CAPTURE_FLAG_CUT     0x08 /**< longer than MCPS_CAPTURE_DATA_MAX */
+
+#define MCPS_CAPTURE_STS_UNKNOWN  0xFF
+
+struct mcps_capture_rec_s
+{
+    uint64_t rctu;      /**< RMARKER, received or scheduled, in RCTU of the MAC timebase */
+    uint32_t cycles;    /**< hal_cycles_get() at the capture */
+    uint16_t len;       /**< length of the frame, the FCS excluded */
+    int16_t cfo_100ppm; /**< clock offset of the sender, 0.01 ppm, 0 for TX */
+    uint8_t sts_mode;   /**< STS packet configuration, MCPS_CAPTURE_STS_UNKNOWN if not known */
+    uint8_t flags;      /**< MCPS_CAPTURE_FLAG_xx */
+    uint8_t data[MCPS_CAPTURE_DATA_MAX];
+};
+
+struct mcps_capture_stats_s
+{
+    uint32_t captured;  /**< frames copied to the ring */
+    uint32_t dropped;   /**< frames without a record free */
+    uint32_t cut;       /**< frames longer than MCPS_CAPTURE_DATA_MAX */
+    uint32_t sent;      /**< records sent by the flushing task */
+    uint32_t cycles;    /**< time of the captures, total */
+    uint32_t max_cycles;/**< time of the longest capture */
+};
+
+void mcps_capture_enable(bool on);
+bool mcps_capture_is_enabled(void);
+void mcps_capture_frame(uint8_t flags, uint64_t rctu, int16_t cfo_100ppm, uint8_t sts_mode,
+                        const uint8_t *data, unsigned int len);
+const struct mcps_capture_rec_s *mcps_capture_front(void);
+void mcps_capture_pop(void);
+const struct mcps_capture_stats_s *mcps_capture_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCPS_CAPTURE_H_ */
@@ -0,0 +1,182 @@
+/**
+ * @file      mcps_event.c
+ *
+ * @brief     Ordered queue of the events of the DW3000 IRQ and of the MAC timer to the MCPS task
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+
+#include "mcps_event.h"
+
+/* The events are posted from the interrupts of the chip and of the timer, which may preempt each other:
+ * the queue is locked by masking the interrupts up to the kernel's level, which is valid in a task too.
+ * A model of the callbacks running on a host gives its own lock.
+ */
+#ifndef MCPS_EVT_LOCK
+#include <FreeRTOS.h>
+#define MCPS_EVT_LOCK()     UBaseType_t lock_mask = portSET_INTERRUPT_MASK_FROM_ISR()
+#define MCPS_EVT_UNLOCK()   portCLEAR_INTERRUPT_MASK_FROM_ISR(lock_mask)
+#endif
+
+#define MCPS_EVT_MASK (MCPS_EVT_QUEUE_LEN - 1)
+
+#if (MCPS_EVT_QUEUE_LEN & MCPS_EVT_MASK)
+#error "MCPS_EVT_QUEUE_LEN must be a power of 2"
+#endif
+
+static struct
+{
+    struct mcps_evt_s evt[MCPS_EVT_QUEUE_LEN];
+    uint16_t head; /**< written by the callbacks only */
+    uint16_t tail; /**< written by the task only */
+    struct mcps_evt_stats_s stats;
+} mcps_evt;
+
+/* @fn      mcps_evt_reset
+ * @brief   empties the queue and clears the counters,
+ *          to be called when no callback can post
+ * */
+void mcps_evt_reset(void)
+{
+    memset(&mcps_evt, 0, sizeof(mcps_evt));
+}
+
+/* @fn      mcps_evt_post
+ * @brief   ISR layer: queues an event behind the ones pending
+ * @return  false if the queue was full and the event is lost
+ * */
+bool mcps_evt_post(uint8_t type, uint32_t status, void *data)
+{
+    bool ret = false;
+    uint16_t used;
+
+    MCPS_EVT_LOCK();
+
+    used = (uint16_t)(mcps_evt.head - mcps_evt.tail);
+
+    if (used < MCPS_EVT_QUEUE_LEN)
+    {
+        struct mcps_evt_s *e = &mcps_evt.evt[mcps_evt.head & MCPS_EVT_MASK];
+
+        e->type = type;
+        e->status = status;
+        e->data = data;
+        mcps_evt.head++;
+
+        mcps_evt.stats.posted[type]++;
+        if (used + 1 > mcps_evt.stats.peak)
+        {
+            mcps_evt.stats.peak = used + 1;
+        }
+        ret = true;
+    }
+    else
+    {
+        mcps_evt.stats.lost++;
+    }
+
+    MCPS_EVT_UNLOCK();
+
+    return ret;
+}
+
+/* @fn      mcps_evt_get
+ * @brief   task layer: takes the oldest event pending
+ * @param   first: true for the first call after a wakeup, false for the following ones
+ * @return  false if no event is pending
+ * */
+bool mcps_evt_get(struct mcps_evt_s *evt, bool first)
+{
+    bool ret = false;
+
+    MCPS_EVT_LOCK();
+
+    if (mcps_evt.head != mcps_evt.tail)
+    {
+        *evt = mcps_evt.evt[mcps_evt.tail & MCPS_EVT_MASK];
+        mcps_evt.tail++;
+
+        mcps_evt.stats.handled[evt->type]++;
+        if (first)
+        {
+            mcps_evt.stats.wakeups++;
+        }
+        else
+        {
+            mcps_evt.stats.coalesced++;
+        }
+        ret = true;
+    }
+
+    MCPS_EVT_UNLOCK();
+
+    return ret;
+}
+
+/* @fn      mcps_evt_rx_time
+ * @brief   task layer: accounts the time taken to handle a frame received
+ * */
+void mcps_evt_rx_time(bool diag, uint32_t us)
+{
+    struct mcps_evt_time_s *t = &mcps_evt.stats.rx_time[diag ? 1 : 0];
+
+    t->frames++;
+    t->total_us += us;
+    if (us > t->max_us)
+    {
+        t->max_us = us;
+    }
+}
+
+const struct mcps_evt_stats_s *mcps_evt_get_stats(void)
+{
+    return &mcps_evt.stats;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file      mcps_event.h
+ *
+ * @brief     Ordered queue of the events of the DW3000 IRQ and of the MAC timer to the MCPS task
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef MCPS_EVENT_H_
+#define MCPS_EVENT_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The interrupt callbacks post the events, the MCPS task gets them in the order they were posted,
+ * all the events pending are handled in one wakeup of the task.
+ *
+ * An event posted when the queue is full is lost and counted as such.
+ * An event got in the same wakeup as a previous one is counted as coalesced:
+ * a single signal has announced several events.
+ */
+
+/* must be a power of 2 */
+#define MCPS_EVT_QUEUE_LEN (8)
+
+typedef enum
+{
+    MCPS_EVT_TX_DONE,
+    MCPS_EVT_RX_TIMEOUT,
+    MCPS_EVT_RX_ERROR,
+    MCPS_EVT_RX,
+    MCPS_EVT_TIMER_EXPIRED,
+    MCPS_EVT_MAX
+} mcps_evt_e;
+
+struct mcps_evt_s
+{
+    uint8_t type;        /**< mcps_evt_e */
+    uint8_t reserved[3];
+    uint32_t status;     /**< status of the chip given to the callback, 0 for the timer */
+    void *data;          /**< event's payload, NULL if none: the descriptor of the RX ring of a frame received */
+};
+
+struct mcps_evt_time_s
+{
+    uint32_t frames;   /**< frames handled */
+    uint32_t max_us;   /**< longest handling */
+    uint64_t total_us;
+};
+
+struct mcps_evt_stats_s
+{
+    uint32_t posted[MCPS_EVT_MAX];  /**< events queued, by type */
+    uint32_t handled[MCPS_EVT_MAX]; /**< events got by the task, by type */
+    uint32_t lost;                  /**< events dropped on a full queue */
+    uint32_t coalesced;             /**< events got in the wakeup of a previous one */
+    uint32_t wakeups;               /**< wakeups of the task which found events */
+    uint16_t peak;                  /**< maximum number of events pending */
+    struct mcps_evt_time_s rx_time[2]; /**< handling of the frames received, diagnostics off and on */
+};
+
+void mcps_evt_reset(void);
+bool mcps_evt_post(uint8_t type, uint32_t status, void *data);
+bool mcps_evt_get(struct mcps_evt_s *evt, bool first);
+void mcps_evt_rx_time(bool diag, uint32_t us);
+const struct mcps_evt_stats_s *mcps_evt_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCPS_EVENT_H_ */
@@ -0,0 +1,181 @@
+/**
+ * @file      mcps_rx_ring.c
+ *
+ * @brief     Ring of the frames received by the DW3000 IRQ for the MCPS task
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+
+#include "mcps_rx_ring.h"
+
+#define MCPS_RX_RING_MASK (MCPS_RX_RING_LEN - 1)
+
+#if (MCPS_RX_RING_LEN & MCPS_RX_RING_MASK)
+#error "MCPS_RX_RING_LEN must be a power of 2"
+#endif
+
+/* the payload is rounded up to keep every descriptor word-aligned */
+#define MCPS_RX_SLOT_SIZE ((MCPS_RX_FRAME_MAX + 3) & ~3)
+
+struct mcps_rx_slot_s
+{
+    dwt_mcps_rx_t rx;
+    uint8_t data[MCPS_RX_SLOT_SIZE];
+} __attribute__((aligned(4)));
+
+/* Single producer, the RX callback, and single consumer, the MCPS task:
+ * each index is written by one side only, the other side reads it with acquire semantics.
+ */
+static struct
+{
+    struct mcps_rx_slot_s slot[MCPS_RX_RING_LEN];
+    uint16_t head; /**< next descriptor to fill, producer */
+    uint16_t tail; /**< oldest descriptor in use, consumer */
+    struct mcps_rx_ring_stats_s stats;
+} mcps_rx;
+
+/* @fn      mcps_rx_ring_reset
+ * @brief   releases all the descriptors and clears the counters,
+ *          to be called when the RX callback cannot run
+ * */
+void mcps_rx_ring_reset(void)
+{
+    mcps_rx.head = 0;
+    mcps_rx.tail = 0;
+    memset(&mcps_rx.stats, 0, sizeof(mcps_rx.stats));
+}
+
+/* @fn      mcps_rx_ring_reserve
+ * @brief   ISR layer: gives the descriptor to fill for a new frame,
+ *          its data points to the payload and its len is the number of bytes to read
+ * @param   datalength: length of the frame received
+ * @param   frame_max: maximum length of a frame in the current PHR mode
+ * @return  NULL on overrun
+ * */
+dwt_mcps_rx_t *mcps_rx_ring_reserve(unsigned int datalength, unsigned int frame_max)
+{
+    uint16_t head = mcps_rx.head;
+    uint16_t tail = __atomic_load_n(&mcps_rx.tail, __ATOMIC_ACQUIRE);
+    struct mcps_rx_slot_s *slot;
+
+    if ((uint16_t)(head - tail) >= MCPS_RX_RING_LEN)
+    {
+        mcps_rx.stats.overruns++;
+        return NULL;
+    }
+
+    if (frame_max > MCPS_RX_FRAME_MAX)
+    {
+        frame_max = MCPS_RX_FRAME_MAX;
+    }
+
+    if (datalength > frame_max)
+    {
+        datalength = frame_max;
+        mcps_rx.stats.truncated++;
+    }
+
+    slot = &mcps_rx.slot[head & MCPS_RX_RING_MASK];
+    slot->rx.data = slot->data;
+    slot->rx.len = datalength;
+    slot->rx.flags = 0;
+
+    return &slot->rx;
+}
+
+/* @fn      mcps_rx_ring_commit
+ * @brief   ISR layer: passes the descriptor given by mcps_rx_ring_reserve() to the task
+ * */
+void mcps_rx_ring_commit(void)
+{
+    uint16_t head = mcps_rx.head + 1;
+    uint16_t used = (uint16_t)(head - __atomic_load_n(&mcps_rx.tail, __ATOMIC_ACQUIRE));
+
+    mcps_rx.stats.received++;
+    if (used > mcps_rx.stats.peak)
+    {
+        mcps_rx.stats.peak = used;
+    }
+
+    __atomic_store_n(&mcps_rx.head, head, __ATOMIC_RELEASE);
+}
+
+/* @fn      mcps_rx_ring_cancel
+ * @brief   ISR layer: drops the descriptor given by mcps_rx_ring_reserve() instead of committing it,
+ *          the task could not be told of the frame: it is counted as an overrun
+ * */
+void mcps_rx_ring_cancel(void)
+{
+    mcps_rx.stats.overruns++;
+}
+
+/* @fn      mcps_rx_ring_pop
+ * @brief   task layer: releases the descriptor of a frame, once handled, to the RX callback.
+ *          The descriptors are released in order: rx is the oldest one in use.
+ * */
+void mcps_rx_ring_pop(const dwt_mcps_rx_t *rx)
+{
+    uint16_t head = __atomic_load_n(&mcps_rx.head, __ATOMIC_ACQUIRE);
+
+    for (uint16_t tail = mcps_rx.tail; tail != head; tail++)
+    {
+        if (&mcps_rx.slot[tail & MCPS_RX_RING_MASK].rx == rx)
+        {
+            __atomic_store_n(&mcps_rx.tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+            break;
+        }
+    }
+}
+
+const struct mcps_rx_ring_stats_s *mcps_rx_ring_get_stats(void)
+{
+    return &mcps_rx.stats;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file      mcps_rx_ring.h
+ *
+ * @brief     Ring of the frames received by the DW3000 IRQ for the MCPS task
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#ifndef MCPS_RX_RING_H_
+#define MCPS_RX_RING_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The RX callback fills the descriptor at the producer index, posts it with the RX event and commits it,
+ * rx_get_frame() reads the descriptor of the event and the MCPS task pops it once the frame is handled.
+ * A frame received when all the descriptors are in use, or whose event cannot be posted,
+ * is an overrun: it is dropped and counted.
+ * A frame longer than a descriptor, or than the PHR mode allows, is truncated and counted.
+ */
+
+/* number of descriptors, must be a power of 2 */
+#ifndef MCPS_RX_RING_LEN
+#define MCPS_RX_RING_LEN (4)
+#endif
+
+#define MCPS_RX_STD_FRAME_MAX (127)  /* standard PHR, FCS included */
+#define MCPS_RX_EXT_FRAME_MAX (1023) /* extended PHR, FCS included */
+
+/* payload of a descriptor: define it to MCPS_RX_EXT_FRAME_MAX to receive extended frames whole */
+#ifndef MCPS_RX_FRAME_MAX
+#define MCPS_RX_FRAME_MAX MCPS_RX_STD_FRAME_MAX
+#endif
+
+struct dwt_mcps_rx_s
+{
+    uint64_t timeStamp; /* Full TimeStamp */
+    uint32_t rtcTimeStamp;
+    uint32_t flags;
+    uint8_t *data;
+    unsigned int len;
+    int16_t cfo;
+};
+typedef struct dwt_mcps_rx_s dwt_mcps_rx_t;
+
+struct mcps_rx_ring_stats_s
+{
+    uint32_t received;  /**< frames committed */
+    uint32_t overruns;  /**< frames dropped, no descriptor free */
+    uint32_t truncated; /**< frames cut to the descriptor's or the PHR mode's maximum */
+    uint16_t peak;      /**< maximum number of descriptors in use */
+};
+
+void mcps_rx_ring_reset(void);
+dwt_mcps_rx_t *mcps_rx_ring_reserve(unsigned int datalength, unsigned int frame_max);
+void mcps_rx_ring_commit(void);
+void mcps_rx_ring_cancel(void);
+void mcps_rx_ring_pop(const dwt_mcps_rx_t *rx);
+const struct mcps_rx_ring_stats_s *mcps_rx_ring_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCPS_RX_RING_H_ */
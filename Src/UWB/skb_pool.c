@@ -0,0 +1,155 @@
+/**
+ * @file      skb_pool.c
+ *
+ * @brief     Pool of the socket buffers of the frames received and of the frames transmitted after a deep sleep
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <string.h>
+
+#include "skb_pool.h"
+
+#if (SKB_POOL_LEN > 32)
+#error "SKB_POOL_LEN exceeds the free mask"
+#endif
+
+#define SKB_POOL_ALL ((SKB_POOL_LEN == 32) ? (0xFFFFFFFFUL) : ((1UL << SKB_POOL_LEN) - 1))
+
+struct skb_pool_entry_s
+{
+    struct sk_buff skb;
+    uint8_t data[SKB_POOL_DATA_SIZE];
+};
+
+static struct
+{
+    struct skb_pool_entry_s entry[SKB_POOL_LEN];
+    uint32_t free_mask; /**< a bit set per entry free */
+    struct skb_pool_stats_s stats;
+} skb_pool = {.free_mask = SKB_POOL_ALL};
+
+/* @fn      skb_pool_reset_stats
+ * @brief   clears the counters, the entries in use stay so: the MAC may still release some
+ * */
+void skb_pool_reset_stats(void)
+{
+    skb_pool.stats.allocs = 0;
+    skb_pool.stats.exhausted = 0;
+    skb_pool.stats.peak = skb_pool.stats.in_use;
+}
+
+/* @fn      skb_pool_alloc
+ * @brief   takes a socket buffer, its head points to the entry's payload, its data is empty
+ * @param   len: bytes of payload needed, 0 when the buffer points to data of its own
+ * @return  NULL if no entry is free or len exceeds SKB_POOL_DATA_SIZE
+ * */
+struct sk_buff *skb_pool_alloc(unsigned int len)
+{
+    uint32_t mask = __atomic_load_n(&skb_pool.free_mask, __ATOMIC_RELAXED);
+    uint32_t bit;
+    uint16_t used, peak;
+
+    do
+    {
+        if (mask == 0 || len > SKB_POOL_DATA_SIZE)
+        {
+            __atomic_fetch_add(&skb_pool.stats.exhausted, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        bit = mask & (~mask + 1);
+    } while (!__atomic_compare_exchange_n(&skb_pool.free_mask, &mask, mask & ~bit, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    struct skb_pool_entry_s *e = &skb_pool.entry[__builtin_ctz(bit)];
+
+    memset(&e->skb, 0, sizeof(e->skb));
+    e->skb.head = e->data;
+    e->skb.data = e->data;
+    e->skb.end = e->data + SKB_POOL_DATA_SIZE;
+
+    __atomic_fetch_add(&skb_pool.stats.allocs, 1, __ATOMIC_RELAXED);
+    used = __atomic_add_fetch(&skb_pool.stats.in_use, 1, __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&skb_pool.stats.peak, __ATOMIC_RELAXED);
+    while (used > peak && !__atomic_compare_exchange_n(&skb_pool.stats.peak, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+
+    return &e->skb;
+}
+
+/* @fn      skb_pool_free
+ * @brief   gives a socket buffer back to the pool, a pointer to an entry's payload is ignored:
+ *          the payload goes back with its buffer
+ * @return  false if ptr does not belong to the pool
+ * */
+bool skb_pool_free(void *ptr)
+{
+    uintptr_t offset = (uintptr_t)ptr - (uintptr_t)skb_pool.entry;
+    uint32_t idx;
+
+    if (offset >= sizeof(skb_pool.entry))
+    {
+        return false;
+    }
+
+    idx = offset / sizeof(struct skb_pool_entry_s);
+
+    if (ptr == &skb_pool.entry[idx].skb)
+    {
+        __atomic_fetch_sub(&skb_pool.stats.in_use, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_or(&skb_pool.free_mask, 1UL << idx, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+const struct skb_pool_stats_s *skb_pool_get_stats(void)
+{
+    return &skb_pool.stats;
+}
@@ -52,6 +52,7 @@
 #include "create_report_task.h"
 #include "uwbmac/uwbmac.h"
 #include "uwbmac/uwbmac_report.h"
+#include "usb_uart_tx.h"
 
 
 osMailQDef(report_mail, CONFIG_UWBMAC_REPORT_QUEUE_LEN, struct report_data);
@@ -66,6 +67,9 @@ static void report_task(const void *arg)
 
     reportTask.Exit = 0;
 
+    /* the reports are printed from this task: give it its own part of the report buffer */
+    port_tx_register(TX_PRODUCER_REPORT);
+
     while (reportTask.Exit == 0)
     {
         /* Wait for report events */
@@ -59,20 +59,27 @@
 #include "HAL_error.h"
 #include "flushTask.h"
 #include "defaultTask.h"
+#include "HAL_cycles.h"
+#include "boot_time.h"
 
 int main(void)
 {
+    hal_cycles_init();
+    boot_time_start();
     BoardInit();
     AppConfigInit();
+    boot_time_mark(BOOT_CONFIG);
     EventManagerInit();
     board_interface_init();
     if (uwb_init())
     {
         error_handler(1, _ERR_DEVID);
     }
+    boot_time_mark(BOOT_UWB);
     DefaultTaskInit();
     FlushTaskInit();
     ControlTaskInit();
+    boot_time_mark(BOOT_KERNEL);
     /* Start scheduler */
     osKernelStart();
 
@@ -0,0 +1,105 @@
+/**
+ * @file      fuzz_cmd.c
+ *
+ * @brief     Fuzzer of the command input: usb_uart_rx_feed() and command_parser(), machine_rx() and its frames
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "cmd.h"
+#include "cmd_machine.h"
+#include "usb_uart_rx.h"
+#include "usb_uart_tx.h"
+
+#define FUZZ_MAX_LEN 2048
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* The first byte selects the path: bit 7 the machine mode, bits 0-1 the interface of the text parser */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static uint8_t out[RX_FEED_OUT_SIZE(FUZZ_MAX_LEN)];
+    static uint8_t in[FUZZ_MAX_LEN];
+    static bool init;
+    usb_data_e res;
+
+    if (!init)
+    {
+        host_init();
+        port_tx_register(TX_PRODUCER_CTRL);
+        port_tx_set_sink(true); /**< no flush task: the replies are formatted, then dropped */
+        init = true;
+    }
+    if (size < 1)
+    {
+        return 0;
+    }
+
+    uint8_t sel = data[0];
+    uint16_t len = (uint16_t)((size - 1 < FUZZ_MAX_LEN) ? (size - 1) : (FUZZ_MAX_LEN));
+
+    memcpy(in, &data[1], len); /**< the parsers may write the buffer they are given */
+
+    if (sel & 0x80)
+    {
+        uint16_t offset = 0;
+
+        res = machine_rx(in, len, &offset, UINT16_MAX);
+        machine_mode_process(res);
+    }
+    else
+    {
+        res = usb_uart_rx_feed((port_itf_e)(sel & 0x03), in, len, out);
+        command_parser(res, (char *)out);
+    }
+    reset_report_buf();
+    host_tx_clear();
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file      fuzz_json.c
+ *
+ * @brief     Differential fuzzer of json_tok against cJSON, on the commands of command_execute()
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "cJSON.h"
+#include "json_tok.h"
+#include "cmd.h"
+
+#define FUZZ_TOKENS  32 /**< CMD_JSON_TOKENS of cmd.c */
+#define NAME_MAX_LEN 20
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* the name of the command as command_execute() takes it: 1 found, 0 not a command, < 0 not parsed */
+static int tok_name(const char *js, int len, char *name)
+{
+    json_tok_t tokens[FUZZ_TOKENS];
+    int n = json_tok_parse(js, len, tokens, FUZZ_TOKENS);
+
+    if (n < 0)
+    {
+        return n;
+    }
+
+    int nm = json_tok_find(js, tokens, n, 0, CMD_NAME);
+    int params = json_tok_find(js, tokens, n, 0, CMD_PARAMS);
+
+    if (nm > 0 && tokens[nm].type == JSON_TOK_STRING && params > 0)
+    {
+        json_tok_copy(js, &tokens[nm], name, NAME_MAX_LEN);
+        return 1;
+    }
+    return 0;
+}
+
+/* the same with cJSON, as the firmware did before json_tok */
+static int cjson_name(const char *js, char *name)
+{
+    cJSON *root = cJSON_ParseWithOpts(js, NULL, 1);
+    int ret = 0;
+
+    if (!root)
+    {
+        return -1;
+    }
+    if (cJSON_IsObject(root))
+    {
+        cJSON *nm = cJSON_GetObjectItemCaseSensitive(root, CMD_NAME);
+        cJSON *params = cJSON_GetObjectItemCaseSensitive(root, CMD_PARAMS);
+
+        if (cJSON_IsString(nm) && params)
+        {
+            snprintf(name, NAME_MAX_LEN, "%s", nm->valuestring);
+            ret = 1;
+        }
+    }
+    cJSON_Delete(root);
+    return ret;
+}
+
+/* json_tok is the stricter: what it accepts cJSON does, with the same command name.
+ * json_tok_copy() keeps the escapes of a string, cJSON decodes them: such names are not compared */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static char js[4096 + 1];
+    char a[NAME_MAX_LEN], b[NAME_MAX_LEN];
+    int len = (size < sizeof(js) - 1) ? ((int)size) : ((int)sizeof(js) - 1);
+
+    memcpy(js, data, len);
+    js[len] = 0;
+    len = (int)strlen(js); /**< cJSON stops at the terminator */
+
+    int x = tok_name(js, len, a);
+
+    if (x < 0)
+    {
+        return 0;
+    }
+
+    int y = cjson_name(js, b);
+
+    CHECK(y >= 0);
+    CHECK(x == y);
+    if (x == 1 && !memchr(js, '\\', len))
+    {
+        CHECK(strcmp(a, b) == 0);
+    }
+    return 0;
+}
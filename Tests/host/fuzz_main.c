@@ -0,0 +1,136 @@
+/**
+ * @file      fuzz_main.c
+ *
+ * @brief     Driver of the fuzzers without libFuzzer: the seed files, then mutations of them
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+
+#define FUZZ_INPUT_MAX      4096
+#define FUZZ_MUTATIONS      20000 /**< per seed */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static uint32_t fuzz_rand(void)
+{
+    static uint32_t x = 2463534242u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* overwrites, inserts or deletes a few bytes, then may cut the end */
+static size_t fuzz_mutate(uint8_t *buf, size_t len)
+{
+    for (int k = fuzz_rand() % 4; k >= 0; k--)
+    {
+        size_t pos = (len) ? (fuzz_rand() % len) : (0);
+
+        switch (fuzz_rand() % 3)
+        {
+        case 0:
+            if (len)
+            {
+                buf[pos] = (uint8_t)fuzz_rand();
+            }
+            break;
+        case 1:
+            if (len < FUZZ_INPUT_MAX)
+            {
+                memmove(&buf[pos + 1], &buf[pos], len - pos);
+                buf[pos] = (uint8_t)fuzz_rand();
+                len++;
+            }
+            break;
+        default:
+            if (len)
+            {
+                memmove(&buf[pos], &buf[pos + 1], len - pos - 1);
+                len--;
+            }
+            break;
+        }
+    }
+    if (len && (fuzz_rand() % 8) == 0)
+    {
+        len = fuzz_rand() % len;
+    }
+    return len;
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t seed[FUZZ_INPUT_MAX], buf[FUZZ_INPUT_MAX];
+    int runs = 0;
+
+    for (int a = 1; a < argc; a++)
+    {
+        FILE *f = fopen(argv[a], "rb");
+        size_t n;
+
+        CHECK(f != NULL);
+        n = fread(seed, 1, sizeof(seed), f);
+        fclose(f);
+
+        LLVMFuzzerTestOneInput(seed, n);
+        runs++;
+        for (int m = 0; m < FUZZ_MUTATIONS; m++)
+        {
+            memcpy(buf, seed, n);
+            LLVMFuzzerTestOneInput(buf, fuzz_mutate(buf, n));
+            runs++;
+        }
+    }
+    printf("%s: %d inputs ok\n", argv[0], runs);
+    return 0;
+}
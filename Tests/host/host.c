@@ -0,0 +1,294 @@
+/**
+ * @file      host.c
+ *
+ * @brief     Host runtime of the tests: the stand-ins of the board, FreeRTOS and the linker script
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "nrf.h"
+#include "cmsis_os.h"
+#include "app.h"
+#include "deca_error.h"
+#include "HAL_timer.h"
+#include "HAL_usb.h"
+#include "InterfUsb.h"
+#include "controlTask.h"
+#include "circular_buffers.h"
+
+/* Every stand-in is weak: a test replaces the ones it drives */
+#define HOST_WEAK __attribute__((weak))
+
+/* Cycle counter */
+static DWT_Type host_dwt;
+static CoreDebug_Type host_core_debug;
+DWT_Type *DWT = &host_dwt;
+CoreDebug_Type *CoreDebug = &host_core_debug;
+
+void host_cycles_add(uint32_t us)
+{
+    host_dwt.CYCCNT += us * 64;
+}
+
+uint64_t host_time_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/* Critical section: one lock for all the threads of a test, as the target masks everything */
+static pthread_mutex_t host_critical;
+static pthread_once_t host_critical_once = PTHREAD_ONCE_INIT;
+
+static void host_critical_init(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&host_critical, &attr);
+}
+
+void host_enter_critical(void)
+{
+    pthread_once(&host_critical_once, host_critical_init);
+    pthread_mutex_lock(&host_critical);
+}
+
+void host_exit_critical(void)
+{
+    pthread_mutex_unlock(&host_critical);
+}
+
+/* Threads: the id is unique per host thread */
+static __thread char host_thread_id;
+
+HOST_WEAK osThreadId osThreadGetId(void)
+{
+    return (osThreadId)&host_thread_id;
+}
+
+HOST_WEAK osStatus osDelay(uint32_t millisec)
+{
+    if (millisec)
+    {
+        usleep(millisec * 1000);
+    }
+    else
+    {
+        sched_yield();
+    }
+    return osOK;
+}
+
+/* Allocations: malloc() is wrapped by the link, see the Makefile */
+static volatile uint32_t host_malloc_calls;
+void *__real_malloc(size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    __atomic_add_fetch(&host_malloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+uint32_t host_allocs(void)
+{
+    return host_malloc_calls;
+}
+
+/* Output: the UART and the USB write to one capture */
+static uint8_t host_tx[1 << 22];
+static int host_tx_len;
+
+static void host_tx_add(const uint8_t *data, int len)
+{
+    if (len > (int)sizeof(host_tx) - host_tx_len)
+    {
+        len = (int)sizeof(host_tx) - host_tx_len;
+    }
+    memcpy(&host_tx[host_tx_len], data, len);
+    host_tx_len += len;
+}
+
+const uint8_t *host_tx_data(int *len)
+{
+    *len = host_tx_len;
+    return host_tx;
+}
+
+void host_tx_clear(void)
+{
+    host_tx_len = 0;
+}
+
+HOST_WEAK int deca_uart_transmit(uint8_t *ptr, uint16_t sz)
+{
+    host_tx_add(ptr, sz);
+    return 1;
+}
+
+static bool host_usb_transmit(uint8_t *tx_buffer, int size)
+{
+    host_tx_add(tx_buffer, size);
+    return true;
+}
+
+static bool host_usb_tx_empty(void)
+{
+    return true;
+}
+
+HOST_WEAK const struct hal_usb_s Usb = {
+    .transmit = host_usb_transmit,
+    .isTxBufferEmpty = host_usb_tx_empty,
+};
+
+HOST_WEAK enum usbState UsbGetState(void)
+{
+    return USB_CONFIGURED;
+}
+
+/* Timer of milliseconds */
+static uint32_t host_ms(void)
+{
+    return (uint32_t)(host_time_ns() / 1000000ULL);
+}
+
+static void host_timer_start(volatile uint32_t *p_timestamp)
+{
+    *p_timestamp = host_ms();
+}
+
+static bool host_timer_check(uint32_t timestamp, uint32_t time)
+{
+    return (host_ms() - timestamp) >= time;
+}
+
+HOST_WEAK const struct hal_timer_s Timer = {
+    .start = host_timer_start,
+    .check = host_timer_check,
+};
+
+HOST_WEAK uint32_t osKernelSysTick(void)
+{
+    return host_ms();
+}
+
+/* Tasks signalled by the modules */
+HOST_WEAK void NotifyControlTask(void)
+{
+}
+
+HOST_WEAK void NotifyFlushTask(void)
+{
+}
+
+HOST_WEAK void error_handler(int block, error_e err)
+{
+}
+
+/* The driver of the reports of fira_report.c is down: no diagnostics */
+HOST_WEAK int fira_uwb_add_diag(char *str, int len, int max_len)
+{
+    return len;
+}
+
+HOST_WEAK void fira_uwb_get_diag(int16_t *rssi_dbm_x10, uint8_t *nlos_pct)
+{
+    *rssi_dbm_x10 = 0;
+    *nlos_pct = 0;
+}
+
+/* Receive buffers of the interfaces */
+uint8_t local_buff[COM_RX_BUF_SIZE];
+static data_circ_buf_t host_uart_rx, host_usb_rx;
+data_circ_buf_t *uartRx = &host_uart_rx;
+data_circ_buf_t *usbRx = &host_usb_rx;
+
+/* Application: idle, the commands are read by the parser of usb_uart_rx.c */
+extern usb_data_e waitForCommand(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size) HOST_WEAK;
+
+static app_definition_t host_idle_app = {
+    .app_name = "STOP",
+    .app_mode = mIDLE,
+};
+
+HOST_WEAK const app_definition_t *AppGet(void)
+{
+    host_idle_app.on_rx = waitForCommand;
+    return &host_idle_app;
+}
+
+/* The defaults of the comm config, the .config_entry section is not walked on the host, and the CRC16 tables */
+extern void set_uartEn(bool set) HOST_WEAK;
+extern void set_flush_threshold(uint16_t threshold) HOST_WEAK;
+extern void set_flush_deadline_ms(uint16_t deadline_ms) HOST_WEAK;
+extern void init_crc16(void) HOST_WEAK;
+
+void host_init(void)
+{
+    if (set_uartEn)
+    {
+        set_uartEn(false);
+        set_flush_threshold(64);
+        set_flush_deadline_ms(2);
+    }
+    if (init_crc16)
+    {
+        init_crc16();
+    }
+    host_tx_clear();
+    host_malloc_calls = 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file      host_cmd_tables.c
+ *
+ * @brief     Host stand-in of the command sections: the names and groups of the firmware's tables, with handlers of the same reply shapes
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmd.h"
+#include "cmd_fn.h"
+#include "cmd_resp.h"
+#include "json_tok.h"
+#include "usb_uart_tx.h"
+
+const char CMD_FN_RET_OK[] = "ok\r\n";
+const char CMD_FN_RET_KO[] = "KO\r\n";
+const char COMMENT_VERSION[] = {"Reports the version"};
+
+command_t *known_commands;
+
+/* a command without a reply of its own */
+static REG_FN(f_host_ok)
+{
+    return CMD_FN_RET_OK;
+}
+
+/* a "COMMAND value" setter, as UART or TXPOWER */
+static REG_FN(f_host_value)
+{
+    char cmd[12];
+    int v;
+
+    return (sscanf(text, "%10s %d", cmd, &v) == 2 || params) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/* a text reply of a few lines, as STAT */
+static REG_FN(f_host_text)
+{
+    cmd_resp_t resp;
+
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_printf(&resp, "MODE: %s\r\nLAST ERR CODE: %d\r\nMAX MSG LEN: %d\r\n", "STOP", 0, 0);
+    }
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/* a JSON reply of counters, as TXSTAT */
+static REG_FN(f_host_json)
+{
+    cmd_resp_t resp;
+
+    if (cmd_resp_json(&resp, 3 * MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, "{\"TXSTAT\":{");
+        for (int i = 0; i < TX_PRODUCER_MAX; i++)
+        {
+            const struct tx_stats_s *stats = get_tx_stats(i);
+
+            cmd_resp_printf(&resp, "%s\"%d\":{\"Enq\":%lu,\"Drop\":%lu,\"Bytes\":%lu,\"Peak\":%u}",
+                            (i > 0) ? (",") : (""), i,
+                            (unsigned long)stats->enqueued, (unsigned long)stats->dropped,
+                            (unsigned long)stats->bytes, stats->peak);
+        }
+        cmd_resp_str(&resp, "}}");
+    }
+    return (cmd_resp_end(&resp) == _NO_ERR) ? (CMD_FN_RET_OK) : (NULL);
+}
+
+/* a JSON command, as {"CMD_NAME":"UWBCFG","CMD_PARAMS":{...}}: every member of the parameters is read */
+static REG_FN(f_host_params)
+{
+    char value[16];
+    int i;
+
+    if (!params)
+    {
+        return f_host_value(text, pbss, val, params);
+    }
+    if (params->tokens[params->params].type != JSON_TOK_OBJECT)
+    {
+        return NULL;
+    }
+    for (i = params->params + 1; i < params->n_tokens; i++)
+    {
+        json_tok_copy(params->js, &params->tokens[i], value, sizeof(value));
+    }
+    return CMD_FN_RET_OK;
+}
+
+static const char COMMENT_HOST[] = {"host stand-in"};
+
+/* the MACHINE of cmd_machine.c: its .known_commands_anytime entry is not walked on the host */
+extern REG_FN(f_machine);
+
+/* The order of the sections in flash_placement.xml: anytime, app, idle, service, then the apps */
+static const command_t host_commands[] = {
+    /* .known_commands_anytime */
+    {NULL, mCmdGrp0 | mANY, NULL, "Anytime commands -----"},
+    {"HELP", mCmdGrp1 | mANY, f_host_text, COMMENT_HOST},
+    {"STAT", mCmdGrp1 | mANY, f_host_text, COMMENT_HOST},
+    {"THREAD", mCmdGrp1 | mANY, f_host_text, COMMENT_HOST},
+    {"STOP", mCmdGrp1 | mANY, f_host_ok, COMMENT_HOST},
+    {"TXSTAT", mCmdGrp1 | mANY, f_host_json, COMMENT_HOST},
+    {"MCPS", mCmdGrp1 | mANY, f_host_json, COMMENT_HOST},
+    {"MACHINE", mCmdGrp1 | mANY, f_machine, COMMENT_HOST},
+    {"VERSION", mCmdGrp1 | mANY, f_host_text, COMMENT_HOST},
+    {"DECAID", mCmdGrp1 | mANY, f_host_text, COMMENT_HOST},
+    {"RCAP", mCmdGrp1 | mANY, f_host_value, COMMENT_HOST},
+    /* .known_commands_app */
+    {NULL, mCmdGrp0 | mIDLE, NULL, "Application selection "},
+    {"RESPF", mCmdGrp2 | mIDLE, f_host_ok, COMMENT_HOST},
+    {"INITF", mCmdGrp2 | mIDLE, f_host_ok, COMMENT_HOST},
+    /* .known_app_subcommands of the FiRa apps */
+    {NULL, mCmdGrp0 | mIDLE, NULL, "FiRa options --------"},
+    {"PAVRG", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"AGGR", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"RREPLAY", mCmdGrp1 | mIDLE, f_host_json, COMMENT_HOST},
+    /* .known_commands_ilde */
+    {NULL, mCmdGrp0 | mIDLE, NULL, "IDLE time commands --"},
+    {"UWBCFG", mCmdGrp1 | mIDLE, f_host_params, COMMENT_HOST},
+    {"TXPOWER", mCmdGrp1 | mIDLE, f_host_params, COMMENT_HOST},
+    {"ANTENNA", mCmdGrp1 | mIDLE, f_host_params, COMMENT_HOST},
+    {"XTALTRIM", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"UART", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"TXFLUSH", mCmdGrp1 | mIDLE, f_host_params, COMMENT_HOST},
+    {"RFORMAT", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"RDELTA", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"DIAG", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"SAVE", mCmdGrp1 | mIDLE, f_host_ok, COMMENT_HOST},
+    {"RESTORE", mCmdGrp1 | mIDLE, f_host_ok, COMMENT_HOST},
+    {"STSKEYIV", mCmdGrp1 | mIDLE, f_host_params, COMMENT_HOST},
+    /* .known_commands_service */
+    {NULL, mCmdGrp0 | mIDLE, NULL, "Service commands -----"},
+    {"ANTTXA", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"ANTRXA", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"ANTRXB", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+    {"PDOAOFF", mCmdGrp1 | mIDLE, f_host_value, COMMENT_HOST},
+};
+
+#define HOST_CMD_APP         11
+#define HOST_CMD_IDLE        18
+#define HOST_CMD_SERVICE     31
+#define HOST_CMD_N           (int)(sizeof(host_commands) / sizeof(host_commands[0]))
+
+extern usb_data_e waitForCommand(uint8_t *pBuf, uint16_t len, uint16_t *read_offset, uint16_t cyclic_size);
+
+/* .known_apps, of helpers_app_fira[] */
+static const app_definition_t host_apps[] = {
+    {"INITF", mAPP | APP_SAVEABLE, NULL, NULL, waitForCommand, command_parser, NULL},
+    {"RESPF", mAPP | APP_SAVEABLE, NULL, NULL, waitForCommand, command_parser, NULL},
+};
+
+const struct command_s *const host_commands_start = &host_commands[0];
+const struct command_s *const host_commands_app_start = &host_commands[HOST_CMD_APP];
+const struct command_s *const host_commands_idle_start = &host_commands[HOST_CMD_IDLE];
+const struct command_s *const host_commands_service_start = &host_commands[HOST_CMD_SERVICE];
+const struct command_s *const host_commands_end = &host_commands[HOST_CMD_N];
+const struct app_definition_s *const host_apps_start = &host_apps[0];
+const struct app_definition_s *const host_apps_end = &host_apps[sizeof(host_apps) / sizeof(host_apps[0])];
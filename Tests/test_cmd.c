@@ -0,0 +1,390 @@
+/**
+ * @file      test_cmd.c
+ *
+ * @brief     Host test of the command path: recorded CLI sessions through usb_uart_rx(), command_parser() and the reporter, and its benchmark
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "app.h"
+#include "cmd.h"
+#include "cmd_fn.h"
+#include "usb_uart_rx.h"
+#include "usb_uart_tx.h"
+#include "circular_buffers.h"
+#include "controlTask.h"
+#include "json_tok.h"
+
+#define SESSION_MAX      4096
+#define BENCH_SESSIONS   20000
+#define BENCH_LOOKUPS    200000
+
+extern data_circ_buf_t *usbRx;
+
+static char session[SESSION_MAX];
+static int session_len;
+static int session_cmds;
+
+/* the application running, idle unless a test selects the FiRa initiator */
+static app_definition_t test_app = {"STOP", mIDLE, NULL, NULL, waitForCommand, command_parser, NULL};
+
+const app_definition_t *AppGet(void)
+{
+    return &test_app;
+}
+
+static void session_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+
+    CHECK(f != NULL);
+    session_len = (int)fread(session, 1, sizeof(session) - 1, f);
+    fclose(f);
+    session[session_len] = 0;
+    for (int i = 0; i < session_len; i++)
+    {
+        session_cmds += (session[i] == '\n');
+    }
+}
+
+static int count(const char *what)
+{
+    int len, n = 0;
+    const uint8_t *out = host_tx_data(&len);
+    int wlen = (int)strlen(what);
+
+    for (int i = 0; i + wlen <= len; i++)
+    {
+        n += (memcmp(&out[i], what, wlen) == 0);
+    }
+    return n;
+}
+
+/* the flush task's loop, the time jumps to each deadline */
+static void tx_drain(void)
+{
+    int due;
+
+    while ((due = flush_report_due_ms()) >= 0)
+    {
+        host_cycles_add(due * 1000);
+        flush_report_buf();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+}
+
+/* the control task's loop: the bytes arrive on the USB by packets of 64 */
+static void session_type(const char *text, int len)
+{
+    for (int i = 0; i < len; i += 64)
+    {
+        int n = (len - i < 64) ? (len - i) : (64);
+
+        for (int k = 0; k < n; k++)
+        {
+            usbRx->buf[usbRx->head] = text[i + k];
+            usbRx->head = (usbRx->head + 1) & (sizeof(usbRx->buf) - 1);
+        }
+        usb_data_e res = usb_uart_rx();
+        AppGet()->command_parser(res, (char *)local_buff);
+        tx_drain();
+    }
+}
+
+static void test_session_idle(void)
+{
+    host_tx_clear();
+    session_type(session, session_len);
+
+    /* every command is echoed and replies, the replies of STAT and TXSTAT are whole */
+    CHECK(count("ok\r\n") == session_cmds);
+    CHECK(count("error") == 0);
+    CHECK(count("MODE: STOP\r\n") == 5); /**< the text replies: STAT, HELP, THREAD, VERSION, DECAID */
+    CHECK(count("JS") == 2);              /**< the JSON replies: TXSTAT, MCPS */
+    CHECK(count("{\"TXSTAT\":{") == 2);
+    CHECK(count("uwbcfg 5") == 1);
+}
+
+static void test_session_app(void)
+{
+    const char *text = "stat\nuwbcfg 5\nnocmd 1\n{\"CMD_NAME\":\"TXFLUSH\",\"CMD_PARAMS\":{\"THRESHOLD\":0}}\nstop\n";
+
+    test_app.app_mode = mAPP;
+    host_tx_clear();
+    session_type(text, (int)strlen(text));
+    test_app.app_mode = mIDLE;
+
+    /* the idle commands are refused, an unknown one is ignored */
+    CHECK(count("ok\r\n") == 2);
+    CHECK(count("error  incompatible mode\r\n") == 2);
+}
+
+static void test_feed_split(void)
+{
+    static uint8_t out[RX_FEED_OUT_SIZE(SESSION_MAX)];
+    int total = 0;
+
+    /* a command split anywhere between two reads completes on the second one */
+    for (int cut = 1; cut < session_len; cut += 7)
+    {
+        int n = 0;
+
+        if (usb_uart_rx_feed(PORT_ITF_DEFAULT, (uint8_t *)session, cut, out) == COMMAND_READY)
+        {
+            for (char *p = (char *)out; *p; p++)
+            {
+                n += (*p == '\n');
+            }
+        }
+        if (usb_uart_rx_feed(PORT_ITF_DEFAULT, (uint8_t *)&session[cut], session_len - cut, out) == COMMAND_READY)
+        {
+            for (char *p = (char *)out; *p; p++)
+            {
+                n += (*p == '\n');
+            }
+        }
+        CHECK(n == session_cmds);
+        tx_drain(); /**< the echo */
+        total++;
+    }
+    CHECK(total > 0);
+    host_tx_clear();
+}
+
+/* commands per second and allocations per command, the transport drops the replies.
+ * In an app the idle commands are refused, which takes the error path of the parser */
+static void bench(mode_e mode)
+{
+    static uint8_t out[RX_FEED_OUT_SIZE(SESSION_MAX)];
+    uint32_t allocs = host_allocs();
+    uint32_t cmd_allocs = cmd_get_allocs();
+    uint64_t t0 = host_time_ns();
+
+    test_app.app_mode = mode;
+    port_tx_set_sink(true);
+    for (int i = 0; i < BENCH_SESSIONS; i++)
+    {
+        usb_data_e res = usb_uart_rx_feed(PORT_ITF_DEFAULT, (uint8_t *)session, session_len, out);
+
+        command_parser(res, (char *)out);
+        reset_report_buf();
+    }
+    port_tx_set_sink(false);
+    test_app.app_mode = mIDLE;
+
+    uint64_t ns = host_time_ns() - t0;
+    double cmds = (double)BENCH_SESSIONS * session_cmds;
+
+    printf("cmd %s: %.0f commands, %.0f commands/s, %.2f ns/command, %.3f malloc/command (%.3f by the parser)\n",
+           (mode == mIDLE) ? ("idle") : ("app"), cmds, cmds * 1e9 / ns, ns / cmds,
+           (host_allocs() - allocs) / cmds, (cmd_get_allocs() - cmd_allocs) / cmds);
+}
+
+/* @fn      scan_lookup
+ * @brief   the dispatch of command_parser() before the index: a strcmp() of every known command
+ *          and a walk of the sub-commands of the running application, kept to compare with command_lookup()
+ * */
+static const command_t *scan_lookup(const char *cmd, bool *allowed)
+{
+    const command_t *known_commands;
+
+    *allowed = false;
+    for (known_commands = KNOWN_COMMANDS_START; known_commands < KNOWN_COMMANDS_END; known_commands++)
+    {
+        if (known_commands->name && strcmp(cmd, known_commands->name) == 0)
+        {
+            uint32_t mode = known_commands->mode & mMASK;
+
+            switch (mode)
+            {
+            case mANY:
+                *allowed = true;
+                break;
+            case mIDLE:
+                *allowed = (mode == AppGet()->app_mode);
+                break;
+            default:
+                break;
+            }
+            const struct command_s *sub_cmd = AppGet()->sub_command;
+            if (sub_cmd != NULL)
+            {
+                while (!*allowed)
+                {
+                    if (sub_cmd == known_commands)
+                    {
+                        *allowed = true;
+                        break;
+                    }
+                    if (sub_cmd->mode & APP_LAST_SUB_CMD)
+                    {
+                        break;
+                    }
+                    sub_cmd++;
+                }
+            }
+            return known_commands;
+        }
+    }
+    return NULL;
+}
+
+/* @brief   the parse of command_execute(): the name of a text or a JSON command, uppercased by command_parser()
+ * */
+static void parse_name(const char *line, char *cmd, int *val)
+{
+    static json_tok_t tokens[32];
+
+    cmd[0] = 0;
+    if (*line == '{')
+    {
+        int n = json_tok_parse(line, (int)strlen(line), tokens, 32);
+        int name = (n > 0) ? (json_tok_find(line, tokens, n, 0, CMD_NAME)) : (-1);
+
+        if (name > 0 && json_tok_find(line, tokens, n, 0, CMD_PARAMS) > 0)
+        {
+            char name_str[20];
+
+            json_tok_copy(line, &tokens[name], name_str, sizeof(name_str));
+            sscanf(name_str, "%9s", cmd);
+        }
+    }
+    else
+    {
+        sscanf(line, "%9s %d", cmd, val);
+    }
+}
+
+/* parse and dispatch of each command of the session, without running it: the scan against the index.
+ * Both find the same command with the same permission, the parse is the same for both */
+static void bench_dispatch(mode_e mode)
+{
+    static char text[SESSION_MAX];
+    double total_parse = 0, total_scan = 0, total_index = 0;
+    int n = 0;
+
+    test_app.app_mode = mode;
+    memcpy(text, session, session_len + 1);
+    for (char *p = text; *p; p++)
+    {
+        *p = (char)toupper(*p);
+    }
+
+    for (char *save, *line = strtok_r(text, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save))
+    {
+        char cmd[20];
+        int val = 0;
+        bool allowed_scan = false, allowed_index = false;
+        const command_t *found = NULL;
+        uint64_t t0, t1, t2, t3;
+
+        parse_name(line, cmd, &val);
+        CHECK(scan_lookup(cmd, &allowed_scan) == command_lookup(cmd, &allowed_index));
+        CHECK(allowed_scan == allowed_index);
+
+        t0 = host_time_ns();
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+        {
+            parse_name(line, cmd, &val);
+            __asm__ volatile("" : : "r"(cmd) : "memory");
+        }
+        t1 = host_time_ns();
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+        {
+            parse_name(line, cmd, &val);
+            found = scan_lookup(cmd, &allowed_scan);
+            __asm__ volatile("" : : "r"(found) : "memory");
+        }
+        t2 = host_time_ns();
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+        {
+            parse_name(line, cmd, &val);
+            found = command_lookup(cmd, &allowed_index);
+            __asm__ volatile("" : : "r"(found) : "memory");
+        }
+        t3 = host_time_ns();
+
+        double parse = (double)(t1 - t0) / BENCH_LOOKUPS;
+        double scan = (double)(t2 - t1) / BENCH_LOOKUPS, index = (double)(t3 - t2) / BENCH_LOOKUPS;
+
+        printf("cmd dispatch %s %-9s: parse %6.1f ns, parse+scan %6.1f ns, parse+index %6.1f ns\n",
+               (mode == mIDLE) ? ("idle") : ("app"), cmd, parse, scan, index);
+        total_parse += parse;
+        total_scan += scan;
+        total_index += index;
+        n++;
+    }
+    test_app.app_mode = mIDLE;
+
+    printf("cmd dispatch %s: %d commands, parse %.1f ns/command, parse+scan %.1f ns/command, parse+index %.1f ns/command\n",
+           (mode == mIDLE) ? ("idle") : ("app"), n, total_parse / n, total_scan / n, total_index / n);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+    port_tx_register(TX_PRODUCER_CTRL);
+    session_load("sessions/cli_idle.txt");
+
+    test_session_idle();
+    test_session_app();
+    test_feed_split();
+    printf("test_cmd: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench(mIDLE);
+        bench(mAPP);
+        bench_dispatch(mIDLE);
+        bench_dispatch(mAPP);
+    }
+    return 0;
+}
@@ -0,0 +1,364 @@
+/**
+ * @file      test_cmd_resp.c
+ *
+ * @brief     Host test of the response builder, and its time against the snprintf replies it replaced
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "cmd_fn.h"
+#include "cmd_resp.h"
+#include "reporter.h"
+#include "usb_uart_tx.h"
+
+#define CMD_COLUMN_WIDTH 10 /**< as cmd_fn.c */
+#define CMD_COLUMN_MAX   4
+#define HELP_PASSES      4  /**< the help of the firmware has about four times the commands of the host's table */
+#define LIST_MAX         2048
+#define LIST_DEVICES     32
+#define BENCH_ROUNDS     20000
+
+static const char project_name[] = "DWM3001CDK - DW3_QM33_SDK - FiRa";
+
+static void tx_drain(void)
+{
+    int due;
+
+    while ((due = flush_report_due_ms()) >= 0)
+    {
+        host_cycles_add(due * 1000);
+        flush_report_buf();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+}
+
+/* the reply as sent, then the capture is cleared */
+static int tx_take(char *out, int max)
+{
+    int len;
+    const uint8_t *data;
+
+    tx_drain();
+    data = host_tx_data(&len);
+    CHECK(len < max);
+    memcpy(out, data, len);
+    host_tx_clear();
+    return len;
+}
+
+/* "help": print_help_line() and f_help_std() before the builder, one message per line */
+static int help_line_old(char *str, int cnt, const command_t *c)
+{
+    if ((c->mode & mCmdGrpMASK) == mCmdGrp0)
+    {
+        if (cnt > 0)
+        {
+            sprintf(&str[cnt], "\r\n");
+            port_tx_msg((uint8_t *)str, strlen(str));
+            cnt = 0;
+        }
+        sprintf(str, "---- %s---\r\n", c->cmnt);
+        port_tx_msg((uint8_t *)str, strlen(str));
+    }
+    else if (c->name)
+    {
+        sprintf(&str[cnt], "%-10s", c->name);
+        cnt += CMD_COLUMN_WIDTH;
+        if (cnt >= CMD_COLUMN_WIDTH * CMD_COLUMN_MAX)
+        {
+            sprintf(&str[cnt], "\r\n");
+            port_tx_msg((uint8_t *)str, strlen(str));
+            cnt = 0;
+        }
+    }
+    return cnt;
+}
+
+static void help_old(void)
+{
+    char *str = malloc(MAX_STR_SIZE);
+    int cnt = 0;
+
+    CHECK(str);
+    reporter_instance.print((char *)project_name, strlen(project_name));
+    reporter_instance.print("\r\n", 2);
+    for (int pass = 0; pass < HELP_PASSES; pass++)
+    {
+        for (const command_t *c = KNOWN_COMMANDS_START; c < KNOWN_COMMANDS_END; c++)
+        {
+            cnt = help_line_old(str, cnt, c);
+        }
+    }
+    sprintf(&str[cnt], "\r\n");
+    port_tx_msg((uint8_t *)str, strlen(str));
+    free(str);
+}
+
+/* the same with the builder, as print_help_line() and f_help_std() now */
+static int help_line(cmd_resp_t *resp, int cnt, const command_t *c)
+{
+    if ((c->mode & mCmdGrpMASK) == mCmdGrp0)
+    {
+        if (cnt > 0)
+        {
+            cmd_resp_str(resp, "\r\n");
+            cnt = 0;
+        }
+        cmd_resp_str(resp, "---- ");
+        cmd_resp_str(resp, c->cmnt);
+        cmd_resp_str(resp, "---\r\n");
+    }
+    else if (c->name)
+    {
+        cmd_resp_printf(resp, "%-10s", c->name);
+        cnt += CMD_COLUMN_WIDTH;
+        if (cnt >= CMD_COLUMN_WIDTH * CMD_COLUMN_MAX)
+        {
+            cmd_resp_str(resp, "\r\n");
+            cnt = 0;
+        }
+    }
+    return cnt;
+}
+
+static error_e help_new(void)
+{
+    cmd_resp_t resp;
+    int cnt = 0;
+
+    if (cmd_resp_text(&resp, MAX_STR_SIZE))
+    {
+        cmd_resp_str(&resp, project_name);
+        cmd_resp_str(&resp, "\r\n");
+        for (int pass = 0; pass < HELP_PASSES; pass++)
+        {
+            for (const command_t *c = KNOWN_COMMANDS_START; c < KNOWN_COMMANDS_END; c++)
+            {
+                cnt = help_line(&resp, cnt, c);
+            }
+        }
+        cmd_resp_str(&resp, "\r\n");
+    }
+    return cmd_resp_end(&resp);
+}
+
+/* A list of devices, as a "getdlist": a JSON reply built with sprintf() at strlen(), then its header patched */
+static void list_old(int n)
+{
+    char *str = malloc(LIST_MAX);
+    int hlen;
+
+    CHECK(str);
+    hlen = sprintf(str, "JS%04X", 0x5A5A);
+    sprintf(&str[strlen(str)], "{\"DList\":[");
+    for (int i = 0; i < n; i++)
+    {
+        sprintf(&str[strlen(str)], "{\"Addr\":\"0x%04X\",\"Ok\":%u,\"Err\":%u},", 0x1000 + i, 1000u * i, (unsigned)i);
+    }
+    if (str[strlen(str) - 1] == ',')
+    {
+        str[strlen(str) - 1] = '\0';
+    }
+    sprintf(&str[strlen(str)], "]}");
+    sprintf(&str[2], "%04X", (unsigned)(strlen(str) - hlen)); /**< erases the first '{' */
+    str[hlen] = '{';
+    sprintf(&str[strlen(str)], "\r\n");
+    reporter_instance.print(str, strlen(str));
+    free(str);
+}
+
+static error_e list_new(int n, int max)
+{
+    cmd_resp_t resp;
+
+    if (cmd_resp_json(&resp, max))
+    {
+        cmd_resp_str(&resp, "{\"DList\":[");
+        for (int i = 0; i < n; i++)
+        {
+            cmd_resp_str(&resp, (i > 0) ? (",{\"Addr\":\"0x") : ("{\"Addr\":\"0x"));
+            cmd_resp_hex(&resp, 0x1000 + i, 4, true);
+            cmd_resp_str(&resp, "\",\"Ok\":");
+            cmd_resp_uint(&resp, 1000u * i);
+            cmd_resp_str(&resp, ",\"Err\":");
+            cmd_resp_uint(&resp, i);
+            cmd_resp_char(&resp, '}');
+        }
+        cmd_resp_str(&resp, "]}");
+    }
+    return cmd_resp_end(&resp);
+}
+
+static void test_help(void)
+{
+    static char old[8192], new[8192];
+    int old_len, new_len;
+
+    help_old();
+    old_len = tx_take(old, sizeof(old));
+    CHECK(help_new() == _NO_ERR);
+    new_len = tx_take(new, sizeof(new));
+    CHECK(new_len > 4 * MAX_STR_SIZE); /**< sent by several chunks */
+    CHECK(old_len == new_len && memcmp(old, new, old_len) == 0);
+}
+
+static void test_list(void)
+{
+    static char old[LIST_MAX + 16], new[LIST_MAX + 16];
+    int old_len, new_len;
+
+    for (int n = 0; n <= LIST_DEVICES; n++)
+    {
+        list_old(n);
+        old_len = tx_take(old, sizeof(old));
+        CHECK(list_new(n, LIST_MAX) == _NO_ERR);
+        new_len = tx_take(new, sizeof(new));
+        CHECK(old_len == new_len && memcmp(old, new, old_len) == 0);
+    }
+
+    /* the length of the header is the length of the object */
+    unsigned hdr;
+
+    CHECK(sscanf(new, "JS%4X", &hdr) == 1 && (int)hdr == new_len - 6 - 2);
+
+    /* a JSON reply which does not fit is dropped whole */
+    CHECK(list_new(LIST_DEVICES, 64) == _ERR);
+    CHECK(tx_take(new, sizeof(new)) == 0);
+}
+
+/* a text longer than a chunk is split over several */
+static void test_chunks(void)
+{
+    static char text[3000], out[4096];
+    cmd_resp_t resp;
+
+    for (int i = 0; i < (int)sizeof(text) - 1; i++)
+    {
+        text[i] = 'a' + i % 26;
+    }
+    text[sizeof(text) - 1] = '\0';
+
+    CHECK(cmd_resp_text(&resp, 100));
+    cmd_resp_str(&resp, text);
+    cmd_resp_int(&resp, -123456);
+    cmd_resp_printf(&resp, "%-90s|", "x");
+    CHECK(cmd_resp_end(&resp) == _NO_ERR);
+
+    int len = tx_take(out, sizeof(out));
+
+    CHECK(len == (int)strlen(text) + 7 + 91);
+    CHECK(memcmp(out, text, strlen(text)) == 0);
+    CHECK(memcmp(&out[strlen(text)], "-123456x", 8) == 0 && out[len - 1] == '|');
+}
+
+/* the time and the allocations of a reply, the reporter's output being dropped at the commit */
+static void bench(void)
+{
+    uint64_t t0;
+    uint32_t allocs;
+
+    port_tx_set_sink(true);
+
+    allocs = host_allocs();
+    t0 = host_time_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        help_old();
+    }
+    printf("cmd_resp: help, %d bytes: snprintf %.0f ns %.1f malloc", 4 * MAX_STR_SIZE,
+           (double)(host_time_ns() - t0) / BENCH_ROUNDS, (double)(host_allocs() - allocs) / BENCH_ROUNDS);
+
+    allocs = host_allocs();
+    t0 = host_time_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        help_new();
+    }
+    printf(", builder %.0f ns %.1f malloc\n", (double)(host_time_ns() - t0) / BENCH_ROUNDS,
+           (double)(host_allocs() - allocs) / BENCH_ROUNDS);
+
+    allocs = host_allocs();
+    t0 = host_time_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        list_old(LIST_DEVICES);
+    }
+    printf("cmd_resp: list of %d devices: snprintf %.0f ns %.1f malloc", LIST_DEVICES,
+           (double)(host_time_ns() - t0) / BENCH_ROUNDS, (double)(host_allocs() - allocs) / BENCH_ROUNDS);
+
+    allocs = host_allocs();
+    t0 = host_time_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        list_new(LIST_DEVICES, LIST_MAX);
+    }
+    printf(", builder %.0f ns %.1f malloc\n", (double)(host_time_ns() - t0) / BENCH_ROUNDS,
+           (double)(host_allocs() - allocs) / BENCH_ROUNDS);
+
+    port_tx_set_sink(false);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+    port_tx_register(TX_PRODUCER_CTRL); /**< the replies are built by the control task */
+
+    test_help();
+    test_list();
+    test_chunks();
+    printf("test_cmd_resp: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
@@ -0,0 +1,431 @@
+/**
+ * @file      test_dw3000_shadow.c
+ *
+ * @brief     Host test of the shadow of the radio settings: a register model of the DW3000, the settings it ends with written through the shadow and written always
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "dw3000.h"
+#include "dw3000_mcps_wrapper.h"
+#include "dw3000_shadow.h"
+#include "net/mac802154.h"
+
+#define STEPS 50000 /**< settings programmed in each pass of the random test */
+
+/* the registers of the model behind the settings of the shadow */
+struct regs_s
+{
+    uint8_t sts_mode;
+    uint8_t sts_len;
+    bool autoack;
+    bool ff_en;
+    uint16_t ff_mode;
+    uint16_t short_addr;
+    uint16_t pan_id;
+    uint64_t eui;
+};
+
+/* the registers after a reset or a deep sleep */
+static const struct regs_s regs_reset = {
+    .sts_mode = DWT_STS_MODE_OFF,
+    .sts_len = DWT_STS_LEN_64,
+    .short_addr = 0xFFFF,
+    .pan_id = 0xFFFF,
+};
+
+static struct
+{
+    struct regs_s regs;
+    uint32_t spi_writes;  /**< the ioctl and ack_enable which reached the device */
+    dwt_ioctl_e fail_fn;  /**< an ioctl of this kind fails, without reaching the device */
+    bool fail;
+} dev;
+
+static uint32_t shadow_calls;
+
+/* dw3000_wakeup_timer_start of the wrapper, defined in its header, calls the MCPS */
+void mcps802154_timer_expired(struct mcps802154_llhw *llhw)
+{
+}
+
+/* the shadow writes of the firmware, counted */
+bool __real_dw3000_shadow_write(dw3000_shadow_e reg, uint64_t value);
+
+bool __wrap_dw3000_shadow_write(dw3000_shadow_e reg, uint64_t value)
+{
+    shadow_calls++;
+    return __real_dw3000_shadow_write(reg, value);
+}
+
+static int model_ioctl(struct dwchip_s *dw, dwt_ioctl_e fn, int parm, void *ptr)
+{
+    if (dev.fail && fn == dev.fail_fn)
+    {
+        return -1;
+    }
+    dev.spi_writes++;
+
+    switch (fn)
+    {
+    case DWT_CONFIGURESTSMODE:
+        dev.regs.sts_mode = *(uint8_t *)ptr;
+        break;
+    case DWT_SET_STS_LEN:
+        dev.regs.sts_len = (uint8_t)*(dwt_sts_lengths_e *)ptr;
+        break;
+    case DWT_CFG_STS:
+        /* the STS configuration programs the STS mode of the configuration */
+        dev.regs.sts_mode = ((dwt_config_t *)ptr)->stsMode;
+        dev.regs.sts_len = ((dwt_config_t *)ptr)->stsLength;
+        break;
+    case DWT_CONFIGUREFRAMEFILTER:
+    {
+        struct dwt_configure_ff_s *ff = ptr;
+
+        /* the disabled filter clears its configuration, the auto-acknowledgement is left set but acknowledges nothing */
+        dev.regs.ff_en = (ff->enabletype == DWT_FF_ENABLE_802_15_4);
+        dev.regs.ff_mode = dev.regs.ff_en ? ff->filtermode : 0;
+        break;
+    }
+    case DWT_SETADDRESS16:
+        dev.regs.short_addr = *(uint16_t *)ptr;
+        break;
+    case DWT_SETEUI:
+        dev.regs.eui = *(uint64_t *)ptr;
+        break;
+    case DWT_SETPANID:
+        dev.regs.pan_id = *(uint16_t *)ptr;
+        break;
+    default:
+        CHECK(false);
+    }
+    return 0;
+}
+
+static void model_ack_enable(struct dwchip_s *dw, int enable)
+{
+    dev.spi_writes++;
+    dev.regs.autoack = (enable != 0);
+}
+
+static const struct dwt_mcps_ops_s model_mcps_ops = {
+    .ioctl = model_ioctl,
+    .mcps_compat.ack_enable = model_ack_enable,
+};
+
+static struct dwt_driver_s model_driver = {.dwt_mcps_ops = &model_mcps_ops};
+static dwt_config_t model_cfg;
+static rxtx_configure_t model_rxtx = {.pdwCfg = &model_cfg};
+static struct dwt_mcps_config_s model_config = {.rxtx_config = &model_rxtx};
+static struct dwchip_s model_dw = {.dwt_driver = &model_driver, .config = &model_config};
+
+/* configure_frame_filter, set_hw_addr_filt and set_promiscuous_mode of dw3000_mcps_mcu.c, on the dwchip_s */
+static int configure_frame_filter(struct dwchip_s *dw, uint16_t enabletype, uint16_t filtermode)
+{
+    struct dwt_configure_ff_s tmp = {enabletype, filtermode};
+    int ret = 0;
+
+    if (dw3000_shadow_write(DW3000_SHADOW_FRAME_FILTER, ((uint32_t)enabletype << 16) | filtermode))
+    {
+        ret = dw->dwt_driver->dwt_mcps_ops->ioctl(dw, DWT_CONFIGUREFRAMEFILTER, 0, (void *)&tmp);
+        dw3000_shadow_invalidate(DW3000_SHADOW_AUTOACK);
+        if (ret)
+        {
+            dw3000_shadow_invalidate(DW3000_SHADOW_FRAME_FILTER);
+        }
+    }
+    return ret;
+}
+
+static int set_hw_addr_filt(struct dwchip_s *dw, struct ieee802154_hw_addr_filt *filt, unsigned long changed)
+{
+    const struct dwt_mcps_ops_s *ops = dw->dwt_driver->dwt_mcps_ops;
+    int ret = 0;
+
+    if ((changed & IEEE802154_AFILT_SADDR_CHANGED) && dw3000_shadow_write(DW3000_SHADOW_SHORT_ADDR, filt->short_addr))
+    {
+        ret = ops->ioctl(dw, DWT_SETADDRESS16, 0, (void *)&filt->short_addr);
+    }
+    if (!ret && (changed & IEEE802154_AFILT_IEEEADDR_CHANGED) && dw3000_shadow_write(DW3000_SHADOW_EUI, filt->ieee_addr))
+    {
+        ret = ops->ioctl(dw, DWT_SETEUI, 0, (void *)&filt->ieee_addr);
+    }
+    if (!ret && (changed & IEEE802154_AFILT_PANID_CHANGED) && dw3000_shadow_write(DW3000_SHADOW_PAN_ID, filt->pan_id))
+    {
+        ret = ops->ioctl(dw, DWT_SETPANID, 0, (void *)&filt->pan_id);
+    }
+    if (!ret && (changed & IEEE802154_AFILT_PANC_CHANGED))
+    {
+        ret = configure_frame_filter(dw, 0, 0);
+    }
+    if (ret)
+    {
+        dw3000_shadow_invalidate_all();
+    }
+    return ret;
+}
+
+static int set_promiscuous_mode(struct dwchip_s *dw, bool on)
+{
+    rxtx_configure_t *p = dw->config->rxtx_config;
+
+    p->frameFilter = on ? DWT_FF_DISABLE : DWT_FF_ENABLE_802_15_4;
+    configure_frame_filter(dw, p->frameFilter, p->frameFilterMode);
+    return 0;
+}
+
+/* the deep sleep: the device wakes up with its defaults, the STS configured again by the wakeup */
+static void deep_sleep(struct dwchip_s *dw)
+{
+    dev.regs = regs_reset;
+    dev.regs.sts_mode = dw->config->rxtx_config->pdwCfg->stsMode;
+    dev.regs.sts_len = dw->config->rxtx_config->pdwCfg->stsLength;
+    dw3000_shadow_invalidate_all();
+}
+
+/* the device and the firmware as after the start of the MCPS */
+static void model_start(void)
+{
+    memset(&dev, 0, sizeof(dev));
+    dev.regs = regs_reset;
+    model_cfg.stsMode = DWT_STS_MODE_OFF;
+    model_cfg.stsLength = DWT_STS_LEN_64;
+    model_rxtx.frameFilter = DWT_FF_DISABLE;
+    model_rxtx.frameFilterMode = DWT_FF_DATA_EN | DWT_FF_ACK_EN;
+    dw3000_shadow_invalidate_all();
+    dw3000_shadow_reset_stats();
+    shadow_calls = 0;
+}
+
+static bool regs_equal(const struct regs_s *a, const struct regs_s *b)
+{
+    return a->sts_mode == b->sts_mode && a->sts_len == b->sts_len && a->autoack == b->autoack &&
+           a->ff_en == b->ff_en && a->ff_mode == b->ff_mode && a->short_addr == b->short_addr &&
+           a->pan_id == b->pan_id && a->eui == b->eui;
+}
+
+static uint32_t rnd(uint32_t *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 16;
+}
+
+/* the sequences which the shadow got wrong before it was keyed on the frame filter written */
+static void test_sequences(void)
+{
+    struct dwchip_s *dw = &model_dw;
+    struct ieee802154_hw_addr_filt filt = {.pan_coord = false};
+    uint32_t writes;
+
+    /* the filter of the address filter, the promiscuous mode left, the address filter again */
+    model_start();
+    CHECK(set_hw_addr_filt(dw, &filt, IEEE802154_AFILT_PANC_CHANGED) == 0);
+    CHECK(!dev.regs.ff_en);
+    set_promiscuous_mode(dw, false);
+    CHECK(dev.regs.ff_en && dev.regs.ff_mode == (DWT_FF_DATA_EN | DWT_FF_ACK_EN));
+    CHECK(set_hw_addr_filt(dw, &filt, IEEE802154_AFILT_PANC_CHANGED) == 0);
+    CHECK(!dev.regs.ff_en);
+
+    /* the auto-acknowledgement across the promiscuous mode: written again after the frame filter */
+    model_start();
+    set_promiscuous_mode(dw, false);
+    dw3000_enable_autoack(dw, false);
+    CHECK(dev.regs.autoack && dev.regs.ff_en);
+    set_promiscuous_mode(dw, true);
+    CHECK(!dev.regs.ff_en);
+    set_promiscuous_mode(dw, false);
+    writes = dev.spi_writes;
+    dw3000_enable_autoack(dw, false);
+    CHECK(dev.regs.autoack && dev.regs.ff_en && dev.spi_writes == writes + 1);
+    dw3000_enable_autoack(dw, false);
+    CHECK(dev.spi_writes == writes + 1);
+
+    /* the STS mode of the configuration programmed by a change of the STS length */
+    model_start();
+    CHECK(dw3000_set_sts(dw, DWT_STS_MODE_1) == 0);
+    CHECK(dw3000_set_sts_length(dw, DWT_STS_LEN_128) == 0);
+    CHECK(dev.regs.sts_mode == DWT_STS_MODE_OFF && dev.regs.sts_len == DWT_STS_LEN_128);
+    CHECK(dw3000_set_sts(dw, DWT_STS_MODE_1) == 0);
+    CHECK(dev.regs.sts_mode == DWT_STS_MODE_1);
+
+    /* a failed write, then the same value again */
+    model_start();
+    dev.fail = true;
+    dev.fail_fn = DWT_CONFIGURESTSMODE;
+    CHECK(dw3000_set_sts(dw, DWT_STS_MODE_ND) != 0);
+    dev.fail = false;
+    CHECK(dw3000_set_sts(dw, DWT_STS_MODE_ND) == 0);
+    CHECK(dev.regs.sts_mode == DWT_STS_MODE_ND);
+
+    /* the deep sleep */
+    CHECK(dw3000_set_sts(dw, DWT_STS_MODE_1) == 0);
+    deep_sleep(dw);
+    CHECK(dw3000_set_sts(dw, DWT_STS_MODE_1) == 0);
+    CHECK(dev.regs.sts_mode == DWT_STS_MODE_1);
+}
+
+/* one step of the random test: a setting programmed as per frame by the MCPS, sometimes with a failure of the device */
+static void random_step(struct dwchip_s *dw, uint32_t *seed)
+{
+    static const uint8_t sts_modes[] = {DWT_STS_MODE_OFF, DWT_STS_MODE_1, DWT_STS_MODE_ND};
+    static const dwt_sts_lengths_e sts_lens[] = {DWT_STS_LEN_64, DWT_STS_LEN_128};
+    uint32_t r = rnd(seed), op = r % 16;
+    struct ieee802154_hw_addr_filt filt = {
+        .short_addr = (uint16_t)(0x1000 + (r >> 4) % 2),
+        .pan_id = (uint16_t)(0xDECA + (r >> 5) % 2),
+        .ieee_addr = 0x0102030405060700ull + (r >> 6) % 2,
+    };
+    unsigned long changed = (r >> 7) & 0xF;
+
+    dev.fail = (rnd(seed) % 32) == 0;
+
+    if (op < 6)
+    {
+        dev.fail_fn = DWT_CONFIGURESTSMODE;
+        dw3000_set_sts(dw, sts_modes[(r >> 4) % 3]);
+    }
+    else if (op < 9)
+    {
+        dw3000_enable_autoack(dw, (r >> 4) % 8 == 0);
+    }
+    else if (op < 11)
+    {
+        dw3000_disable_autoack(dw, (r >> 4) % 8 == 0);
+    }
+    else if (op == 11)
+    {
+        dev.fail_fn = ((r >> 4) & 1) ? DWT_SET_STS_LEN : DWT_CFG_STS;
+        dw3000_set_sts_length(dw, sts_lens[(r >> 5) % 2]);
+    }
+    else if (op == 12)
+    {
+        /* a failure of the last write of the address filter, the writes before it alike in both passes */
+        dev.fail_fn = (changed & IEEE802154_AFILT_PANC_CHANGED)   ? DWT_CONFIGUREFRAMEFILTER
+                      : (changed & IEEE802154_AFILT_PANID_CHANGED) ? DWT_SETPANID
+                      : (changed & IEEE802154_AFILT_IEEEADDR_CHANGED) ? DWT_SETEUI
+                                                                        : DWT_SETADDRESS16;
+        set_hw_addr_filt(dw, &filt, changed);
+    }
+    else if (op == 13)
+    {
+        dev.fail_fn = DWT_CONFIGUREFRAMEFILTER;
+        set_promiscuous_mode(dw, (r >> 4) & 1);
+    }
+    else if (op == 14)
+    {
+        /* the application changes the frame filter for the next time it is programmed */
+        dw->config->rxtx_config->frameFilterMode = ((r >> 4) & 1) ? (DWT_FF_DATA_EN | DWT_FF_ACK_EN) : DWT_FF_DATA_EN;
+    }
+    else if ((r >> 4) % 16 == 0)
+    {
+        deep_sleep(dw);
+    }
+    dev.fail = false;
+}
+
+static struct regs_s trace[STEPS];
+
+/* the same steps written through the shadow and written always, the registers alike after each */
+static void test_random(void)
+{
+    struct dwchip_s *dw = &model_dw;
+    const struct dw3000_shadow_stats_s *stats = dw3000_shadow_get_stats();
+    uint32_t seed, always_writes, written = 0, elided = 0;
+
+    /* always: the shadow forgotten before each step */
+    model_start();
+    seed = 1;
+    for (int i = 0; i < STEPS; i++)
+    {
+        dw3000_shadow_invalidate_all();
+        random_step(dw, &seed);
+        trace[i] = dev.regs;
+    }
+    always_writes = dev.spi_writes;
+    for (int reg = 0; reg < DW3000_SHADOW_MAX; reg++)
+    {
+        CHECK(stats->elided[reg] == 0);
+    }
+
+    /* shadowed */
+    model_start();
+    seed = 1;
+    for (int i = 0; i < STEPS; i++)
+    {
+        random_step(dw, &seed);
+        if (!regs_equal(&dev.regs, &trace[i]))
+        {
+            fprintf(stderr, "dw3000_shadow: the registers differ at step %d\n", i);
+            exit(1);
+        }
+    }
+    for (int reg = 0; reg < DW3000_SHADOW_MAX; reg++)
+    {
+        written += stats->written[reg];
+        elided += stats->elided[reg];
+    }
+    CHECK(written + elided == shadow_calls);
+    CHECK(elided > 0 && dev.spi_writes < always_writes);
+
+    printf("dw3000_shadow: %d steps, SPI writes %u always, %u shadowed, %u elided\n",
+           STEPS, always_writes, dev.spi_writes, elided);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_sequences();
+    test_random();
+    printf("test_dw3000_shadow: ok\n");
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file      test_json.c
+ *
+ * @brief     Host test of json_tok, and its throughput against cJSON on the commands
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "cJSON.h"
+#include "json_tok.h"
+#include "cmd.h"
+
+#define TOKENS        32 /**< CMD_JSON_TOKENS of cmd.c */
+#define BENCH_ROUNDS  200000
+
+static const char *const commands[] = {
+    "{\"CMD_NAME\":\"UWBCFG\",\"CMD_PARAMS\":{\"CHAN\":9,\"PCODE\":10,\"PLEN\":64,\"PAC\":8}}",
+    "{\"CMD_NAME\":\"TXFLUSH\",\"CMD_PARAMS\":{\"THRESHOLD\":64,\"DEADLINE\":2}}",
+    "{\"CMD_NAME\":\"INITF\",\"CMD_PARAMS\":{\"A\":1,\"B\":[1,2,3],\"C\":\"x\"}}",
+    "{\"CMD_NAME\":\"STAT\",\"CMD_PARAMS\":null}",
+};
+
+#define N_COMMANDS (int)(sizeof(commands) / sizeof(commands[0]))
+
+static int parse(const char *js, json_tok_t *t)
+{
+    return json_tok_parse(js, (int)strlen(js), t, TOKENS);
+}
+
+static void test_tokens(void)
+{
+    json_tok_t t[TOKENS];
+    const char *js = commands[2];
+    char buf[16];
+    int n = parse(js, t);
+
+    /* object, CMD_NAME, "INITF", CMD_PARAMS, {A, 1, B, [1, 2, 3], C, "x"} */
+    CHECK(n == 14);
+    CHECK(t[0].type == JSON_TOK_OBJECT && t[0].size == 2 && t[0].parent == -1);
+
+    int nm = json_tok_find(js, t, n, 0, CMD_NAME);
+    int params = json_tok_find(js, t, n, 0, CMD_PARAMS);
+
+    CHECK(nm == 2 && t[nm].type == JSON_TOK_STRING);
+    CHECK(json_tok_copy(js, &t[nm], buf, sizeof(buf)) == 5 && strcmp(buf, "INITF") == 0);
+    CHECK(params == 4 && t[params].type == JSON_TOK_OBJECT && t[params].size == 3);
+
+    int b = json_tok_find(js, t, n, params, "B");
+
+    CHECK(b > 0 && t[b].type == JSON_TOK_ARRAY && t[b].size == 3);
+    CHECK(json_tok_find(js, t, n, params, "D") < 0);
+    CHECK(json_tok_find(js, t, n, 0, "A") < 0); /**< not a member of the root */
+
+    int c = json_tok_find(js, t, n, params, "C");
+
+    CHECK(json_tok_copy(js, &t[c], buf, 1) < 0 || buf[0] == 0); /**< no room for the value */
+}
+
+static void test_errors(void)
+{
+    json_tok_t t[TOKENS];
+
+    CHECK(parse("{\"a\":1", t) == JSON_TOK_ERROR_PART);
+    CHECK(parse("{\"a\":\"b", t) == JSON_TOK_ERROR_PART);
+    CHECK(parse("{\"a\" 1}", t) == JSON_TOK_ERROR_INVAL);
+    CHECK(parse("{\"a\":01}", t) == JSON_TOK_ERROR_INVAL);
+    CHECK(parse("{\"a\":1,}", t) == JSON_TOK_ERROR_INVAL);
+    CHECK(parse("{\"a\":1}}", t) == JSON_TOK_ERROR_INVAL);
+    CHECK(parse("{\"a\":tru}", t) == JSON_TOK_ERROR_INVAL);
+    CHECK(parse("[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32]", t) ==
+          JSON_TOK_ERROR_NOMEM);
+    CHECK(parse(" {} ", t) == 1);
+}
+
+/* the parse and the look up of the name and the parameters of a command, as command_execute() */
+static void bench(void)
+{
+    json_tok_t t[TOKENS];
+    volatile int sink = 0;
+    uint32_t allocs = host_allocs();
+    uint64_t t0 = host_time_ns();
+
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        const char *js = commands[r % N_COMMANDS];
+        int n = parse(js, t);
+
+        sink += json_tok_find(js, t, n, 0, CMD_NAME) + json_tok_find(js, t, n, 0, CMD_PARAMS);
+    }
+
+    uint64_t tok_ns = host_time_ns() - t0;
+    uint32_t tok_allocs = host_allocs() - allocs;
+
+    allocs = host_allocs();
+    t0 = host_time_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        cJSON *root = cJSON_Parse(commands[r % N_COMMANDS]);
+
+        sink += (cJSON_GetObjectItemCaseSensitive(root, CMD_NAME) != NULL) +
+                (cJSON_GetObjectItemCaseSensitive(root, CMD_PARAMS) != NULL);
+        cJSON_Delete(root);
+    }
+
+    uint64_t cjson_ns = host_time_ns() - t0;
+    uint32_t cjson_allocs = host_allocs() - allocs;
+
+    printf("json: json_tok %.0f ns/command %.1f malloc/command, cJSON %.0f ns/command %.1f malloc/command\n",
+           (double)tok_ns / BENCH_ROUNDS, (double)tok_allocs / BENCH_ROUNDS,
+           (double)cjson_ns / BENCH_ROUNDS, (double)cjson_allocs / BENCH_ROUNDS);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_tokens();
+    test_errors();
+    printf("test_json: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
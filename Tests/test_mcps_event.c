@@ -0,0 +1,309 @@
+/**
+ * @file      test_mcps_event.c
+ *
+ * @brief     Host test of the MCPS event queue: a model of the ISR callbacks and of the MCPS task, and the events lost by one signal per event
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "mcps_event.h"
+
+#define BURSTS        20000 /**< wakeups of the task in the model of the signals */
+#define STRESS_EVENTS 50000 /**< events of each callback of the threaded model */
+
+/* the payload of an event: the callback which posted it and its count */
+#define EVT_DATA(src, n)  ((void *)(uintptr_t)(((uintptr_t)(src) << 24) | (n)))
+#define EVT_SRC(data)     ((int)((uintptr_t)(data) >> 24))
+#define EVT_N(data)       ((uint32_t)((uintptr_t)(data) & 0xFFFFFF))
+
+/* the MCPS task before the queue: one bit per event type, the first bit set of the chain handled */
+static int signals_first(uint32_t signals)
+{
+    for (int type = 0; type < MCPS_EVT_MAX; type++)
+    {
+        if (signals & (1u << type))
+        {
+            return type;
+        }
+    }
+    return -1;
+}
+
+static uint32_t rnd(uint32_t *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 16;
+}
+
+static void test_order(void)
+{
+    const struct mcps_evt_stats_s *stats = mcps_evt_get_stats();
+    struct mcps_evt_s e;
+    int x, n = 0;
+    bool first = true;
+    uint8_t order[3];
+
+    mcps_evt_reset();
+    CHECK(!mcps_evt_get(&e, true));
+    CHECK(stats->wakeups == 0);
+
+    /* a TX done, a frame and the timer in one wakeup */
+    CHECK(mcps_evt_post(MCPS_EVT_TX_DONE, 1, NULL));
+    CHECK(mcps_evt_post(MCPS_EVT_RX, 2, &x));
+    CHECK(mcps_evt_post(MCPS_EVT_TIMER_EXPIRED, 0, NULL));
+    while (mcps_evt_get(&e, first))
+    {
+        first = false;
+        CHECK(n < 3);
+        order[n++] = e.type;
+        CHECK(e.type != MCPS_EVT_RX || (e.status == 2 && e.data == &x));
+    }
+    CHECK(n == 3);
+    CHECK(order[0] == MCPS_EVT_TX_DONE && order[1] == MCPS_EVT_RX && order[2] == MCPS_EVT_TIMER_EXPIRED);
+    CHECK(stats->wakeups == 1 && stats->coalesced == 2 && stats->peak == 3);
+    CHECK(stats->posted[MCPS_EVT_RX] == 1 && stats->handled[MCPS_EVT_RX] == 1 && stats->lost == 0);
+}
+
+static void test_full(void)
+{
+    const struct mcps_evt_stats_s *stats = mcps_evt_get_stats();
+    struct mcps_evt_s e;
+    int n = 0;
+
+    /* the events beyond the queue are lost and counted, the ones queued are kept in order */
+    mcps_evt_reset();
+    for (int i = 0; i < 3 * MCPS_EVT_QUEUE_LEN; i++)
+    {
+        CHECK(mcps_evt_post(MCPS_EVT_RX, i, NULL) == (i < MCPS_EVT_QUEUE_LEN));
+    }
+    CHECK(stats->lost == 2 * MCPS_EVT_QUEUE_LEN);
+    CHECK(stats->peak == MCPS_EVT_QUEUE_LEN);
+    while (mcps_evt_get(&e, n == 0))
+    {
+        CHECK(e.status == (uint32_t)n);
+        n++;
+    }
+    CHECK(n == MCPS_EVT_QUEUE_LEN);
+
+    /* the indexes wrap */
+    for (uint32_t i = 0; i < 70000; i++)
+    {
+        CHECK(mcps_evt_post(i % MCPS_EVT_MAX, i, NULL));
+        CHECK(mcps_evt_get(&e, true) && e.type == i % MCPS_EVT_MAX && e.status == i);
+    }
+}
+
+/* bursts of 1 to 3 events between two wakeups of the task, as in the tight slots of a ranging round */
+static void test_bursts(void)
+{
+    const struct mcps_evt_stats_s *stats = mcps_evt_get_stats();
+    uint32_t seed = 1, events = 0, old_handled = 0, new_handled = 0;
+
+    mcps_evt_reset();
+    for (int i = 0; i < BURSTS; i++)
+    {
+        uint32_t signals = 0;
+        int k = 1 + (int)(rnd(&seed) % 3);
+        struct mcps_evt_s e;
+
+        for (int j = 0; j < k; j++)
+        {
+            uint8_t type = (uint8_t)(rnd(&seed) % MCPS_EVT_MAX);
+
+            signals |= 1u << type;
+            CHECK(mcps_evt_post(type, events++, NULL));
+        }
+
+        /* osSignalWait() clears every bit: the chain handled one of them */
+        old_handled += (signals_first(signals) >= 0);
+
+        for (bool first = true; mcps_evt_get(&e, first); first = false)
+        {
+            CHECK(e.status == new_handled);
+            new_handled++;
+        }
+    }
+
+    CHECK(new_handled == events && stats->lost == 0);
+    CHECK(stats->wakeups == BURSTS && stats->coalesced == events - BURSTS);
+    printf("mcps_event: %u events in %d wakeups, one per signal: %u lost, queue: %u lost\n",
+           events, BURSTS, events - old_handled, stats->lost);
+}
+
+/* The threaded model: the chip's callbacks and the MAC timer post from two threads,
+ * the task is woken by a word of signals which its wait clears, as osSignalWait() */
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t signals;
+    int done;
+} sig = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static uint32_t sent[2], refused[2];
+
+static void sig_set(uint32_t bits)
+{
+    pthread_mutex_lock(&sig.lock);
+    sig.signals |= bits;
+    pthread_cond_signal(&sig.cond);
+    pthread_mutex_unlock(&sig.lock);
+}
+
+static void *isr_chip(void *arg)
+{
+    /* a TX done then the frame of the answer, or a timeout */
+    for (uint32_t n = 0; n < STRESS_EVENTS; n++)
+    {
+        uint8_t type = (n % 3 == 0) ? (MCPS_EVT_TX_DONE) : ((n % 3 == 1) ? (MCPS_EVT_RX) : (MCPS_EVT_RX_TIMEOUT));
+
+        refused[0] += !mcps_evt_post(type, 0, EVT_DATA(0, n));
+        __atomic_store_n(&sent[0], n + 1, __ATOMIC_RELEASE);
+        sig_set(1u << type);
+        if (n % 4 == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *isr_timer(void *arg)
+{
+    for (uint32_t n = 0; n < STRESS_EVENTS; n++)
+    {
+        refused[1] += !mcps_evt_post(MCPS_EVT_TIMER_EXPIRED, 0, EVT_DATA(1, n));
+        __atomic_store_n(&sent[1], n + 1, __ATOMIC_RELEASE);
+        sig_set(1u << MCPS_EVT_TIMER_EXPIRED);
+        if (n % 3 == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    const struct mcps_evt_stats_s *stats = mcps_evt_get_stats();
+    pthread_t chip, timer;
+    uint32_t got[2] = {0}, handled = 0, posted = 0, handled_types = 0;
+    int32_t last[2] = {-1, -1};
+
+    mcps_evt_reset();
+    CHECK(pthread_create(&chip, NULL, isr_chip, NULL) == 0);
+    CHECK(pthread_create(&timer, NULL, isr_timer, NULL) == 0);
+
+    for (;;)
+    {
+        struct mcps_evt_s e;
+        uint32_t signals;
+
+        pthread_mutex_lock(&sig.lock);
+        while (!sig.signals && sig.done < 2)
+        {
+            pthread_cond_wait(&sig.cond, &sig.lock);
+        }
+        signals = sig.signals;
+        sig.signals = 0;
+        pthread_mutex_unlock(&sig.lock);
+
+        if (!signals)
+        {
+            break;
+        }
+
+        /* every event pending, each callback's in the order it posted them */
+        for (bool first = true; mcps_evt_get(&e, first); first = false)
+        {
+            int src = EVT_SRC(e.data);
+
+            CHECK((int32_t)EVT_N(e.data) > last[src]);
+            last[src] = (int32_t)EVT_N(e.data);
+            got[src]++;
+            handled++;
+        }
+
+        if (__atomic_load_n(&sent[0], __ATOMIC_ACQUIRE) == STRESS_EVENTS &&
+            __atomic_load_n(&sent[1], __ATOMIC_ACQUIRE) == STRESS_EVENTS && sig.done < 2)
+        {
+            pthread_join(chip, NULL);
+            pthread_join(timer, NULL);
+            sig.done = 2;
+            sig_set(1u << MCPS_EVT_MAX); /**< the last wakeup takes what the final signals left */
+        }
+    }
+
+    for (int i = 0; i < MCPS_EVT_MAX; i++)
+    {
+        posted += stats->posted[i];
+        handled_types += stats->handled[i];
+    }
+    CHECK(got[0] + refused[0] == STRESS_EVENTS && got[1] + refused[1] == STRESS_EVENTS);
+    CHECK(posted == handled && handled_types == handled);
+    CHECK(stats->lost == refused[0] + refused[1]);
+    CHECK(stats->wakeups + stats->coalesced == handled);
+    printf("mcps_event: threads %u events, %u wakeups, %u coalesced, %u lost, peak %u\n",
+           handled + stats->lost, stats->wakeups, stats->coalesced, stats->lost, stats->peak);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_order();
+    test_full();
+    test_bursts();
+    test_threads();
+    printf("test_mcps_event: ok\n");
+    return 0;
+}
@@ -0,0 +1,261 @@
+/**
+ * @file      test_mcps_rx_ring.c
+ *
+ * @brief     Host test of the RX descriptor ring: the RX callback fired at a high rate against the MCPS task, in both PHR modes
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "FreeRTOS.h"
+#include "mcps_event.h"
+#include "mcps_rx_ring.h"
+
+#define STRESS_FRAMES 200000 /**< frames received in each PHR mode */
+#define FRAME_LEN_MAX 1100   /**< lengths beyond the extended PHR, to be truncated */
+
+/* the frames of the model: the timestamp is the count of the frame, the payload a pattern of it */
+static uint8_t frame_byte(uint32_t n, unsigned int k)
+{
+    return (uint8_t)(n * 7 + k);
+}
+
+/* What the RX callback did, written under the interrupt mask */
+static struct
+{
+    unsigned int frame_max; /**< of the PHR mode */
+    uint32_t frames;        /**< frames received by the chip */
+    uint32_t committed;
+    uint32_t overruns;      /**< no descriptor, or no room for the event */
+    uint32_t truncated;
+    uint32_t errors_posted; /**< the RX errors the MAC is told of on an overrun */
+    int done;
+} isr;
+
+/* mcps_rx_cb(): the interrupt runs whole before the task goes on, as the mask of the target */
+static void isr_rx(uint32_t n, unsigned int len)
+{
+    dwt_mcps_rx_t *rx;
+
+    host_enter_critical();
+
+    isr.frames++;
+    rx = mcps_rx_ring_reserve(len, isr.frame_max);
+    if (!rx)
+    {
+        isr.overruns++;
+        isr.errors_posted += mcps_evt_post(MCPS_EVT_RX_ERROR, 0, NULL);
+    }
+    else
+    {
+        unsigned int max = (isr.frame_max < MCPS_RX_FRAME_MAX) ? (isr.frame_max) : (MCPS_RX_FRAME_MAX);
+
+        CHECK(rx->len == ((len < max) ? (len) : (max)));
+        isr.truncated += (len > max);
+        rx->timeStamp = n;
+        for (unsigned int k = 0; k < rx->len; k++)
+        {
+            rx->data[k] = frame_byte(n, k);
+        }
+
+        if (mcps_evt_post(MCPS_EVT_RX, n, rx))
+        {
+            mcps_rx_ring_commit();
+            isr.committed++;
+        }
+        else
+        {
+            mcps_rx_ring_cancel();
+            isr.overruns++;
+        }
+    }
+
+    host_exit_critical();
+}
+
+static void *isr_thread(void *arg)
+{
+    uint32_t seed = 1;
+
+    for (uint32_t n = 0; n < STRESS_FRAMES; n++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        isr_rx(n, (seed >> 16) % (FRAME_LEN_MAX + 1));
+
+        /* bursts faster than the task, then pauses */
+        if ((seed >> 8) % 4 == 0)
+        {
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&isr.done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* McpsTask(): every event pending, the frame of an RX event read and then released */
+static void stress(unsigned int frame_max)
+{
+    const struct mcps_rx_ring_stats_s *stats = mcps_rx_ring_get_stats();
+    uint32_t got = 0, errors = 0;
+    int64_t last = -1;
+    pthread_t t;
+
+    mcps_evt_reset();
+    mcps_rx_ring_reset();
+    memset(&isr, 0, sizeof(isr));
+    isr.frame_max = frame_max;
+
+    CHECK(pthread_create(&t, NULL, isr_thread, NULL) == 0);
+
+    for (;;)
+    {
+        struct mcps_evt_s e;
+        int done = __atomic_load_n(&isr.done, __ATOMIC_ACQUIRE);
+        bool any = false;
+
+        for (bool first = true; mcps_evt_get(&e, first); first = false)
+        {
+            any = true;
+            if (e.type == MCPS_EVT_RX_ERROR)
+            {
+                errors++;
+                continue;
+            }
+            CHECK(e.type == MCPS_EVT_RX);
+
+            /* the frame was not overwritten while in use, and the frames come in order */
+            dwt_mcps_rx_t *rx = e.data;
+
+            CHECK(rx->timeStamp == e.status && (int64_t)e.status > last);
+            last = e.status;
+            for (unsigned int k = 0; k < rx->len; k++)
+            {
+                CHECK(rx->data[k] == frame_byte(e.status, k));
+            }
+            mcps_rx_ring_pop(rx);
+            got++;
+        }
+
+        if (done && !any)
+        {
+            break;
+        }
+        if (!any)
+        {
+            sched_yield();
+        }
+    }
+    pthread_join(t, NULL);
+
+    /* every frame is either handled or counted as an overrun */
+    CHECK(got == isr.committed && got == stats->received);
+    CHECK(got + isr.overruns == STRESS_FRAMES);
+    CHECK(stats->overruns == isr.overruns && isr.overruns > 0);
+    CHECK(stats->truncated == isr.truncated && isr.truncated > 0);
+    CHECK(errors == isr.errors_posted);
+    CHECK(stats->peak <= MCPS_RX_RING_LEN);
+
+    /* all the descriptors are free again */
+    for (int i = 0; i < MCPS_RX_RING_LEN; i++)
+    {
+        CHECK(mcps_rx_ring_reserve(0, frame_max) != NULL);
+        mcps_rx_ring_commit();
+    }
+    CHECK(mcps_rx_ring_reserve(0, frame_max) == NULL);
+
+    printf("mcps_rx_ring: PHR max %u: %u frames, %u handled, %u overruns, %u truncated, peak %u of %d\n",
+           frame_max, STRESS_FRAMES, got, isr.overruns, isr.truncated, stats->peak, MCPS_RX_RING_LEN);
+}
+
+/* the descriptors in use are not given again, each one holds a frame of the PHR mode */
+static void test_full(void)
+{
+    const struct mcps_rx_ring_stats_s *stats = mcps_rx_ring_get_stats();
+    dwt_mcps_rx_t *rx[MCPS_RX_RING_LEN];
+
+    mcps_rx_ring_reset();
+    for (int i = 0; i < MCPS_RX_RING_LEN; i++)
+    {
+        rx[i] = mcps_rx_ring_reserve(MCPS_RX_EXT_FRAME_MAX, MCPS_RX_EXT_FRAME_MAX);
+        CHECK(rx[i] && rx[i]->len == MCPS_RX_FRAME_MAX);
+        memset(rx[i]->data, i, rx[i]->len);
+        mcps_rx_ring_commit();
+    }
+    CHECK(mcps_rx_ring_reserve(10, MCPS_RX_STD_FRAME_MAX) == NULL);
+    CHECK(stats->overruns == 1 && stats->peak == MCPS_RX_RING_LEN);
+
+    /* a standard frame is cut at 127 bytes whatever the descriptor holds */
+    mcps_rx_ring_pop(rx[0]);
+    CHECK(mcps_rx_ring_reserve(200, MCPS_RX_STD_FRAME_MAX)->len == MCPS_RX_STD_FRAME_MAX);
+    mcps_rx_ring_cancel();
+    CHECK(stats->overruns == 2 && stats->received == MCPS_RX_RING_LEN);
+
+    /* the payloads do not overlap */
+    for (int i = 1; i < MCPS_RX_RING_LEN; i++)
+    {
+        for (unsigned int k = 0; k < rx[i]->len; k++)
+        {
+            CHECK(rx[i]->data[k] == i);
+        }
+        mcps_rx_ring_pop(rx[i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_full();
+    stress(MCPS_RX_STD_FRAME_MAX);
+    stress(MCPS_RX_EXT_FRAME_MAX);
+    printf("test_mcps_rx_ring: ok\n");
+    return 0;
+}
@@ -0,0 +1,406 @@
+/**
+ * @file      test_report_aggr.c
+ *
+ * @brief     Host test of the aggregation of the ranging reports: the statistics of a window against reference values
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "report_aggr.h"
+
+#define BLOCK_MS      10   /**< ranging interval of the sessions */
+#define BENCH_BLOCKS  100000
+
+static uint32_t rnd_state = 7;
+
+static int32_t noise(int amplitude)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return (int32_t)(rnd_state % (2 * amplitude + 1)) - amplitude;
+}
+
+/* the local AoA of the ranging results, Q16 fraction of 2*pi */
+static int16_t deg_to_q16(double deg)
+{
+    return (int16_t)(int32_t)lround(deg * 65536.0 / 360.0);
+}
+
+/* a block of one measurement */
+static void one_block(struct ranging_results *r, uint32_t block_index, uint16_t short_addr, uint8_t status,
+                      int32_t distance_mm, double aoa_deg)
+{
+    memset(r, 0, sizeof(*r));
+    r->block_index = block_index;
+    r->n_measurements = 1;
+    r->measurements[0].short_addr = short_addr;
+    r->measurements[0].status = status;
+    r->measurements[0].distance_mm = distance_mm;
+    r->measurements[0].local_aoa_measurements[0].aoa_2pi = deg_to_q16(aoa_deg);
+}
+
+/* mean, extremes and population standard deviation against a two pass reference in double */
+static void test_stats(void)
+{
+    static const int32_t fixed[] = {1000, 1010, 990, 1020};
+    struct report_aggr_s aggr;
+    struct report_aggr_result_s res;
+    struct ranging_results r;
+    int32_t d[200];
+    int n = 0, err = 0;
+
+    report_aggr_reset(&aggr);
+    for (int i = 0; i < 4; i++)
+    {
+        one_block(&r, i, 0x1001, 0, fixed[i], 0);
+        report_aggr_add(&aggr, &r, i * BLOCK_MS);
+    }
+    report_aggr_get(&aggr, 0, &res);
+    CHECK(res.short_addr == 0x1001 && res.ok == 4 && res.err == 0);
+    CHECK(res.d_mean_mm == 1005 && res.d_min_mm == 990 && res.d_max_mm == 1020);
+    /* sqrt((25 + 25 + 225 + 225) / 4) */
+    CHECK(fabs(res.d_std_mm - sqrt(125.0)) < 1e-3);
+
+    /* a long window far from 0, every 7th measurement in error */
+    report_aggr_reset(&aggr);
+    for (int i = 0; i < 200; i++)
+    {
+        int32_t v = 25000 + noise(300);
+
+        one_block(&r, i, 0x2002, (i % 7 == 3) ? (1) : (0), v, 0);
+        report_aggr_add(&aggr, &r, i * BLOCK_MS);
+        if (i % 7 == 3)
+        {
+            err++;
+        }
+        else
+        {
+            d[n++] = v;
+        }
+    }
+
+    double mean = 0, var = 0;
+    int32_t lo = INT32_MAX, hi = INT32_MIN;
+
+    for (int i = 0; i < n; i++)
+    {
+        mean += d[i];
+        lo = (d[i] < lo) ? (d[i]) : (lo);
+        hi = (d[i] > hi) ? (d[i]) : (hi);
+    }
+    mean /= n;
+    for (int i = 0; i < n; i++)
+    {
+        var += (d[i] - mean) * (d[i] - mean);
+    }
+
+    report_aggr_get(&aggr, 0, &res);
+    CHECK(res.ok == n && res.err == err);
+    CHECK(labs(res.d_mean_mm - lround(mean)) <= 1);
+    CHECK(res.d_min_mm == lo && res.d_max_mm == hi);
+    CHECK(fabs(res.d_std_mm - sqrt(var / n)) < 0.01 * sqrt(var / n));
+
+    /* one measurement: no spread; only errors: no statistics */
+    report_aggr_reset(&aggr);
+    one_block(&r, 0, 0x3003, 0, -42, 0);
+    report_aggr_add(&aggr, &r, 0);
+    one_block(&r, 1, 0x4004, 2, 500, 0);
+    report_aggr_add(&aggr, &r, BLOCK_MS);
+    report_aggr_get(&aggr, 0, &res);
+    CHECK(res.ok == 1 && res.d_mean_mm == -42 && res.d_min_mm == -42 && res.d_max_mm == -42 && res.d_std_mm == 0.0f);
+    report_aggr_get(&aggr, 1, &res);
+    CHECK(res.short_addr == 0x4004 && res.ok == 0 && res.err == 1 && res.d_mean_mm == 0 && res.d_std_mm == 0.0f);
+}
+
+/* the circular mean of the local AoA, where the arithmetic mean of angles across +-180 deg gives 0 */
+static void test_aoa(void)
+{
+    static const struct
+    {
+        double deg[4];
+        int n;
+        double mean_deg;
+    } cases[] = {
+        {{170, -170}, 2, 180},
+        {{179, -179, 178, -178}, 4, 180},
+        {{175, -165}, 2, -175},
+        {{10, -10, 20, -20}, 4, 0},
+        {{80, 90, 100}, 3, 90},
+        {{-80, -90, -100}, 3, -90},
+        {{30, 30, 30, 30}, 4, 30},
+    };
+    struct report_aggr_s aggr;
+    struct report_aggr_result_s res;
+    struct ranging_results r;
+
+    for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        report_aggr_reset(&aggr);
+        for (int i = 0; i < cases[c].n; i++)
+        {
+            one_block(&r, i, 0x1001, 0, 1000, cases[c].deg[i]);
+            report_aggr_add(&aggr, &r, i * BLOCK_MS);
+        }
+        report_aggr_get(&aggr, 0, &res);
+
+        /* +180 and -180 deg are the same Q16 angle, a couple of LSB of float error */
+        int16_t diff = (int16_t)(res.aoa_2pi - deg_to_q16(cases[c].mean_deg));
+
+        CHECK(abs(diff) <= 2);
+    }
+}
+
+/* N blocks or T ms, whichever comes first, across the wrap of the time */
+static void test_due(void)
+{
+    struct report_aggr_s aggr;
+    struct ranging_results r;
+
+    report_aggr_reset(&aggr);
+    CHECK(!report_aggr_due(&aggr, 1, 1, 1000));
+
+    one_block(&r, 0, 0x1001, 0, 1000, 0);
+    for (int i = 0; i < 4; i++)
+    {
+        report_aggr_add(&aggr, &r, 1000 + i * BLOCK_MS);
+        CHECK(!report_aggr_due(&aggr, 5, 0, 1000 + i * BLOCK_MS));
+    }
+    report_aggr_add(&aggr, &r, 1040);
+    CHECK(report_aggr_due(&aggr, 5, 0, 1040));
+    CHECK(!report_aggr_due(&aggr, 0, 0, 1040));
+
+    /* the period from the first block of the window */
+    CHECK(!report_aggr_due(&aggr, 0, 100, 1099));
+    CHECK(report_aggr_due(&aggr, 0, 100, 1100));
+    CHECK(report_aggr_due(&aggr, 10, 100, 1100));
+    CHECK(report_aggr_due(&aggr, 5, 100, 1040));
+
+    report_aggr_reset(&aggr);
+    report_aggr_add(&aggr, &r, 0xFFFFFFF0u);
+    CHECK(!report_aggr_due(&aggr, 0, 100, 0x53));
+    CHECK(report_aggr_due(&aggr, 0, 100, 0x54));
+}
+
+/* the windows of a session, emitted and reset as the report callback does */
+static int run_windows(int blocks, uint16_t n_blocks, uint16_t period_ms, uint16_t *window_blocks)
+{
+    struct report_aggr_s aggr;
+    struct report_aggr_result_s res;
+    struct ranging_results r;
+    uint32_t next_block = 0;
+    int n = 0;
+
+    report_aggr_reset(&aggr);
+    for (int i = 0; i < blocks; i++)
+    {
+        uint32_t now_ms = (uint32_t)i * BLOCK_MS;
+
+        one_block(&r, i, 0x1001, 0, 1000 + i, 0);
+        report_aggr_add(&aggr, &r, now_ms);
+        if (report_aggr_due(&aggr, n_blocks, period_ms, now_ms))
+        {
+            /* each window starts where the previous one ended, with its own statistics */
+            CHECK(aggr.first_block == next_block && aggr.n_entries == 1);
+            report_aggr_get(&aggr, 0, &res);
+            CHECK(res.ok == aggr.blocks && res.d_min_mm == 1000 + (int32_t)next_block);
+            CHECK(res.d_max_mm == 1000 + (int32_t)(next_block + aggr.blocks - 1));
+            window_blocks[n++] = aggr.blocks;
+            next_block += aggr.blocks;
+            report_aggr_reset(&aggr);
+        }
+    }
+    /* the blocks of the window in progress */
+    CHECK(aggr.blocks == blocks - (int)next_block);
+    return n;
+}
+
+static void test_emission(void)
+{
+    uint16_t w[100];
+    int n;
+
+    /* N blocks */
+    n = run_windows(100, 8, 0, w);
+    CHECK(n == 12);
+    for (int i = 0; i < n; i++)
+    {
+        CHECK(w[i] == 8);
+    }
+
+    /* T ms: a window of 35 ms at 10 ms per block is due at its 5th block, 40 ms after its first */
+    n = run_windows(100, 0, 35, w);
+    CHECK(n == 20);
+    for (int i = 0; i < n; i++)
+    {
+        CHECK(w[i] == 5);
+    }
+
+    /* whichever comes first */
+    CHECK(run_windows(30, 3, 35, w) == 10 && w[0] == 3);
+    CHECK(run_windows(30, 8, 35, w) == 6 && w[0] == 5);
+
+    /* neither: aggregation until the end */
+    CHECK(run_windows(30, 0, 0, w) == 0);
+}
+
+/* the counters of the window: responders beyond the entries, saturation, reset */
+static void test_counters(void)
+{
+    static struct report_aggr_s aggr;
+    struct report_aggr_result_s res;
+    struct ranging_results r;
+
+    report_aggr_reset(&aggr);
+    memset(&r, 0, sizeof(r));
+    r.block_index = 77;
+    r.n_measurements = FIRA_CONTROLEES_MAX;
+    for (int i = 0; i < FIRA_CONTROLEES_MAX; i++)
+    {
+        r.measurements[i].short_addr = (uint16_t)(0x100 + i);
+        r.measurements[i].distance_mm = 1000 * (i + 1);
+    }
+    report_aggr_add(&aggr, &r, 500);
+    CHECK(aggr.n_entries == FIRA_CONTROLEES_MAX && aggr.dropped == 0);
+
+    /* a responder which replaced another one does not fit */
+    r.measurements[0].short_addr = 0x1FF;
+    report_aggr_add(&aggr, &r, 510);
+    CHECK(aggr.n_entries == FIRA_CONTROLEES_MAX && aggr.dropped == 1 && aggr.blocks == 2);
+    for (int i = 0; i < FIRA_CONTROLEES_MAX; i++)
+    {
+        report_aggr_get(&aggr, i, &res);
+        CHECK(res.short_addr == 0x100 + i && res.ok == ((i == 0) ? (1) : (2)));
+        CHECK(res.d_mean_mm == 1000 * (i + 1));
+    }
+
+    /* the reset starts a new window with its own first block and time */
+    report_aggr_reset(&aggr);
+    CHECK(aggr.blocks == 0 && aggr.dropped == 0 && aggr.n_entries == 0);
+    CHECK(!report_aggr_due(&aggr, 1, 1, 10000));
+    one_block(&r, 90, 0x100, 0, 4242, 0);
+    report_aggr_add(&aggr, &r, 9000);
+    report_aggr_get(&aggr, 0, &res);
+    CHECK(aggr.first_block == 90 && aggr.start_ms == 9000);
+    CHECK(res.ok == 1 && res.d_mean_mm == 4242 && res.d_min_mm == 4242 && res.d_max_mm == 4242);
+
+    /* the counters saturate, the measurements beyond are dropped */
+    report_aggr_reset(&aggr);
+    for (int i = 0; i < UINT16_MAX + 1; i++)
+    {
+        report_aggr_add(&aggr, &r, i);
+    }
+    report_aggr_get(&aggr, 0, &res);
+    CHECK(aggr.blocks == UINT16_MAX && res.ok == UINT16_MAX && aggr.dropped == 1);
+    CHECK(res.d_mean_mm == 4242 && res.d_std_mm == 0.0f);
+}
+
+/* the cost of the aggregation of a block of FIRA_CONTROLEES_MAX responders, against the window's statistics */
+static void bench(void)
+{
+    static struct report_aggr_s aggr;
+    struct report_aggr_result_s res;
+    struct ranging_results r;
+    uint64_t t0, t1;
+    int windows = 0;
+
+    memset(&r, 0, sizeof(r));
+    r.n_measurements = FIRA_CONTROLEES_MAX;
+    for (int i = 0; i < FIRA_CONTROLEES_MAX; i++)
+    {
+        r.measurements[i].short_addr = (uint16_t)(0x100 + i);
+    }
+
+    report_aggr_reset(&aggr);
+    t0 = host_time_ns();
+    for (int b = 0; b < BENCH_BLOCKS; b++)
+    {
+        r.block_index = b;
+        for (int i = 0; i < FIRA_CONTROLEES_MAX; i++)
+        {
+            r.measurements[i].distance_mm = 1000 * (i + 1) + noise(20);
+            r.measurements[i].local_aoa_measurements[0].aoa_2pi = (int16_t)noise(2000);
+        }
+        report_aggr_add(&aggr, &r, b * BLOCK_MS);
+        if (report_aggr_due(&aggr, 10, 0, b * BLOCK_MS))
+        {
+            for (int i = 0; i < aggr.n_entries; i++)
+            {
+                report_aggr_get(&aggr, i, &res);
+            }
+            report_aggr_reset(&aggr);
+            windows++;
+        }
+    }
+    t1 = host_time_ns();
+
+    printf("report_aggr: %d responders, %.0f ns/block with the statistics of %d windows of 10 blocks\n",
+           FIRA_CONTROLEES_MAX, (double)(t1 - t0) / BENCH_BLOCKS, windows);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_stats();
+    test_aoa();
+    test_due();
+    test_emission();
+    test_counters();
+    printf("test_report_aggr: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+/**
+ * @file      test_report_bin.c
+ *
+ * @brief     Host test of the binary report frames, and their size and encode time against the JSON report
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "report_bin.h"
+#include "str_fmt.h"
+#include "crc16.h"
+
+#define FRAME_MAX     512
+#define MAX_RESP      8
+#define BENCH_ROUNDS  200000
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* the decoder of the host: checks the frame and returns its payload, NULL if the frame is not valid */
+static const uint8_t *frame_payload(uint8_t *f, int len, report_bin_type_e type, int *plen)
+{
+    if (len < REPORT_BIN_HDR_LEN + REPORT_BIN_CRC_LEN || f[0] != REPORT_BIN_SYNC || f[1] != REPORT_BIN_VERSION ||
+        f[2] != type)
+    {
+        return NULL;
+    }
+    *plen = get_le16(&f[4]);
+    if (REPORT_BIN_HDR_LEN + *plen + REPORT_BIN_CRC_LEN != len || check_crc16(f, (uint16_t)len) != CRC_OKAY)
+    {
+        return NULL;
+    }
+    return &f[REPORT_BIN_HDR_LEN];
+}
+
+static int decode_block(uint8_t *f, int len, uint32_t *block_index, struct report_bin_diag_s *diag,
+                        struct report_bin_meas_s *meas)
+{
+    int plen;
+    const uint8_t *p = frame_payload(f, len, REPORT_BIN_TYPE_BLOCK, &plen);
+    const uint8_t *end = p + plen;
+
+    if (!p || plen < REPORT_BIN_BLOCK_LEN)
+    {
+        return -1;
+    }
+
+    int m = p[4];
+    uint8_t flags = p[5];
+
+    *block_index = get_le32(p);
+    p += REPORT_BIN_BLOCK_LEN;
+    if (flags & REPORT_BIN_FLAG_DIAG)
+    {
+        diag->rssi_dbm_x10 = (int16_t)get_le16(p);
+        diag->nlos_pct = p[2];
+        p += REPORT_BIN_DIAG_LEN;
+    }
+    if (p + m * REPORT_BIN_MEAS_LEN != end)
+    {
+        return -1;
+    }
+    for (int i = 0; i < m; i++, p += REPORT_BIN_MEAS_LEN)
+    {
+        meas[i].short_addr = get_le16(&p[0]);
+        meas[i].status = p[2];
+        meas[i].aoa_fom = p[3];
+        meas[i].distance_mm = (int32_t)get_le32(&p[4]);
+        meas[i].pdoa_2pi = (int16_t)get_le16(&p[8]);
+        meas[i].aoa_2pi = (int16_t)get_le16(&p[10]);
+        meas[i].remote_aoa_2pi = (int16_t)get_le16(&p[12]);
+        meas[i].cfo_100ppm = (int16_t)get_le16(&p[14]);
+    }
+    return m;
+}
+
+static void make_meas(struct report_bin_meas_s *meas, int n, uint32_t seed)
+{
+    for (int i = 0; i < n; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        meas[i] = (struct report_bin_meas_s){
+            .short_addr = (uint16_t)(0x1000 + i),
+            .status = (seed >> 28) == 0,
+            .aoa_fom = (uint8_t)(seed >> 8),
+            .distance_mm = (int32_t)(seed >> 12) - 0x40000,
+            .pdoa_2pi = (int16_t)seed,
+            .aoa_2pi = (int16_t)(seed >> 4),
+            .remote_aoa_2pi = (int16_t)-(int32_t)(seed >> 16),
+            .cfo_100ppm = (int16_t)(seed >> 20) - 2048,
+        };
+    }
+}
+
+static int encode_block(uint8_t *buf, int max, uint32_t block_index, const struct report_bin_diag_s *diag,
+                        const struct report_bin_meas_s *meas, int n)
+{
+    int len = report_bin_block_begin(buf, max, block_index, diag);
+
+    for (int i = 0; i < n && len > 0; i++)
+    {
+        len = report_bin_block_add(buf, len, max, &meas[i]);
+    }
+    return (len < 0) ? (-1) : (report_bin_end(buf, len, max));
+}
+
+/* the ranging report of report_send() with the PDoA fields, for the same measurements */
+static int encode_json(char *str, int max, uint32_t block_index, const struct report_bin_meas_s *meas, int n)
+{
+    int len = fmt_str(str, 0, max, "{\"Block\":");
+
+    len = fmt_uint(str, len, max, block_index);
+    len = fmt_str(str, len, max, ", \"results\":[");
+    for (int i = 0; i < n; i++)
+    {
+        if (i > 0)
+        {
+            len = fmt_char(str, len, max, ',');
+        }
+        len = fmt_str(str, len, max, "{\"Addr\":\"0x");
+        len = fmt_hex(str, len, max, meas[i].short_addr, 4, false);
+        len = fmt_str(str, len, max, (meas[i].status) ? ("\",\"Status\":\"Err\"") : ("\",\"Status\":\"Ok\""));
+        if (meas[i].status == 0)
+        {
+            len = fmt_str(str, len, max, ",\"D_cm\":");
+            len = fmt_int(str, len, max, meas[i].distance_mm / 10);
+            len = fmt_str(str, len, max, ",\"LPDoA_deg\":");
+            len = fmt_q16_deg(str, len, max, meas[i].pdoa_2pi);
+            len = fmt_str(str, len, max, ",\"LAoA_deg\":");
+            len = fmt_q16_deg(str, len, max, meas[i].aoa_2pi);
+            len = fmt_str(str, len, max, ",\"LFoM\":");
+            len = fmt_int(str, len, max, meas[i].aoa_fom);
+            len = fmt_str(str, len, max, ",\"RAoA_deg\":");
+            len = fmt_q16_deg(str, len, max, meas[i].remote_aoa_2pi);
+            len = fmt_str(str, len, max, ",\"CFO_100ppm\":");
+            len = fmt_int(str, len, max, meas[i].cfo_100ppm);
+        }
+        len = fmt_char(str, len, max, '}');
+    }
+    return fmt_str(str, len, max, "]}\r\n");
+}
+
+static void test_block(void)
+{
+    struct report_bin_meas_s meas[MAX_RESP], out[MAX_RESP];
+    struct report_bin_diag_s diag = {.rssi_dbm_x10 = -853, .nlos_pct = 17}, diag_out = {0};
+    uint8_t buf[FRAME_MAX];
+    uint32_t block_index;
+
+    for (int n = 0; n <= MAX_RESP; n++)
+    {
+        const struct report_bin_diag_s *d = (n & 1) ? (&diag) : (NULL);
+        int len;
+
+        make_meas(meas, n, (uint32_t)n);
+        len = encode_block(buf, sizeof(buf), 0xA5000000u + n, d, meas, n);
+        CHECK(len == REPORT_BIN_HDR_LEN + REPORT_BIN_BLOCK_LEN + ((d) ? (REPORT_BIN_DIAG_LEN) : (0)) +
+                         n * REPORT_BIN_MEAS_LEN + REPORT_BIN_CRC_LEN);
+        CHECK(decode_block(buf, len, &block_index, &diag_out, out) == n);
+        CHECK(block_index == 0xA5000000u + n);
+        CHECK(memcmp(meas, out, n * sizeof(meas[0])) == 0);
+        if (d)
+        {
+            CHECK(diag_out.rssi_dbm_x10 == diag.rssi_dbm_x10 && diag_out.nlos_pct == diag.nlos_pct);
+        }
+    }
+}
+
+static void test_errors(void)
+{
+    struct report_bin_meas_s meas[MAX_RESP], out[MAX_RESP];
+    struct report_bin_diag_s diag;
+    uint8_t buf[FRAME_MAX];
+    uint32_t block_index;
+    int len, exact;
+
+    make_meas(meas, 4, 7);
+    exact = encode_block(buf, sizeof(buf), 1, NULL, meas, 4);
+
+    /* every byte is covered by the CRC */
+    for (int i = 0; i < exact; i++)
+    {
+        buf[i] ^= 0x10;
+        CHECK(decode_block(buf, exact, &block_index, &diag, out) < 0);
+        buf[i] ^= 0x10;
+    }
+    CHECK(decode_block(buf, exact, &block_index, &diag, out) == 4);
+    CHECK(decode_block(buf, exact - 1, &block_index, &diag, out) < 0);
+
+    /* a buffer one byte short of the frame is refused, never overrun */
+    memset(buf, 0xEE, sizeof(buf));
+    CHECK(encode_block(buf, exact - 1, 1, NULL, meas, 4) < 0);
+    CHECK(buf[exact - 1] == 0xEE);
+    CHECK(encode_block(buf, exact, 1, NULL, meas, 4) == exact);
+    CHECK(report_bin_block_begin(buf, REPORT_BIN_HDR_LEN + REPORT_BIN_BLOCK_LEN + 1, 1, NULL) < 0);
+
+    /* the frames are numbered in the order they are built */
+    len = report_bin_stopped(buf, sizeof(buf), 3);
+    uint8_t seq = buf[3];
+    int plen;
+
+    CHECK(len == REPORT_BIN_HDR_LEN + 1 + REPORT_BIN_CRC_LEN);
+    CHECK(frame_payload(buf, len, REPORT_BIN_TYPE_STOPPED, &plen)[0] == 3 && plen == 1);
+    report_bin_stopped(buf, sizeof(buf), 3);
+    CHECK(buf[3] == (uint8_t)(seq + 1));
+}
+
+/* the bytes of a block and the time to build it, in binary and as the JSON report */
+static void bench(void)
+{
+    static const int resp[] = {1, 4, 8};
+    struct report_bin_meas_s meas[MAX_RESP];
+    uint8_t buf[FRAME_MAX];
+    char str[256 * MAX_RESP];
+    volatile int sink = 0;
+
+    for (unsigned r = 0; r < sizeof(resp) / sizeof(resp[0]); r++)
+    {
+        int n = resp[r];
+        int bin_len = 0, json_len = 0;
+
+        make_meas(meas, n, 1);
+        for (int i = 0; i < n; i++)
+        {
+            meas[i].status = 0;
+        }
+
+        uint64_t t0 = host_time_ns();
+
+        for (int i = 0; i < BENCH_ROUNDS; i++)
+        {
+            bin_len = encode_block(buf, sizeof(buf), 100000 + i, NULL, meas, n);
+            sink += buf[bin_len - 1];
+        }
+
+        uint64_t bin_ns = host_time_ns() - t0;
+
+        t0 = host_time_ns();
+        for (int i = 0; i < BENCH_ROUNDS; i++)
+        {
+            json_len = encode_json(str, sizeof(str), 100000 + i, meas, n);
+            sink += str[json_len - 1];
+        }
+
+        uint64_t json_ns = host_time_ns() - t0;
+
+        CHECK(bin_len > 0 && json_len > 0);
+        printf("report_bin: %d responders, binary %d bytes %.0f ns/block, JSON %d bytes %.0f ns/block\n", n,
+               bin_len, (double)bin_ns / BENCH_ROUNDS, json_len, (double)json_ns / BENCH_ROUNDS);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_block();
+    test_errors();
+    printf("test_report_bin: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+/**
+ * @file      test_report_delta.c
+ *
+ * @brief     Host test of the delta reports: a decoder of the host reconstructs the stream, and the compression ratio
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "report_delta.h"
+#include "crc16.h"
+
+#define FRAME_MAX     512
+#define RESP          6 /**< responders of the sessions, up to FIRA_CONTROLEES_MAX */
+#define BLOCKS        20000
+
+static const report_config_t cfg = {
+    .delta_mm = 10,     /**< 1 cm */
+    .delta_angle = 91,  /**< 0.5 deg */
+    .delta_cfo = 10,    /**< 0.1 ppm */
+    .delta_key = 50,
+};
+
+static uint32_t rnd_state = 7;
+
+static int32_t noise(int amplitude)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return (int32_t)(rnd_state % (2 * amplitude + 1)) - amplitude;
+}
+
+/* The decoder of the host: the last value of every field of every responder */
+static struct report_bin_meas_s host_state[RESP];
+static int host_n;
+static int host_keys;
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static struct report_bin_meas_s *host_find(uint16_t short_addr)
+{
+    for (int i = 0; i < host_n; i++)
+    {
+        if (host_state[i].short_addr == short_addr)
+        {
+            return &host_state[i];
+        }
+    }
+    CHECK(host_n < RESP);
+    host_state[host_n].short_addr = short_addr;
+    return &host_state[host_n++];
+}
+
+static void host_decode(uint8_t *f, int len, uint32_t block_index)
+{
+    CHECK(len >= REPORT_BIN_HDR_LEN + REPORT_BIN_BLOCK_LEN + REPORT_BIN_CRC_LEN);
+    CHECK(f[0] == REPORT_BIN_SYNC && f[2] == REPORT_BIN_TYPE_DELTA);
+    CHECK(REPORT_BIN_HDR_LEN + get_le16(&f[4]) + REPORT_BIN_CRC_LEN == len);
+    CHECK(check_crc16(f, (uint16_t)len) == CRC_OKAY);
+
+    const uint8_t *p = &f[REPORT_BIN_HDR_LEN];
+    const uint8_t *end = &f[len - REPORT_BIN_CRC_LEN];
+    int m = p[4];
+    uint8_t flags = p[5];
+
+    CHECK(get_le32(p) == block_index);
+    host_keys += (flags & REPORT_BIN_FLAG_KEY) != 0;
+    p += REPORT_BIN_BLOCK_LEN + ((flags & REPORT_BIN_FLAG_DIAG) ? (REPORT_BIN_DIAG_LEN) : (0));
+
+    for (int i = 0; i < m; i++)
+    {
+        struct report_bin_meas_s *h = host_find(get_le16(p));
+        uint8_t mask = p[2];
+
+        CHECK(!(flags & REPORT_BIN_FLAG_KEY) || mask == REPORT_BIN_DELTA_ALL);
+        p += 3;
+        if (mask & REPORT_BIN_DELTA_STATUS)
+        {
+            h->status = *p++;
+        }
+        if (mask & REPORT_BIN_DELTA_FOM)
+        {
+            h->aoa_fom = *p++;
+        }
+        if (mask & REPORT_BIN_DELTA_DISTANCE)
+        {
+            h->distance_mm = (int32_t)get_le32(p);
+            p += 4;
+        }
+        if (mask & REPORT_BIN_DELTA_PDOA)
+        {
+            h->pdoa_2pi = (int16_t)get_le16(p);
+            p += 2;
+        }
+        if (mask & REPORT_BIN_DELTA_AOA)
+        {
+            h->aoa_2pi = (int16_t)get_le16(p);
+            p += 2;
+        }
+        if (mask & REPORT_BIN_DELTA_REMOTE_AOA)
+        {
+            h->remote_aoa_2pi = (int16_t)get_le16(p);
+            p += 2;
+        }
+        if (mask & REPORT_BIN_DELTA_CFO)
+        {
+            h->cfo_100ppm = (int16_t)get_le16(p);
+            p += 2;
+        }
+    }
+    CHECK(p == end);
+}
+
+/* what the host knows shall be the measurement, within the deadbands */
+static void host_check(const struct report_bin_meas_s *meas, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const struct report_bin_meas_s *m = &meas[i];
+        const struct report_bin_meas_s *h = host_find(m->short_addr);
+
+        CHECK(h->status == m->status);
+        if (m->status)
+        {
+            continue;
+        }
+        CHECK(h->aoa_fom == m->aoa_fom);
+        CHECK(labs((long)h->distance_mm - m->distance_mm) <= cfg.delta_mm);
+        CHECK(abs((int16_t)(h->pdoa_2pi - m->pdoa_2pi)) <= cfg.delta_angle);
+        CHECK(abs((int16_t)(h->aoa_2pi - m->aoa_2pi)) <= cfg.delta_angle);
+        CHECK(abs((int16_t)(h->remote_aoa_2pi - m->remote_aoa_2pi)) <= cfg.delta_angle);
+        CHECK(abs(h->cfo_100ppm - m->cfo_100ppm) <= cfg.delta_cfo);
+    }
+}
+
+/* A session: static responders with the noise of the measurements, one walking away and back,
+ * one at the +-pi wrap of the AoA, one joining late, and a few errors */
+static int session_block(int b, struct report_bin_meas_s *meas, int noise_mm)
+{
+    int n = 0;
+
+    for (int i = 0; i < RESP; i++)
+    {
+        if (i == RESP - 1 && b < BLOCKS / 3)
+        {
+            continue; /**< not there yet */
+        }
+
+        struct report_bin_meas_s *m = &meas[n++];
+
+        *m = (struct report_bin_meas_s){
+            .short_addr = (uint16_t)(0x1000 + i),
+            .status = (noise(500) == 0),
+            .aoa_fom = 100,
+            .distance_mm = 1500 * (i + 1) + noise(noise_mm),
+            .pdoa_2pi = (int16_t)(4000 * i + noise(60)),
+            .aoa_2pi = (int16_t)(2000 * i + noise(60)),
+            .remote_aoa_2pi = (int16_t)(-1000 * i + noise(60)),
+            .cfo_100ppm = (int16_t)(-300 + 50 * i + noise(6)),
+        };
+        if (i == 1)
+        {
+            m->distance_mm += (b % 4000 < 2000) ? (b % 2000) : (2000 - b % 2000); /**< walks, 1 mm per block */
+        }
+        if (i == 2)
+        {
+            m->aoa_2pi = (int16_t)(INT16_MAX + noise(60)); /**< wraps between +pi and -pi */
+        }
+        if (m->status)
+        {
+            m->aoa_fom = 0;
+            m->distance_mm = 0;
+        }
+    }
+    return n;
+}
+
+/* runs a session through the encoder and the decoder, returns the bytes of the delta frames and of the blocks */
+static void run_session(int noise_mm, long *delta_bytes, long *block_bytes)
+{
+    struct report_bin_meas_s meas[RESP];
+    uint8_t buf[FRAME_MAX];
+
+    report_delta_reset();
+    memset(host_state, 0, sizeof(host_state));
+    host_n = 0;
+    host_keys = 0;
+    *delta_bytes = *block_bytes = 0;
+
+    for (int b = 0; b < BLOCKS; b++)
+    {
+        int n = session_block(b, meas, noise_mm);
+        int len = report_delta_encode(buf, sizeof(buf), &cfg, b, NULL, meas, n);
+
+        CHECK(len > 0);
+        host_decode(buf, len, b);
+        host_check(meas, n);
+        *delta_bytes += len;
+        *block_bytes += REPORT_BIN_HDR_LEN + REPORT_BIN_BLOCK_LEN + n * REPORT_BIN_MEAS_LEN + REPORT_BIN_CRC_LEN;
+    }
+    CHECK(host_keys == (BLOCKS + cfg.delta_key - 1) / cfg.delta_key);
+}
+
+static void test_session(void)
+{
+    long delta, block;
+
+    run_session(3, &delta, &block);
+    CHECK(delta * 2 < block); /**< a static session compresses */
+    run_session(40, &delta, &block);
+}
+
+/* a frame too small for the block is refused and the host's state is kept: the next frame says it all */
+static void test_refused(void)
+{
+    struct report_bin_meas_s meas[RESP];
+    uint8_t buf[FRAME_MAX];
+    int n, len;
+
+    report_delta_reset();
+    memset(host_state, 0, sizeof(host_state));
+    host_n = 0;
+
+    n = session_block(BLOCKS, meas, 3);
+    len = report_delta_encode(buf, sizeof(buf), &cfg, 0, NULL, meas, n);
+    host_decode(buf, len, 0);
+
+    meas[0].distance_mm += 1000;
+    CHECK(report_delta_encode(buf, REPORT_BIN_HDR_LEN + REPORT_BIN_BLOCK_LEN + 4, &cfg, 1, NULL, meas, n) < 0);
+    len = report_delta_encode(buf, sizeof(buf), &cfg, 1, NULL, meas, n);
+    CHECK(len > 0);
+    host_decode(buf, len, 1);
+    host_check(meas, n);
+}
+
+/* the compression ratio on the sessions, against the REPORT_BIN_TYPE_BLOCK frames */
+static void bench(void)
+{
+    static const int noise_mm[] = {3, 10, 40};
+
+    for (unsigned i = 0; i < sizeof(noise_mm) / sizeof(noise_mm[0]); i++)
+    {
+        long delta, block;
+
+        run_session(noise_mm[i], &delta, &block);
+        printf("report_delta: distance noise +-%d mm, %d responders, %.1f bytes/block against %.1f, ratio %.2f\n",
+               noise_mm[i], RESP, (double)delta / BLOCKS, (double)block / BLOCKS, (double)block / delta);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_session();
+    test_refused();
+    printf("test_report_delta: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
@@ -0,0 +1,447 @@
+/**
+ * @file      test_report_policy.c
+ *
+ * @brief     Host test of the ranging reports when the link falls behind: budgets of the message classes and coalescing, with a slow consumer
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "common_fira.h"
+#include "fira_report.h"
+#include "report_config.h"
+#include "usb_uart_tx.h"
+#include "reporter.h"
+#include "cmsis_os.h"
+
+#define RESP          4   /**< responders of the session */
+#define MSG_LEN       100 /**< length of the diag and echo messages */
+#define THROTTLE      20  /**< blocks between two flushes of the slow consumer */
+#define RUN_BLOCKS    1000
+#define BENCH_BLOCKS  5000
+
+/* The tasks of the firmware on one host thread: the test switches the task which produces */
+static char task_report, task_ctrl, task_diag;
+static char *task_cur = &task_report;
+
+osThreadId osThreadGetId(void)
+{
+    return (osThreadId)task_cur;
+}
+
+static void tx_drain(void)
+{
+    int due;
+
+    while ((due = flush_report_due_ms()) >= 0)
+    {
+        host_cycles_add(due * 1000);
+        flush_report_buf();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+}
+
+/* the distance of a responder at a block, a multiple of 1 cm to be found in D_cm */
+static int32_t distance_mm(uint16_t short_addr, uint32_t block)
+{
+    return 10 * (int32_t)((short_addr & 0xFF) * 1000 + block % 1000);
+}
+
+/* a block of n responders from first_addr, sent by the report task */
+static bool report_block(uint32_t block, uint16_t first_addr, int n)
+{
+    static struct ranging_results r;
+    struct string_measurement str_result;
+
+    memset(&r, 0, sizeof(r));
+    r.stopped_reason = 0xFF;
+    r.block_index = block;
+    r.n_measurements = n;
+    for (int i = 0; i < n; i++)
+    {
+        r.measurements[i].short_addr = (uint16_t)(first_addr + i);
+        r.measurements[i].distance_mm = distance_mm(first_addr + i, block);
+    }
+
+    task_cur = &task_report;
+    return fira_report_process(&r, &str_result);
+}
+
+/* messages of len bytes of a class until the class refuses count of them, from task */
+static int flood(char *task, tx_class_e cls, int count)
+{
+    static uint8_t msg[MSG_LEN];
+    int refused = 0, sent = 0;
+
+    memset(msg, 'x', sizeof(msg));
+    task_cur = task;
+    while (refused < count)
+    {
+        if (port_tx_msg_class(msg, sizeof(msg), cls) == _NO_ERR)
+        {
+            sent++;
+        }
+        else
+        {
+            refused++;
+        }
+    }
+    task_cur = &task_report;
+    return sent;
+}
+
+/* the last ranging report of the output: its block and the D_cm of every responder */
+static uint32_t last_report(int32_t *d_cm, int n, uint16_t first_addr)
+{
+    static char str[1 << 16];
+    int len;
+    const uint8_t *out = host_tx_data(&len);
+    const char *p, *q;
+    unsigned block, addr;
+    int d;
+
+    /* the output of the last flushes, as a string */
+    len = (len < (int)sizeof(str)) ? (len) : ((int)sizeof(str) - 1);
+    memcpy(str, out, len);
+    str[len] = 0;
+
+    for (p = NULL, q = str; (q = strstr(q, "{\"Block\":")) != NULL; q++)
+    {
+        p = q;
+    }
+    CHECK(p != NULL && sscanf(p, "{\"Block\":%u", &block) == 1);
+
+    for (int i = 0; i < n; i++)
+    {
+        d_cm[i] = -1;
+    }
+    while ((p = strstr(p, "{\"Addr\":\"0x")) != NULL)
+    {
+        CHECK(sscanf(p, "{\"Addr\":\"0x%x\",\"Status\":\"Ok\",\"D_cm\":%d", &addr, &d) == 2);
+        CHECK(addr >= first_addr && addr < first_addr + (unsigned)n);
+        d_cm[addr - first_addr] = d;
+        p++;
+    }
+    return block;
+}
+
+/* the diag and the echo fill the link while it is stalled: they hit their own budgets,
+ * the ranging results and the command replies still find room */
+static void test_classes(void)
+{
+    struct tx_class_stats_s before[TX_CLASS_MAX];
+    uint32_t diag_sent, echo_sent;
+
+    for (int c = 0; c < TX_CLASS_MAX; c++)
+    {
+        before[c] = *get_tx_class_stats(c);
+    }
+
+    diag_sent = flood(&task_diag, TX_CLASS_DIAG, 10);
+    echo_sent = flood(&task_ctrl, TX_CLASS_ECHO, 10);
+    CHECK(diag_sent > 0 && echo_sent > 0);
+
+    CHECK(get_tx_class_stats(TX_CLASS_DIAG)->dropped - before[TX_CLASS_DIAG].dropped == 10);
+    CHECK(get_tx_class_stats(TX_CLASS_ECHO)->dropped - before[TX_CLASS_ECHO].dropped == 10);
+    CHECK(get_tx_class_stats(TX_CLASS_ECHO)->pending <= get_tx_class_stats(TX_CLASS_ECHO)->budget);
+    CHECK(get_tx_class_stats(TX_CLASS_DIAG)->pending <= get_tx_class_stats(TX_CLASS_DIAG)->budget);
+
+    CHECK(report_block(1, 0x100, RESP));
+    task_cur = &task_ctrl;
+    CHECK(port_tx_msg((uint8_t *)"{\"ok\"}\r\n", 8) == _NO_ERR);
+    task_cur = &task_report;
+
+    CHECK(get_tx_class_stats(TX_CLASS_RANGING)->dropped == before[TX_CLASS_RANGING].dropped);
+    CHECK(get_tx_class_stats(TX_CLASS_REPLY)->dropped == before[TX_CLASS_REPLY].dropped);
+
+    tx_drain();
+    host_tx_clear();
+    for (int c = 0; c < TX_CLASS_MAX; c++)
+    {
+        CHECK(get_tx_class_stats(c)->pending == 0);
+    }
+}
+
+/* the ranging results fill their budget while the link is stalled: the blocks are coalesced,
+ * latest measurement per responder, a new responder which does not fit is dropped */
+static void test_coalesce(void)
+{
+    const struct tx_class_stats_s *stats = get_tx_class_stats(TX_CLASS_RANGING);
+    uint32_t dropped = stats->dropped, coalesced = stats->coalesced;
+    int32_t d_cm[FIRA_CONTROLEES_MAX];
+    uint32_t block = 100;
+    int refused = 0;
+
+    /* until the budget refuses a block, which is then held */
+    while (report_block(block, 0x100, RESP))
+    {
+        block++;
+    }
+    refused++;
+    CHECK(stats->dropped - dropped == 1 && stats->coalesced == coalesced);
+
+    /* the next ones replace it, responder per responder */
+    for (int i = 0; i < 10; i++)
+    {
+        CHECK(!report_block(++block, 0x100, RESP));
+        refused++;
+    }
+    CHECK(stats->coalesced - coalesced == 10 * RESP);
+
+    /* new responders join the held block until it is full, the one beyond is dropped */
+    CHECK(!report_block(++block, 0x100 + RESP, FIRA_CONTROLEES_MAX - RESP + 1));
+    refused++;
+    CHECK(stats->dropped - dropped == (uint32_t)refused + 1);
+    CHECK(stats->coalesced - coalesced == 10 * RESP);
+
+    /* the link catches up: the held block goes with the next one, as a single block */
+    tx_drain();
+    host_tx_clear();
+    CHECK(report_block(++block, 0x100, RESP));
+    CHECK(stats->coalesced - coalesced == 11 * RESP);
+    tx_drain();
+
+    CHECK(last_report(d_cm, FIRA_CONTROLEES_MAX, 0x100) == block);
+    for (int i = 0; i < FIRA_CONTROLEES_MAX; i++)
+    {
+        /* the responders of the last block with their latest distance, the ones of the held block with theirs */
+        uint32_t latest = (i < RESP) ? (block) : (block - 1);
+
+        CHECK(d_cm[i] == distance_mm(0x100 + i, latest) / 10);
+    }
+    host_tx_clear();
+}
+
+/* the JSON line of a block is sent in one record per measurement: the messages of the other tasks
+ * committed meanwhile wait for the end of the line, a line which does not fit whole is not started */
+static void test_stream(void)
+{
+    const struct tx_stats_s *ring = get_tx_stats(TX_PRODUCER_REPORT);
+    uint32_t enqueued = ring->enqueued;
+    int32_t d_cm[FIRA_CONTROLEES_MAX];
+    const uint8_t *out;
+    char *str;
+    int len;
+
+    /* a record per measurement, and the start and the end of the line */
+    CHECK(report_block(1, 0x300, FIRA_CONTROLEES_MAX));
+    CHECK(ring->enqueued - enqueued == FIRA_CONTROLEES_MAX + 2);
+    tx_drain();
+    CHECK(last_report(d_cm, FIRA_CONTROLEES_MAX, 0x300) == 1);
+    for (int i = 0; i < FIRA_CONTROLEES_MAX; i++)
+    {
+        CHECK(d_cm[i] == distance_mm(0x300 + i, 1) / 10);
+    }
+    host_tx_clear();
+
+    /* a reply committed between the parts of a message, the flushing thread running meanwhile */
+    CHECK(reporter_instance.room(3, 8));
+    str = reporter_instance.reserve(8);
+    memcpy(str, "<a", 2);
+    CHECK(reporter_instance.commit_more(2) == _NO_ERR);
+    tx_drain();
+    task_cur = &task_ctrl;
+    CHECK(port_tx_msg((uint8_t *)"{\"ok\"}\r\n", 8) == _NO_ERR);
+    task_cur = &task_report;
+    tx_drain();
+    str = reporter_instance.reserve(8);
+    memcpy(str, "b", 1);
+    CHECK(reporter_instance.commit_more(1) == _NO_ERR);
+    tx_drain();
+    str = reporter_instance.reserve(8);
+    memcpy(str, "c>", 2);
+    CHECK(reporter_instance.commit(2) == _NO_ERR);
+    tx_drain();
+    out = host_tx_data(&len);
+    CHECK(len == 5 + 8 && memcmp(out, "<abc>{\"ok\"}\r\n", len) == 0);
+    host_tx_clear();
+
+    /* the last part empty */
+    reporter_instance.reserve(8);
+    CHECK(reporter_instance.commit_more(0) == _NO_ERR);
+    str = reporter_instance.reserve(8);
+    memcpy(str, "<d", 2);
+    CHECK(reporter_instance.commit_more(2) == _NO_ERR);
+    reporter_instance.reserve(8);
+    CHECK(reporter_instance.commit(0) == _NO_ERR);
+    task_cur = &task_ctrl;
+    CHECK(port_tx_msg((uint8_t *)"e", 1) == _NO_ERR);
+    task_cur = &task_report;
+    tx_drain();
+    out = host_tx_data(&len);
+    CHECK(len == 3 && memcmp(out, "<de", len) == 0);
+    host_tx_clear();
+
+    /* more parts than the ranging budget holds: refused before the first one */
+    CHECK(!reporter_instance.room(get_tx_class_stats(TX_CLASS_RANGING)->budget / MSG_LEN + 1, MSG_LEN));
+    CHECK(reporter_instance.room(1, MSG_LEN));
+    for (int c = 0; c < TX_CLASS_MAX; c++)
+    {
+        CHECK(get_tx_class_stats(c)->pending == 0);
+    }
+}
+
+/* a consumer which flushes every THROTTLE blocks, with diag traffic at every block:
+ * no ranging result is lost, the last report carries the last distance of every responder */
+static void test_slow_consumer(void)
+{
+    const struct tx_class_stats_s *stats = get_tx_class_stats(TX_CLASS_RANGING);
+    uint32_t dropped = stats->dropped, coalesced = stats->coalesced, diag_dropped = get_tx_class_stats(TX_CLASS_DIAG)->dropped;
+    struct string_measurement str_result;
+    int32_t d_cm[RESP];
+    uint32_t block = 10000;
+    int refused = 0;
+
+    for (int b = 0; b < RUN_BLOCKS; b++)
+    {
+        flood(&task_diag, TX_CLASS_DIAG, 1);
+        refused += !report_block(++block, 0x200, RESP);
+        if (b % THROTTLE == THROTTLE - 1)
+        {
+            tx_drain();
+            host_tx_clear();
+        }
+    }
+    CHECK(refused > 0);
+    CHECK(fira_report_flush(&str_result));
+    tx_drain();
+
+    CHECK(last_report(d_cm, RESP, 0x200) == block);
+    for (int i = 0; i < RESP; i++)
+    {
+        CHECK(d_cm[i] == distance_mm(0x200 + i, block) / 10);
+    }
+
+    /* the counters of TXSTAT: a refused reservation per held block, no measurement lost */
+    CHECK(stats->dropped - dropped == (uint32_t)refused);
+    CHECK(stats->coalesced - coalesced >= (uint32_t)refused * RESP - RESP);
+    CHECK(get_tx_class_stats(TX_CLASS_DIAG)->dropped - diag_dropped >= RUN_BLOCKS);
+    printf("report_policy: %d blocks, flushed every %d: %d held, %lu measurements coalesced\n",
+           RUN_BLOCKS, THROTTLE, refused, (unsigned long)(stats->coalesced - coalesced));
+    host_tx_clear();
+}
+
+/* the cost of the report path against the controlees of the session, up to FIRA_CONTROLEES_MAX, with a consumer
+ * which keeps up: formatting and commit of each block, then its transmission. The JSON line is streamed, a record
+ * per measurement, the binary frames are one record per block */
+static void bench(void)
+{
+    static const char *const names[REPORT_FORMAT_MAX] = {"JSON", "BIN", "DELTA"};
+    const struct tx_stats_s *ring = get_tx_stats(TX_PRODUCER_REPORT);
+    report_config_t *cfg = get_report_config();
+
+    /* the defaults of report_config.c, the .config_entry section is not walked on the host */
+    cfg->delta_mm = 10;
+    cfg->delta_angle = 91;
+    cfg->delta_cfo = 10;
+    cfg->delta_key = 50;
+
+    for (uint8_t format = 0; format < REPORT_FORMAT_MAX; format++)
+    {
+        cfg->format = format;
+        for (int n = 1; n <= FIRA_CONTROLEES_MAX; n++)
+        {
+            uint64_t fmt_ns = 0, out_ns = 0, bytes = 0;
+            uint32_t enqueued;
+
+            fira_report_reset();
+            host_tx_clear();
+            enqueued = ring->enqueued;
+            for (uint32_t b = 0; b < BENCH_BLOCKS; b++)
+            {
+                uint64_t t1 = host_time_ns(), t2, t3;
+                int len;
+
+                CHECK(report_block(b, 0x400, n));
+                t2 = host_time_ns();
+                tx_drain();
+                t3 = host_time_ns();
+
+                host_tx_data(&len);
+                bytes += len;
+                fmt_ns += t2 - t1;
+                out_ns += t3 - t1;
+                host_tx_clear();
+            }
+
+            printf("report_policy: %-5s %d controlees: %.2f records/block, %.1f bytes/block, per block %.2f us "
+                   "to the commit, %.2f us to the USB, per measurement %.2f us to the USB\n",
+                   names[format], n, (double)(ring->enqueued - enqueued) / BENCH_BLOCKS, (double)bytes / BENCH_BLOCKS,
+                   fmt_ns / 1e3 / BENCH_BLOCKS, out_ns / 1e3 / BENCH_BLOCKS, out_ns / 1e3 / BENCH_BLOCKS / n);
+        }
+    }
+    cfg->format = REPORT_FORMAT_JSON;
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    task_cur = &task_report;
+    port_tx_register(TX_PRODUCER_REPORT);
+    task_cur = &task_ctrl;
+    port_tx_register(TX_PRODUCER_CTRL);
+    task_cur = &task_report;
+
+    get_report_config()->format = REPORT_FORMAT_JSON;
+    fira_report_reset();
+
+    test_classes();
+    test_coalesce();
+    test_stream();
+    test_slow_consumer();
+    printf("test_report_policy: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
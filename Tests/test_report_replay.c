@@ -0,0 +1,380 @@
+/**
+ * @file      test_report_replay.c
+ *
+ * @brief     Host replay of a capture of ranging results through the report path: formatting, reporter and USB/UART transmission
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "common_fira.h"
+#include "fira_report.h"
+#include "report_bin.h"
+#include "report_capture.h"
+#include "report_config.h"
+#include "usb_uart_tx.h"
+#include "crc16.h"
+
+#define RESP          4   /**< responders of the captured session */
+#define BLOCKS        ((REPORT_CAPTURE_BUFSIZE - REPORT_CAPTURE_HDR_LEN) / (REPORT_CAPTURE_HDR_LEN + RESP * REPORT_CAPTURE_MEAS_LEN))
+#define BENCH_LOOPS   200 /**< passes over the capture, as RREPLAY <LOOPS> */
+
+static uint32_t rnd_state = 7;
+
+static int32_t noise(int amplitude)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return (int32_t)(rnd_state % (2 * amplitude + 1)) - amplitude;
+}
+
+static void tx_drain(void)
+{
+    int due;
+
+    while ((due = flush_report_due_ms()) >= 0)
+    {
+        host_cycles_add(due * 1000);
+        flush_report_buf();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+}
+
+/* a session of RESP responders captured by report_cb(), until the log is full, then its stop */
+static int capture_session(void)
+{
+    static struct ranging_results r;
+    struct report_capture_stats_s stats;
+
+    report_capture_start();
+    for (int b = 0; b < BLOCKS - 1; b++)
+    {
+        memset(&r, 0, sizeof(r));
+        r.stopped_reason = 0xFF;
+        r.block_index = 1000 + b;
+        r.n_measurements = RESP;
+        for (int i = 0; i < RESP; i++)
+        {
+            struct ranging_measurements *rm = &r.measurements[i];
+
+            rm->short_addr = (uint16_t)(0x1000 + i);
+            rm->status = ((b + i) % 13 == 0) ? (1) : (0);
+            rm->distance_mm = 1000 * (i + 1) + noise(20);
+            rm->local_aoa_measurements[0].aoa_fom = (uint8_t)(100 + noise(20));
+            rm->local_aoa_measurements[0].pdoa_2pi = (int16_t)(4000 * i + noise(300));
+            rm->local_aoa_measurements[0].aoa_2pi = (int16_t)(2000 * i + noise(300));
+            rm->remote_aoa_azimuth_2pi = (int16_t)noise(1000);
+        }
+        report_capture_add(&r, -431 + noise(5));
+    }
+    memset(&r, 0, sizeof(r));
+    r.stopped_reason = 0;
+    r.block_index = 1000 + BLOCKS - 1;
+    report_capture_add(&r, 0);
+    report_capture_stop();
+
+    report_capture_get_stats(&stats);
+    CHECK(stats.dropped == 0);
+    return stats.records;
+}
+
+/* RCAP DUMP replies saved by the host: the bytes of the "Hex" fields, in order, added back to the log */
+static int load_dump(const char *path)
+{
+    static uint8_t data[REPORT_CAPTURE_BUFSIZE];
+    static struct ranging_results r;
+    static char line[1024];
+    struct report_capture_stats_s stats;
+    FILE *f = fopen(path, "r");
+    int len = 0;
+
+    CHECK(f != NULL);
+    while (fgets(line, sizeof(line), f))
+    {
+        const char *p = strstr(line, "\"Hex\":\"");
+        unsigned v;
+
+        for (p = (p) ? (p + 7) : (NULL); p && len < (int)sizeof(data) && sscanf(p, "%2x", &v) == 1; p += 2)
+        {
+            data[len++] = (uint8_t)v;
+        }
+    }
+    fclose(f);
+
+    report_capture_start();
+    for (int off = 0; off + REPORT_CAPTURE_HDR_LEN <= len;)
+    {
+        const uint8_t *p = &data[off];
+        int n = p[0];
+
+        CHECK(n <= FIRA_CONTROLEES_MAX && off + REPORT_CAPTURE_HDR_LEN + n * REPORT_CAPTURE_MEAS_LEN <= len);
+        memset(&r, 0, sizeof(r));
+        r.n_measurements = n;
+        r.stopped_reason = p[1];
+        r.block_index = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        for (int i = 0; i < n; i++)
+        {
+            const uint8_t *m = &p[REPORT_CAPTURE_HDR_LEN + i * REPORT_CAPTURE_MEAS_LEN];
+            struct ranging_measurements *rm = &r.measurements[i];
+
+            rm->short_addr = (uint16_t)(m[0] | (m[1] << 8));
+            rm->status = m[2];
+            rm->local_aoa_measurements[0].aoa_fom = m[3];
+            rm->distance_mm = (int32_t)((uint32_t)m[4] | ((uint32_t)m[5] << 8) | ((uint32_t)m[6] << 16) | ((uint32_t)m[7] << 24));
+            rm->local_aoa_measurements[0].pdoa_2pi = (int16_t)(m[8] | (m[9] << 8));
+            rm->local_aoa_measurements[0].aoa_2pi = (int16_t)(m[10] | (m[11] << 8));
+            rm->remote_aoa_azimuth_2pi = (int16_t)(m[12] | (m[13] << 8));
+        }
+        report_capture_add(&r, (int16_t)(p[2] | (p[3] << 8)));
+        off += REPORT_CAPTURE_HDR_LEN + n * REPORT_CAPTURE_MEAS_LEN;
+    }
+    report_capture_stop();
+
+    report_capture_get_stats(&stats);
+    CHECK(stats.bytes == len);
+    return stats.records;
+}
+
+/* the output of one block: JSON lines, or report_bin frames with their CRC.
+ * A stop sends what waited for room before its own report. */
+static void check_output(uint8_t format, const uint8_t *out, int len)
+{
+    if (format == REPORT_FORMAT_JSON)
+    {
+        for (int off = 0; off < len;)
+        {
+            const uint8_t *end = memchr(&out[off], '\n', len - off);
+
+            CHECK(end != NULL && end - &out[off] > 2 && out[off] == '{' && end[-1] == '\r');
+            off = (int)(end - out) + 1;
+        }
+        return;
+    }
+
+    for (int off = 0; off < len;)
+    {
+        int flen;
+
+        CHECK(len - off >= REPORT_BIN_HDR_LEN + REPORT_BIN_CRC_LEN && out[off] == REPORT_BIN_SYNC);
+        flen = REPORT_BIN_HDR_LEN + (out[off + 4] | (out[off + 5] << 8)) + REPORT_BIN_CRC_LEN;
+        CHECK(off + flen <= len && check_crc16((uint8_t *)&out[off], (uint16_t)flen) == CRC_OKAY);
+        off += flen;
+    }
+}
+
+struct replay_res_s
+{
+    uint32_t blocks;  /**< ranging blocks reported */
+    uint32_t reports; /**< blocks with an output */
+    uint64_t bytes;   /**< bytes sent to the USB */
+    uint64_t ns;      /**< time of the replay */
+    uint64_t fmt_ns;  /**< time from the report_cb() of the blocks to the commit of their reports */
+    uint64_t fmt_max_ns;
+    uint64_t out_ns;  /**< time from the report_cb() of the blocks to the transmission of their report */
+    uint64_t out_max_ns;
+};
+
+/* the replay of RREPLAY: the capture through the report path, a consumer which keeps up with the reports */
+static void replay(uint8_t format, uint8_t aggr_blocks, int loops, struct replay_res_s *res)
+{
+    static struct ranging_results r;
+    struct string_measurement str_result;
+    report_config_t *cfg = get_report_config();
+    const struct report_stats_s *stats = fira_report_get_stats(format);
+    struct report_stats_s start;
+    int32_t cfo_100ppm;
+    uint64_t t0 = host_time_ns();
+
+    cfg->format = format;
+    cfg->aggr_blocks = aggr_blocks;
+    cfg->aggr_period_ms = 0;
+    fira_report_reset();
+    start = *stats;
+    memset(res, 0, sizeof(*res));
+    host_tx_clear();
+
+    for (int loop = 0; loop < loops; loop++)
+    {
+        int offset = 0;
+
+        while ((offset = report_capture_read(offset, &r, &cfo_100ppm)) > 0)
+        {
+            const uint8_t *out;
+            int len;
+            uint64_t t1 = host_time_ns(), t2, t3;
+
+            fira_report_set_env(cfo_100ppm, false);
+            CHECK(fira_report_process(&r, &str_result));
+            t2 = host_time_ns();
+            tx_drain();
+            t3 = host_time_ns();
+
+            out = host_tx_data(&len);
+            if (len)
+            {
+                check_output(format, out, len);
+                res->reports++;
+                res->bytes += len;
+                res->fmt_ns += t2 - t1;
+                res->fmt_max_ns = (t2 - t1 > res->fmt_max_ns) ? (t2 - t1) : (res->fmt_max_ns);
+                res->out_ns += t3 - t1;
+                res->out_max_ns = (t3 - t1 > res->out_max_ns) ? (t3 - t1) : (res->out_max_ns);
+            }
+            host_tx_clear();
+        }
+    }
+    CHECK(fira_report_flush(&str_result));
+
+    res->ns = host_time_ns() - t0;
+    res->blocks = stats->blocks - start.blocks;
+    CHECK(stats->errors == start.errors);
+    CHECK(stats->bytes - start.bytes == res->bytes);
+}
+
+/* every block of the capture is reported once, in every format */
+static void test_replay(void)
+{
+    static const char *const names[REPORT_FORMAT_MAX] = {"JSON", "BIN", "DELTA"};
+    struct replay_res_s res;
+    int records = capture_session();
+
+    CHECK(records == BLOCKS);
+    for (uint8_t format = 0; format < REPORT_FORMAT_MAX; format++)
+    {
+        replay(format, 0, 2, &res);
+        CHECK(res.blocks == 2 * (records - 1));
+        CHECK(res.reports == 2 * records);
+        printf("report_replay: %s, %d blocks of %d responders, %.1f bytes/block\n",
+               names[format], records - 1, RESP, (double)res.bytes / res.reports);
+    }
+
+    /* the aggregation: one report per 10 blocks, and the window and the stop at the end of each pass */
+    replay(REPORT_FORMAT_JSON, 10, 1, &res);
+    CHECK(res.blocks == records - 1);
+    CHECK(res.reports == (records - 1) / 10 + 1);
+}
+
+/* the capture saved as the replies of RCAP DUMP, 64 bytes per line, is loaded back as it was */
+static void test_dump(void)
+{
+    static uint8_t data[REPORT_CAPTURE_BUFSIZE];
+    struct report_capture_stats_s stats;
+    char path[] = "/tmp/test_report_replay_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fdopen(fd, "w");
+    int records = capture_session();
+
+    CHECK(f != NULL);
+    report_capture_get_stats(&stats);
+    memcpy(data, report_capture_data(), stats.bytes);
+    for (int off = 0; off < stats.bytes; off += 64)
+    {
+        fprintf(f, "{\"RCAP\":{\"Offset\":%d,\"Hex\":\"", off);
+        for (int i = off; i < off + 64 && i < stats.bytes; i++)
+        {
+            fprintf(f, "%02X", data[i]);
+        }
+        fprintf(f, "\"}}\r\n");
+    }
+    fclose(f);
+
+    CHECK(load_dump(path) == records);
+    remove(path);
+    CHECK(memcmp(report_capture_data(), data, stats.bytes) == 0);
+}
+
+static void print_res(const char *name, int records, const struct replay_res_s *res)
+{
+    printf("report_replay: %-9s %d blocks x %d: %.0f blocks/s, %.0f bytes/s, per report: %.2f us to the commit "
+           "(max %.2f), %.2f us to the USB (max %.2f)\n",
+           name, records, BENCH_LOOPS, res->blocks * 1e9 / res->ns, res->bytes * 1e9 / res->ns,
+           res->fmt_ns / 1e3 / res->reports, res->fmt_max_ns / 1e3, res->out_ns / 1e3 / res->reports, res->out_max_ns / 1e3);
+}
+
+/* the throughput of the report path of the host, on the capture or on the RCAP DUMP saved in path */
+static void bench(const char *path)
+{
+    static const char *const names[REPORT_FORMAT_MAX] = {"JSON", "BIN", "DELTA"};
+    struct replay_res_s res;
+    int records = (path) ? (load_dump(path)) : (capture_session());
+
+    for (uint8_t format = 0; format < REPORT_FORMAT_MAX; format++)
+    {
+        replay(format, 0, BENCH_LOOPS, &res);
+        print_res(names[format], records, &res);
+    }
+    replay(REPORT_FORMAT_JSON, 10, BENCH_LOOPS, &res);
+    print_res("JSON/10", records, &res);
+}
+
+int main(int argc, char *argv[])
+{
+    report_config_t *cfg = get_report_config();
+
+    host_init();
+    port_tx_register(TX_PRODUCER_REPORT);
+
+    /* the defaults of report_config.c, the .config_entry section is not walked on the host */
+    cfg->delta_mm = 10;
+    cfg->delta_angle = 91;
+    cfg->delta_cfo = 10;
+    cfg->delta_key = 50;
+
+    test_replay();
+    test_dump();
+    printf("test_report_replay: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench((argc > 2) ? (argv[2]) : (NULL));
+    }
+    return 0;
+}
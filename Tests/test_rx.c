@@ -0,0 +1,466 @@
+/**
+ * @file      test_rx.c
+ *
+ * @brief     Host test of the command input of two hosts at once: the interfaces interleaved through usb_uart_rx(), the replies routed back
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "app.h"
+#include "cmd.h"
+#include "cmd_machine.h"
+#include "comm_config.h"
+#include "crc16.h"
+#include "usb_uart_rx.h"
+#include "usb_uart_tx.h"
+#include "circular_buffers.h"
+#include "controlTask.h"
+#include "HAL_uart.h"
+#include "HAL_usb.h"
+#include "InterfUsb.h"
+
+#define STRESS_CMDS   300  /**< commands of each host */
+#define STRESS_CHUNK  12   /**< the longest run of bytes received at once */
+#define OUT_MAX       (1 << 20)
+#define BENCH_TRIPS   20000 /**< round trips of each command */
+
+extern data_circ_buf_t *uartRx;
+extern data_circ_buf_t *usbRx;
+
+/* what each host received */
+struct host_out_s
+{
+    uint8_t data[OUT_MAX];
+    int len;
+};
+
+static struct host_out_s out_uart, out_usb;
+
+static void out_add(struct host_out_s *o, const uint8_t *data, int len)
+{
+    CHECK(o->len + len <= OUT_MAX);
+    memcpy(&o->data[o->len], data, len);
+    o->len += len;
+}
+
+int deca_uart_transmit(uint8_t *ptr, uint16_t sz)
+{
+    out_add(&out_uart, ptr, sz);
+    return 1;
+}
+
+static bool test_usb_transmit(uint8_t *tx_buffer, int size)
+{
+    out_add(&out_usb, tx_buffer, size);
+    return true;
+}
+
+static bool test_usb_tx_empty(void)
+{
+    return true;
+}
+
+const struct hal_usb_s Usb = {
+    .transmit = test_usb_transmit,
+    .isTxBufferEmpty = test_usb_tx_empty,
+};
+
+/* the signals of usb_uart_rx() to come back for the bytes left */
+static int notified;
+
+void NotifyControlTask(void)
+{
+    notified++;
+}
+
+static app_definition_t test_app = {"STOP", mIDLE, NULL, NULL, waitForCommand, command_parser, NULL};
+
+const app_definition_t *AppGet(void)
+{
+    return &test_app;
+}
+
+static int count(const struct host_out_s *o, const char *what)
+{
+    int wlen = (int)strlen(what);
+    int n = 0;
+
+    for (int i = 0; i + wlen <= o->len; i++)
+    {
+        n += (memcmp(&o->data[i], what, wlen) == 0);
+    }
+    return n;
+}
+
+static void out_clear(void)
+{
+    out_uart.len = 0;
+    out_usb.len = 0;
+}
+
+static void tx_drain(void)
+{
+    int due;
+
+    while ((due = flush_report_due_ms()) >= 0)
+    {
+        host_cycles_add(due * 1000);
+        flush_report_buf();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+}
+
+static int rx_room(data_circ_buf_t *rx)
+{
+    return (int)sizeof(rx->buf) - 1 - CIRC_CNT(rx->head, rx->tail, sizeof(rx->buf));
+}
+
+/* the interrupt of an interface: the bytes land in its receive buffer */
+static void rx_put(data_circ_buf_t *rx, const char *text, int len)
+{
+    CHECK(len <= rx_room(rx));
+    for (int i = 0; i < len; i++)
+    {
+        rx->buf[rx->head] = text[i];
+        rx->head = (rx->head + 1) & (sizeof(rx->buf) - 1);
+    }
+}
+
+/* one run of the control task on CTRL_DATA_RECEIVED, then the flush task */
+static port_itf_e ctrl_run(void)
+{
+    usb_data_e res;
+    port_itf_e itf;
+
+    notified = 0;
+    res = usb_uart_rx();
+    itf = usb_uart_rx_itf();
+    if (machine_mode_is_on())
+    {
+        machine_mode_process(res);
+    }
+    else
+    {
+        AppGet()->command_parser(res, (char *)local_buff);
+    }
+    machine_mode_update();
+    tx_drain();
+
+    return (res == COMMAND_READY) ? (itf) : (PORT_ITF_DEFAULT);
+}
+
+/* a framed command of the machine mode */
+static void rx_put_frame(data_circ_buf_t *rx, uint8_t seq, const char *cmd)
+{
+    char frame[TX_FRAME_HDR_LEN + 64 + TX_FRAME_CRC_LEN];
+    int len = (int)strlen(cmd);
+    uint16_t crc;
+
+    frame[0] = (char)TX_FRAME_SOF;
+    frame[1] = (char)len;
+    frame[2] = 0;
+    frame[3] = (char)seq;
+    frame[4] = TX_FRAME_CMD;
+    memcpy(&frame[TX_FRAME_HDR_LEN], cmd, len);
+    crc = calc_crc16((uint8_t *)&frame[1], (uint16_t)(TX_FRAME_HDR_LEN - 1 + len));
+    frame[TX_FRAME_HDR_LEN + len] = (char)(crc >> 8);
+    frame[TX_FRAME_HDR_LEN + len + 1] = (char)crc;
+    rx_put(rx, frame, TX_FRAME_HDR_LEN + len + TX_FRAME_CRC_LEN);
+}
+
+/* the halves of the commands of two hosts arrive in turn */
+static void test_interleave(void)
+{
+    out_clear();
+    rx_put(uartRx, "st", 2);
+    rx_put(usbRx, "{\"CMD_NAME\":", 12);
+    CHECK(ctrl_run() == PORT_ITF_DEFAULT);
+    rx_put(usbRx, "\"TXSTAT\",\"CMD_PARAMS\":{}}\n", 26);
+    rx_put(uartRx, "at\r", 3);
+    CHECK(ctrl_run() != PORT_ITF_DEFAULT);
+    CHECK(notified == 1); /**< the other host's command is waiting */
+    CHECK(ctrl_run() != PORT_ITF_DEFAULT);
+    CHECK(notified == 0);
+    CHECK(ctrl_run() == PORT_ITF_DEFAULT);
+
+    /* each host sees its own echo and its own reply only */
+    CHECK(count(&out_uart, "stat\r") == 1);
+    CHECK(count(&out_uart, "MODE: STOP") == 1);
+    CHECK(count(&out_uart, "TXSTAT") == 0);
+    CHECK(count(&out_uart, "ok\r\n") == 1);
+    CHECK(count(&out_usb, "{\"CMD_NAME\":\"TXSTAT\",\"CMD_PARAMS\":{}}\n") == 1);
+    CHECK(count(&out_usb, "{\"TXSTAT\":{") == 1);
+    CHECK(count(&out_usb, "MODE: STOP") == 0);
+    CHECK(count(&out_usb, "ok\r\n") == 1);
+}
+
+/* a host sending without a pause does not keep the other one waiting */
+static void test_fair(void)
+{
+    port_itf_e last = PORT_ITF_DEFAULT;
+    int served[PORT_ITF_MAX] = {0};
+
+    out_clear();
+    rx_put(usbRx, "stat\n", 5);
+    for (int i = 0; i < 4; i++)
+    {
+        port_itf_e itf;
+
+        rx_put(uartRx, "stat\r", 5);
+        itf = ctrl_run();
+        CHECK(itf != PORT_ITF_DEFAULT && itf != last);
+        served[itf]++;
+        last = itf;
+        if (itf == PORT_ITF_USB)
+        {
+            rx_put(usbRx, "stat\n", 5);
+        }
+    }
+    CHECK(served[PORT_ITF_UART] == 2 && served[PORT_ITF_USB] == 2);
+    CHECK(count(&out_usb, "MODE: STOP") == 2);
+
+    /* the UART's commands wait together, the last run takes those left */
+    while (ctrl_run() != PORT_ITF_DEFAULT)
+    {
+    }
+    CHECK(count(&out_uart, "MODE: STOP") == 4);
+    CHECK(count(&out_usb, "MODE: STOP") == 3);
+}
+
+/* two hosts typing at random paces, a run of the control task after each arrival */
+static void test_stress(void)
+{
+    static char text_uart[STRESS_CMDS * 8], text_usb[STRESS_CMDS * 48];
+    int len_uart = 0, len_usb = 0, pos_uart = 0, pos_usb = 0;
+    int runs = 0;
+    uint32_t seed = 1;
+
+    /* drop what a test left in the receive buffers */
+    uartRx->tail = uartRx->head;
+    usbRx->tail = usbRx->head;
+    out_clear();
+
+    for (int i = 0; i < STRESS_CMDS; i++)
+    {
+        len_uart += sprintf(&text_uart[len_uart], "stat\r");
+        len_usb += sprintf(&text_usb[len_usb], "{\"CMD_NAME\":\"TXSTAT\",\"CMD_PARAMS\":{}}\n");
+    }
+
+    while (pos_uart < len_uart || pos_usb < len_usb || notified)
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            data_circ_buf_t *rx = (k == 0) ? (uartRx) : (usbRx);
+            const char *text = (k == 0) ? (text_uart) : (text_usb);
+            int *pos = (k == 0) ? (&pos_uart) : (&pos_usb);
+            int len = (k == 0) ? (len_uart) : (len_usb);
+            int n;
+
+            seed = seed * 1103515245u + 12345u;
+            n = (int)((seed >> 16) % (STRESS_CHUNK + 1));
+            n = (n > len - *pos) ? (len - *pos) : (n);
+            n = (n > rx_room(rx)) ? (rx_room(rx)) : (n);
+            rx_put(rx, &text[*pos], n);
+            *pos += n;
+        }
+        ctrl_run();
+        runs++;
+        CHECK(runs < 100 * STRESS_CMDS);
+    }
+
+    /* the echo of a command split between two runs is cut by the replies of the run, it is not counted */
+    CHECK(count(&out_uart, "MODE: STOP") == STRESS_CMDS);
+    CHECK(count(&out_uart, "ok\r\n") == STRESS_CMDS);
+    CHECK(count(&out_uart, "TXSTAT") == 0);
+    CHECK(count(&out_uart, "CMD_") == 0);
+    CHECK(count(&out_usb, "{\"TXSTAT\":{") == STRESS_CMDS);
+    CHECK(count(&out_usb, "stat") == 0);
+    CHECK(count(&out_usb, "ok\r\n") == STRESS_CMDS);
+    CHECK(count(&out_usb, "MODE: STOP") == 0);
+    CHECK(count(&out_usb, "error") == 0);
+}
+
+/* the machine mode belongs to the host which entered it, the other one is not heard meanwhile */
+static void test_machine(void)
+{
+    out_clear();
+    rx_put(usbRx, "machine 1\n", 10);
+    CHECK(ctrl_run() == PORT_ITF_USB);
+    CHECK(machine_mode_is_on() && machine_mode_itf() == PORT_ITF_USB);
+
+    rx_put(uartRx, "stat\r", 5);
+    rx_put_frame(usbRx, 1, "STAT");
+    while (ctrl_run() != PORT_ITF_DEFAULT || notified)
+    {
+    }
+    rx_put_frame(usbRx, 2, "MACHINE 0");
+    while (ctrl_run() != PORT_ITF_DEFAULT || notified)
+    {
+    }
+    CHECK(!machine_mode_is_on());
+    CHECK(out_uart.len == 0);
+    CHECK(count(&out_usb, "MODE: STOP") == 1);
+
+    /* the UART is heard again, with nothing left of the bytes dropped */
+    rx_put(uartRx, "stat\r", 5);
+    CHECK(ctrl_run() == PORT_ITF_UART);
+    CHECK(count(&out_uart, "stat\r") == 1);
+    CHECK(count(&out_uart, "MODE: STOP") == 1);
+    CHECK(count(&out_uart, "error") == 0);
+}
+
+/* the frames of the machine mode received by the host, checked: the number of TX_FRAME_DONE frames */
+static int frames_done(const struct host_out_s *o)
+{
+    int n = 0;
+
+    for (int i = 0; i < o->len;)
+    {
+        int len;
+
+        CHECK(o->len - i >= TX_FRAME_HDR_LEN + TX_FRAME_CRC_LEN && o->data[i] == TX_FRAME_SOF);
+        len = o->data[i + 1] | (o->data[i + 2] << 8);
+        CHECK(i + TX_FRAME_HDR_LEN + len + TX_FRAME_CRC_LEN <= o->len);
+        CHECK(calc_crc16((uint8_t *)&o->data[i + 1], (uint16_t)(TX_FRAME_HDR_LEN - 1 + len)) ==
+              ((o->data[i + TX_FRAME_HDR_LEN + len] << 8) | o->data[i + TX_FRAME_HDR_LEN + len + 1]));
+        n += (o->data[i + 4] == TX_FRAME_DONE);
+        i += TX_FRAME_HDR_LEN + len + TX_FRAME_CRC_LEN;
+    }
+    return n;
+}
+
+/* the runs of the control task until the commands received are served */
+static void ctrl_idle(void)
+{
+    while (ctrl_run() != PORT_ITF_DEFAULT || notified)
+    {
+    }
+}
+
+/* round trips per second of the same commands, typed on the CLI and framed in the machine mode,
+ * over the USB: each command is sent when the whole reply of the previous one has been received */
+static void bench(void)
+{
+    static const char *const cmds[] = {"STAT", "TXSTAT", "DECAID", "XTALTRIM 30"};
+    const int n_cmds = sizeof(cmds) / sizeof(cmds[0]);
+    uint64_t ns[2][sizeof(cmds) / sizeof(cmds[0])] = {0};
+    uint8_t seq = 0;
+
+    uartRx->tail = uartRx->head;
+    usbRx->tail = usbRx->head;
+
+    for (int machine = 0; machine < 2; machine++)
+    {
+        if (machine)
+        {
+            rx_put(usbRx, "machine 1\n", 10);
+            ctrl_idle();
+            CHECK(machine_mode_is_on());
+        }
+
+        for (int t = 0; t < BENCH_TRIPS; t++)
+        {
+            for (int c = 0; c < n_cmds; c++)
+            {
+                char line[32];
+                int len = snprintf(line, sizeof(line), "%s\n", cmds[c]);
+                uint64_t t0 = host_time_ns();
+
+                out_clear();
+                if (machine)
+                {
+                    seq = (seq == 0xFF) ? (1) : (seq + 1);
+                    rx_put_frame(usbRx, seq, cmds[c]);
+                }
+                else
+                {
+                    rx_put(usbRx, line, len);
+                }
+                ctrl_idle();
+                ns[machine][c] += host_time_ns() - t0;
+
+                CHECK((machine) ? (frames_done(&out_usb) == 1) : (count(&out_usb, "ok\r\n") == 1));
+            }
+        }
+
+        if (machine)
+        {
+            rx_put_frame(usbRx, 0, "MACHINE 0");
+            ctrl_idle();
+            CHECK(!machine_mode_is_on());
+        }
+    }
+
+    for (int c = 0; c < n_cmds; c++)
+    {
+        printf("rx %-11s %.0f round trips/s on the CLI, %.0f in the machine mode\n", cmds[c],
+               BENCH_TRIPS * 1e9 / ns[0][c], BENCH_TRIPS * 1e9 / ns[1][c]);
+    }
+    out_clear();
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+    set_uartEn(true);
+    port_tx_register(TX_PRODUCER_CTRL);
+
+    test_interleave();
+    test_fair();
+    test_stress();
+    test_machine();
+    printf("test_rx: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file      test_skb_pool.c
+ *
+ * @brief     Host test of the socket buffer pool from concurrent threads, and its benchmark against the heap of the firmware
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "skb_pool.h"
+
+/* The per-frame path before the pool: heap_4 of the nRF5 SDK when the Makefile finds it, else the host's malloc */
+#ifdef HOST_HEAP_4
+#define HEAP_NAME    "heap_4"
+#define heap_alloc   pvPortMalloc
+#define heap_free    vPortFree
+#else
+#define HEAP_NAME    "host malloc"
+#define heap_alloc   malloc
+#define heap_free    free
+#endif
+
+#define STRESS_THREADS 3      /**< the MCPS task, the RX interrupt and the deep sleep timer */
+#define STRESS_ROUNDS  200000 /**< allocations tried by each thread */
+#define STRESS_HELD    3
+#define BENCH_FRAMES   200000
+#define BENCH_LIVE     24     /**< blocks the other tasks hold in the heap meanwhile */
+#define TX_FRAME_LEN   100    /**< payload of a frame sent after a deep sleep */
+
+static void test_limits(void)
+{
+    const struct skb_pool_stats_s *stats = skb_pool_get_stats();
+    struct sk_buff *all[SKB_POOL_LEN];
+    int x;
+
+    skb_pool_reset_stats();
+    CHECK(stats->in_use == 0);
+
+    /* every entry once, each with a payload of its own */
+    for (int i = 0; i < SKB_POOL_LEN; i++)
+    {
+        all[i] = skb_pool_alloc(SKB_POOL_DATA_SIZE);
+        CHECK(all[i] && all[i]->len == 0 && all[i]->data == all[i]->head);
+        CHECK(all[i]->end == all[i]->head + SKB_POOL_DATA_SIZE);
+        memset(all[i]->data, i, SKB_POOL_DATA_SIZE);
+    }
+    CHECK(skb_pool_alloc(0) == NULL);
+    CHECK(stats->exhausted == 1 && stats->in_use == SKB_POOL_LEN && stats->peak == SKB_POOL_LEN);
+
+    /* the payload is released with its buffer, a pointer out of the pool is not the pool's */
+    CHECK(skb_pool_free(all[0]->data));
+    CHECK(skb_pool_alloc(0) == NULL);
+    CHECK(!skb_pool_free(&x));
+    CHECK(skb_pool_free(all[0]));
+    CHECK(skb_pool_alloc(SKB_POOL_DATA_SIZE + 1) == NULL);
+    all[0] = skb_pool_alloc(1);
+    CHECK(all[0] != NULL);
+
+    for (int i = 1; i < SKB_POOL_LEN; i++)
+    {
+        for (int k = 0; k < SKB_POOL_DATA_SIZE; k++)
+        {
+            CHECK(all[i]->data[k] == i);
+        }
+    }
+    for (int i = 0; i < SKB_POOL_LEN; i++)
+    {
+        CHECK(skb_pool_free(all[i]));
+    }
+    CHECK(stats->in_use == 0 && stats->allocs == SKB_POOL_LEN + 1 && stats->exhausted == 3);
+}
+
+static uint32_t stress_got[STRESS_THREADS], stress_refused[STRESS_THREADS];
+
+/* an entry is held by one thread only: its mark survives the other threads.
+ * The threads hold up to STRESS_HELD entries each, more than the pool has */
+static void *stress_thread(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    struct sk_buff *held[STRESS_HELD] = {NULL};
+
+    for (uint32_t i = 0; i < STRESS_ROUNDS; i++)
+    {
+        struct sk_buff **s = &held[i % STRESS_HELD];
+        uint8_t mark = (uint8_t)(id * 64 + i);
+
+        if (*s)
+        {
+            CHECK((*s)->len == (unsigned int)id + 1 && (*s)->data[0] == (uint8_t)(mark - STRESS_HELD));
+            CHECK((*s)->data[SKB_POOL_DATA_SIZE - 1] == (uint8_t)(mark - STRESS_HELD));
+            CHECK(skb_pool_free(*s));
+        }
+        *s = skb_pool_alloc((i % 3) ? (SKB_POOL_DATA_SIZE) : (0));
+        if (!*s)
+        {
+            stress_refused[id]++;
+            continue;
+        }
+        stress_got[id]++;
+        (*s)->len = id + 1;
+        (*s)->data[0] = mark;
+        (*s)->data[SKB_POOL_DATA_SIZE - 1] = mark;
+        if (i % 8 == 0)
+        {
+            sched_yield();
+        }
+    }
+    for (int k = 0; k < STRESS_HELD; k++)
+    {
+        if (held[k])
+        {
+            CHECK(skb_pool_free(held[k]));
+        }
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    const struct skb_pool_stats_s *stats = skb_pool_get_stats();
+    pthread_t t[STRESS_THREADS];
+    uint32_t got = 0, refused = 0;
+
+    skb_pool_reset_stats();
+    for (int i = 0; i < STRESS_THREADS; i++)
+    {
+        CHECK(pthread_create(&t[i], NULL, stress_thread, (void *)(intptr_t)i) == 0);
+    }
+    for (int i = 0; i < STRESS_THREADS; i++)
+    {
+        pthread_join(t[i], NULL);
+        got += stress_got[i];
+        refused += stress_refused[i];
+    }
+
+    CHECK(stats->in_use == 0);
+    CHECK(stats->allocs == got && stats->exhausted == refused && refused > 0);
+    CHECK(stats->peak == SKB_POOL_LEN);
+    printf("skb_pool: %d threads, %u allocations, %u exhausted, peak %u of %d\n",
+           STRESS_THREADS, got, refused, stats->peak, SKB_POOL_LEN);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* mean, median, 99th and 99.9th percentiles of the times of the frames, ns, the time of the clock taken off.
+ * The worst times of a host are those of its scheduler, they are not shown */
+static void bench_print(const char *what, uint32_t *ns, int n, uint32_t clock_ns)
+{
+    uint64_t sum = 0;
+
+    qsort(ns, n, sizeof(ns[0]), cmp_u32);
+    for (int i = 0; i < n; i++)
+    {
+        ns[i] = (ns[i] > clock_ns) ? (ns[i] - clock_ns) : (0);
+        sum += ns[i];
+    }
+    printf(" %s %.0f/%u/%u/%u", what, (double)sum / n, ns[n / 2], ns[n * 99 / 100], ns[n * 999 / 1000]);
+}
+
+/* the median time of reading the clock twice */
+static uint32_t bench_clock(void)
+{
+    static uint32_t t[BENCH_FRAMES];
+
+    for (int i = 0; i < BENCH_FRAMES; i++)
+    {
+        uint64_t t0 = host_time_ns();
+
+        t[i] = (uint32_t)(host_time_ns() - t0);
+    }
+    qsort(t, BENCH_FRAMES, sizeof(t[0]), cmp_u32);
+    return t[BENCH_FRAMES / 2];
+}
+
+/* The time of the buffers of a frame: the RX frame takes its sk_buff only,
+ * the TX deferred across a deep sleep a sk_buff and its payload */
+static void bench(bool tx, uint32_t clock_ns)
+{
+    static uint32_t t_pool[BENCH_FRAMES], t_heap[BENCH_FRAMES];
+    void *live[BENCH_LIVE] = {NULL};
+    uint32_t seed = 1;
+
+    for (int i = 0; i < BENCH_FRAMES; i++)
+    {
+        uint64_t t0, t1;
+
+        /* the other tasks keep the heap fragmented */
+        seed = seed * 1103515245u + 12345u;
+        heap_free(live[(seed >> 16) % BENCH_LIVE]);
+        live[(seed >> 16) % BENCH_LIVE] = heap_alloc(16 + (seed >> 8) % 496);
+
+        t0 = host_time_ns();
+        struct sk_buff *skb = skb_pool_alloc((tx) ? (TX_FRAME_LEN) : (0));
+        skb_pool_free(skb);
+        t1 = host_time_ns();
+        t_pool[i] = (uint32_t)(t1 - t0);
+        CHECK(skb != NULL);
+
+        t0 = host_time_ns();
+        struct sk_buff *h = heap_alloc(sizeof(struct sk_buff));
+        uint8_t *data = (tx) ? (heap_alloc(TX_FRAME_LEN)) : (NULL);
+        heap_free(data);
+        heap_free(h);
+        t1 = host_time_ns();
+        t_heap[i] = (uint32_t)(t1 - t0);
+        CHECK(h != NULL && (!tx || data != NULL));
+    }
+    for (int i = 0; i < BENCH_LIVE; i++)
+    {
+        heap_free(live[i]);
+    }
+
+    printf("skb_pool: %s frame, ns mean/median/p99/p99.9:", (tx) ? ("TX") : ("RX"));
+    bench_print("pool", t_pool, BENCH_FRAMES, clock_ns);
+    bench_print(HEAP_NAME, t_heap, BENCH_FRAMES, clock_ns);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_limits();
+    test_threads();
+    printf("test_skb_pool: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        uint32_t clock_ns = bench_clock();
+
+        bench(false, clock_ns);
+        bench(true, clock_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+/**
+ * @file      test_str_fmt.c
+ *
+ * @brief     Host test of str_fmt against the printf conversions it replaces, and its throughput
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "str_fmt.h"
+
+#define RANDOM_ROUNDS 300000
+#define BENCH_ROUNDS  100000
+#define MAX_RESP      8
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static void check_same(const char *expected, const char *buf, int len)
+{
+    if (len != (int)strlen(expected) || memcmp(expected, buf, len) != 0)
+    {
+        fprintf(stderr, "expected \"%s\", got \"%.*s\"\n", expected, (len < 0) ? (0) : (len), buf);
+        CHECK(0);
+    }
+}
+
+/* as fira_app.c before str_fmt */
+static float convert_aoa_2pi_q16_to_deg(int16_t aoa_2pi_q16)
+{
+    return (360.0 * aoa_2pi_q16 / (1 << 16));
+}
+
+static void test_q16_deg(void)
+{
+    char exp[32], buf[32];
+
+    for (int32_t a = INT16_MIN; a <= INT16_MAX; a++)
+    {
+        snprintf(exp, sizeof(exp), "%0.2f", convert_aoa_2pi_q16_to_deg((int16_t)a));
+        check_same(exp, buf, fmt_q16_deg(buf, 0, sizeof(buf), a));
+    }
+}
+
+static void test_random(void)
+{
+    char exp[64], buf[64];
+
+    for (int i = 0; i < RANDOM_ROUNDS; i++)
+    {
+        int32_t v = (int32_t)rnd();
+        int q = rnd() % 17;
+        int d = rnd() % 4;
+        uint32_t u = rnd();
+        float f;
+
+        snprintf(exp, sizeof(exp), "%d", (int)v);
+        check_same(exp, buf, fmt_int(buf, 0, sizeof(buf), v));
+        snprintf(exp, sizeof(exp), "%u", (unsigned)v);
+        check_same(exp, buf, fmt_uint(buf, 0, sizeof(buf), (uint32_t)v));
+        snprintf(exp, sizeof(exp), "%04x", (unsigned)v & 0xFFFF);
+        check_same(exp, buf, fmt_hex(buf, 0, sizeof(buf), (uint32_t)v & 0xFFFF, 4, false));
+        snprintf(exp, sizeof(exp), "%06X", (unsigned)v);
+        check_same(exp, buf, fmt_hex(buf, 0, sizeof(buf), (uint32_t)v, 6, true));
+        snprintf(exp, sizeof(exp), "%.2f", (double)v / (1 << q));
+        check_same(exp, buf, fmt_q(buf, 0, sizeof(buf), v, q, 2));
+
+        /* any float of the range, and the RSSI of the diagnostics */
+        memcpy(&f, &u, sizeof(f));
+        if (f > -2e9f && f < 2e9f)
+        {
+            snprintf(exp, sizeof(exp), "%.*f", d, f);
+            check_same(exp, buf, fmt_float(buf, 0, sizeof(buf), f, d));
+        }
+        f = -(float)(u % 200000) / 1000.0f;
+        snprintf(exp, sizeof(exp), "%.1f", f);
+        check_same(exp, buf, fmt_float(buf, 0, sizeof(buf), f, 1));
+    }
+}
+
+static void test_limits(void)
+{
+    char exp[32], buf[32];
+
+    snprintf(exp, sizeof(exp), "%d", (int)INT32_MIN);
+    check_same(exp, buf, fmt_int(buf, 0, sizeof(buf), INT32_MIN));
+    snprintf(exp, sizeof(exp), "%u", (unsigned)UINT32_MAX);
+    check_same(exp, buf, fmt_uint(buf, 0, sizeof(buf), UINT32_MAX));
+    check_same("-0.0", buf, fmt_float(buf, 0, sizeof(buf), -0.0f, 1));
+    check_same("-0.01", buf, fmt_q(buf, 0, sizeof(buf), -1, 7, 2));
+
+    /* nothing is written beyond max, and an error is passed through a chain */
+    memset(buf, '#', sizeof(buf));
+    CHECK(fmt_str(buf, 0, 3, "abcd") == -1 && buf[0] == '#');
+    CHECK(fmt_str(buf, 0, 4, "abcd") == 4 && buf[4] == '#');
+    CHECK(fmt_int(buf, 0, 2, -10) == -1);
+    CHECK(fmt_int(buf, -1, sizeof(buf), 5) == -1);
+    CHECK(fmt_char(buf, 4, 4, 'x') == -1 && buf[4] == '#');
+}
+
+struct meas_s
+{
+    uint16_t short_addr;
+    uint8_t status;
+    int32_t distance_mm;
+    int16_t pdoa_2pi;
+    int16_t aoa_2pi;
+    uint8_t aoa_fom;
+    int16_t remote_aoa_2pi;
+};
+
+struct block_s
+{
+    uint32_t block_index;
+    int n;
+    struct meas_s meas[MAX_RESP];
+    int32_t cfo_100ppm;
+    float rssi;
+    int nlos;
+};
+
+static void make_block(struct block_s *b)
+{
+    b->block_index = rnd() >> (rnd() % 32);
+    b->n = 1 + rnd() % MAX_RESP;
+    b->cfo_100ppm = (int32_t)(rnd() % 8001) - 4000;
+    b->rssi = (rnd() % 4) ? (-(float)(rnd() % 1200) / 10.0f) : (0.0f);
+    b->nlos = rnd() % 101;
+    for (int i = 0; i < b->n; i++)
+    {
+        b->meas[i] = (struct meas_s){
+            .short_addr = (uint16_t)rnd(),
+            .status = (rnd() % 8) == 0,
+            .distance_mm = (int32_t)(rnd() % 200000) - 1000,
+            .pdoa_2pi = (int16_t)rnd(),
+            .aoa_2pi = (int16_t)rnd(),
+            .aoa_fom = (uint8_t)rnd(),
+            .remote_aoa_2pi = (int16_t)rnd(),
+        };
+    }
+}
+
+/* the ranging report with PDoA and diagnostics, as report_cb() and fira_uwb_add_diag() printed it */
+static int report_snprintf(char *str, int max, const struct block_s *b)
+{
+    int len = snprintf(str, max, "{\"Block\":%" PRIu32 ", \"results\":[", b->block_index);
+
+    for (int i = 0; i < b->n; i++)
+    {
+        const struct meas_s *rm = &b->meas[i];
+
+        if (i > 0)
+        {
+            len += snprintf(&str[len], max - len, ",");
+        }
+        len += snprintf(&str[len], max - len, "{\"Addr\":\"0x%04x\",\"Status\":\"%s\"", rm->short_addr,
+                        (rm->status) ? ("Err") : ("Ok"));
+        if (rm->status == 0)
+        {
+            len += snprintf(&str[len], max - len, ",\"D_cm\":%d", (int)(rm->distance_mm / 10));
+            len += snprintf(&str[len], max - len, ",\"LPDoA_deg\":%0.2f,\"LAoA_deg\":%0.2f,\"LFoM\":%d,\"RAoA_deg\":%0.2f",
+                            convert_aoa_2pi_q16_to_deg(rm->pdoa_2pi), convert_aoa_2pi_q16_to_deg(rm->aoa_2pi),
+                            rm->aoa_fom, convert_aoa_2pi_q16_to_deg(rm->remote_aoa_2pi));
+            len += snprintf(&str[len], max - len, ",\"CFO_100ppm\":%d", (int)b->cfo_100ppm);
+        }
+        len += snprintf(&str[len], max - len, "}");
+    }
+    len += snprintf(&str[len], max - len, "]");
+    if (b->rssi < 0.0)
+    {
+        len += snprintf(&str[len], max - len, ",\"RSSI_dBm\":\"%.1f\"", b->rssi);
+    }
+    else
+    {
+        len += snprintf(&str[len], max - len, ",\"RSSI_dBm\":\"Invalid\"");
+    }
+    len += snprintf(&str[len], max - len, ",\"NLOS_%%\":%d", b->nlos);
+    len += snprintf(&str[len], max - len, "}\r\n");
+    return len;
+}
+
+/* the same report as report_send() and fira_uwb_add_diag() print it now */
+static int report_fmt(char *str, int max, const struct block_s *b)
+{
+    int len = fmt_str(str, 0, max, "{\"Block\":");
+
+    len = fmt_uint(str, len, max, b->block_index);
+    len = fmt_str(str, len, max, ", \"results\":[");
+    for (int i = 0; i < b->n; i++)
+    {
+        const struct meas_s *rm = &b->meas[i];
+
+        if (i > 0)
+        {
+            len = fmt_char(str, len, max, ',');
+        }
+        len = fmt_str(str, len, max, "{\"Addr\":\"0x");
+        len = fmt_hex(str, len, max, rm->short_addr, 4, false);
+        len = fmt_str(str, len, max, (rm->status) ? ("\",\"Status\":\"Err\"") : ("\",\"Status\":\"Ok\""));
+        if (rm->status == 0)
+        {
+            len = fmt_str(str, len, max, ",\"D_cm\":");
+            len = fmt_int(str, len, max, rm->distance_mm / 10);
+            len = fmt_str(str, len, max, ",\"LPDoA_deg\":");
+            len = fmt_q16_deg(str, len, max, rm->pdoa_2pi);
+            len = fmt_str(str, len, max, ",\"LAoA_deg\":");
+            len = fmt_q16_deg(str, len, max, rm->aoa_2pi);
+            len = fmt_str(str, len, max, ",\"LFoM\":");
+            len = fmt_int(str, len, max, rm->aoa_fom);
+            len = fmt_str(str, len, max, ",\"RAoA_deg\":");
+            len = fmt_q16_deg(str, len, max, rm->remote_aoa_2pi);
+            len = fmt_str(str, len, max, ",\"CFO_100ppm\":");
+            len = fmt_int(str, len, max, b->cfo_100ppm);
+        }
+        len = fmt_char(str, len, max, '}');
+    }
+    len = fmt_char(str, len, max, ']');
+    if (b->rssi < 0.0)
+    {
+        len = fmt_str(str, len, max, ",\"RSSI_dBm\":\"");
+        len = fmt_float(str, len, max, b->rssi, 1);
+        len = fmt_char(str, len, max, '"');
+    }
+    else
+    {
+        len = fmt_str(str, len, max, ",\"RSSI_dBm\":\"Invalid\"");
+    }
+    len = fmt_str(str, len, max, ",\"NLOS_%\":");
+    len = fmt_int(str, len, max, b->nlos);
+    return fmt_str(str, len, max, "}\r\n");
+}
+
+static void test_report(void)
+{
+    static char exp[256 * MAX_RESP], buf[256 * MAX_RESP];
+    struct block_s b;
+
+    for (int i = 0; i < 20000; i++)
+    {
+        make_block(&b);
+        report_snprintf(exp, sizeof(exp), &b);
+        check_same(exp, buf, report_fmt(buf, sizeof(buf), &b));
+    }
+}
+
+static void bench(void)
+{
+    static char str[256 * MAX_RESP];
+    static struct block_s blocks[64];
+    volatile int sink = 0;
+    uint64_t t0, printf_ns, fmt_ns;
+
+    for (int i = 0; i < 64; i++)
+    {
+        make_block(&blocks[i]);
+        blocks[i].n = 4;
+        for (int k = 0; k < 4; k++)
+        {
+            blocks[i].meas[k].status = 0;
+        }
+    }
+
+    t0 = host_time_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sink += report_snprintf(str, sizeof(str), &blocks[i % 64]);
+    }
+    printf_ns = host_time_ns() - t0;
+
+    t0 = host_time_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sink += report_fmt(str, sizeof(str), &blocks[i % 64]);
+    }
+    fmt_ns = host_time_ns() - t0;
+
+    printf("str_fmt: report of 4 responders with PDoA and diagnostics, snprintf %.0f ns, str_fmt %.0f ns\n",
+           (double)printf_ns / BENCH_ROUNDS, (double)fmt_ns / BENCH_ROUNDS);
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+
+    test_q16_deg();
+    test_random();
+    test_limits();
+    test_report();
+    printf("test_str_fmt: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
@@ -0,0 +1,456 @@
+/**
+ * @file      test_tx.c
+ *
+ * @brief     Host test of the report buffer of usb_uart_tx.c
+ *
+ * @author    Decawave Applications
+ *
+ * @attention Copyright (c) 2021 - 2022, Qorvo US, Inc.
+ * All rights reserved
+ * Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *  list of conditions, and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ * 3. You may only use this software, with or without any modification, with an
+ *  integrated circuit developed by Qorvo US, Inc. or any of its affiliates
+ *  (collectively, "Qorvo"), or any module that contains such integrated circuit.
+ * 4. You may not reverse engineer, disassemble, decompile, decode, adapt, or
+ *  otherwise attempt to derive or gain access to the source code to any software
+ *  distributed under this license in binary or object code form, in whole or in
+ *  part.
+ * 5. You may not use any Qorvo name, trademarks, service marks, trade dress,
+ *  logos, trade names, or other symbols or insignia identifying the source of
+ *  Qorvo's products or services, or the names of any of Qorvo's developers to
+ *  endorse or promote products derived from this software without specific prior
+ *  written permission from Qorvo US, Inc. You must not call products derived from
+ *  this software "Qorvo", you must not have "Qorvo" appear in their name, without
+ *  the prior permission from Qorvo US, Inc.
+ * 6. Qorvo may publish revised or new version of this license from time to time.
+ *  No one other than Qorvo US, Inc. has the right to modify the terms applicable
+ *  to the software provided under this license.
+ * THIS SOFTWARE IS PROVIDED BY QORVO US, INC. "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. NEITHER
+ *  QORVO, NOR ANY PERSON ASSOCIATED WITH QORVO MAKES ANY WARRANTY OR
+ *  REPRESENTATION WITH RESPECT TO THE COMPLETENESS, SECURITY, RELIABILITY, OR
+ *  ACCURACY OF THE SOFTWARE, THAT IT IS ERROR FREE OR THAT ANY DEFECTS WILL BE
+ *  CORRECTED, OR THAT THE SOFTWARE WILL OTHERWISE MEET YOUR NEEDS OR EXPECTATIONS.
+ * IN NO EVENT SHALL QORVO OR ANYBODY ASSOCIATED WITH QORVO BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ *  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host.h"
+#include "usb_uart_tx.h"
+#include "str_fmt.h"
+#include "HAL_uart.h"
+#include "HAL_usb.h"
+#include "InterfUsb.h"
+
+#define REPORT_MAX    (256 * 8) /**< the reservation of report_send() for 8 responders */
+#define BENCH_BLOCKS  2000
+
+#define STRESS_PRODUCERS 4    /**< the report task, the control task and two tasks sharing the diag ring */
+#define STRESS_MSGS      8000 /**< messages of each producer */
+
+/* The USB: the bytes of the packets gathered in ubuf are the bytes copied by the flush */
+static uint8_t *tx_ubuf;
+static uint32_t tx_copied;
+
+static bool test_usb_transmit(uint8_t *tx_buffer, int size)
+{
+    if (!tx_ubuf)
+    {
+        tx_ubuf = tx_buffer; /**< see find_ubuf() */
+    }
+    else if (tx_buffer == tx_ubuf)
+    {
+        tx_copied += size;
+    }
+    return deca_uart_transmit(tx_buffer, (uint16_t)size);
+}
+
+static bool test_usb_tx_empty(void)
+{
+    return true;
+}
+
+const struct hal_usb_s Usb = {
+    .transmit = test_usb_transmit,
+    .isTxBufferEmpty = test_usb_tx_empty,
+};
+
+static void tx_drain(void)
+{
+    int due;
+
+    while ((due = flush_report_due_ms()) >= 0)
+    {
+        host_cycles_add(due * 1000);
+        flush_report_buf();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+}
+
+/* a ranging report of n responders, as report_send() without the PDoA fields */
+static int fmt_report(char *str, int max, uint32_t block, int n)
+{
+    int len = fmt_str(str, 0, max, "{\"Block\":");
+
+    len = fmt_uint(str, len, max, block);
+    len = fmt_str(str, len, max, ", \"results\":[");
+    for (int i = 0; i < n; i++)
+    {
+        len = fmt_str(str, len, max, (i > 0) ? (",{\"Addr\":\"0x") : ("{\"Addr\":\"0x"));
+        len = fmt_hex(str, len, max, 0x1000 + i, 4, false);
+        len = fmt_str(str, len, max, "\",\"Status\":\"Ok\",\"D_cm\":");
+        len = fmt_int(str, len, max, (int32_t)(block % 1000) + 100 * i);
+        len = fmt_str(str, len, max, ",\"CFO_100ppm\":");
+        len = fmt_int(str, len, max, -431);
+        len = fmt_char(str, len, max, '}');
+    }
+    return fmt_str(str, len, max, "]}\r\n");
+}
+
+/* the transmission of a short message shows which buffer gathers the packets */
+static void find_ubuf(void)
+{
+    port_tx_msg((uint8_t *)"x", 1);
+    tx_drain();
+    CHECK(tx_ubuf != NULL);
+    host_tx_clear();
+}
+
+/* the reports formatted in the ring and sent, then the same reports copied to the ring */
+static void test_reserve_commit(void)
+{
+    char ref[REPORT_MAX];
+    int out_len, len;
+
+    host_tx_clear();
+    for (int b = 0; b < 100; b++)
+    {
+        uint8_t *p = reserve_tx_msg(REPORT_MAX, TX_CLASS_RANGING);
+
+        CHECK(p != NULL);
+        len = fmt_report((char *)p, REPORT_MAX, b, b % 9);
+        CHECK(len > 0);
+        CHECK(commit_tx_msg(len) == _NO_ERR);
+        tx_drain();
+
+        const uint8_t *out = host_tx_data(&out_len);
+
+        CHECK(out_len == len && memcmp(out, p, len) == 0);
+        CHECK(fmt_report(ref, sizeof(ref), b, b % 9) == len && memcmp(out, ref, len) == 0);
+        host_tx_clear();
+
+        CHECK(port_tx_msg((uint8_t *)ref, len) == _NO_ERR);
+        tx_drain();
+        out = host_tx_data(&out_len);
+        CHECK(out_len == len && memcmp(out, ref, len) == 0);
+        host_tx_clear();
+    }
+
+    /* a dropped reservation sends nothing */
+    CHECK(reserve_tx_msg(16, TX_CLASS_RANGING) != NULL);
+    CHECK(commit_tx_msg(0) == _NO_ERR);
+    tx_drain();
+    host_tx_data(&out_len);
+    CHECK(out_len == 0);
+}
+
+/* Multi-producer stress: each producer numbers its messages "<p:n:" padded with its letter up to ">",
+ * the flushing thread runs as FlushTask. Every message accepted shall be received once, whole, and
+ * in the order of its producer; the counters of the rings shall match what the producers saw.
+ * The report task commits some of its messages in three parts, port_tx_commit_more(). */
+struct stress_producer_s
+{
+    int id;
+    tx_producer_e ring;
+    int max_pad;
+    uint32_t accepted;
+    uint32_t refused;
+    uint32_t parts; /**< records of the messages in parts, beyond one per message */
+};
+
+static volatile int stress_running;
+
+static void *stress_produce(void *arg)
+{
+    struct stress_producer_s *p = arg;
+    uint32_t rnd = 0x9E3779B9u * (p->id + 1);
+    char msg[400];
+
+    if (p->ring != TX_PRODUCER_DIAG)
+    {
+        port_tx_register(p->ring);
+    }
+
+    while (p->accepted < STRESS_MSGS)
+    {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+
+        int len = fmt_char(msg, 0, sizeof(msg), '<');
+
+        len = fmt_uint(msg, len, sizeof(msg), p->id);
+        len = fmt_char(msg, len, sizeof(msg), ':');
+        len = fmt_uint(msg, len, sizeof(msg), p->accepted);
+        len = fmt_char(msg, len, sizeof(msg), ':');
+        for (int pad = rnd % p->max_pad; pad > 0; pad--)
+        {
+            msg[len++] = 'a' + p->id;
+        }
+        msg[len++] = '>';
+
+        bool ok;
+
+        if (p->ring == TX_PRODUCER_REPORT && (rnd & 0x600) == 0)
+        {
+            int cut[4] = {0, len / 3, 2 * len / 3, len};
+
+            ok = port_tx_room_n(3, len);
+            for (int k = 0; ok && k < 3; k++)
+            {
+                uint8_t *dst = reserve_tx_msg(len, TX_CLASS_AUTO);
+
+                CHECK(dst != NULL);
+                memcpy(dst, &msg[cut[k]], cut[k + 1] - cut[k]);
+                if (k < 2)
+                {
+                    port_tx_commit_more(cut[k + 1] - cut[k]);
+                    sched_yield(); /**< the flushing thread waits for the next part */
+                }
+                else
+                {
+                    port_tx_commit(cut[k + 1] - cut[k]);
+                }
+            }
+            if (!ok)
+            {
+                sched_yield();
+                continue; /**< not counted as refused: nothing was reserved */
+            }
+            p->parts += 2;
+        }
+        else if (rnd & 0x100)
+        {
+            ok = (port_tx_msg((uint8_t *)msg, len) == _NO_ERR);
+        }
+        else
+        {
+            uint8_t *dst = reserve_tx_msg(len, TX_CLASS_AUTO);
+
+            ok = (dst != NULL);
+            if (ok)
+            {
+                if ((rnd & 0x3000) == 0)
+                {
+                    sched_yield(); /**< preempted between the reservation and the commit */
+                }
+                memcpy(dst, msg, len);
+                port_tx_commit(len);
+            }
+        }
+
+        if (ok)
+        {
+            p->accepted++;
+        }
+        else
+        {
+            p->refused++;
+            sched_yield(); /**< the flushing thread makes room */
+        }
+    }
+    return NULL;
+}
+
+static void *stress_flush(void *arg)
+{
+    int due;
+
+    while (stress_running || flush_report_due_ms() >= 0)
+    {
+        due = flush_report_due_ms();
+        if (due > 0)
+        {
+            host_cycles_add(due * 1000);
+        }
+        flush_report_buf();
+        sched_yield();
+    }
+    flush_report_buf(); /**< releases the last transfer of the USB */
+    return NULL;
+}
+
+/* the tasks which wait for the flush, port_tx_wait_flushed(), poll the deadline while the flushing thread sends */
+static void *stress_wait(void *arg)
+{
+    while (stress_running)
+    {
+        flush_report_due_ms();
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void test_stress(void)
+{
+    struct stress_producer_s prod[STRESS_PRODUCERS] = {
+        {.id = 0, .ring = TX_PRODUCER_REPORT, .max_pad = 250},
+        {.id = 1, .ring = TX_PRODUCER_CTRL, .max_pad = 40},
+        {.id = 2, .ring = TX_PRODUCER_DIAG, .max_pad = 30},
+        {.id = 3, .ring = TX_PRODUCER_DIAG, .max_pad = 30},
+    };
+    struct tx_stats_s before[TX_PRODUCER_MAX];
+    pthread_t th[STRESS_PRODUCERS], flusher, waiter;
+    uint32_t next[STRESS_PRODUCERS] = {0};
+    int out_len, i = 0;
+
+    for (int r = 0; r < TX_PRODUCER_MAX; r++)
+    {
+        before[r] = *get_tx_stats(r);
+    }
+    host_tx_clear();
+
+    stress_running = 1;
+    pthread_create(&flusher, NULL, stress_flush, NULL);
+    pthread_create(&waiter, NULL, stress_wait, NULL);
+    for (int k = 0; k < STRESS_PRODUCERS; k++)
+    {
+        pthread_create(&th[k], NULL, stress_produce, &prod[k]);
+    }
+    for (int k = 0; k < STRESS_PRODUCERS; k++)
+    {
+        pthread_join(th[k], NULL);
+    }
+    stress_running = 0;
+    pthread_join(waiter, NULL);
+    pthread_join(flusher, NULL);
+
+    const uint8_t *out = host_tx_data(&out_len);
+
+    while (i < out_len)
+    {
+        unsigned id = 0, n = 0;
+        int j = i + 1;
+
+        CHECK(out[i] == '<');
+        for (; out[j] != ':'; j++)
+        {
+            id = id * 10 + out[j] - '0';
+        }
+        for (j++; out[j] != ':'; j++)
+        {
+            n = n * 10 + out[j] - '0';
+        }
+        CHECK(id < STRESS_PRODUCERS && n == next[id]);
+        for (j++; j < out_len && out[j] != '>'; j++)
+        {
+            CHECK(out[j] == 'a' + id);
+        }
+        CHECK(j < out_len);
+        next[id]++;
+        i = j + 1;
+    }
+
+    for (int k = 0; k < STRESS_PRODUCERS; k++)
+    {
+        CHECK(next[k] == STRESS_MSGS);
+    }
+
+    const struct tx_stats_s *report = get_tx_stats(TX_PRODUCER_REPORT);
+    const struct tx_stats_s *ctrl = get_tx_stats(TX_PRODUCER_CTRL);
+    const struct tx_stats_s *diag = get_tx_stats(TX_PRODUCER_DIAG);
+
+    CHECK(prod[0].parts > 0);
+    CHECK(report->enqueued - before[TX_PRODUCER_REPORT].enqueued == STRESS_MSGS + prod[0].parts);
+    CHECK(report->dropped - before[TX_PRODUCER_REPORT].dropped == prod[0].refused);
+    CHECK(ctrl->enqueued - before[TX_PRODUCER_CTRL].enqueued == STRESS_MSGS);
+    CHECK(ctrl->dropped - before[TX_PRODUCER_CTRL].dropped == prod[1].refused);
+    CHECK(diag->enqueued - before[TX_PRODUCER_DIAG].enqueued == 2 * STRESS_MSGS);
+    CHECK(diag->dropped - before[TX_PRODUCER_DIAG].dropped == prod[2].refused + prod[3].refused);
+    for (int c = 0; c < TX_CLASS_MAX; c++)
+    {
+        CHECK(get_tx_class_stats(c)->pending == 0);
+    }
+    CHECK(flush_report_due_ms() < 0);
+
+    printf("tx: stress %d bytes, refused %u %u %u %u, %u messages in parts\n", out_len, prod[0].refused,
+           prod[1].refused, prod[2].refused, prod[3].refused, prod[0].parts / 2);
+    host_tx_clear();
+}
+
+/* bytes copied per reported block: formatted in a buffer then copied to the ring, against formatted in the ring.
+ * Before the reservation, every byte was copied to the ring then to ubuf. Now the flush gathers in ubuf
+ * only the ends of the messages shorter than a packet. */
+static void bench(void)
+{
+    static const int resp[] = {1, 4, 8};
+    static char str[REPORT_MAX];
+
+    for (unsigned r = 0; r < sizeof(resp) / sizeof(resp[0]); r++)
+    {
+        int n = resp[r];
+        uint32_t bytes = 0, copy_copied;
+
+        tx_copied = 0;
+        for (int b = 0; b < BENCH_BLOCKS; b++)
+        {
+            int len = fmt_report(str, sizeof(str), b, n);
+
+            port_tx_msg((uint8_t *)str, len);
+            tx_copied += len; /**< copy_tx_msg() */
+            bytes += len;
+            tx_drain();
+            host_tx_clear();
+        }
+
+        copy_copied = tx_copied;
+        tx_copied = 0;
+        for (int b = 0; b < BENCH_BLOCKS; b++)
+        {
+            uint8_t *p = reserve_tx_msg(REPORT_MAX, TX_CLASS_RANGING);
+
+            commit_tx_msg(fmt_report((char *)p, REPORT_MAX, b, n));
+            tx_drain();
+            host_tx_clear();
+        }
+
+        printf("tx: %d responders, %u bytes/block, bytes copied/block: %u before the reservation, "
+               "%u with copy_tx_msg(), %u with reserve_tx_msg()\n",
+               n, bytes / BENCH_BLOCKS, 2 * bytes / BENCH_BLOCKS, copy_copied / BENCH_BLOCKS, tx_copied / BENCH_BLOCKS);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    host_init();
+    find_ubuf();
+
+    test_reserve_commit();
+    test_stress();
+    printf("test_tx: ok\n");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        bench();
+    }
+    return 0;
+}
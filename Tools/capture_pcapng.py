@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Converts the frames captured by the CAPTURE command to pcapng, for Wireshark.
+
+The input is the raw byte stream read from the port of the board, the REPORT_BIN_TYPE_FRAME
+frames are found in it by their sync byte and CRC, everything else is skipped.
+The link type is IEEE 802.15.4 without FCS. A packet is stamped with the cycle counter of the capture,
+in ns from --epoch; its comment gives the direction, the RMARKER in RCTU, the CFO, the STS packet
+configuration and the RSSI of the sender when the diagnostics computed it.
+
+  capture_pcapng.py capture.bin out.pcapng
+"""
+
+import argparse
+import struct
+import sys
+
+from trace_decode import report_bin_frames
+
+REPORT_BIN_TYPE_FRAME = 6
+FRAME_HDR_LEN = 19
+RSSI_INVALID = -0x8000
+
+# MCPS_CAPTURE_FLAG_xx of mcps_capture.h
+FLAG_TX = 0x01
+FLAG_DELAYED = 0x02
+FLAG_ND = 0x04
+FLAG_CUT = 0x08
+STS_UNKNOWN = 0xFF
+
+LINKTYPE_IEEE802_15_4_NOFCS = 230
+
+
+def parse(data):
+    """yields a dict per captured frame, in the order of the stream"""
+    for p in report_bin_frames(data, REPORT_BIN_TYPE_FRAME):
+        if len(p) < FRAME_HDR_LEN:
+            continue
+        cpu, cycles, rctu_lo, rctu_hi, cfo, rssi, sts, flags, length = struct.unpack_from("<HIIBhhBBH", p, 0)
+        yield {
+            "cpu": cpu,
+            "cycles": cycles,
+            "rctu": rctu_lo | (rctu_hi << 32),
+            "cfo": cfo,
+            "rssi": rssi,
+            "sts": sts,
+            "flags": flags,
+            "len": length,
+            "data": bytes(p[FRAME_HDR_LEN:]),
+        }
+
+
+def comment(f):
+    s = "TX" if (f["flags"] & FLAG_TX) else "RX"
+    if (f["flags"] & FLAG_TX) and not (f["flags"] & FLAG_DELAYED):
+        s += " immediate"
+    else:
+        s += " rmarker_rctu=0x{:010x}".format(f["rctu"])
+    if f["sts"] != STS_UNKNOWN:
+        s += " sts=SP{}".format(f["sts"])
+    if f["flags"] & FLAG_ND:
+        s += " no_data"
+    if not (f["flags"] & FLAG_TX):
+        s += " cfo={:.2f}ppm".format(f["cfo"] / 100.0)
+    if f["rssi"] != RSSI_INVALID:
+        s += " rssi={:.1f}dBm".format(f["rssi"] / 10.0)
+    if f["flags"] & FLAG_CUT:
+        s += " cut"
+    return s
+
+
+def block(btype, body):
+    body += b"\0" * (-len(body) % 4)
+    n = len(body) + 12
+    return struct.pack("<II", btype, n) + body + struct.pack("<I", n)
+
+
+def option(code, value):
+    return struct.pack("<HH", code, len(value)) + value + b"\0" * (-len(value) % 4)
+
+
+def pcapng(frames, epoch_ns):
+    out = [block(0x0A0D0D0A, struct.pack("<IHHq", 0x1A2B3C4D, 1, 0, -1) + option(0, b"")),
+           block(0x00000001, struct.pack("<HHI", LINKTYPE_IEEE802_15_4_NOFCS, 0, 0) +
+                 option(2, b"uwb0") + option(9, bytes([9])) + option(0, b""))]
+    t_ns = 0.0
+    last = None
+    n = 0
+    for f in frames:
+        # the cycle counter wraps every 2^32 cycles, less than that is assumed between two frames
+        if last is not None:
+            t_ns += ((f["cycles"] - last) & 0xFFFFFFFF) * 1000.0 / f["cpu"]
+        last = f["cycles"]
+        ts = epoch_ns + int(t_ns)
+        body = struct.pack("<IIIII", 0, ts >> 32, ts & 0xFFFFFFFF, len(f["data"]), f["len"]) + f["data"]
+        body += b"\0" * (-len(body) % 4)
+        body += option(1, comment(f).encode()) + option(0, b"")
+        out.append(block(0x00000006, body))
+        n += 1
+    return b"".join(out), n
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", help="bytes read from the port, '-' for stdin")
+    ap.add_argument("output", help="pcapng file to write")
+    ap.add_argument("--epoch", type=float, default=0.0, help="time of the first frame, seconds since 1970")
+    args = ap.parse_args()
+
+    data = sys.stdin.buffer.read() if args.capture == "-" else open(args.capture, "rb").read()
+    out, n = pcapng(parse(data), int(args.epoch * 1e9))
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+    print("{} frames".format(n))
+
+
+if __name__ == "__main__":
+    main()
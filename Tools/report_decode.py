@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Decodes the binary ranging reports of RFORMAT 1 (BIN) and RFORMAT 2 (DELTA).
+
+The input is the raw byte stream read from the port of the board, the report_bin frames are
+found in it by their sync byte and CRC, everything else is skipped. The DELTA frames update the
+values known from the previous ones, as report_delta.c expects of the host: the decoded block has
+every responder known so far. Until the first keyframe, or after a gap in the sequence numbers which
+tells frames lost, the values of a DELTA block are stale until the next keyframe.
+
+  report_decode.py capture.bin            the reports as the JSON lines of RFORMAT 0
+  report_decode.py capture.bin --stats    bytes per block of the capture against the same blocks in JSON
+"""
+
+import argparse
+import struct
+import sys
+
+from trace_decode import CRC_LEN, HDR_LEN, REPORT_BIN_SYNC, REPORT_BIN_VERSION, crc16
+
+# report_bin_type_e of report_bin.h
+REPORT_BIN_TYPE_BLOCK = 1
+REPORT_BIN_TYPE_STOPPED = 2
+REPORT_BIN_TYPE_AGGR = 3
+REPORT_BIN_TYPE_DELTA = 4
+
+BLOCK_LEN = 6
+DIAG_LEN = 4
+MEAS_LEN = 16
+AGGR_HDR_LEN = 8
+AGGR_LEN = 22
+
+FLAG_DIAG = 0x01
+FLAG_KEY = 0x02
+RSSI_INVALID = -0x8000
+
+# the fields of a measurement record in their order, with their REPORT_BIN_DELTA_xx bit and struct format
+MEAS_FIELDS = [
+    ("status", 0x01, "B"),
+    ("fom", 0x02, "B"),
+    ("distance_mm", 0x04, "i"),
+    ("pdoa_2pi", 0x08, "h"),
+    ("aoa_2pi", 0x10, "h"),
+    ("remote_aoa_2pi", 0x20, "h"),
+    ("cfo_100ppm", 0x40, "h"),
+]
+
+STOPPED_REASONS = {0: "Stop request", 1: "Inband Stop", 2: "Max attempts"}
+
+
+def frames(data):
+    """yields (type, seq, payload, length of the frame) of every frame with a valid CRC, in a stream of any bytes"""
+    i = 0
+    while True:
+        i = data.find(bytes([REPORT_BIN_SYNC, REPORT_BIN_VERSION]), i)
+        if i < 0 or i + HDR_LEN > len(data):
+            return
+        ftype, seq, plen = struct.unpack_from("<BBH", data, i + 2)
+        end = i + HDR_LEN + plen
+        if end + CRC_LEN > len(data) or crc16(data[i:end]) != (data[end] << 8 | data[end + 1]):
+            i += 1
+            continue
+        yield ftype, seq, data[i + HDR_LEN:end], end + CRC_LEN - i
+        i = end + CRC_LEN
+
+
+def q16_deg(v):
+    """degrees of an angle in Q16 fraction of 2*pi"""
+    return v * 360.0 / 65536
+
+
+def fmt_q16_deg(v):
+    """fmt_q16_deg() of str_fmt.h: 2 decimals, the halves rounded to even"""
+    m = abs(v) * 360 * 100
+    q, rem = m >> 16, m & 0xFFFF
+    if rem > 0x8000 or (rem == 0x8000 and (q & 1)):
+        q += 1
+    return "{}{}.{:02d}".format("-" if v < 0 else "", q // 100, q % 100)
+
+
+def parse_diag(payload, off, flags):
+    """(diagnostics or None, offset of the records)"""
+    if not (flags & FLAG_DIAG):
+        return None, off
+    rssi, nlos = struct.unpack_from("<hB", payload, off)
+    return {"rssi_dbm_x10": rssi, "nlos_pct": nlos}, off + DIAG_LEN
+
+
+def parse_block(payload):
+    if len(payload) < BLOCK_LEN:
+        return None
+    index, n, flags = struct.unpack_from("<IBB", payload, 0)
+    diag, off = parse_diag(payload, BLOCK_LEN, flags)
+    if off + n * MEAS_LEN != len(payload):
+        return None
+    meas = []
+    for k in range(n):
+        v = struct.unpack_from("<HBBihhhh", payload, off + k * MEAS_LEN)
+        m = {"addr": v[0], "status": v[1], "fom": v[2], "distance_mm": v[3], "pdoa_2pi": v[4], "aoa_2pi": v[5],
+             "remote_aoa_2pi": v[6], "cfo_100ppm": v[7]}
+        meas.append(m)
+    return {"type": "block", "block": index, "diag": diag, "meas": meas}
+
+
+def parse_delta(payload):
+    """the records of a DELTA frame: (address, {field: value} of the fields of its mask)"""
+    if len(payload) < BLOCK_LEN:
+        return None
+    index, n, flags = struct.unpack_from("<IBB", payload, 0)
+    diag, off = parse_diag(payload, BLOCK_LEN, flags)
+    recs = []
+    for _ in range(n):
+        if off + 3 > len(payload):
+            return None
+        addr, mask = struct.unpack_from("<HB", payload, off)
+        off += 3
+        fields = {}
+        for name, bit, fmt in MEAS_FIELDS:
+            if mask & bit:
+                if off + struct.calcsize(fmt) > len(payload):
+                    return None
+                (fields[name],) = struct.unpack_from("<" + fmt, payload, off)
+                off += struct.calcsize(fmt)
+        recs.append((addr, fields))
+    if off != len(payload):
+        return None
+    return {"type": "delta", "block": index, "key": bool(flags & FLAG_KEY), "diag": diag, "records": recs}
+
+
+def parse_aggr(payload):
+    if len(payload) < AGGR_HDR_LEN:
+        return None
+    first, blocks, n = struct.unpack_from("<IHB", payload, 0)
+    if AGGR_HDR_LEN + n * AGGR_LEN != len(payload):
+        return None
+    aggr = []
+    for k in range(n):
+        v = struct.unpack_from("<HHHhiiiH", payload, AGGR_HDR_LEN + k * AGGR_LEN)
+        aggr.append({"addr": v[0], "ok": v[1], "err": v[2], "aoa_2pi": v[3], "d_mean_mm": v[4], "d_min_mm": v[5],
+                     "d_max_mm": v[6], "d_std_mm_x10": v[7]})
+    return {"type": "aggr", "block": first, "blocks": blocks, "aggr": aggr}
+
+
+def parse_stopped(payload):
+    if len(payload) != 1:
+        return None
+    return {"type": "stopped", "reason": payload[0]}
+
+
+PARSERS = {
+    REPORT_BIN_TYPE_BLOCK: parse_block,
+    REPORT_BIN_TYPE_STOPPED: parse_stopped,
+    REPORT_BIN_TYPE_AGGR: parse_aggr,
+    REPORT_BIN_TYPE_DELTA: parse_delta,
+}
+
+
+def decode(data):
+    """the reports of the stream in order, each with "bytes", the length of its frame, and the frames lost.
+    A DELTA frame is decoded as a block, "delta" set, "stale" set if there was no keyframe since the start
+    or since frames were lost"""
+    reports = []
+    known = {}
+    stale = True
+    lost = 0
+    last_seq = None
+    for ftype, seq, payload, flen in frames(data):
+        if last_seq is not None and (seq - last_seq - 1) & 0xFF:
+            lost += (seq - last_seq - 1) & 0xFF
+            stale = True
+        last_seq = seq
+        parser = PARSERS.get(ftype)
+        r = parser(payload) if parser else None
+        if r is None:
+            continue
+        if r["type"] == "delta":
+            if r["key"]:
+                stale = False
+            for addr, fields in r.pop("records"):
+                m = known.setdefault(addr, {"addr": addr, "status": 0, "fom": 0, "distance_mm": 0, "pdoa_2pi": 0,
+                                            "aoa_2pi": 0, "remote_aoa_2pi": 0, "cfo_100ppm": 0})
+                m.update(fields)
+            r = {"type": "block", "block": r["block"], "diag": r["diag"], "meas": [dict(m) for m in known.values()],
+                 "delta": True, "stale": stale}
+        r["bytes"] = flen
+        reports.append(r)
+    return reports, lost
+
+
+def to_json(r):
+    """the line of RFORMAT 0 for the same report, without its CR LF; the data of SP1 is not in the binary frames"""
+    if r["type"] == "stopped":
+        return '{{"Session Stopped":"{}"}}'.format(STOPPED_REASONS.get(r["reason"], "Unknown"))
+
+    if r["type"] == "aggr":
+        out = []
+        for a in r["aggr"]:
+            s = '{{"Addr":"0x{:04x}","Ok":{},"Err":{}'.format(a["addr"], a["ok"], a["err"])
+            if a["ok"]:
+                s += ',"D_cm":{},"D_min_cm":{},"D_max_cm":{},"D_std_cm":{:.1f},"LAoA_deg":{}'.format(
+                    int(a["d_mean_mm"] / 10), int(a["d_min_mm"] / 10), int(a["d_max_mm"] / 10),
+                    a["d_std_mm_x10"] / 100.0, fmt_q16_deg(a["aoa_2pi"]))
+            out.append(s + "}")
+        return '{{"Block":{}, "Blocks":{}, "aggr":[{}]}}'.format(r["block"], r["blocks"], ",".join(out))
+
+    out = []
+    for m in r["meas"]:
+        s = '{{"Addr":"0x{:04x}","Status":"{}"'.format(m["addr"], "Err" if m["status"] else "Ok")
+        if m["status"] == 0:
+            s += ',"D_cm":{},"LPDoA_deg":{},"LAoA_deg":{},"LFoM":{},"RAoA_deg":{},"CFO_100ppm":{}'.format(
+                int(m["distance_mm"] / 10), fmt_q16_deg(m["pdoa_2pi"]), fmt_q16_deg(m["aoa_2pi"]), m["fom"],
+                fmt_q16_deg(m["remote_aoa_2pi"]), m["cfo_100ppm"])
+        out.append(s + "}")
+    s = '{{"Block":{}, "results":[{}]'.format(r["block"], ",".join(out))
+    if r["diag"]:
+        rssi = r["diag"]["rssi_dbm_x10"]
+        s += ',"RSSI_dBm":{}'.format('"Invalid"' if rssi == RSSI_INVALID else '"{:.1f}"'.format(rssi / 10.0))
+        s += ',"NLOS_%":{}'.format(r["diag"]["nlos_pct"])
+    return s + "}"
+
+
+def stats(reports, lost):
+    """bytes per report of every kind of frame, against the JSON lines of the same reports"""
+    lines = ["reports {} lost frames {}".format(len(reports), lost),
+             "{:<10}{:>8}{:>14}{:>14}{:>10}".format("frames", "n", "bytes/report", "JSON", "ratio")]
+    kinds = [("block", lambda r: r["type"] == "block" and not r.get("delta")),
+             ("delta", lambda r: r.get("delta", False)),
+             ("aggr", lambda r: r["type"] == "aggr"),
+             ("stopped", lambda r: r["type"] == "stopped"),
+             ("total", lambda r: True)]
+    for name, match in kinds:
+        sel = [r for r in reports if match(r)]
+        if not sel:
+            continue
+        n_bin = sum(r["bytes"] for r in sel)
+        n_json = sum(len(to_json(r)) + 2 for r in sel)
+        lines.append("{:<10}{:>8}{:>14.1f}{:>14.1f}{:>10.2f}".format(
+            name, len(sel), n_bin / len(sel), n_json / len(sel), n_bin / n_json))
+    return "\n".join(lines)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", help="bytes read from the port, '-' for stdin")
+    ap.add_argument("--stats", action="store_true", help="prints the bytes per report against JSON instead of the reports")
+    args = ap.parse_args()
+
+    data = sys.stdin.buffer.read() if args.capture == "-" else open(args.capture, "rb").read()
+    reports, lost = decode(data)
+
+    if args.stats:
+        print(stats(reports, lost))
+    else:
+        for r in reports:
+            print(to_json(r))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Tests of capture_pcapng.py, run by make -C Tests or with:
+
+  cd Tools && python3 -m unittest test_capture_pcapng
+"""
+
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import capture_pcapng as cp
+from test_trace_decode import TRACE_FRAME, frame
+
+# REPORT_BIN_TYPE_FRAME frames written by report_bin_frame() of report_bin.c at 64 cycles per us:
+# a frame received with STS and diagnostics, then an immediate TX after the wrap of the cycle counter
+RX_FRAME = bytes.fromhex("b501060118004000c0ffffff9a7856341206ffc9fc01000500418801cade8cc5")
+TX_FRAME = bytes.fromhex("b50106021600400080000000000000000000000080ff01030002000112de")
+
+RX = {"cpu": 64, "cycles": 0xFFFFFFC0, "rctu": 0x123456789A, "cfo": -250, "rssi": -823, "sts": 1, "flags": 0,
+      "len": 5, "data": bytes.fromhex("418801cade")}
+TX = {"cpu": 64, "cycles": 0x80, "rctu": 0, "cfo": 0, "rssi": cp.RSSI_INVALID, "sts": cp.STS_UNKNOWN,
+      "flags": cp.FLAG_TX, "len": 3, "data": bytes.fromhex("020001")}
+
+
+def capture_frame(f, seq=0):
+    """a REPORT_BIN_TYPE_FRAME frame of the fields of parse()"""
+    payload = struct.pack("<HIIBhhBBH", f["cpu"], f["cycles"], f["rctu"] & 0xFFFFFFFF, f["rctu"] >> 32, f["cfo"],
+                          f["rssi"], f["sts"], f["flags"], f["len"]) + f["data"]
+    return frame(cp.REPORT_BIN_TYPE_FRAME, payload, seq)
+
+
+def blocks(data):
+    """(type, body) of every block of a pcapng file, checking both lengths of each"""
+    out = []
+    i = 0
+    while i < len(data):
+        btype, n = struct.unpack_from("<II", data, i)
+        assert n % 4 == 0 and struct.unpack_from("<I", data, i + n - 4)[0] == n
+        out.append((btype, data[i + 8:i + n - 4]))
+        i += n
+    return out
+
+
+def options(body):
+    """{code: value} of the options of a block body"""
+    out = {}
+    i = 0
+    while i < len(body):
+        code, n = struct.unpack_from("<HH", body, i)
+        if code == 0:
+            break
+        out[code] = body[i + 4:i + 4 + n]
+        i += 4 + n + (-n % 4)
+    return out
+
+
+def packets(data):
+    """(timestamp ns, captured bytes, original length, comment) of every enhanced packet block"""
+    out = []
+    for btype, body in blocks(data):
+        if btype == 6:
+            _, hi, lo, caplen, origlen = struct.unpack_from("<IIIII", body, 0)
+            pkt = body[20:20 + caplen]
+            opts = options(body[20 + caplen + (-caplen % 4):])
+            out.append(((hi << 32) | lo, pkt, origlen, opts[1].decode()))
+    return out
+
+
+class ParseTest(unittest.TestCase):
+    def test_golden(self):
+        self.assertEqual(list(cp.parse(RX_FRAME + TX_FRAME)), [RX, TX])
+
+    def test_encoder(self):
+        self.assertEqual(capture_frame(RX, seq=1), RX_FRAME)
+        self.assertEqual(capture_frame(TX, seq=2), TX_FRAME)
+
+    def test_stream(self):
+        # console text, trace frames and a frame cut by the end of the capture around the captured frames
+        data = b"JS0010{}\r\n" + TRACE_FRAME + RX_FRAME + b"\xb5" + TRACE_FRAME + TX_FRAME + RX_FRAME[:20]
+        self.assertEqual(list(cp.parse(data)), [RX, TX])
+
+    def test_short_payload(self):
+        self.assertEqual(list(cp.parse(frame(cp.REPORT_BIN_TYPE_FRAME, bytes(cp.FRAME_HDR_LEN - 1)))), [])
+
+
+class CommentTest(unittest.TestCase):
+    def test_rx(self):
+        self.assertEqual(cp.comment(RX), "RX rmarker_rctu=0x123456789a sts=SP1 cfo=-2.50ppm rssi=-82.3dBm")
+
+    def test_tx_immediate(self):
+        self.assertEqual(cp.comment(TX), "TX immediate")
+
+    def test_tx_delayed(self):
+        f = dict(TX, flags=cp.FLAG_TX | cp.FLAG_DELAYED, rctu=0x100, sts=3)
+        self.assertEqual(cp.comment(f), "TX rmarker_rctu=0x0000000100 sts=SP3")
+
+    def test_no_data_cut(self):
+        f = dict(RX, flags=cp.FLAG_ND, sts=3, rssi=cp.RSSI_INVALID)
+        self.assertEqual(cp.comment(f), "RX rmarker_rctu=0x123456789a sts=SP3 no_data cfo=-2.50ppm")
+        self.assertTrue(cp.comment(dict(RX, flags=cp.FLAG_CUT)).endswith(" cut"))
+
+
+class PcapngTest(unittest.TestCase):
+    def test_headers(self):
+        out, n = cp.pcapng([], 0)
+        self.assertEqual(n, 0)
+        (shb_type, shb), (idb_type, idb) = blocks(out)
+        self.assertEqual((shb_type, struct.unpack_from("<IHH", shb, 0)), (0x0A0D0D0A, (0x1A2B3C4D, 1, 0)))
+        self.assertEqual((idb_type, struct.unpack_from("<H", idb, 0)[0]), (1, cp.LINKTYPE_IEEE802_15_4_NOFCS))
+        # the timestamps in ns
+        self.assertEqual(options(idb[8:])[9], bytes([9]))
+
+    def test_packets(self):
+        epoch = 1700000000 * 10**9
+        out, n = cp.pcapng(cp.parse(RX_FRAME + TX_FRAME), epoch)
+        self.assertEqual(n, 2)
+        # 0xC0 cycles across the wrap of the counter, 3 us
+        self.assertEqual(packets(out), [
+            (epoch, RX["data"], 5, cp.comment(RX)),
+            (epoch + 3000, TX["data"], 3, cp.comment(TX)),
+        ])
+
+    def test_cut_and_no_data(self):
+        cut = dict(RX, flags=cp.FLAG_CUT, len=200, data=bytes(range(125)))
+        nd = dict(RX, flags=cp.FLAG_ND, len=20, data=b"", cycles=(RX["cycles"] + 64 * 10**6) & 0xFFFFFFFF)
+        out, _ = cp.pcapng(cp.parse(capture_frame(cut) + capture_frame(nd)), 0)
+        (t0, p0, len0, _), (t1, p1, len1, c1) = packets(out)
+        self.assertEqual((p0, len0), (cut["data"], 200))
+        self.assertEqual((t1, p1, len1), (10**9, b"", 20))
+        self.assertIn("no_data", c1)
+
+    def test_cli(self):
+        with tempfile.TemporaryDirectory() as d:
+            path = os.path.join(d, "out.pcapng")
+            p = subprocess.run([sys.executable, cp.__file__, "-", path, "--epoch", "1.5"],
+                               input=RX_FRAME + TX_FRAME, stdout=subprocess.PIPE, check=True)
+            self.assertEqual(p.stdout.decode().strip(), "2 frames")
+            with open(path, "rb") as f:
+                self.assertEqual([t for t, _, _, _ in packets(f.read())], [1500000000, 1500003000])
+
+
+if __name__ == "__main__":
+    unittest.main()
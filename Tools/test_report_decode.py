@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Tests of report_decode.py, run by make -C Tests or with:
+
+  cd Tools && python3 -m unittest test_report_decode
+"""
+
+import struct
+import subprocess
+import sys
+import unittest
+
+import report_decode as rd
+from test_trace_decode import TRACE_FRAME, frame
+
+# the output of fira_report.c for the same session in RFORMAT 0, 1 and 2: block 7 with 0x1001 Ok and 0x1002
+# in error, block 8 with 0x1001 50 mm further, then the stop request; and AGGR 2 over blocks 7 and 8 in RFORMAT 0 and 1
+JSON_7 = ('{"Block":7, "results":[{"Addr":"0x1001","Status":"Ok","D_cm":123,"LPDoA_deg":-5.49,"LAoA_deg":13.73,'
+          '"LFoM":87,"RAoA_deg":-65.92,"CFO_100ppm":-431},{"Addr":"0x1002","Status":"Err"}]}')
+JSON_8 = JSON_7.replace('"Block":7', '"Block":8').replace('"D_cm":123', '"D_cm":128')
+JSON_STOP = '{"Session Stopped":"Stop request"}'
+JSON_AGGR = ('{"Block":7, "Blocks":2, "aggr":[{"Addr":"0x1001","Ok":2,"Err":0,"D_cm":125,"D_min_cm":123,"D_max_cm":128,'
+             '"D_std_cm":2.5,"LAoA_deg":13.73},{"Addr":"0x1002","Ok":0,"Err":2}]}')
+
+BIN_7 = bytes.fromhex("b5010100260007000000020001100057d204000018fcc40920d151fe021001000000000000000000000000004595")
+BIN_8 = bytes.fromhex("b50101012600080000000200011000570405000018fcc40920d151fe021001000000000000000000000000007863")
+BIN_STOP = bytes.fromhex("b5010202010000fdd1")
+DELTA_7 = bytes.fromhex("b5010403280007000000020201107f0057d204000018fcc40920d151fe02107f0100000000000000000000000000f1e1")
+DELTA_8 = bytes.fromhex("b50104040d0008000000010001100404050000c6c8")
+DELTA_STOP = bytes.fromhex("b5010205010000dc86")
+BIN_AGGR = bytes.fromhex("b501030634000700000002000200011002000000c409eb040000d204000004050000fa00021000000200000000"
+                         "0000000000000000000000000064a2")
+
+MEAS_7 = {"addr": 0x1001, "status": 0, "fom": 87, "distance_mm": 1234, "pdoa_2pi": -1000, "aoa_2pi": 2500,
+          "remote_aoa_2pi": -12000, "cfo_100ppm": -431}
+
+
+def renumber(data, seq):
+    """the frame with another sequence number"""
+    return frame(data[2], data[6:-2], seq)
+
+
+class FormatTest(unittest.TestCase):
+    def test_q16_deg(self):
+        self.assertAlmostEqual(rd.q16_deg(-16384), -90.0)
+        self.assertEqual(rd.fmt_q16_deg(2500), "13.73")
+        self.assertEqual(rd.fmt_q16_deg(-12000), "-65.92")
+        self.assertEqual(rd.fmt_q16_deg(-32768), "-180.00")
+        self.assertEqual(rd.fmt_q16_deg(0), "0.00")
+
+
+class BinTest(unittest.TestCase):
+    def test_block(self):
+        reports, lost = rd.decode(BIN_7)
+        self.assertEqual(lost, 0)
+        self.assertEqual(reports[0]["meas"][0], MEAS_7)
+        self.assertEqual(reports[0]["bytes"], len(BIN_7))
+
+    def test_same_as_json(self):
+        reports, lost = rd.decode(BIN_7 + BIN_8 + BIN_STOP)
+        self.assertEqual([rd.to_json(r) for r in reports], [JSON_7, JSON_8, JSON_STOP])
+        self.assertEqual(lost, 0)
+
+    def test_aggr(self):
+        reports, _ = rd.decode(BIN_AGGR)
+        self.assertEqual([rd.to_json(r) for r in reports], [JSON_AGGR])
+
+    def test_diag(self):
+        payload = struct.pack("<IBBhBB", 7, 0, rd.FLAG_DIAG, -823, 5, 0)
+        r, = rd.decode(frame(rd.REPORT_BIN_TYPE_BLOCK, payload))[0]
+        self.assertEqual(rd.to_json(r), '{"Block":7, "results":[],"RSSI_dBm":"-82.3","NLOS_%":5}')
+        payload = struct.pack("<IBBhBB", 7, 0, rd.FLAG_DIAG, rd.RSSI_INVALID, 0, 0)
+        r, = rd.decode(frame(rd.REPORT_BIN_TYPE_BLOCK, payload))[0]
+        self.assertIn('"RSSI_dBm":"Invalid"', rd.to_json(r))
+
+    def test_stream(self):
+        # console text, a trace frame, a frame with a bad CRC, a block of a wrong length and a frame cut by the end
+        bad = bytearray(BIN_8)
+        bad[10] ^= 1
+        short = frame(rd.REPORT_BIN_TYPE_BLOCK, BIN_7[6:-3], seq=2)
+        data = b"JS0010{}\r\n" + BIN_7 + TRACE_FRAME + bytes(bad) + short + BIN_STOP + BIN_8[:20]
+        reports, _ = rd.decode(data)
+        self.assertEqual([r["type"] for r in reports], ["block", "stopped"])
+
+
+class DeltaTest(unittest.TestCase):
+    def test_same_as_json(self):
+        # the second frame carries only the distance of 0x1001, the block has both responders
+        reports, lost = rd.decode(DELTA_7 + DELTA_8 + DELTA_STOP)
+        self.assertEqual([rd.to_json(r) for r in reports], [JSON_7, JSON_8, JSON_STOP])
+        self.assertEqual(lost, 0)
+        self.assertEqual([r.get("stale") for r in reports], [False, False, None])
+
+    def test_lost(self):
+        # the values are stale before the first keyframe, and after a frame lost until the next one
+        reports, lost = rd.decode(renumber(DELTA_8, 1) + DELTA_7 + renumber(DELTA_8, 5))
+        self.assertEqual(lost, 1 + 1)
+        self.assertEqual([r["stale"] for r in reports], [True, False, True])
+
+
+class StatsTest(unittest.TestCase):
+    def test_bytes_per_block(self):
+        data = b"".join(renumber(f, seq) for seq, f in enumerate([BIN_7, BIN_8, DELTA_7, DELTA_8, BIN_AGGR]))
+        lines = rd.stats(*rd.decode(data)).splitlines()
+        self.assertEqual(lines[0], "reports 5 lost frames 0")
+        rows = {l.split()[0]: l.split()[1:] for l in lines[2:]}
+        json_block = (len(JSON_7) + 2 + len(JSON_8) + 2) / 2.0
+        self.assertEqual(rows["block"], ["2", "{:.1f}".format(len(BIN_7)), "{:.1f}".format(json_block),
+                                         "{:.2f}".format(len(BIN_7) / json_block)])
+        self.assertEqual(rows["delta"][1], "{:.1f}".format((len(DELTA_7) + len(DELTA_8)) / 2.0))
+        self.assertEqual(rows["aggr"][2], "{:.1f}".format(len(JSON_AGGR) + 2))
+        self.assertEqual(rows["total"][0], "5")
+
+    def test_cli(self):
+        p = subprocess.run([sys.executable, rd.__file__, "-"], input=b"noise" + BIN_7 + BIN_STOP,
+                           stdout=subprocess.PIPE, check=True)
+        self.assertEqual(p.stdout.decode().splitlines(), [JSON_7, JSON_STOP])
+        p = subprocess.run([sys.executable, rd.__file__, "-", "--stats"], input=BIN_7,
+                           stdout=subprocess.PIPE, check=True)
+        self.assertTrue(p.stdout.decode().splitlines()[-1].startswith("total"))
+
+
+if __name__ == "__main__":
+    unittest.main()
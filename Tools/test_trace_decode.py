@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Tests of trace_decode.py, run by make -C Tests or with:
+
+  cd Tools && python3 -m unittest test_trace_decode
+"""
+
+import struct
+import subprocess
+import sys
+import unittest
+
+import trace_decode as td
+
+# a REPORT_BIN_TYPE_TRACE frame written by report_bin_trace_begin(), report_bin_trace_add() and report_bin_end()
+# of report_bin.c at 64 cycles per us: the cycle counter wraps after the first two records, the index after
+# the second, two records are lost after the third
+TRACE_FRAME = bytes.fromhex(
+    "b501050058004000070000"
+    "ffffff000000000142feff"
+    "40ffffff000000000269ffff"
+    "400000000300000003420000"
+    "800000000000000004690300"
+    "000100000000000003450400"
+    "000200000000000007690500"
+    "000400000000000008420600"
+    "6bb7")
+
+TRACE_RECORDS = [
+    (0xFFFFFF00, 0, 1, "B", 0xFFFE),
+    (0xFFFFFF40, 0, 2, "i", 0xFFFF),
+    (0x00000040, 3, 3, "B", 0x0000),
+    (0x00000080, 0, 4, "i", 0x0003),
+    (0x00000100, 0, 3, "E", 0x0004),
+    (0x00000200, 0, 7, "i", 0x0005),
+    (0x00000400, 0, 8, "B", 0x0006),
+]
+
+
+def frame(ftype, payload, seq=0):
+    """a report_bin frame as written by report_bin_end()"""
+    f = struct.pack("<BBBBH", td.REPORT_BIN_SYNC, td.REPORT_BIN_VERSION, ftype, seq, len(payload)) + payload
+    return f + struct.pack(">H", td.crc16(f))
+
+
+def trace_frame(cpu, recs, seq=0):
+    payload = struct.pack("<HBB", cpu, len(recs), 0)
+    for cycles, arg, rid, ph, s in recs:
+        payload += struct.pack("<IIBBH", cycles, arg, rid, ord(ph), s)
+    return frame(td.REPORT_BIN_TYPE_TRACE, payload, seq)
+
+
+class Crc16Test(unittest.TestCase):
+    def test_check_value(self):
+        # calc_crc16() of crc16.c on "123456789"
+        self.assertEqual(td.crc16(b"123456789"), 0x8921)
+
+    def test_golden_frame(self):
+        self.assertEqual(td.crc16(TRACE_FRAME[:-2]), struct.unpack(">H", TRACE_FRAME[-2:])[0])
+
+
+class FramesTest(unittest.TestCase):
+    def test_golden(self):
+        self.assertEqual(list(td.parse_frames(TRACE_FRAME)), [(64, TRACE_RECORDS)])
+
+    def test_encoder(self):
+        self.assertEqual(trace_frame(64, TRACE_RECORDS), TRACE_FRAME)
+
+    def test_resync(self):
+        # text of the console, a frame with a bad CRC, a frame of another type, a frame cut by the end of the capture
+        bad = bytearray(TRACE_FRAME)
+        bad[10] ^= 1
+        other = frame(td.REPORT_BIN_TYPE_TRACE + 1, TRACE_FRAME[6:-2])
+        data = (b"JS0042{\"ok\"}\r\n\xb5\x01" + bytes(bad) + TRACE_FRAME + other + b"\xb5\x01\x05" +
+                TRACE_FRAME + TRACE_FRAME[:40])
+        self.assertEqual(len(list(td.parse_frames(data))), 2)
+
+    def test_sync_in_payload(self):
+        # a record with the header bytes in its argument
+        recs = [(0x10, 0x0501B5B5, 1, "i", 0)]
+        data = trace_frame(64, recs) + trace_frame(64, recs)
+        self.assertEqual([r for _, r in td.parse_frames(data)], [recs, recs])
+
+    def test_count_mismatch(self):
+        payload = struct.pack("<HBB", 64, 2, 0) + struct.pack("<IIBBH", 0, 0, 1, ord("i"), 0)
+        self.assertEqual(list(td.parse_frames(frame(td.REPORT_BIN_TYPE_TRACE, payload))), [])
+
+    def test_empty(self):
+        self.assertEqual(list(td.parse_frames(b"")), [])
+        self.assertEqual(list(td.parse_frames(trace_frame(64, []))), [(64, [])])
+
+
+class DecodeTest(unittest.TestCase):
+    def test_unwrap_and_lost(self):
+        events, lost = td.decode(TRACE_FRAME)
+        self.assertEqual([e["t"] for e in events], [0, 1, 5, 6, 8, 12, 20])
+        self.assertEqual(lost, 2)
+
+    def test_across_frames(self):
+        # the time and the index go on from one frame to the next
+        data = trace_frame(64, TRACE_RECORDS[:3]) + trace_frame(64, TRACE_RECORDS[3:], seq=1)
+        self.assertEqual(td.decode(data), td.decode(TRACE_FRAME))
+
+    def test_stage_latencies(self):
+        events, _ = td.decode(TRACE_FRAME)
+        self.assertEqual(td.stage_latencies(events), {
+            "IRQ->RX_CB": [1],
+            "RX_CB->MCPS_RX": [4],
+            "MCPS_RX->RX_GET_FRAME": [1],
+            "RX_GET_FRAME->REPORT": [6],
+            "REPORT->FLUSH": [8],
+        })
+
+    def test_other_event_not_a_stage(self):
+        # the MCPS event of a TX done is not the MCPS_RX stage
+        recs = [(0, 0, 1, "B", 0), (64, 0, 2, "i", 1), (128, 1, 3, "B", 2), (192, 3, 3, "B", 3)]
+        events, _ = td.decode(trace_frame(64, recs))
+        self.assertEqual(td.stage_latencies(events)["RX_CB->MCPS_RX"], [2])
+
+    def test_durations(self):
+        events, _ = td.decode(TRACE_FRAME)
+        self.assertEqual(td.durations(events), {"MCPS_EVT": [3]})
+
+    def test_percentile(self):
+        v = list(range(100, 0, -1))
+        self.assertEqual(td.percentile(v, 50), 51)
+        self.assertEqual(td.percentile(v, 99), 99)
+        self.assertEqual(td.percentile(v, 100), 100)
+
+
+class OutputTest(unittest.TestCase):
+    def test_chrome(self):
+        events, _ = td.decode(TRACE_FRAME)
+        out = td.chrome(events)["traceEvents"]
+        self.assertEqual([e["name"] for e in out], ["IRQ", "RX_CB", "MCPS_EVT", "RX_GET_FRAME", "MCPS_EVT", "REPORT", "FLUSH"])
+        self.assertEqual(out[1], {"name": "RX_CB", "ph": "i", "ts": 1, "pid": 0, "tid": 2, "args": {"arg": 0}, "s": "t"})
+        self.assertNotIn("s", out[0])
+
+    def test_stats(self):
+        lines = td.stats(*td.decode(TRACE_FRAME)).splitlines()
+        self.assertEqual(lines[0], "records 7 lost 2")
+        self.assertEqual(len(lines), 2 + 5 + 1)
+        self.assertTrue(lines[-1].startswith("duration MCPS_EVT"))
+
+    def test_cli(self):
+        p = subprocess.run([sys.executable, td.__file__, "-"], input=b"noise" + TRACE_FRAME,
+                           stdout=subprocess.PIPE, check=True)
+        self.assertEqual(p.stdout.decode().splitlines()[0], "records 7 lost 2")
+
+
+if __name__ == "__main__":
+    unittest.main()
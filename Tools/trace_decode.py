@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""Decodes the tracepoints dumped by the TRACE command of a firmware built with TRACE_ENABLE.
+
+The input is the raw byte stream read from the port of the board, the REPORT_BIN_TYPE_TRACE
+frames are found in it by their sync byte and CRC, everything else is skipped.
+
+  trace_decode.py capture.bin --chrome trace.json   events for chrome://tracing or Perfetto
+  trace_decode.py capture.bin                       latency percentiles of the stages of a frame received
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+REPORT_BIN_SYNC = 0xB5
+REPORT_BIN_VERSION = 1
+REPORT_BIN_TYPE_TRACE = 5
+HDR_LEN = 6
+CRC_LEN = 2
+TRACE_HDR_LEN = 4
+TRACE_REC_LEN = 12
+
+# trace_id_e of trace.h
+TRACE_NAMES = {
+    1: "IRQ",
+    2: "RX_CB",
+    3: "MCPS_EVT",
+    4: "RX_GET_FRAME",
+    5: "TX_FRAME",
+    6: "LP_TIMER",
+    7: "REPORT",
+    8: "FLUSH",
+}
+
+# mcps_evt_e of mcps_event.h
+MCPS_EVT_RX = 3
+
+# stages of a frame received, from the IRQ to the transmission of the report:
+# (name, id, phase, argument or None for any)
+STAGES = [
+    ("IRQ", 1, "B", None),
+    ("RX_CB", 2, "i", None),
+    ("MCPS_RX", 3, "B", MCPS_EVT_RX),
+    ("RX_GET_FRAME", 4, "i", None),
+    ("REPORT", 7, "i", None),
+    ("FLUSH", 8, "B", None),
+]
+
+
+def crc16(data):
+    """calc_crc16() of crc16.c: CCITT polynomial on reflected bytes, each byte of the result reflected"""
+    def rev(b):
+        return int("{:08b}".format(b)[::-1], 2)
+
+    crc = 0
+    for b in data:
+        crc ^= rev(b) << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+        crc &= 0xFFFF
+    return (rev(crc >> 8) << 8) | rev(crc & 0xFF)
+
+
+def report_bin_frames(data, frame_type):
+    """yields the payload of every frame of the type with a valid CRC, in a stream of any bytes"""
+    i = 0
+    while True:
+        i = data.find(bytes([REPORT_BIN_SYNC, REPORT_BIN_VERSION, frame_type]), i)
+        if i < 0 or i + HDR_LEN > len(data):
+            return
+        (plen,) = struct.unpack_from("<H", data, i + 4)
+        end = i + HDR_LEN + plen
+        if end + CRC_LEN > len(data) or crc16(data[i:end]) != (data[end] << 8 | data[end + 1]):
+            i += 1
+            continue
+        yield data[i + HDR_LEN:end]
+        i = end + CRC_LEN
+
+
+def parse_frames(data):
+    """yields (cycles per us, records) of every valid trace frame,
+    a record being (cycles, arg, id, phase, seq)"""
+    for payload in report_bin_frames(data, REPORT_BIN_TYPE_TRACE):
+        if len(payload) < TRACE_HDR_LEN:
+            continue
+        cpu, n = struct.unpack_from("<HB", payload, 0)
+        if TRACE_HDR_LEN + n * TRACE_REC_LEN != len(payload):
+            continue
+        recs = []
+        for k in range(n):
+            cycles, arg, rid, ph, seq = struct.unpack_from("<IIBBH", payload, TRACE_HDR_LEN + k * TRACE_REC_LEN)
+            recs.append((cycles, arg, rid, chr(ph), seq))
+        yield cpu, recs
+
+
+def decode(data):
+    """the records of all the frames, with their time in microseconds from the first one;
+    the cycle counter wraps, it is unwrapped assuming less than a wrap between two records"""
+    events = []
+    lost = 0
+    last_cycles = last_seq = None
+    t = 0
+    for cpu, recs in parse_frames(data):
+        for cycles, arg, rid, ph, seq in recs:
+            if last_cycles is not None:
+                t += ((cycles - last_cycles) & 0xFFFFFFFF) / cpu
+                lost += (seq - last_seq - 1) & 0xFFFF
+            last_cycles, last_seq = cycles, seq
+            events.append({"t": t, "id": rid, "ph": ph, "arg": arg})
+    return events, lost
+
+
+def chrome(events):
+    out = []
+    for e in events:
+        name = TRACE_NAMES.get(e["id"], "ID{}".format(e["id"]))
+        ev = {"name": name, "ph": e["ph"], "ts": round(e["t"], 3), "pid": 0, "tid": e["id"], "args": {"arg": e["arg"]}}
+        if e["ph"] == "i":
+            ev["s"] = "t"
+        out.append(ev)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def percentile(values, p):
+    s = sorted(values)
+    return s[min(len(s) - 1, int(round(p / 100.0 * (len(s) - 1))))]
+
+
+def stage_latencies(events):
+    """microseconds from every stage to the next one of the same frame: the first occurrence of the
+    next stage after the stage, before the stage occurs again"""
+    def match(e, st):
+        return e["id"] == st[1] and e["ph"] == st[2] and (st[3] is None or e["arg"] == st[3])
+
+    res = {}
+    for a, b in zip(STAGES, STAGES[1:]):
+        lat = []
+        start = None
+        for e in events:
+            if match(e, a):
+                start = e["t"]
+            elif start is not None and match(e, b):
+                lat.append(e["t"] - start)
+                start = None
+        res["{}->{}".format(a[0], b[0])] = lat
+    return res
+
+
+def durations(events):
+    """microseconds between every begin and its end, per id"""
+    res = {}
+    open_at = {}
+    for e in events:
+        if e["ph"] == "B":
+            open_at[e["id"]] = e["t"]
+        elif e["ph"] == "E" and e["id"] in open_at:
+            res.setdefault(TRACE_NAMES.get(e["id"], "ID{}".format(e["id"])), []).append(e["t"] - open_at.pop(e["id"]))
+    return res
+
+
+def stats(events, lost):
+    lines = ["records {} lost {}".format(len(events), lost), "{:<28}{:>8}{:>10}{:>10}{:>10}{:>10}".format(
+        "us", "n", "p50", "p90", "p99", "max")]
+    for title, table in (("latency", stage_latencies(events)), ("duration", durations(events))):
+        for name, v in table.items():
+            if v:
+                lines.append("{:<28}{:>8}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}".format(
+                    "{} {}".format(title, name), len(v), percentile(v, 50), percentile(v, 90), percentile(v, 99), max(v)))
+    return "\n".join(lines)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", help="bytes read from the port, '-' for stdin")
+    ap.add_argument("--chrome", metavar="FILE", help="writes the Chrome trace JSON to FILE instead of the statistics")
+    args = ap.parse_args()
+
+    data = sys.stdin.buffer.read() if args.capture == "-" else open(args.capture, "rb").read()
+    events, lost = decode(data)
+
+    if args.chrome:
+        with open(args.chrome, "w") as f:
+            json.dump(chrome(events), f)
+    else:
+        print(stats(events, lost))
+
+
+if __name__ == "__main__":
+    main()